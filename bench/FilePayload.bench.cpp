@@ -0,0 +1,142 @@
+/**
+ * Throughput of FilePayload over a loopback TCP connection, with sendfile
+ * and with the pread/send fallback.
+ *
+ * Usage: ./bench_FilePayload [max_size_in_bytes]
+ * The 1GB case is skipped when max_size_in_bytes is smaller.
+ */
+#include <arpa/inet.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <iomanip>
+#include <iostream>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "utils/Payload.hpp"
+#include "utils/socket.hpp"
+
+namespace {
+	struct Result {
+		double seconds;
+		std::size_t iterations;
+	};
+
+	std::filesystem::path createFile(std::size_t size) {
+		std::filesystem::path path = std::filesystem::temp_directory_path() / ("webserv_bench_" + std::to_string(size));
+		int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+		std::vector<char> block(1024 * 1024);
+
+		for (std::size_t i = 0; i < block.size(); i++) {
+			block[i] = static_cast<char>('a' + i % 26);
+		}
+
+		for (std::size_t written = 0; written < size;) {
+			const std::size_t chunk = std::min(block.size(), size - written);
+			written += static_cast<std::size_t>(::write(fd, block.data(), chunk));
+		}
+
+		::close(fd);
+		return path;
+	}
+
+	void connectPair(int& sender, int& receiver) {
+		int listener = utils::createPassiveSocket("127.0.0.1", 0, 1, false);
+		sockaddr_in address {};
+		socklen_t addressLength = sizeof(address);
+
+		::getsockname(listener, reinterpret_cast<sockaddr*>(&address), &addressLength);
+		receiver = ::socket(AF_INET, SOCK_STREAM, 0);
+		::connect(receiver, reinterpret_cast<sockaddr*>(&address), addressLength);
+		sender = ::accept(listener, nullptr, nullptr);
+		utils::setNonBlocking(sender);
+		::close(listener);
+	}
+
+	Result run(const std::filesystem::path& path, std::size_t size, bool sendfile) {
+		int sender;
+		int receiver;
+
+		connectPair(sender, receiver);
+
+		std::thread drain([receiver, size]() {
+			std::vector<char> buffer(1024 * 1024);
+
+			for (std::size_t received = 0; received < size;) {
+				const ssize_t bytes = ::recv(receiver, buffer.data(), buffer.size(), 0);
+
+				if (bytes <= 0) {
+					break;
+				}
+
+				received += static_cast<std::size_t>(bytes);
+			}
+		});
+
+		utils::FilePayload payload(path);
+		payload.useSendfile(sendfile);
+
+		Result result { 0, 0 };
+		pollfd pfd { sender, POLLOUT, 0 };
+		auto start = std::chrono::steady_clock::now();
+
+		while (!payload.isSent()) {
+			::poll(&pfd, 1, -1);
+			payload.send(sender);
+			result.iterations++;
+		}
+
+		drain.join();
+		result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		::close(sender);
+		::close(receiver);
+		return result;
+	}
+}
+
+int main(int argc, char** argv) {
+	const std::size_t maxSize = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 1024ULL * 1024 * 1024;
+	const std::vector<std::size_t> sizes { 1024, 1024 * 1024, 1024ULL * 1024 * 1024 };
+
+	std::cout
+		<< std::left << std::setw(12) << "size"
+		<< std::setw(12) << "mode"
+		<< std::setw(14) << "MB/s"
+		<< "loop iterations" << std::endl;
+
+	for (const std::size_t size : sizes) {
+		if (size > maxSize) {
+			continue;
+		}
+
+		auto path = createFile(size);
+		const int repeat = (size < 1024 * 1024) ? 1000 : (size < 1024 * 1024 * 1024) ? 20 : 1;
+
+		for (const bool sendfile : { false, true }) {
+			Result total { 0, 0 };
+
+			for (int i = 0; i < repeat; i++) {
+				Result result = run(path, size, sendfile);
+				total.seconds += result.seconds;
+				total.iterations += result.iterations;
+			}
+
+			std::cout
+				<< std::left << std::setw(12) << size
+				<< std::setw(12) << (sendfile ? "sendfile" : "read/send")
+				<< std::setw(14) << std::fixed << std::setprecision(1)
+				<< (static_cast<double>(size) * repeat / (1024 * 1024)) / total.seconds
+				<< total.iterations / repeat << std::endl;
+		}
+
+		std::filesystem::remove(path);
+	}
+
+	return 0;
+}
@@ -0,0 +1,94 @@
+/**
+ * CPU cost against bytes saved of the on-the-fly gzip stage, per zlib
+ * level, for an HTML-like body and for incompressible data.
+ *
+ * Usage: ./bench_Gzip [body_size_in_bytes]
+ */
+#include <chrono>
+#include <cstdlib>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+
+#include "utils/Payload.hpp"
+
+namespace {
+	std::string createHtml(std::size_t size) {
+		std::string body("<html><head><title>Index</title></head><body><ul>\n");
+
+		for (std::size_t i = 0; body.size() < size; i++) {
+			body += "<li><a href=\"file_" + std::to_string(i) + ".txt\">file_" + std::to_string(i) + ".txt</a> "
+				+ std::to_string(i * 7919 % 100000) + " bytes</li>\n";
+		}
+
+		body.resize(size);
+		return body;
+	}
+
+	std::string createRandom(std::size_t size) {
+		std::mt19937 generator(42);
+		std::string body(size, '\0');
+
+		for (auto& c : body) {
+			c = static_cast<char>(generator());
+		}
+
+		return body;
+	}
+
+	// CPU time spent deflating the whole body, and the size of the result
+	std::pair<double, std::size_t> run(const std::string& body, int level) {
+		utils::GzipPayload payload(std::make_unique<utils::StringPayload>(body), level);
+		std::uint8_t buffer[16 * 1024];
+		std::size_t compressed = 0;
+		const std::clock_t start = std::clock();
+
+		while (!payload.isSent()) {
+			compressed += payload.read(buffer, sizeof(buffer));
+		}
+
+		return { static_cast<double>(std::clock() - start) / CLOCKS_PER_SEC, compressed };
+	}
+}
+
+int main(int argc, char** argv) {
+	const std::size_t size = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 4 * 1024 * 1024;
+	const std::pair<const char*, std::string> bodies[] = {
+		{ "html", createHtml(size) },
+		{ "random", createRandom(size) }
+	};
+
+	std::cout
+		<< std::left << std::setw(10) << "body"
+		<< std::setw(8) << "level"
+		<< std::setw(14) << "MB/s (CPU)"
+		<< std::setw(14) << "ratio"
+		<< "CPU ms per MB saved" << std::endl;
+
+	for (const auto& [name, body] : bodies) {
+		for (const int level : { 1, 3, 6, 9 }) {
+			const auto [seconds, compressed] = run(body, level);
+			const double megabytes = static_cast<double>(body.size()) / (1024 * 1024);
+			const double savedMegabytes = (static_cast<double>(body.size()) - static_cast<double>(compressed)) / (1024 * 1024);
+
+			std::cout
+				<< std::left << std::setw(10) << name
+				<< std::setw(8) << level
+				<< std::setw(14) << std::fixed << std::setprecision(1) << megabytes / seconds
+				<< std::setw(14) << std::setprecision(3) << static_cast<double>(compressed) / static_cast<double>(body.size());
+
+			if (savedMegabytes > 0) {
+				std::cout << std::setprecision(2) << seconds * 1000 / savedMegabytes;
+			} else {
+				std::cout << "-";
+			}
+
+			std::cout << std::endl;
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,101 @@
+/**
+ * Cost of serializing a typical response header: the former ostringstream
+ * over an unordered_map against Response::build(), which appends to a
+ * recycled buffer behind a precomputed status line and the cached Date.
+ *
+ * Usage: ./bench_HeaderSerializer [iterations]
+ */
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+
+#include "http/index.hpp"
+
+namespace {
+	const std::pair<http::Header, std::string> fields[] = {
+		{ http::Header::CONTENT_TYPE, "text/html; charset=utf-8" },
+		{ http::Header::CONTENT_LENGTH, "1061" },
+		{ http::Header::CACHE_CONTROL, "public, max-age=3600" },
+		{ http::Header::ETAG, "\"11e2c4-425-18dfcd99a1434743\"" },
+		{ http::Header::LAST_MODIFIED, "Mon, 19 Oct 2026 02:12:00 GMT" },
+		{ http::Header::ACCEPT_RANGES, "bytes" },
+		{ http::Header::VARY, "Accept-Encoding" },
+	};
+
+	// What Response::build() did before: a stream, a map walk and a formatted status line
+	std::string buildWithStream(const std::unordered_map<std::string, std::string>& headerFields) {
+		std::ostringstream ostream;
+
+		ostream
+			<< "HTTP/1.1 "
+			<< static_cast<std::uint16_t>(http::StatusCode::OK_200) << " "
+			<< http::stringOf(http::StatusCode::OK_200) << "\r\n";
+
+		for (const auto& [name, value] : headerFields) {
+			ostream << name << ": " << value << "\r\n";
+		}
+
+		ostream << "\r\n";
+		return ostream.str();
+	}
+
+	template <typename Function>
+	double nanosecondsPerCall(std::size_t iterations, Function function) {
+		std::size_t bytes = 0;
+		auto start = std::chrono::steady_clock::now();
+
+		for (std::size_t i = 0; i < iterations; i++) {
+			bytes += function();
+		}
+
+		const double elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+		if (bytes == 0) {
+			std::cerr << "nothing serialized" << std::endl;
+		}
+
+		return elapsed / static_cast<double>(iterations);
+	}
+}
+
+int main(int argc, char** argv) {
+	const std::size_t iterations = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+
+	std::unordered_map<std::string, std::string> headerFields;
+	http::Response response(-1);
+
+	for (const auto& [header, value] : fields) {
+		headerFields[http::stringOf(header)] = value;
+		response.setHeader(header, value);
+	}
+
+	response.setStatusCode(http::StatusCode::OK_200);
+
+	const double stream = nanosecondsPerCall(iterations, [&headerFields]() {
+		return buildWithStream(headerFields).size();
+	});
+
+	const double serializer = nanosecondsPerCall(iterations, [&response]() {
+		response.build();
+
+		// The connection hands the sent header back for the next response
+		std::string buffer = response.releaseHeaderBuffer();
+		const std::size_t size = buffer.size();
+
+		response.reuseHeaderBuffer(std::move(buffer));
+		return size;
+	});
+
+	std::cout
+		<< std::left << std::setw(14) << "serializer" << "ns/header" << std::endl
+		<< std::setw(14) << "ostringstream" << std::fixed << std::setprecision(1) << stream << std::endl
+		<< std::setw(14) << "Response" << serializer << std::endl
+		<< "speedup " << stream / serializer << "x" << std::endl;
+
+	return 0;
+}
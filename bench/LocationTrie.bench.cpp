@@ -0,0 +1,116 @@
+/**
+ * Location lookup with many locations per server: the former linear scan,
+ * which compares a substr of the request path against every location,
+ * against LocationTrie.
+ *
+ * Usage: ./bench_LocationTrie [locations] [lookups]
+ */
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "LocationTrie.hpp"
+
+namespace {
+	// What Router::findBestMatchingLocation() did before
+	std::size_t findLinear(const std::unordered_map<std::string, std::size_t>& locations, const std::string& url) {
+		std::size_t best = LocationTrie::NONE;
+		std::size_t longestMatch = 0;
+
+		for (const auto& [path, index] : locations) {
+			if (url.substr(0, path.size()) == path && path.length() > longestMatch) {
+				best = index;
+				longestMatch = path.length();
+			}
+		}
+
+		return best;
+	}
+
+	// Generated configs look like this: one location per service, version and area
+	std::vector<std::string> makeLocations(std::size_t count) {
+		std::vector<std::string> paths { "/" };
+
+		for (std::size_t i = 0; paths.size() < count; i++) {
+			const std::string service = "/service-" + std::to_string(i / 20) + "/";
+			const std::string version = service + "v" + std::to_string(i % 4) + "/";
+
+			paths.push_back(version + "area-" + std::to_string(i % 20) + "/");
+
+			if (i % 20 == 0) {
+				paths.push_back(service);
+			}
+		}
+
+		paths.resize(count);
+		return paths;
+	}
+
+	template <typename Function>
+	double nanosecondsPerLookup(const std::vector<std::string>& urls, std::size_t lookups, Function function) {
+		std::size_t found = 0;
+		auto start = std::chrono::steady_clock::now();
+
+		for (std::size_t i = 0; i < lookups; i++) {
+			found += function(urls[i % urls.size()]) != LocationTrie::NONE;
+		}
+
+		const double elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+		if (found == 0) {
+			std::cerr << "nothing matched" << std::endl;
+		}
+
+		return elapsed / static_cast<double>(lookups);
+	}
+}
+
+int main(int argc, char** argv) {
+	const std::size_t count = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 10000;
+	const std::size_t lookups = (argc > 2) ? std::strtoull(argv[2], nullptr, 10) : 100000;
+
+	const std::vector<std::string> paths = makeLocations(count);
+	std::unordered_map<std::string, std::size_t> locations;
+	LocationTrie trie;
+
+	for (std::size_t i = 0; i < paths.size(); i++) {
+		locations[paths[i]] = i;
+		trie.insert(paths[i], i);
+	}
+
+	std::mt19937 random(42);
+	std::vector<std::string> urls;
+
+	for (std::size_t i = 0; i < 1024; i++) {
+		urls.push_back(paths[random() % paths.size()] + "assets/app." + std::to_string(i) + ".js");
+	}
+
+	for (const auto& url : urls) {
+		if (findLinear(locations, url) != trie.find(url)) {
+			std::cerr << "mismatch for " << url << std::endl;
+			return 1;
+		}
+	}
+
+	const double linear = nanosecondsPerLookup(urls, lookups / 100 + 1, [&locations](const std::string& url) {
+		return findLinear(locations, url);
+	});
+
+	const double radix = nanosecondsPerLookup(urls, lookups, [&trie](const std::string& url) {
+		return trie.find(url);
+	});
+
+	std::cout
+		<< count << " locations" << std::endl
+		<< std::left << std::setw(14) << "matcher" << "ns/lookup" << std::endl
+		<< std::setw(14) << "linear scan" << std::fixed << std::setprecision(1) << linear << std::endl
+		<< std::setw(14) << "radix trie" << radix << std::endl
+		<< "speedup " << linear / radix << "x" << std::endl;
+
+	return 0;
+}
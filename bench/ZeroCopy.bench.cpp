@@ -0,0 +1,180 @@
+/**
+ * Throughput of an in-memory body sent over a loopback TCP connection
+ * with plain sendmsg and with MSG_ZEROCOPY, including the error queue
+ * completions that have to be read before the body may be freed.
+ *
+ * On loopback the kernel copies anyway and flags the completions with
+ * SO_EE_CODE_ZEROCOPY_COPIED, the "copied" column counts them.
+ *
+ * Usage: ./bench_ZeroCopy [max_size_in_bytes]
+ */
+#include <algorithm>
+#include <arpa/inet.h>
+#include <array>
+#include <chrono>
+#include <climits>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <linux/errqueue.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "utils/Payload.hpp"
+#include "utils/socket.hpp"
+
+namespace {
+	struct Result {
+		double seconds;
+		std::size_t sends;
+		std::size_t copied;
+	};
+
+	void connectPair(int& sender, int& receiver) {
+		int listener = utils::createPassiveSocket("127.0.0.1", 0, 1, false);
+		sockaddr_in address {};
+		socklen_t addressLength = sizeof(address);
+
+		::getsockname(listener, reinterpret_cast<sockaddr*>(&address), &addressLength);
+		receiver = ::socket(AF_INET, SOCK_STREAM, 0);
+		::connect(receiver, reinterpret_cast<sockaddr*>(&address), addressLength);
+		sender = ::accept(listener, nullptr, nullptr);
+		utils::setNonBlocking(sender);
+		::close(listener);
+	}
+
+	// Returns the number of sends completed, counting the ones the kernel copied in `copied`
+	std::size_t readCompletions(int fd, std::size_t& copied) {
+		std::size_t completed = 0;
+
+		while (true) {
+			char control[CMSG_SPACE(sizeof(struct sock_extended_err)) * 4];
+			struct msghdr message {};
+			message.msg_control = control;
+			message.msg_controllen = sizeof(control);
+
+			if (::recvmsg(fd, &message, MSG_ERRQUEUE) == -1) {
+				return completed;
+			}
+
+			for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&message); cmsg != nullptr; cmsg = CMSG_NXTHDR(&message, cmsg)) {
+				const auto* error = reinterpret_cast<const struct sock_extended_err*>(CMSG_DATA(cmsg));
+
+				if (error->ee_origin != SO_EE_ORIGIN_ZEROCOPY) {
+					continue;
+				}
+
+				const std::size_t count = error->ee_data - error->ee_info + 1;
+
+				completed += count;
+				copied += (error->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) ? count : 0;
+			}
+		}
+	}
+
+	Result run(const std::string& body, bool zeroCopy) {
+		int sender;
+		int receiver;
+
+		connectPair(sender, receiver);
+
+		if (zeroCopy) {
+			const int enabled = 1;
+			::setsockopt(sender, SOL_SOCKET, SO_ZEROCOPY, &enabled, sizeof(enabled));
+		}
+
+		const std::size_t size = body.size();
+		std::thread drain([receiver, size]() {
+			std::vector<char> buffer(1024 * 1024);
+
+			for (std::size_t received = 0; received < size;) {
+				const ssize_t bytes = ::recv(receiver, buffer.data(), buffer.size(), 0);
+
+				if (bytes <= 0) {
+					break;
+				}
+
+				received += static_cast<std::size_t>(bytes);
+			}
+		});
+
+		utils::StringPayload payload(body);
+		std::array<struct iovec, IOV_MAX> iov;
+		Result result { 0, 0, 0 };
+		std::size_t completed = 0;
+		pollfd pfd { sender, POLLOUT, 0 };
+		auto start = std::chrono::steady_clock::now();
+
+		// The body may only be released once every zerocopy send has completed
+		while (!payload.isSent() || completed < result.sends) {
+			pfd.events = payload.isSent() ? 0 : POLLOUT;
+			::poll(&pfd, 1, -1);
+
+			if (pfd.revents & POLLERR) {
+				completed += readCompletions(sender, result.copied);
+			}
+
+			if (payload.isSent() || !(pfd.revents & POLLOUT)) {
+				continue;
+			}
+
+			struct msghdr message {};
+			message.msg_iov = iov.data();
+			message.msg_iovlen = payload.peek(iov.data(), iov.size());
+
+			const ssize_t bytesSent = ::sendmsg(sender, &message, MSG_NOSIGNAL | (zeroCopy ? MSG_ZEROCOPY : 0));
+
+			if (bytesSent > 0) {
+				payload.commit(static_cast<std::size_t>(bytesSent));
+				result.sends += zeroCopy ? 1 : 0;
+			}
+		}
+
+		drain.join();
+		result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		::close(sender);
+		::close(receiver);
+		return result;
+	}
+}
+
+int main(int argc, char** argv) {
+	const std::size_t maxSize = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 16 * 1024 * 1024;
+
+	std::cout
+		<< std::left << std::setw(12) << "size"
+		<< std::setw(12) << "mode"
+		<< std::setw(14) << "MB/s"
+		<< std::setw(10) << "sends"
+		<< "copied" << std::endl;
+
+	for (std::size_t size = 64 * 1024; size <= maxSize; size *= 4) {
+		const std::string body(size, 'x');
+		const int repeat = static_cast<int>(std::max<std::size_t>(4, 256 * 1024 * 1024 / size / 4));
+
+		for (const bool zeroCopy : { false, true }) {
+			Result total { 0, 0, 0 };
+
+			for (int i = 0; i < repeat; i++) {
+				Result result = run(body, zeroCopy);
+				total.seconds += result.seconds;
+				total.sends += result.sends;
+				total.copied += result.copied;
+			}
+
+			std::cout
+				<< std::left << std::setw(12) << size
+				<< std::setw(12) << (zeroCopy ? "zerocopy" : "copy")
+				<< std::setw(14) << std::fixed << std::setprecision(1)
+				<< (static_cast<double>(size) * repeat / (1024 * 1024)) / total.seconds
+				<< std::setw(10) << total.sends / repeat
+				<< total.copied / repeat << std::endl;
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+/**
+ * Remembers whether a script path can be run as CGI: it exists, is a
+ * regular file and is executable by its owner. Missing scripts are
+ * remembered too, so a hot URL costs one hash lookup and no syscall.
+ *
+ * With inotify watching the location roots, a decision holds until
+ * `invalidate()` drops it. Without it, decisions are re-checked after the
+ * open file cache validity. The cache is disabled until `configure()` is
+ * called, in which case every call goes to the OpenFileCache.
+ */
+class CgiScriptCache {
+	public:
+		static CgiScriptCache& instance();
+
+		CgiScriptCache(const CgiScriptCache&) = delete;
+		CgiScriptCache& operator=(const CgiScriptCache&) = delete;
+
+		void configure(std::size_t maxEntries, std::chrono::seconds validity, bool isWatched);
+		void invalidate(const std::filesystem::path& path);
+
+		bool isRunnable(std::string_view scriptPath);
+		bool isEnabled() const;
+
+	private:
+		struct Entry {
+			bool isRunnable;
+			std::chrono::steady_clock::time_point validUntil;
+		};
+
+		// Lets find() take a string_view, so a lookup allocates nothing
+		struct Hash {
+			using is_transparent = void;
+
+			std::size_t operator()(std::string_view path) const {
+				return std::hash<std::string_view>()(path);
+			}
+		};
+
+		std::size_t _maxEntries { 0 };
+		std::chrono::seconds _validity { 0 };
+		bool _isWatched { false };
+		std::unordered_map<std::string, Entry, Hash, std::equal_to<>> _entries;
+
+		CgiScriptCache() = default;
+};
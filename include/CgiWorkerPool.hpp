@@ -0,0 +1,92 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+#include "Config.hpp"
+#include "http/index.hpp"
+
+/**
+ * Long-lived CGI interpreters of one location.
+ *
+ * Starting an interpreter costs more than most scripts take to run, so a
+ * location with `cgi_workers` keeps Python processes that run its scripts
+ * in a loop. Each is connected by a socketpair carrying frames of a type
+ * byte, a big-endian 32-bit length and the payload:
+ *
+ *   server -> worker  'P' NUL-separated NAME=value CGI variables, 'I' body
+ *                     bytes, an empty 'I' ends the request
+ *   worker -> server  'O' stdout bytes, an empty 'E' ends the response
+ *
+ * The server's end of the socketpair is non-blocking: `send()` queues the
+ * frames of a request and writes what the socket takes, the body a chunk
+ * at a time, and the loop polls the worker for POLLOUT while `hasOutput()`
+ * to `flush()` the rest.
+ *
+ * The pool starts `min` workers and grows up to `max`; extra workers retire
+ * once idle for `cgi_worker_timeout`. A worker is replaced after
+ * `cgi_worker_requests` requests, when it dies, or when a request runs
+ * longer than the timeout. When every worker is busy, `acquire()` returns
+ * null and the caller forks as usual.
+ *
+ * A worker that finished or failed keeps its descriptor until `update()`,
+ * which the loop calls after dropping the finished WorkerProcess entries,
+ * so a descriptor number is never reused while it is still polled.
+ */
+class CgiWorkerPool {
+	public:
+		static constexpr const char* INTERPRETER = "/usr/bin/python1";
+
+		enum class State { IDLE, BUSY, DONE, FAILED };
+
+		struct Worker {
+			pid_t pid { -1 };
+			int fd { -1 };
+			State state { State::IDLE };
+			std::size_t requestCount { 0 };
+			std::chrono::steady_clock::time_point since;	// Of the last state change
+			std::array<std::uint8_t, 5> header {};			// Of the frame being received
+			std::size_t headerSize { 0 };
+			std::size_t frameRemaining { 0 };
+			std::string output;								// Frames not written yet, from outputOffset
+			std::size_t outputOffset { 0 };
+			http::RequestBody body;							// Queued as stdin frames while the output drains
+			std::size_t bodySent { 0 };
+			bool isStdinDone { true };
+
+			bool hasOutput() const;
+		};
+
+		explicit CgiWorkerPool(const Location& location);
+
+		CgiWorkerPool(const CgiWorkerPool&) = delete;
+		CgiWorkerPool& operator=(const CgiWorkerPool&) = delete;
+
+		void start();
+		Worker* acquire();
+		bool send(Worker& worker, const http::Request& request, const std::string& scriptPath);
+		void flush(Worker& worker);
+		void receive(Worker& worker, short revents, http::Response& response);
+		void fail(Worker& worker);
+		bool isTimedOut(const Worker& worker, std::chrono::steady_clock::time_point now) const;
+		void update();
+		void shutdown();
+
+	private:
+		std::size_t _min;
+		std::size_t _max;
+		std::size_t _maxRequests;
+		std::chrono::seconds _timeout;
+		std::list<Worker> _workers;	// Handed out by address, so they never move
+		std::vector<pid_t> _exited;	// Terminated, not reaped yet
+
+		bool _spawn();
+		void _retire(std::list<Worker>::iterator it);
+		void _decode(Worker& worker, const std::uint8_t* data, std::size_t size, http::Response& response);
+};
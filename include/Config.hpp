@@ -1,9 +1,11 @@
 #pragma once
 
+#include <chrono>
 #include <functional>
 #include <string>
 #include <vector>
 #include <map>
+#include <optional>
 #include <filesystem>
 #include <iostream>
 #include <fstream>
@@ -17,21 +19,40 @@
 struct Location {
 	std::string path;						// Location path (/, /static/, /static/index.html, /cgi-bin)
 	std::filesystem::path root;				// Full path resolved during parsing
+	std::filesystem::path bundle;			// Archive made by ./bundle, served instead of the files below root
 	std::string index;						// Default index.html file
 	std::string autoIndex;
 	bool isAutoIndex = false;				// Enbale or disable directory listing
+	std::size_t autoIndexPageSize = 1000;	// Entries per page of a directory listing
 	std::vector<std::string> methods; 		// Allowed methods
 	std::vector<std::string> cgiExtension; 	// CGI extensions
 	std::vector<std::string> returnUrl; 	// Redirect URLs (if any)
+	std::optional<std::chrono::seconds> expires;	// Freshness lifetime of served files, unset means revalidate every time
+	bool isImmutable = false;				// Files never change under the same URL
+	bool isPrecompressed = false;			// Serve foo.css.br / foo.css.gz next to foo.css when the client accepts them
+	bool isGzip = false;					// Compress generated responses (CGI output, listings, text) on the fly
+	int gzipLevel = 1;						// zlib level, 1 is the cheapest
+	std::size_t gzipMinLength = 256;		// Smaller bodies are not worth a gzip header
+	std::vector<std::string> gzipTypes { "text/html", "text/plain", "text/css", "text/javascript", "application/json" };
+	std::size_t cgiWorkersMin = 0;			// Long-lived CGI interpreters kept ready, see CgiWorkerPool
+	std::size_t cgiWorkersMax = 0;			// 0 forks an interpreter per request
+	std::size_t cgiWorkerRequests = 1000;	// Requests a worker serves before it is replaced
+	std::chrono::seconds cgiWorkerTimeout { 30 };	// A longer request recycles its worker, idle extra workers retire after it
+	std::string fastCgiPass;				// "unix:/path" or "ip:port" of a FastCGI application running the scripts
+	std::size_t fastCgiConnections = 8;		// Persistent connections to it
 };
 
 struct ServerConfig {
 	std::string host;
 	std::vector<int> ports;
-	std::string serverName;
+	std::vector<std::string> serverNames;			// Matched against the Host header, may start or end with a wildcard
 	std::map<int, std::string> errorPages;
 	std::string clientMaxBodySizeStr;
 	size_t clientMaxBodySize = 10 * 1024 * 1024;	// 10MB
+	std::string clientBodyBufferSizeStr;
+	size_t clientBodyBufferSize = 16 * 1024;		// 16KB, larger bodies are stored in a temporary file
+	size_t zeroCopyMinSize = 64 * 1024;				// 64KB, larger in-memory bodies are sent with MSG_ZEROCOPY, 0 disables it
+	bool isReusePort = false;						// Every worker process binds its own listening sockets
 	std::vector<Location> locations;
 
 	std::size_t msRequestTimeout = 10000;			// Default: 10 seconds
@@ -44,6 +65,15 @@ struct ServerConfig {
 struct Config {
 	std::vector<int> ports;
 	std::vector<ServerConfig> servers;
+
+	std::size_t workerProcesses = 1;				// Processes accepting connections, more than one shares the file cache
+
+	size_t fileCacheSize = 16 * 1024 * 1024;		// 16MB, 0 disables the static file cache
+	size_t fileCacheMaxFileSize = 64 * 1024;		// 64KB, larger files are always streamed from disk
+	bool fileCachePrewarm = false;					// Load the location roots into the cache at startup
+	size_t openFileCacheSize = 256;					// Cached stat results and descriptors, 0 disables the cache
+	std::chrono::seconds openFileCacheValid { 60 };	// Entries are revalidated after this long
+	size_t missingPathCacheSize = 4096;				// Paths last found missing, answered with 404 without a stat, 0 disables the cache
 };
 
 // Define types for parsers
@@ -57,6 +87,7 @@ class ConfigParser {
 		ConfigParser(const std::string &path): filePath(path) {};
 
 		void parseHttpBlock(std::ifstream &file, Config &config);
+		void parseHttp(const std::string &line, Config &config);
 		void parseServerBlock(std::ifstream &file, ServerConfig &server);
 		void parseLocationBlock(std::ifstream &file, Location &location);
 		void parseConfig(const std::string &filename, Config &config);
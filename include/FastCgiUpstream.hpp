@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <list>
+#include <map>
+#include <string>
+#include <sys/socket.h>
+#include <vector>
+
+#include "Config.hpp"
+#include "http/index.hpp"
+
+/**
+ * FastCGI client for the application server of one `fastcgi_pass` location.
+ *
+ * Requests go over up to `fastcgi_connections` persistent, non-blocking
+ * connections opened with FCGI_KEEP_CONN. Every new connection first asks
+ * for FCGI_MPXS_CONNS: until the application says it multiplexes, a
+ * connection carries one request at a time, after that several. Requests
+ * no connection can take wait in a queue.
+ *
+ * Params and stdin are queued as records and written when the loop polls
+ * the connection for POLLOUT, the body a little at a time so requests
+ * sharing a connection interleave. Stdout records are appended to the
+ * response, whose CgiPayload parses the header fields as for a forked
+ * script. The upstream never touches the HTTP side otherwise: ended
+ * requests are collected by the Server with `takeFinished()`.
+ *
+ * A connection that hangs up is marked closed and keeps its descriptor
+ * until `collect()`, which the loop calls once it stopped polling it.
+ */
+class FastCgiUpstream {
+	public:
+		struct Exchange {
+			http::Response* response { nullptr };	// Null once the client went away
+			int clientFd { -1 };
+			std::filesystem::path errorPage;		// Sent with a 502 when the request fails
+			std::string params;						// Encoded name-value pairs
+			http::RequestBody body;
+			std::size_t bodySent { 0 };
+			bool isStdinDone { false };
+			bool isOk { false };					// Set when it ended
+		};
+
+		struct Connection {
+			int fd { -1 };
+			bool isConnecting { false };
+			bool isMultiplexed { false };	// Learned from FCGI_GET_VALUES_RESULT
+			bool isClosed { false };
+			std::string output;				// Records not written yet, from outputOffset
+			std::size_t outputOffset { 0 };
+			std::vector<std::uint8_t> input;	// Start of a record not received completely
+			std::map<std::uint16_t, Exchange> exchanges;	// By request id
+			std::uint16_t lastId { 0 };
+
+			bool hasOutput() const;
+		};
+
+		explicit FastCgiUpstream(const Location& location);
+
+		FastCgiUpstream(const FastCgiUpstream&) = delete;
+		FastCgiUpstream& operator=(const FastCgiUpstream&) = delete;
+
+		void submit(const http::Request& request, const std::string& scriptPath, http::Response& response, const std::filesystem::path& errorPage);
+		bool process(int fd, short revents);
+		void abandon(int clientFd);
+		std::vector<Exchange> takeFinished();
+		const std::list<Connection>& getConnections() const;
+		void collect();
+		void shutdown();
+
+	private:
+		static constexpr std::size_t MAX_REQUESTS_PER_CONNECTION = 64;
+
+		struct sockaddr_storage _address {};
+		socklen_t _addressLength { 0 };
+		std::size_t _maxConnections;
+		std::string _documentRoot;
+		std::list<Connection> _connections;	// Found by descriptor, so they never move
+		std::deque<Exchange> _waiting;
+		std::vector<Exchange> _finished;
+
+		Connection* _pick();
+		Connection* _open();
+		void _start(Connection& connection, Exchange&& exchange);
+		void _dispatchWaiting();
+		void _flush(Connection& connection);
+		void _fillStdin(Connection& connection);
+		void _receive(Connection& connection);
+		void _handleRecord(Connection& connection, std::uint8_t type, std::uint16_t id, const std::uint8_t* content, std::size_t size);
+		void _close(Connection& connection);
+		void _finish(Exchange&& exchange, bool isOk);
+};
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * Compressed radix trie over location paths, built once when the router
+ * is set up. `find()` returns the value of the longest location path that
+ * is a prefix of the request path, walking each character of the path at
+ * most once and without allocating.
+ *
+ * Values are indices into the owner's location list, so the trie stays
+ * valid when the owner is copied or moved.
+ */
+class LocationTrie {
+	public:
+		static constexpr std::size_t NONE = static_cast<std::size_t>(-1);
+
+		LocationTrie();
+
+		void insert(std::string_view prefix, std::size_t value);
+		std::size_t find(std::string_view path) const;
+		void clear();
+
+	private:
+		struct Node {
+			std::string label;					// Characters on the edge from the parent
+			std::size_t value { NONE };
+			std::vector<std::uint32_t> children;	// Sorted by the first character of their label
+		};
+
+		std::vector<Node> _nodes; // _nodes[0] is the root, its label is empty
+
+		const Node* _childOf(const Node& node, char c) const;
+		std::uint32_t _addChild(std::uint32_t parent, std::string label, std::size_t value);
+};
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <list>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Remembers the file paths a GET found missing, so a scanner probing the
+ * same paths again gets the canned 404 without any stat.
+ *
+ * A counting Bloom filter answers most lookups of existing files without
+ * touching the index, and still lets entries be removed. The paths
+ * themselves live in an LRU list bounded to `maxEntries`, a hit in the
+ * filter is confirmed there.
+ *
+ * With inotify watching the location roots, a path stays missing until
+ * `invalidate()` drops it or one of its parents, which the handlers also
+ * call for the files they write. Without it, entries expire after the open
+ * file cache validity. The cache is disabled until `configure()` is called.
+ */
+class MissingPaths {
+	public:
+		static MissingPaths& instance();
+
+		MissingPaths(const MissingPaths&) = delete;
+		MissingPaths& operator=(const MissingPaths&) = delete;
+
+		void configure(std::size_t maxEntries, std::chrono::seconds validity, bool isWatched);
+		void invalidate(const std::filesystem::path& path);
+
+		bool contains(std::string_view path);
+		void insert(std::string_view path);
+		bool isEnabled() const;
+		std::size_t size() const;
+
+	private:
+		struct Entry {
+			std::string path;
+			std::uint64_t hash;
+			std::chrono::steady_clock::time_point validUntil;
+		};
+
+		using Entries = std::list<Entry>;
+
+		static constexpr std::size_t HASH_COUNT = 3;
+		static constexpr std::size_t COUNTERS_PER_ENTRY = 8;
+
+		std::size_t _maxEntries { 0 };
+		std::chrono::seconds _validity { 0 };
+		bool _isWatched { false };
+		std::vector<std::uint8_t> _counters;
+		std::size_t _mask { 0 };
+		Entries _entries; // Most recently missed first
+		std::unordered_map<std::string_view, Entries::iterator> _index; // Views into the list nodes, which never move
+
+		MissingPaths() = default;
+
+		bool _mayContain(std::uint64_t hash) const;
+		void _count(std::uint64_t hash, bool isAdding);
+		void _erase(Entries::iterator it);
+};
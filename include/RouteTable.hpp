@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Config.hpp"
+#include "LocationTrie.hpp"
+
+/**
+ * The routing part of a server config, compiled once when the router is
+ * built and never changed afterwards, so copies of the router share it.
+ *
+ * Each route keeps its location together with what the router would
+ * otherwise work out per request: the allowed methods as a bitmask, the
+ * CGI extensions as a sorted set and the serialized redirect. Matching a
+ * request path, checking its method and its CGI extension allocate nothing.
+ */
+class RouteTable {
+	public:
+		enum class Method : std::uint8_t { GET, POST, DELETE, UNKNOWN };
+
+		static constexpr std::size_t METHOD_COUNT = static_cast<std::size_t>(Method::UNKNOWN);
+
+		struct Route {
+			Location location;								// Root already canonical, see ConfigParser::getConfigPath()
+			std::uint8_t methods { 0 };						// One bit per allowed Method
+			std::vector<std::string> cgiExtensions;			// Sorted, without the dot
+			std::shared_ptr<const std::string> redirect;	// Serialized `return` response, null without one
+
+			bool allows(Method method) const;
+			bool isCgiExtension(std::string_view extension) const;
+		};
+
+		explicit RouteTable(const ServerConfig& serverConfig);
+
+		static Method methodOf(std::string_view method);
+
+		const Route* match(std::string_view path) const;
+		const std::vector<Route>& getRoutes() const;
+		const std::string& getErrorPage(int code) const;
+		std::size_t getClientBodyBufferSize() const;
+		std::size_t getClientMaxBodySize() const;
+
+	private:
+		std::vector<Route> _routes;
+		LocationTrie _trie; // location path -> index in _routes
+		std::map<int, std::string> _errorPages;
+		std::size_t _clientBodyBufferSize;
+		std::size_t _clientMaxBodySize;
+};
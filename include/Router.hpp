@@ -1,14 +1,15 @@
 #pragma once
 
+#include <array>
 #include <fstream>
 #include <functional>
 #include <iostream>
 #include <sstream>
 #include <string>
-#include <unordered_map>
 
 #include "http/index.hpp"
 #include "Config.hpp"
+#include "RouteTable.hpp"
 
 // Forward declaration
 void handleGetRequest(const Location& loc, const std::string& requestPath, http::Request& request, http::Response& response);
@@ -20,7 +21,7 @@ class Router {
 	public:
 		using Handler = std::function<void(const Location&, const std::string&, http::Request&, http::Response&)>;
 
-		Router(const ServerConfig& serverConfig) : _serverConfig(serverConfig) {
+		Router(const ServerConfig& serverConfig) {
 			addLocations(serverConfig);
 		}
 
@@ -32,17 +33,19 @@ class Router {
 			_cgiHandler = handler;
 		}
 		void handle(http::Request& req, http::Response& res);
+		void prepareUpload(http::Request& req) const;
 
 		void addLocations(const ServerConfig& serverConfig);
-		bool isCGI(const Location& loc, const std::string& requestPath) const;
+		const RouteTable& getRouteTable() const;
+		bool isCGI(const RouteTable::Route& route, const std::string& requestPath) const;
 
-		void handleRedirectRequest(const Location& loc, http::Response& res, http::Request& req);
+		void handleRedirectRequest(const RouteTable::Route& route, http::Response& res, http::Request& req);
 	private:
-		ServerConfig _serverConfig;
-		std::string requestPath;
+		std::shared_ptr<const RouteTable> _routeTable;
+		mutable std::string _requestPath; // Reused for every request
+		mutable std::string _scriptPath; // Reused by isCGI()
 		Handler _cgiHandler;
-		std::unordered_map<std::string, Handler> _routes; // method -> handler
-		std::unordered_map<std::string, Location> _locationConfigs; // route -> location config
+		std::array<Handler, RouteTable::METHOD_COUNT> _handlers; // indexed by RouteTable::Method
 
-		const Location* findBestMatchingLocation(const std::string& url) const;
+		const std::string& normalizeRequestPath(const std::string& path) const;
 };
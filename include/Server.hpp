@@ -11,21 +11,28 @@
 #include <unordered_set>
 #include <filesystem>
 
+#include "CgiWorkerPool.hpp"
 #include "Config.hpp"
+#include "FastCgiUpstream.hpp"
 #include "http/index.hpp"
 #include "Router.hpp"
+#include "VirtualHosts.hpp"
 
 struct WorkerProcess {
 	int pipeFds[2];
 	int clientFd;
 	pid_t pid;
 	std::filesystem::path rootPath;
+	http::Response* response;	// Not necessarily the front of a pipelined queue, valid while the pipe is open
+	CgiWorkerPool* pool { nullptr };				// Set when a pooled worker runs the script instead of a fork
+	CgiWorkerPool::Worker* worker { nullptr };	// Its socket is pipeFds[0], the pool closes it
+	std::filesystem::path errorPage;				// The server's 500 page, sent when the pooled worker fails
 };
 
 class Server {
 	public:
 		Server() = delete;
-		Server(const ServerConfig& serverConfig);
+		Server(const std::string& host, int port, const std::vector<std::reference_wrapper<const ServerConfig>>& serverConfigs);
 		~Server() = default;
 
 		Server(Server&&) noexcept = default;
@@ -34,19 +41,24 @@ class Server {
 		void addRouterHandlers();
 		void onShutdown(std::function<void()> shutdownHandler);
 		void closeConnection(http::Connection& con);
+		void releaseConnection(int clientFd);
 		void process(const int fd, short& events, const short revents);
+		void updateCgiWorkerPools();
 
 		const std::unordered_set<int>& getServerFds() const;
 		std::unordered_map<int, http::Connection> connections;
 		std::unordered_map<int, WorkerProcess> workerProcesses;
 		std::vector<pid_t> unreapedProcesses;
+		std::unordered_map<const Location*, FastCgiUpstream> fastCgiUpstreams;	// Keyed by the route's location
+		std::vector<int> readyClientFds;	// Clients whose FastCGI response ended, to poll for POLLOUT
 		void shutdown();
 
 	private:
-		const ServerConfig& _serverConfig;
-		Router _router;
+		const ServerConfig& _serverConfig;	// The default server of the address, its limits apply until a request names its server
+		VirtualHosts _virtualHosts;
 		std::unordered_set<int> _serverFds;
 		std::function<void()> _shutdownHandler;
+		std::unordered_map<const Location*, CgiWorkerPool> _cgiWorkerPools;	// Keyed by the route's location
 
 		void _handleCGI(
 			const Location& loc,
@@ -55,6 +67,9 @@ class Server {
 			http::Response& response
 		);
 
+		Router& _routerFor(const http::Request& request);
 		void _processConnection(http::Connection& con, short& events, const short revents);
 		void _processWorkerProcess(WorkerProcess& process, const short revents);
+		void _processPooledWorker(WorkerProcess& process, const short revents);
+		void _finishFastCgiExchanges(FastCgiUpstream& upstream);
 };
@@ -6,6 +6,7 @@
 
 #include "Config.hpp"
 #include "Server.hpp"
+#include "utils/FileWatcher.hpp"
 
 class ServerManager {
 	public:
@@ -21,11 +22,18 @@ class ServerManager {
 		std::unordered_map<int, std::reference_wrapper<Server>> _serverMap;
 		std::vector<struct ::pollfd> _pollFds;
 		std::unordered_map<int, std::size_t> _pollfdIndexMap;
+		utils::FileWatcher _fileWatcher;
 
+		void _setupFileCache();
+		void _setupCannedResponses();
+		void _setupBundles();
+		void _setupReadAhead();
+		void _resumePendingConnections();
 		void _track(int fd, Server& server);
 		void _untrack(int fd);
 		void _updatePollFds();
 		void _processPollFds();
 		void _updateClientConnections(Server& server);
 		void _updatePipeConnections(Server& server);
+		void _updateFastCgiConnections(Server& server);
 };
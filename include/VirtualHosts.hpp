@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "Config.hpp"
+#include "Router.hpp"
+
+/**
+ * The server blocks sharing one listening address, each with its own
+ * router. A request goes to the server whose server_name matches its Host
+ * header, in nginx order: the exact name, then the longest name starting
+ * with a wildcard ("*.example.com"), then the longest name ending with one
+ * ("www.example.*"). ".example.com" stands for both "example.com" and
+ * "*.example.com". Requests that match nothing go to the first server
+ * added, the default for the address. The server configs must outlive the
+ * table, connections apply the limits and timeouts of the one found.
+ *
+ * Every candidate name is one hash lookup, so dispatch costs one lookup
+ * per label of the host at most, whatever the number of servers.
+ */
+class VirtualHosts {
+	public:
+		void add(const ServerConfig& serverConfig);
+
+		Router& find(std::string_view host);
+		const ServerConfig& findServerConfig(std::string_view host);
+		std::vector<Router>& getRouters();
+
+	private:
+		// Lets find() look names up by string_view
+		struct Hash {
+			using is_transparent = void;
+
+			std::size_t operator()(std::string_view name) const {
+				return std::hash<std::string_view>()(name);
+			}
+		};
+
+		using NameMap = std::unordered_map<std::string, std::size_t, Hash, std::equal_to<>>;
+
+		std::vector<Router> _routers;
+		std::vector<const ServerConfig*> _serverConfigs;	// Same index as the router
+		NameMap _exactNames;
+		NameMap _leadingWildcards;	// "*.example.com" stored as ".example.com"
+		NameMap _trailingWildcards;	// "www.example.*" stored as "www.example."
+		std::string _host;			// Reused to lower-case the Host header
+
+		std::size_t _indexOf(std::string_view host);
+		static void _insert(NameMap& names, std::string name, std::size_t index);
+};
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <unordered_map>
+#include <sys/types.h>
+
+#include "Config.hpp"
+
+/**
+ * Runs `worker_processes` copies of the event loop. The shared file cache is
+ * mapped before forking, then every worker builds its own ServerManager and
+ * binds the listening sockets with SO_REUSEPORT. The master only waits for
+ * the workers, replaces the ones that crash, and passes SIGINT on. A
+ * replacement takes the index of the worker it replaces, whose pins in the
+ * shared file cache are dropped first.
+ */
+class WorkerPool {
+	public:
+		WorkerPool() = delete;
+		WorkerPool(const Config& config);
+		~WorkerPool() = default;
+		int run();
+
+	private:
+		Config _config;
+		std::unordered_map<pid_t, std::size_t> _workers;	// Index of each worker
+
+		void _spawn(std::size_t index);
+		void _work(std::size_t index);
+		void _interrupt();
+};
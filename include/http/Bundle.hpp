@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace http {
+	/**
+	 * Read-only view of a static site packed by tools/bundle.cpp, mapped
+	 * once and shared by every response served from it.
+	 *
+	 * The archive is written in host byte order: a Header, the perfect hash
+	 * seeds (one per bucket), the slot table (entry index per slot), the
+	 * entries, then the strings and file contents they point to. A path is
+	 * found with two hashes and one comparison, and each entry carries the
+	 * serialized header fields of its identity, gzip and brotli variants.
+	 */
+	class Bundle {
+		public:
+			enum Encoding : std::uint8_t {
+				IDENTITY,
+				GZIP,
+				BROTLI,
+				ENCODING_COUNT
+			};
+
+			static constexpr char MAGIC[8] = { 'W', 'S', 'B', 'U', 'N', 'D', 'L', '1' };
+			static constexpr std::uint32_t EMPTY_SLOT = 0xFFFFFFFF;
+
+			// Bytes from the start of the archive
+			struct Span {
+				std::uint64_t offset;
+				std::uint64_t size;
+			};
+
+			// A variant without entity tag is absent, the identity one is always there
+			struct Variant {
+				Span content;
+				Span entityTag;
+				Span headerFields;	// Content-Type, Content-Length, Content-Encoding, ETag and Last-Modified lines
+			};
+
+			struct Entry {
+				Span path;			// Relative to the packed root, without leading slash
+				std::int64_t lastModified;
+				Variant variants[ENCODING_COUNT];
+			};
+
+			struct Header {
+				char magic[8];
+				std::uint32_t entryCount;
+				std::uint32_t bucketCount;
+				std::uint32_t slotCount;
+				std::uint32_t reserved;
+				std::uint64_t seedsOffset;
+				std::uint64_t slotsOffset;
+				std::uint64_t entriesOffset;
+			};
+
+			Bundle(const Bundle&) = delete;
+			~Bundle();
+
+			Bundle& operator=(const Bundle&) = delete;
+
+			static std::shared_ptr<const Bundle> open(const std::filesystem::path& path);
+			static std::uint64_t hashOf(std::string_view key, std::uint32_t seed);
+
+			const Entry* find(std::string_view path) const;
+			std::string_view viewOf(const Span& span) const;
+			std::size_t size() const;
+
+		private:
+			const std::uint8_t* _data;
+			std::size_t _size;
+			const Header* _header;
+			const std::uint32_t* _seeds;
+			const std::uint32_t* _slots;
+			const Entry* _entries;
+
+			Bundle(const std::uint8_t* data, std::size_t size);
+
+			bool _loadIndex();
+			bool _contains(const Span& span) const;
+	};
+
+	/**
+	 * The bundles of the config by path. They are mapped when the server
+	 * starts and mapped again by `refresh()` when the file watcher reports
+	 * that the tool replaced one; responses still in flight keep the old
+	 * mapping alive.
+	 */
+	class Bundles {
+		public:
+			static Bundles& instance();
+
+			Bundles(const Bundles&) = delete;
+			Bundles& operator=(const Bundles&) = delete;
+
+			bool add(const std::filesystem::path& path);
+			void refresh(const std::filesystem::path& path);
+
+			std::shared_ptr<const Bundle> get(const std::filesystem::path& path) const;
+
+		private:
+			std::unordered_map<std::string, std::shared_ptr<const Bundle>> _bundles;
+
+			Bundles() = default;
+	};
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "constants.hpp"
+
+namespace http {
+	/**
+	 * Error pages serialized once, header fields and body together, so an
+	 * error response is a shared immutable buffer sent in the same write as
+	 * the status line and Date field of the response. The pages are read
+	 * when the config loads and re-read by `refresh()` when the file watcher
+	 * reports a change.
+	 */
+	class CannedResponses {
+		public:
+			static CannedResponses& instance();
+
+			CannedResponses(const CannedResponses&) = delete;
+			CannedResponses& operator=(const CannedResponses&) = delete;
+
+			void add(StatusCode statusCode, const std::filesystem::path& page);
+			void refresh(const std::filesystem::path& path);
+
+			std::shared_ptr<const std::string> get(StatusCode statusCode, const std::filesystem::path& page) const;
+
+			static std::shared_ptr<const std::string> serialize(const std::string& headerFields, const std::string& body);
+			static std::shared_ptr<const std::string> serializeRedirect(const std::string& location);
+
+		private:
+			struct Entry {
+				StatusCode statusCode;
+				std::filesystem::path page;
+				std::shared_ptr<const std::string> message;
+			};
+
+			std::unordered_map<std::string, Entry> _entries;	// status code and page path -> response
+
+			CannedResponses() = default;
+
+			static std::string _keyOf(StatusCode statusCode, const std::filesystem::path& page);
+			static std::shared_ptr<const std::string> _load(const std::filesystem::path& page);
+	};
+}
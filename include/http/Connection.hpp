@@ -1,9 +1,12 @@
 #pragma once
 
 #include <vector>
-#include <queue>
+#include <deque>
 #include <utility>
 #include <chrono>
+#include <cstdint>
+#include <memory>
+#include <optional>
 #include <functional>
 #include "Request.hpp"
 #include "Response.hpp"
@@ -19,11 +22,15 @@ namespace http {
 			Connection& operator=(const Connection&) = delete;
 
 			void read();
+			void handleRequests(const std::function<void(Request&, Response&)>& handler);
 			bool sendResponse();
+			bool readErrorQueue();
 			void close();
+			void onHeaderComplete(std::function<const ServerConfig&(Request&)> handler);
 
 			bool isClosed() const;
 			bool isTimedOut() const;
+			bool hasReadyResponse() const;
 
 			Request* getRequest();
 			Response* getResponse();
@@ -34,15 +41,32 @@ namespace http {
 			using TimePoint = std::chrono::steady_clock::time_point;
 
 			int _clientFd;
-			const ServerConfig& _serverConfig;
+			const ServerConfig* _serverConfig;					// Of the request being read, the address default before its header
 			Request _request { Request::Status::PENDING };
 			std::vector<std::uint8_t> _buffer;
-			std::queue<std::pair<Request, Response>> _queue;
+			std::deque<std::pair<Request, Response>> _queue;	// Pipelined requests, answered in order
+			std::vector<std::string> _headerBuffers;			// Header storage of sent responses, reused by the next ones
 			TimePoint _lastReceived;
 			TimePoint _requestHandleStart { TimePoint::min() };
 			TimePoint _responseHandleStart { TimePoint::min() };
 			TimePoint _responseDeliveryStart { TimePoint::min() };
+			std::function<const ServerConfig&(Request&)> _headerCompleteHandler;
 
+			bool _isZeroCopyEnabled { false };
+			bool _isClosing { false };							// Closes once the kernel is done with the pinned bodies
+			std::uint32_t _zeroCopySeq { 0 };					// Sequence number of the next MSG_ZEROCOPY send
+			std::uint32_t _zeroCopyCompleted { 0 };				// Every send before this one has completed
+			std::optional<std::uint32_t> _frontZeroCopySeq;		// Last MSG_ZEROCOPY send of the front response body
+			std::deque<std::pair<std::uint32_t, std::shared_ptr<utils::Payload>>> _zeroCopyPins;
+
+			bool _canSpliceBody() const;
+			ssize_t _receive();
+			ssize_t _spliceBody();
 			void _processBuffer();
+			void _parseRequests();
+			void _popSentResponses();
+			bool _isZeroCopyCandidate(const Response& res) const;
+			bool _isZeroCopyComplete(std::uint32_t seq) const;
+			void _sendZeroCopy(Response& res);
 	};
 }
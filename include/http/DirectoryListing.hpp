@@ -0,0 +1,100 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <ctime>
+#include <filesystem>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "utils/Payload.hpp"
+
+namespace http {
+	/**
+	 * Cache of autoindex entries. A directory is read once, sorted by name,
+	 * and kept until its mtime changes, so a request for a huge upload folder
+	 * only pays for the page it renders. The other sort orders are computed
+	 * on first use and kept with the entries.
+	 */
+	class DirectoryListing {
+		public:
+			enum class SortKey : std::uint8_t {
+				NAME,
+				SIZE,
+				MODIFIED
+			};
+
+			struct Item {
+				std::string name;
+				bool isDirectory;
+				std::uint64_t size;
+				std::time_t modified;
+			};
+
+			struct Entries {
+				std::filesystem::path path;
+				struct timespec mtime;
+				std::vector<Item> items;	// By name
+				mutable std::array<std::vector<std::uint32_t>, 3> orders;	// Indexes into items per SortKey, NAME stays empty
+
+				const Item& at(SortKey key, bool isDescending, std::size_t position) const;
+			};
+
+			struct Page {
+				SortKey key { SortKey::NAME };
+				bool isDescending { false };
+				std::size_t number { 1 };
+				std::size_t size { 1000 };
+			};
+
+			static DirectoryListing& instance();
+
+			DirectoryListing(const DirectoryListing&) = delete;
+			DirectoryListing& operator=(const DirectoryListing&) = delete;
+
+			std::shared_ptr<const Entries> get(const std::filesystem::path& directory);
+			void clear();
+
+			static Page pageOf(const std::string& query, std::size_t pageSize);
+
+		private:
+			using LruList = std::list<std::shared_ptr<const Entries>>;
+
+			LruList _lru; // most recently used first
+			std::unordered_map<std::string, LruList::iterator> _entries;
+
+			DirectoryListing() = default;
+
+			static std::shared_ptr<const Entries> _read(const std::filesystem::path& directory, const struct timespec& mtime);
+	};
+
+	/**
+	 * Renders one page of a directory listing as HTML, a few hundred rows
+	 * per block as the socket drains. Its length is not known up front, the
+	 * response sends it chunked.
+	 */
+	class DirectoryListingPayload : public utils::StreamPayload {
+		public:
+			DirectoryListingPayload(std::shared_ptr<const DirectoryListing::Entries> entries, const std::string& requestPath, DirectoryListing::Page page);
+			DirectoryListingPayload(const DirectoryListingPayload& other) = default;
+			DirectoryListingPayload(DirectoryListingPayload &&) noexcept = default;
+			~DirectoryListingPayload() = default;
+
+			std::unique_ptr<utils::Payload> clone() const override;
+
+		private:
+			std::shared_ptr<const DirectoryListing::Entries> _entries;
+			std::string _requestPath;
+			DirectoryListing::Page _page;
+			std::size_t _next;		// Position of the next row in the sorted entries
+			std::size_t _end;		// Position after the last row of the page
+			bool _hasStarted { false };
+
+			void _produce() override;
+			void _append(const std::string& text);
+			std::string _linkTo(DirectoryListing::SortKey key, bool isDescending, std::size_t page) const;
+	};
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <ctime>
+#include <filesystem>
+#include <list>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <sys/stat.h>
+
+namespace http {
+	/**
+	 * Byte-budgeted LRU cache of small static files.
+	 *
+	 * An entry holds the file content, its MIME type, its validators and the
+	 * serialized Content-Type / Content-Length and ETag / Last-Modified header
+	 * lines, so serving a hit needs no filesystem access at all. Entries are only dropped by
+	 * eviction or `invalidate()`, which the event loop calls from inotify
+	 * events on the location roots. The cache stays disabled (capacity 0)
+	 * until `configure()` is called. When the worker processes share a
+	 * SharedFileCache segment, entries live there instead and this cache
+	 * keeps no copy of its own.
+	 */
+	class FileCache {
+		public:
+			// The fields view `storage`, or a block of the SharedFileCache that stays pinned while the entry lives
+			struct Entry {
+				std::string_view path;
+				std::string_view content;
+				std::string_view mimeType;
+				std::string_view entityTag;
+				std::time_t lastModified;
+				std::string_view headerFields;
+				std::string_view validatorFields;
+				std::shared_ptr<const std::string> storage;
+			};
+
+			static FileCache& instance();
+
+			FileCache(const FileCache&) = delete;
+			FileCache& operator=(const FileCache&) = delete;
+
+			void configure(std::size_t capacity, std::size_t maxFileSize);
+			void clear();
+			void invalidate(const std::filesystem::path& path);
+			void prewarm(const std::filesystem::path& directory);
+
+			std::shared_ptr<const Entry> get(const std::filesystem::path& path);
+			std::shared_ptr<const Entry> load(const std::filesystem::path& path);
+
+			bool isEnabled() const;
+			std::size_t size() const;
+			std::size_t getMaxFileSize() const;
+
+		private:
+			using LruList = std::list<std::shared_ptr<const Entry>>;
+
+			std::size_t _capacity { 0 };
+			std::size_t _maxFileSize { 0 };
+			std::size_t _size { 0 };
+			bool _isShared { false };
+			LruList _lru; // most recently used first
+			std::unordered_map<std::string, LruList::iterator> _entries;
+
+			FileCache() = default;
+
+			static std::shared_ptr<Entry> _makeEntry(const std::string& path, const std::string& content, const struct ::stat& st);
+			static std::size_t _cost(const Entry& entry);
+			void _erase(std::unordered_map<std::string, LruList::iterator>::iterator it);
+	};
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstdint>
+#include <filesystem>
 #include <optional>
 #include <string>
 #include <unordered_map>
@@ -8,6 +9,7 @@
 
 #include "data_types.hpp"
 #include "constants.hpp"
+#include "RequestBody.hpp"
 #include "utils.hpp"
 
 namespace http {
@@ -33,7 +35,9 @@ namespace http {
 
 			bool isChunkEncoding() const;
 			bool isMultipart() const;
+			bool isNotModified(const std::string& entityTag, std::time_t lastModified) const;
 
+			std::vector<std::string> getCgiEnv() const;
 			char** getCgiEnvp() const;
 
 			const std::string& getMethod() const;
@@ -43,21 +47,15 @@ namespace http {
 			std::string getBoundary() const;
 			std::size_t getContentLength() const;
 			std::optional<std::string> getHeader(Header header) const;
-			const std::vector<std::uint8_t>& getRawBody() const;
+			std::optional<std::vector<ByteRange>> getRanges(std::size_t size, const std::string& entityTag, std::time_t lastModified) const;
+			const RequestBody& getBody() const;
 			Request::Status getStatus() const;
 
-			Request& setRawBody(
-				std::vector<uint8_t>::const_iterator begin,
-				std::vector<uint8_t>::const_iterator end,
-				bool append
-			);
-
-			Request& setRawBody(
-				std::move_iterator<std::vector<uint8_t>::iterator> begin,
-				std::move_iterator<std::vector<uint8_t>::iterator> end,
-				bool append
-			) noexcept;
+			ssize_t spliceBody(int fd);
 
+			Request& appendBody(const std::uint8_t* data, std::size_t size);
+			Request& setBodyBufferSize(std::size_t bytes);
+			Request& storeBodyIn(const std::filesystem::path& directory);
 			Request& setContentLength(std::size_t bytes);
 			Request& setHeader(const std::string& name, const std::string& value);
 			Request& setHeader(Header header, const std::string& value);
@@ -74,7 +72,7 @@ namespace http {
 			Url _url;
 			std::unordered_map<std::string, std::string> _headerFields;
 			std::size_t _contentLength { 0 };
-			std::vector<std::uint8_t> _rawBody;
+			RequestBody _body;
 			Request::Status _status { Request::Status::PENDING };
 	};
 }
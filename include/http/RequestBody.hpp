@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+namespace http {
+	constexpr std::size_t DEFAULT_CLIENT_BODY_BUFFER_SIZE = 16 * 1024; // 16KB
+
+	/**
+	 * Storage for a request body.
+	 *
+	 * Small bodies stay in memory. Once the body grows past `bufferSize`
+	 * bytes it is moved into an anonymous temporary file (O_TMPFILE) so the
+	 * memory held per connection stays bounded. A file-backed body can be
+	 * read through `view()` (mmap), handed over as a raw fd, or filled
+	 * straight from a socket with `spliceFrom()`.
+	 *
+	 * Copies share the same temporary file.
+	 */
+	class RequestBody {
+		public:
+			RequestBody() = default;
+			RequestBody(const RequestBody&) = default;
+			RequestBody(RequestBody&&) noexcept = default;
+			~RequestBody() = default;
+
+			RequestBody& operator=(const RequestBody&) = default;
+			RequestBody& operator=(RequestBody&&) noexcept = default;
+
+			void append(const std::uint8_t* data, std::size_t size);
+			void clear();
+			void saveAs(const std::filesystem::path& path) const;
+			void preallocate(std::size_t size);
+			void spill();
+			ssize_t spliceFrom(int fd, std::size_t size);
+
+			bool empty() const;
+			bool isInFile() const;
+
+			int getFd() const;
+			std::size_t size() const;
+			std::span<const std::uint8_t> view() const;
+
+			RequestBody& setBufferSize(std::size_t bytes);
+			RequestBody& setTempDirectory(const std::filesystem::path& directory);
+
+		private:
+			struct TempFile;
+
+			std::size_t _bufferSize { DEFAULT_CLIENT_BODY_BUFFER_SIZE };
+			std::size_t _size { 0 };
+			std::filesystem::path _tempDirectory { P_tmpdir };
+			std::vector<std::uint8_t> _memory;
+			std::shared_ptr<TempFile> _file;
+	};
+}
@@ -1,12 +1,17 @@
 #pragma once
 
+#include <ctime>
 #include <string>
 #include <memory>
 #include <unordered_map>
 #include <filesystem>
 #include <functional>
 
+#include "Bundle.hpp"
+#include "Config.hpp"
 #include "constants.hpp"
+#include "data_types.hpp"
+#include "FileCache.hpp"
 #include "utils/Payload.hpp"
 
 namespace http {
@@ -26,9 +31,15 @@ namespace http {
 			Response& operator=(const Response& other);
 
 			bool send();
+			std::size_t peek(struct iovec* iov, std::size_t count) const;
+			std::size_t commit(std::size_t bytes);
 			void onStatusChanged(std::function<void(Response::Status status)> handler);
 			void build();
 
+			bool isSent() const;
+			bool isBuffered() const;
+			bool isPending() const;
+
 			int getClientSocket() const;
 			Response::Status getStatus() const;
 			StatusCode getStatusCode() const;
@@ -36,23 +47,51 @@ namespace http {
 			const std::unique_ptr<utils::Payload>& getBody() const;
 
 			Response& clear();
+			Response& reset();
 			Response& setStatus(const Status status);
 			Response& setStatusCode(const StatusCode statusCode);
 			Response& setHeader(Header header, const std::string& value);
 			Response& setHeader(const std::string& headerName, const std::string& headerValue);
 			Response& setBody(std::unique_ptr<utils::Payload> body);
+			std::unique_ptr<utils::Payload> releaseBody();
 			Response& appendBody(const std::uint8_t* data, size_t size);
+			Response& setFileMimeType(const std::string& mimeType);
+			Response& setCompression(const Location* location);
+			Response& reuseHeaderBuffer(std::string&& buffer);
+			std::string releaseHeaderBuffer();
 
+			void setCanned(StatusCode statusCode, std::shared_ptr<const std::string> message);
+			void setStream(StatusCode statusCode, std::unique_ptr<utils::Payload> body, const std::string& mimeType);
 			void setText(StatusCode statusCode, const std::string& text);
 			void setFile(StatusCode statusCode, const std::filesystem::path &filePath);
+			void setFile(StatusCode statusCode, const std::shared_ptr<const FileCache::Entry>& entry);
+			void setBundled(const std::shared_ptr<const Bundle>& bundle, const Bundle::Variant& variant);
+			void setFileRanges(const std::filesystem::path &filePath, const std::vector<ByteRange>& ranges);
+			void setNotModified(const std::string& entityTag, std::time_t lastModified);
+			void setRangeNotSatisfiable(std::size_t size);
 
 		private:
+			using HeaderField = std::pair<std::string, std::string>;
+
 			int _clientSocket;
 			Status _status { Status::PENDING };
 			StatusCode _statusCode { StatusCode::NONE_0 };
-			std::unordered_map<std::string, std::string> _headerFields { {"Content-Type", "application/octet-stream"} };
+			std::vector<HeaderField> _headerFields { {"Content-Type", "application/octet-stream"} };	// In insertion order, so the header is deterministic
+			std::string _headerBuffer;		// Storage recycled from an earlier response of the connection
+			std::string _serializedFields;	// Header lines written as is after _headerFields
+			std::string _fileMimeType;		// Content-Type of the served file when its extension does not tell (precompressed sidecars)
+			bool _isFileBody { false };		// Files keep their validators and ranges, they are never compressed on the fly
+			bool _isStreamBody { false };	// Generated as it is sent, its length is unknown until the end
+			const Location* _compression { nullptr };	// gzip policy of the matched location, set when the client accepts gzip
 			utils::StringPayload _header;
 			std::unique_ptr<utils::Payload> _body;
 			std::vector<std::function<void(Response::Status status)>> _handlers;
+
+			std::vector<HeaderField>::iterator _findHeader(const std::string& name);
+			void _eraseHeader(const std::string& name);
+			void _setDefaultHeader(const std::string& name, const std::string& value);
+			std::string& _serializeStatusLine();
+			std::string _mimeTypeOf(const std::filesystem::path& filePath) const;
+			void _compressBody();
 	};
 }
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "FileCache.hpp"
+
+namespace http {
+	/**
+	 * File cache entries shared by the worker processes.
+	 *
+	 * One memfd segment is mapped before the workers fork, so all of them see
+	 * it at the same address. It holds a slab allocator (pages carved into
+	 * blocks of power-of-two size classes, one lock-free free list per class)
+	 * and an open-addressing index of path hashes, both driven by atomics
+	 * only. A block holds a whole FileCache::Entry, content and serialized
+	 * header lines included, and is reference counted: the index holds one
+	 * reference and every response sending from it holds another, so a block
+	 * is only reused once nothing points into it. When a size class runs out,
+	 * a clock sweep over the index evicts blocks that were not used since the
+	 * last sweep. Once every page is carved, a page whose blocks are all free
+	 * goes back to a free page list that any size class can take.
+	 *
+	 * The state of a block (references, generation, free list link) lives in
+	 * a side table with one cell per MIN_BLOCK_SIZE bytes of pages, so a
+	 * stale reference into a page carved again for another class still lands
+	 * on a valid cell instead of in the middle of some content.
+	 *
+	 * Every worker records the references it holds in its own pin table. When
+	 * a worker dies, the master drops them with `releasePins()` before
+	 * starting its replacement.
+	 */
+	class SharedFileCache {
+		public:
+			static SharedFileCache& instance();
+
+			SharedFileCache(const SharedFileCache&) = delete;
+			SharedFileCache& operator=(const SharedFileCache&) = delete;
+
+			bool create(std::size_t capacity, std::size_t maxFileSize, std::size_t workerCount);
+			void destroy();
+			bool isEnabled() const;
+			void attach(std::size_t worker);
+			void releasePins(std::size_t worker);
+
+			std::shared_ptr<const FileCache::Entry> find(std::string_view path);
+			std::shared_ptr<const FileCache::Entry> insert(const FileCache::Entry& entry);
+			void erase(std::string_view path);
+			void eraseBelow(std::string_view directory);
+
+			std::size_t size() const;
+
+		private:
+			struct Segment;
+			struct Slot;
+			struct Page;
+			struct Cell;
+			struct Block;
+			struct PinTable;
+			class PinnedEntry;
+
+			Segment* _segment { nullptr };
+			Slot* _slots { nullptr };
+			Page* _pages { nullptr };
+			Cell* _cells { nullptr };
+			PinTable* _pinTables { nullptr };
+			PinTable* _pins { nullptr };	// Of this worker, null in the master
+			std::uint8_t* _base { nullptr };
+
+			SharedFileCache() = default;
+
+			Block* _blockAt(std::uint32_t ref) const;
+			std::uint32_t _pageOf(std::uint32_t ref) const;
+			std::uint32_t _allocate(std::uint8_t sizeClass);
+			std::uint32_t _take(std::uint8_t sizeClass);
+			std::uint32_t _carve(std::uint32_t page, std::uint8_t sizeClass);
+			std::uint32_t _takePage();
+			bool _evict(std::uint8_t sizeClass, bool isAnyClass);
+			void _evictPage(std::uint32_t page);
+			void _reclaim(std::uint8_t sizeClass);
+			void _push(std::uint8_t sizeClass, std::uint32_t ref);
+			std::uint32_t _pop(std::uint8_t sizeClass);
+			bool _pin(std::uint32_t ref, std::uint32_t generation);
+			void _unpin(std::uint32_t ref);
+			void _release(std::uint32_t ref);
+			bool _track(std::uint32_t ref);
+			void _untrack(std::uint32_t ref);
+			Slot* _findSlot(std::uint64_t hash, bool isClaiming);
+			std::shared_ptr<const FileCache::Entry> _entryOf(std::uint32_t ref);
+			void _unlink(Slot& slot, std::uint64_t value);
+	};
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "utils/Payload.hpp"
+
+namespace http {
+	/**
+	 * Holds the sockets of closed connections that still had MSG_ZEROCOPY
+	 * sends in flight, together with the bodies those sends read from. The
+	 * socket is shut down but left open, so its error queue keeps reporting
+	 * completions, and a body is only released once the kernel is done with
+	 * it. A socket whose peer does not take the data before LINGER_TIMEOUT
+	 * is reset, which drops its queued sends, and then closed.
+	 */
+	class ZeroCopyReaper {
+		public:
+			using Pins = std::deque<std::pair<std::uint32_t, std::shared_ptr<utils::Payload>>>;
+
+			static ZeroCopyReaper& instance();
+
+			ZeroCopyReaper(const ZeroCopyReaper&) = delete;
+			ZeroCopyReaper& operator=(const ZeroCopyReaper&) = delete;
+
+			void adopt(int fd, std::uint32_t completed, Pins pins);
+			void collect();
+			void shutdown();
+
+			static bool readCompletions(int fd, std::uint32_t& completed, bool& isCopied);
+			static void releaseCompleted(Pins& pins, std::uint32_t completed);
+
+		private:
+			struct Socket {
+				int fd;
+				std::uint32_t completed;	// Every send before this one has completed
+				Pins pins;
+				std::chrono::steady_clock::time_point deadline;
+			};
+
+			static constexpr std::chrono::seconds LINGER_TIMEOUT { 10 };
+
+			std::vector<Socket> _sockets;
+
+			ZeroCopyReaper() = default;
+
+			static void _close(int fd, bool isReset);
+	};
+}
@@ -2,6 +2,7 @@
 
 #include <string>
 #include <vector>
+#include <cstddef>
 #include <cstdint>
 
 namespace http {
@@ -35,6 +36,14 @@ namespace http {
 		Url& operator=(const Url&) = default;
 	};
 
+	// Inclusive byte range of a representation, as in `Range: bytes=first-last`
+	struct ByteRange {
+		std::size_t first;
+		std::size_t last;
+
+		std::size_t length() const { return last - first + 1; }
+	};
+
 	struct MultipartElement {
 		std::string name;
 		std::string fileName;
@@ -2,6 +2,7 @@
 
 #include <string>
 #include <array>
+#include <span>
 #include <vector>
 #include <unordered_map>
 
@@ -14,5 +15,5 @@ namespace http {
 	void parseRequestHeader(std::vector<uint8_t>& buffer, Request& request);
 	void parseRequestBody(std::vector<uint8_t>& buffer, Request& request, std::size_t clientMaxBodySize);
 
-	std::vector<MultipartElement> parseMultipart(const std::vector<uint8_t>& rawMultipart, const std::string& boundary);
+	std::vector<MultipartElement> parseMultipart(std::span<const std::uint8_t> rawMultipart, const std::string& boundary);
 }
@@ -1,9 +1,14 @@
 #pragma once
 
+#include <cstdint>
+#include <ctime>
+#include <optional>
 #include <string>
 #include <array>
 #include <unordered_map>
+#include <vector>
 #include "constants.hpp"
+#include "data_types.hpp"
 #include "utils/common.hpp"
 
 namespace http {
@@ -12,6 +17,16 @@ namespace http {
 	std::string stringOf(Header header);
 	std::string stringOf(StatusCode code);
 
+	const std::string& statusLineOf(StatusCode code);
+	const std::string& dateField();
+	void updateDateField(std::time_t now);
+
+	std::string formatHttpDate(std::time_t time);
+	std::optional<std::time_t> parseHttpDate(const std::string& date);
+	std::string entityTagOf(std::uint64_t inode, std::uint64_t size, const struct timespec& mtime);
+	std::optional<std::vector<ByteRange>> parseRange(const std::string& value, std::size_t size);
+	double qualityOf(const std::string& acceptHeader, const std::string& token);
+
 	bool hasHeaderName(const std::string &headerName);
 	bool isValidHeaderField(const std::string &headerField);
 
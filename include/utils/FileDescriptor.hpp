@@ -0,0 +1,18 @@
+#pragma once
+
+namespace utils {
+	// Owns a file descriptor, which is closed together with the last owner
+	class FileDescriptor {
+		public:
+			explicit FileDescriptor(int fd);
+			FileDescriptor(const FileDescriptor&) = delete;
+			~FileDescriptor();
+
+			FileDescriptor& operator=(const FileDescriptor&) = delete;
+
+			int get() const;
+
+		private:
+			int _fd;
+	};
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <filesystem>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+namespace utils {
+	/**
+	 * Recursive inotify watch over a set of directories.
+	 *
+	 * The fd is polled by the event loop, which calls `process()` when it is
+	 * readable. Every handler then receives the path of each file or directory
+	 * that was created, modified, moved or deleted below a watched directory.
+	 * When the kernel queue overflows, handlers receive "/".
+	 */
+	class FileWatcher {
+		public:
+			using Handler = std::function<void(const std::filesystem::path& path)>;
+
+			FileWatcher();
+			FileWatcher(const FileWatcher&) = delete;
+			~FileWatcher();
+
+			FileWatcher& operator=(const FileWatcher&) = delete;
+
+			void watch(const std::filesystem::path& directory);
+			void onChange(Handler handler);
+			void process();
+
+			int getFd() const;
+			bool isActive() const;
+
+		private:
+			int _fd;
+			std::unordered_map<int, std::filesystem::path> _watches; // watch descriptor -> directory
+			std::vector<Handler> _handlers;
+
+			void _addWatch(const std::filesystem::path& directory);
+			void _notify(const std::filesystem::path& path);
+	};
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <filesystem>
+#include <list>
+#include <memory>
+#include <string>
+#include <sys/stat.h>
+#include <unordered_map>
+
+#include "FileDescriptor.hpp"
+
+namespace utils {
+	/**
+	 * Cache of statx results and open file descriptors keyed by path, in the
+	 * spirit of nginx's open_file_cache.
+	 *
+	 * `stat()` answers existence, type and permission questions and `open()`
+	 * additionally returns a shared descriptor for a regular file, so a hit
+	 * costs no syscall. Entries expire after the configured validity period
+	 * and are dropped earlier by `invalidate()`, called from inotify events.
+	 * Missing paths are not cached. The cache is disabled until
+	 * `configure()` is called, in which case every call goes to the filesystem.
+	 */
+	class OpenFileCache {
+		public:
+			struct Entry {
+				std::string path;
+				struct ::statx stat;
+				std::shared_ptr<const FileDescriptor> file;
+				std::chrono::steady_clock::time_point validUntil;
+
+				bool isDirectory() const;
+				bool isRegularFile() const;
+				bool isOwnerExecutable() const;
+				std::size_t size() const;
+			};
+
+			static OpenFileCache& instance();
+
+			OpenFileCache(const OpenFileCache&) = delete;
+			OpenFileCache& operator=(const OpenFileCache&) = delete;
+
+			void configure(std::size_t maxEntries, std::chrono::seconds validity);
+			void clear();
+			void invalidate(const std::filesystem::path& path);
+
+			std::shared_ptr<const Entry> stat(const std::filesystem::path& path);
+			std::shared_ptr<const Entry> open(const std::filesystem::path& path);
+
+			bool isEnabled() const;
+
+		private:
+			using LruList = std::list<std::shared_ptr<Entry>>;
+
+			std::size_t _maxEntries { 0 };
+			std::chrono::seconds _validity { 0 };
+			LruList _lru; // most recently used first
+			std::unordered_map<std::string, LruList::iterator> _entries;
+
+			OpenFileCache() = default;
+
+			std::shared_ptr<Entry> _find(const std::string& key);
+			void _insert(const std::shared_ptr<Entry>& entry);
+			void _erase(std::unordered_map<std::string, LruList::iterator>::iterator it);
+	};
+}
@@ -4,8 +4,13 @@
 #include <string.h>
 #include <filesystem>
 #include <fstream>
+#include <memory>
+#include <string>
 #include <vector>
 #include <unordered_map>
+#include <sys/uio.h>
+
+#include "FileDescriptor.hpp"
 
 namespace utils {
 	class Payload {
@@ -18,14 +23,20 @@ namespace utils {
 			Payload& operator=(const Payload&) = default;
 
 			virtual void send(int fd) = 0;
+			virtual std::size_t read(std::uint8_t* buffer, std::size_t size);
+			virtual std::size_t peek(struct iovec* iov, std::size_t count) const;
+			virtual std::size_t commit(std::size_t bytes);
 
 			virtual void append(const std::uint8_t* data, size_t size);
 
 			virtual std::string toString() const = 0;
 			virtual std::unique_ptr<Payload> clone() const = 0;
 
-			bool isSent() const;
+			virtual bool isSent() const;
+			virtual bool isBuffered() const;
+			virtual bool isPending() const;
 			std::size_t size() const;
+			std::size_t bytesSent() const;
 
 		protected:
 			std::size_t _totalBytes { 0 };
@@ -42,10 +53,14 @@ namespace utils {
 			CgiPayload& operator=(const CgiPayload&) = default;
 
 			void send(int fd) override;
+			std::size_t read(std::uint8_t* buffer, std::size_t size) override;
+			std::size_t peek(struct iovec* iov, std::size_t count) const override;
 			void append(const std::uint8_t* data, size_t size) override;
 			std::string toString() const override;
 			std::unique_ptr<Payload> clone() const override;
 
+			bool isBuffered() const override;
+
 			const std::unordered_map<std::string, std::string>& headerFields() const;
 
 		private:
@@ -63,31 +78,194 @@ namespace utils {
 			StringPayload& operator=(const StringPayload&) = default;
 
 			void send(int fd) override;
+			std::size_t read(std::uint8_t* buffer, std::size_t size) override;
+			std::size_t peek(struct iovec* iov, std::size_t count) const override;
 			void append(const std::uint8_t* data, size_t size) override;
 			std::string toString() const override;
 			std::unique_ptr<Payload> clone() const override;
 
-			void setMessage(const std::string &message);
+			bool isBuffered() const override;
+
+			void setMessage(std::string message);
+			std::string release();
 
 		private:
 			std::string _message;
 	};
 
+	/**
+	 * Sends an immutable buffer owned elsewhere (a cache entry, a canned
+	 * response, a mapping). `owner` keeps the memory alive for as long as
+	 * any copy of the payload exists.
+	 */
+	class BufferPayload : public Payload {
+		public:
+			BufferPayload(std::shared_ptr<const void> owner, const void* data, std::size_t size);
+			explicit BufferPayload(std::shared_ptr<const std::string> buffer);
+			BufferPayload(const BufferPayload&) = default;
+			BufferPayload(BufferPayload &&) noexcept = default;
+			~BufferPayload() = default;
+
+			BufferPayload& operator=(const BufferPayload&) = default;
+
+			void send(int fd) override;
+			std::size_t read(std::uint8_t* buffer, std::size_t size) override;
+			std::size_t peek(struct iovec* iov, std::size_t count) const override;
+			std::string toString() const override;
+			std::unique_ptr<Payload> clone() const override;
+
+			bool isBuffered() const override;
+
+		private:
+			std::shared_ptr<const void> _owner;
+			const std::uint8_t* _data;
+	};
+
+	/**
+	 * Base of payloads produced on the fly from another payload, whose
+	 * length is not known up front. `send()` pulls the next block through
+	 * `_produce()` whenever the previous one has been written out.
+	 */
+	class StreamPayload : public Payload {
+		public:
+			StreamPayload(std::unique_ptr<Payload> source);
+			StreamPayload(const StreamPayload& other);
+			StreamPayload(StreamPayload &&) noexcept = default;
+			~StreamPayload() = default;
+
+			StreamPayload& operator=(const StreamPayload& other) = delete;
+
+			void send(int fd) override;
+			std::size_t read(std::uint8_t* buffer, std::size_t size) override;
+			std::size_t peek(struct iovec* iov, std::size_t count) const override;
+			std::size_t commit(std::size_t bytes) override;
+			std::string toString() const override;
+
+			bool isSent() const override;
+
+		protected:
+			std::unique_ptr<Payload> _source;
+			std::vector<std::uint8_t> _pending;
+			std::size_t _pendingOffset { 0 };
+			bool _isFinished { false };
+
+			// Appends the next block to _pending, sets _isFinished after the last one
+			virtual void _produce() = 0;
+	};
+
+	/**
+	 * Deflates another payload into a gzip stream block by block, so only
+	 * what the socket can take is ever compressed ahead.
+	 */
+	class GzipPayload : public StreamPayload {
+		public:
+			GzipPayload(std::unique_ptr<Payload> source, int level);
+			GzipPayload(const GzipPayload& other);
+			GzipPayload(GzipPayload &&) noexcept = default;
+			~GzipPayload();
+
+			std::unique_ptr<Payload> clone() const override;
+
+		private:
+			struct Stream;
+
+			std::unique_ptr<Stream> _stream;
+
+			void _produce() override;
+	};
+
+	// Frames another payload with the chunked transfer coding
+	class ChunkedPayload : public StreamPayload {
+		public:
+			explicit ChunkedPayload(std::unique_ptr<Payload> source);
+			ChunkedPayload(const ChunkedPayload& other) = default;
+			ChunkedPayload(ChunkedPayload &&) noexcept = default;
+			~ChunkedPayload() = default;
+
+			std::unique_ptr<Payload> clone() const override;
+
+		private:
+			void _produce() override;
+	};
+
+	/**
+	 * Sends a sequence of payloads back to back, e.g. the parts of a
+	 * multipart/byteranges body.
+	 */
+	class CompositePayload : public Payload {
+		public:
+			CompositePayload() = default;
+			CompositePayload(const CompositePayload& other);
+			CompositePayload(CompositePayload &&) noexcept = default;
+			~CompositePayload() = default;
+
+			CompositePayload& operator=(const CompositePayload& other);
+
+			void send(int fd) override;
+			std::size_t read(std::uint8_t* buffer, std::size_t size) override;
+			std::size_t peek(struct iovec* iov, std::size_t count) const override;
+			std::size_t commit(std::size_t bytes) override;
+			std::string toString() const override;
+			std::unique_ptr<Payload> clone() const override;
+
+			bool isBuffered() const override;
+			bool isPending() const override;
+
+			CompositePayload& add(std::unique_ptr<Payload> part);
+
+		private:
+			std::vector<std::unique_ptr<Payload>> _parts;
+			std::size_t _current { 0 };
+	};
+
+	/**
+	 * Streams a file with sendfile(2), so the content goes from the page
+	 * cache to the socket without being copied through user space. When the
+	 * socket or file does not support sendfile, it falls back to pread/send.
+	 *
+	 * The descriptor may be shared with the open file cache and with copies
+	 * of the payload, reads always go through an explicit offset. A payload
+	 * may cover only `size` bytes starting at `offset`, for range requests.
+	 *
+	 * A large file whose next pages are not in the page cache would make
+	 * sendfile block the event loop on the disk. Such a file is read ahead
+	 * on the ReadAhead threads instead, into two buffers that are sent while
+	 * the other one is filled. The payload is pending while the buffer to
+	 * send next is still being read.
+	 */
 	class FilePayload : public Payload {
 		public:
 			FilePayload(const std::filesystem::path &filePath);
+			FilePayload(const std::filesystem::path &filePath, std::shared_ptr<const FileDescriptor> file, std::size_t size, std::size_t offset = 0);
 			FilePayload(const FilePayload& other);
-			FilePayload(FilePayload &&) noexcept = default;
+			FilePayload(FilePayload &&other) noexcept = default;
 			~FilePayload() = default;
 
 			FilePayload& operator=(const FilePayload& other);
 
 			void send(int fd) override;
+			std::size_t read(std::uint8_t* buffer, std::size_t size) override;
 			std::string toString() const override;
 			std::unique_ptr<Payload> clone() const override;
 
+			bool isPending() const override;
+
+			FilePayload& useSendfile(bool enabled);
+
 		private:
+			struct ReadAheadState;
+
 			std::filesystem::path _filePath;
-			mutable std::ifstream _ifstream;
+			std::shared_ptr<const FileDescriptor> _file;
+			std::size_t _offset { 0 };
+			bool _useSendfile { true };
+			std::shared_ptr<ReadAheadState> _readAhead; // Set once the file turned out to be cold, never shared by copies
+			std::size_t _nextProbe { 0 };					// Bytes sent before the page cache is probed again
+
+			ssize_t _readAndSend(int fd, std::size_t size);
+			bool _isCold(std::size_t size) const;
+			void _startReadAhead();
+			void _scheduleRead(std::size_t index);
+			ssize_t _sendReadAhead(int fd);
 	};
 }
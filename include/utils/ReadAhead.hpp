@@ -0,0 +1,45 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace utils {
+	/**
+	 * A small thread pool for disk reads that would block the event loop.
+	 *
+	 * Jobs run on background threads, which are started with the first job.
+	 * Each finished job bumps an eventfd, which the event loop polls and
+	 * drains with `process()` before it resumes the connections that were
+	 * waiting for their data.
+	 */
+	class ReadAhead {
+		public:
+			using Job = std::function<void()>;
+
+			static ReadAhead& instance();
+
+			ReadAhead(const ReadAhead&) = delete;
+			ReadAhead& operator=(const ReadAhead&) = delete;
+
+			void submit(Job job);
+			void process();
+
+			int getFd() const;
+			bool isActive() const;
+
+		private:
+			int _fd;
+			std::vector<std::thread> _threads;
+			std::deque<Job> _jobs;
+			std::mutex _mutex;
+			std::condition_variable _hasJobs;
+
+			ReadAhead();
+
+			void _run();
+	};
+}
@@ -5,6 +5,7 @@
 #include <string>
 #include <initializer_list>
 #include <algorithm>
+#include <chrono>
 #include <iterator>
 // #include "http/Request.hpp"
 
@@ -19,6 +20,8 @@ namespace utils {
     std::string trim(const std::string &str);
 
     int parsePort(const std::string &value);
+	std::size_t parseCount(const std::string &value);
+	std::chrono::seconds parseDuration(const std::string &value);
 
 	bool isValidPath(const std::string& rawPath);
     bool isValidFilePath(const std::string &path);
@@ -6,5 +6,5 @@
 
 namespace utils {
 	bool setNonBlocking(int fd);
-	int createPassiveSocket(const char* host, int port, int backlog, bool isNonBlocking);
+	int createPassiveSocket(const char* host, int port, int backlog, bool isNonBlocking, bool isReusePort = false);
 }
@@ -0,0 +1,187 @@
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "http/Bundle.hpp"
+#include "utils/FileDescriptor.hpp"
+
+namespace fs = std::filesystem;
+
+namespace http {
+	Bundle::Bundle(const std::uint8_t* data, std::size_t size)
+		: _data(data)
+		, _size(size)
+		, _header(reinterpret_cast<const Header*>(data))
+		, _seeds(nullptr)
+		, _slots(nullptr)
+		, _entries(nullptr) {
+	}
+
+	Bundle::~Bundle() {
+		::munmap(const_cast<std::uint8_t*>(_data), _size);
+	}
+
+	// Maps the archive at `path`, returns nullptr when it can not be read or is not a valid bundle
+	std::shared_ptr<const Bundle> Bundle::open(const fs::path& path) {
+		utils::FileDescriptor fd(::open(path.c_str(), O_RDONLY | O_CLOEXEC));
+		struct ::stat st;
+
+		if (fd.get() == -1 || ::fstat(fd.get(), &st) == -1 || static_cast<std::size_t>(st.st_size) < sizeof(Header)) {
+			return nullptr;
+		}
+
+		const std::size_t size = static_cast<std::size_t>(st.st_size);
+		void* data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd.get(), 0);
+
+		if (data == MAP_FAILED) {
+			return nullptr;
+		}
+
+		// The index and the small files are read on every request, fault them in now
+		::madvise(data, size, MADV_WILLNEED);
+
+		std::shared_ptr<Bundle> bundle(new Bundle(static_cast<const std::uint8_t*>(data), size));
+
+		return bundle->_loadIndex() ? bundle : nullptr;
+	}
+
+	// FNV-1a with a splitmix64 finalizer, `seed` picks one function of the family
+	std::uint64_t Bundle::hashOf(std::string_view key, std::uint32_t seed) {
+		std::uint64_t hash = 0xcbf29ce484222325ULL ^ (seed * 0x9e3779b97f4a7c15ULL);
+
+		for (const char c : key) {
+			hash ^= static_cast<std::uint8_t>(c);
+			hash *= 0x100000001b3ULL;
+		}
+
+		hash ^= hash >> 30;
+		hash *= 0xbf58476d1ce4e5b9ULL;
+		hash ^= hash >> 27;
+		hash *= 0x94d049bb133111ebULL;
+		hash ^= hash >> 31;
+		return hash;
+	}
+
+	// The bucket hash picks a seed, the seeded hash picks the slot, the path tells a hit from a miss
+	const Bundle::Entry* Bundle::find(std::string_view path) const {
+		if (_header->entryCount == 0) {
+			return nullptr;
+		}
+
+		const std::uint32_t seed = _seeds[hashOf(path, 0) % _header->bucketCount];
+		const std::uint32_t index = _slots[hashOf(path, seed) % _header->slotCount];
+
+		if (index == EMPTY_SLOT || viewOf(_entries[index].path) != path) {
+			return nullptr;
+		}
+
+		return &_entries[index];
+	}
+
+	std::string_view Bundle::viewOf(const Span& span) const {
+		return std::string_view(reinterpret_cast<const char*>(_data) + span.offset, span.size);
+	}
+
+	std::size_t Bundle::size() const {
+		return _header->entryCount;
+	}
+
+	// Locates the tables and checks every span once, so lookups never need to
+	bool Bundle::_loadIndex() {
+		const Header& header = *_header;
+
+		if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.bucketCount == 0 || header.slotCount < header.entryCount) {
+			return false;
+		}
+
+		const Span tables[] = {
+			{ header.seedsOffset, std::uint64_t { header.bucketCount } * sizeof(std::uint32_t) },
+			{ header.slotsOffset, std::uint64_t { header.slotCount } * sizeof(std::uint32_t) },
+			{ header.entriesOffset, std::uint64_t { header.entryCount } * sizeof(Entry) },
+		};
+
+		for (const Span& table : tables) {
+			if (!_contains(table) || table.offset % alignof(std::uint64_t) != 0) {
+				return false;
+			}
+		}
+
+		_seeds = reinterpret_cast<const std::uint32_t*>(_data + header.seedsOffset);
+		_slots = reinterpret_cast<const std::uint32_t*>(_data + header.slotsOffset);
+		_entries = reinterpret_cast<const Entry*>(_data + header.entriesOffset);
+
+		for (std::uint32_t i = 0; i < header.slotCount; i++) {
+			if (_slots[i] != EMPTY_SLOT && _slots[i] >= header.entryCount) {
+				return false;
+			}
+		}
+
+		for (std::uint32_t i = 0; i < header.entryCount; i++) {
+			const Entry& entry = _entries[i];
+
+			if (!_contains(entry.path) || entry.variants[IDENTITY].entityTag.size == 0) {
+				return false;
+			}
+
+			for (const Variant& variant : entry.variants) {
+				if (!_contains(variant.content) || !_contains(variant.entityTag) || !_contains(variant.headerFields)) {
+					return false;
+				}
+			}
+		}
+
+		return true;
+	}
+
+	bool Bundle::_contains(const Span& span) const {
+		return span.offset <= _size && span.size <= _size - span.offset;
+	}
+
+	Bundles& Bundles::instance() {
+		static Bundles bundles;
+		return bundles;
+	}
+
+	// Maps the bundle at `path` unless it already is, returns whether it can be served
+	bool Bundles::add(const fs::path& path) {
+		const std::string key = path.lexically_normal().string();
+
+		if (_bundles.contains(key)) {
+			return true;
+		}
+
+		auto bundle = Bundle::open(path);
+
+		if (bundle == nullptr) {
+			std::cerr << "Invalid bundle " << path << std::endl;
+			return false;
+		}
+
+		_bundles[key] = bundle;
+		return true;
+	}
+
+	// Maps the bundles at or below `path` again, a bundle that is gone or broken keeps its last mapping
+	void Bundles::refresh(const fs::path& path) {
+		const std::string normalized = path.lexically_normal().string();
+		const std::string prefix = normalized.ends_with('/') ? normalized : normalized + "/";
+
+		for (auto& [key, bundle] : _bundles) {
+			if (key != normalized && !key.starts_with(prefix)) {
+				continue;
+			}
+
+			if (auto reopened = Bundle::open(key)) {
+				bundle = reopened;
+			}
+		}
+	}
+
+	std::shared_ptr<const Bundle> Bundles::get(const fs::path& path) const {
+		auto it = _bundles.find(path.lexically_normal().string());
+		return (it == _bundles.end()) ? nullptr : it->second;
+	}
+}
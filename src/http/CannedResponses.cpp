@@ -0,0 +1,90 @@
+#include <fstream>
+#include <iterator>
+
+#include "http/CannedResponses.hpp"
+#include "http/utils.hpp"
+
+namespace fs = std::filesystem;
+
+namespace http {
+	CannedResponses& CannedResponses::instance() {
+		static CannedResponses responses;
+		return responses;
+	}
+
+	// Serializes `page` as the response for `statusCode`, a page that can not be read is left to Response::setFile
+	void CannedResponses::add(StatusCode statusCode, const fs::path& page) {
+		const std::string key = _keyOf(statusCode, page);
+
+		if (_entries.contains(key)) {
+			return;
+		}
+
+		if (auto message = _load(page)) {
+			_entries[key] = { statusCode, page.lexically_normal(), message };
+		}
+	}
+
+	// Reloads the pages at or below `path`, dropping the ones that are gone
+	void CannedResponses::refresh(const fs::path& path) {
+		const fs::path normalized = path.lexically_normal();
+		const std::string prefix = normalized.string().ends_with('/') ? normalized.string() : normalized.string() + "/";
+
+		for (auto it = _entries.begin(); it != _entries.end();) {
+			Entry& entry = it->second;
+
+			if (entry.page != normalized && !entry.page.string().starts_with(prefix)) {
+				it++;
+				continue;
+			}
+
+			if (auto message = _load(entry.page)) {
+				entry.message = message;
+				it++;
+				continue;
+			}
+
+			it = _entries.erase(it);
+		}
+	}
+
+	std::shared_ptr<const std::string> CannedResponses::get(StatusCode statusCode, const fs::path& page) const {
+		auto it = _entries.find(_keyOf(statusCode, page));
+		return (it == _entries.end()) ? nullptr : it->second.message;
+	}
+
+	// Everything after the status line, Date and Server fields, which Response::setCanned() writes per response
+	std::shared_ptr<const std::string> CannedResponses::serialize(const std::string& headerFields, const std::string& body) {
+		auto message = std::make_shared<std::string>();
+
+		message->reserve(headerFields.size() + body.size() + 64);
+		*message += headerFields;
+		*message += stringOf(Header::CONTENT_LENGTH) + ": " + std::to_string(body.size()) + "\r\n\r\n";
+		*message += body;
+		return message;
+	}
+
+	std::shared_ptr<const std::string> CannedResponses::serializeRedirect(const std::string& location) {
+		return serialize(stringOf(Header::LOCATION) + ": " + location + "\r\n", "");
+	}
+
+	std::string CannedResponses::_keyOf(StatusCode statusCode, const fs::path& page) {
+		return std::to_string(static_cast<std::uint16_t>(statusCode)) + ":" + page.lexically_normal().string();
+	}
+
+	std::shared_ptr<const std::string> CannedResponses::_load(const fs::path& page) {
+		std::ifstream file(page, std::ios::binary);
+
+		if (!file.is_open() || !fs::is_regular_file(page)) {
+			return nullptr;
+		}
+
+		const std::string body((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		const std::string extension = page.extension().string();
+		const std::string headerFields =
+			stringOf(Header::CONTENT_TYPE) + ": " + getMimeType(extension.empty() ? extension : extension.substr(1)) + "\r\n"
+			+ stringOf(Header::CACHE_CONTROL) + ": no-store\r\n";
+
+		return serialize(headerFields, body);
+	}
+}
@@ -5,19 +5,48 @@
 #include <iostream>
 #include <algorithm>
 #include <array>
+#include <climits>
 #include <iterator>
+#include <system_error>
 
 #include "http/index.hpp"
+#include "http/ZeroCopyReaper.hpp"
 #include "utils/common.hpp"
 
 using std::chrono::steady_clock;
 using std::chrono::duration_cast;
 using std::chrono::milliseconds;
 
+namespace {
+	constexpr std::size_t MAX_PIPELINED_REQUESTS = 32;
+
+	std::array<struct iovec, IOV_MAX> iovecs;
+
+	bool closesConnection(const http::Request& req, const http::Response& res) {
+		using enum http::StatusCode;
+
+		const http::StatusCode code = res.getStatusCode();
+
+		return (
+			req.getHeader(http::Header::CONNECTION).value_or("") == "close"
+			|| code == BAD_REQUEST_400
+			|| code == REQUEST_TIMEOUT_408
+			|| code == INTERNAL_SERVER_ERROR_500
+			|| code == SERVICE_UNAVAILABLE_503
+			|| code == GATEWAY_TIMEOUT_504
+		);
+	}
+}
+
 namespace http {
 	Connection::Connection(int clientSocket, const ServerConfig& serverConfig)
 		: _clientFd(clientSocket)
-		, _serverConfig(serverConfig) {
+		, _serverConfig(&serverConfig)
+		, _lastReceived(steady_clock::now()) {
+		if (serverConfig.zeroCopyMinSize > 0) {
+			const int enabled = 1;
+			_isZeroCopyEnabled = (::setsockopt(clientSocket, SOL_SOCKET, SO_ZEROCOPY, &enabled, sizeof(enabled)) == 0);
+		}
 	}
 
 	void Connection::read() {
@@ -25,78 +54,149 @@ namespace http {
 			return;
 		}
 
-		unsigned char buf[4096];
-		ssize_t bytesRead = recv(_clientFd, buf, sizeof(buf), MSG_NOSIGNAL);
+		ssize_t bytesRead = _canSpliceBody() ? _spliceBody() : _receive();
 
-		if (bytesRead > 0) {
-			_buffer.reserve(_buffer.size() + bytesRead);
-			_buffer.insert(_buffer.end(), buf, buf + bytesRead);
+		// A body that could not be stored still gets its request answered, with a 400
+		if (bytesRead > 0 || _request.getStatus() == Request::Status::BAD) {
 			_lastReceived = steady_clock::now();
 
 			if (_requestHandleStart == TimePoint::min()) {
 				_requestHandleStart = steady_clock::now();
 			}
 
-			if (_queue.size() > 0) {
-				return;
+			if (!_isClosing) {
+				_parseRequests();
 			}
+		}
+	}
 
-			_processBuffer();
-
-			if (_request.getStatus() == Request::Status::BAD || _request.getStatus() == Request::Status::COMPLETE) {
-				_requestHandleStart = TimePoint::min();
-				Response res(_clientFd);
-
-				res.onStatusChanged([this](Response::Status status) {
-					if (status == Response::Status::PENDING) {
-						_responseHandleStart = steady_clock::now();
-					} else if (status == Response::Status::READY) {
-						_responseHandleStart = TimePoint::min();
-					}
-				});
+	// Hands every request that has not been routed yet to `handler`, in arrival order
+	void Connection::handleRequests(const std::function<void(Request&, Response&)>& handler) {
+		if (_isClosing) {
+			return;
+		}
 
-				_queue.emplace(std::move(_request), res);
-				_request.clear();
+		for (auto& [req, res] : _queue) {
+			if (res.getStatus() == Response::Status::PENDING) {
+				handler(req, res);
 			}
 		}
 	}
 
+	/**
+	 * Flushes the ready responses at the front of the queue. The header and
+	 * in-memory body of consecutive responses are chained into one sendmsg of
+	 * up to IOV_MAX segments. The chain ends at a response whose body has to
+	 * be streamed (file, gzip) or is large enough for MSG_ZEROCOPY, which
+	 * then goes out on its own.
+	 * Returns true once no ready response is left to send, or the next one
+	 * waits for a background read and the event loop resumes it later. A body
+	 * that fails to read closes the connection.
+	 */
 	bool Connection::sendResponse() {
-		if (isClosed() || _queue.empty()) {
+		if (isClosed()) {
 			return false;
 		}
 
-		auto& [req, res] = _queue.front();
-
-		if (res.getStatus() != Response::Status::READY) {
-			return false;
+		if (!hasReadyResponse()) {
+			return true;
 		}
 
 		if (_responseDeliveryStart == TimePoint::min()) {
 			_responseDeliveryStart = steady_clock::now();
 		}
 
-		if (res.send()) {
-			_responseDeliveryStart = TimePoint::min();
-			const StatusCode code = res.getStatusCode();
-			auto connectionHeader = req.getHeader(Header::CONNECTION);
-			_queue.pop();
+		std::size_t count = 0;
+		bool hasMore = false;
 
-			if (
-				connectionHeader.value_or("") == "close"
-				|| code == StatusCode::BAD_REQUEST_400
-				|| code == StatusCode::REQUEST_TIMEOUT_408
-				|| code == StatusCode::INTERNAL_SERVER_ERROR_500
-				|| code == StatusCode::SERVICE_UNAVAILABLE_503
-				|| code == StatusCode::GATEWAY_TIMEOUT_504
-			) {
-				this->close();
+		for (const auto& [req, res] : _queue) {
+			if (res.getStatus() != Response::Status::READY || count == iovecs.size()) {
+				break;
 			}
 
-			return true;
+			if (_isZeroCopyCandidate(res)) {
+				count += res.getHeader().peek(iovecs.data() + count, iovecs.size() - count);
+				hasMore = true;
+				break;
+			}
+
+			count += res.peek(iovecs.data() + count, iovecs.size() - count);
+
+			if (!res.isBuffered()) {
+				hasMore = true;
+				break;
+			}
+
+			if (closesConnection(req, res)) {
+				break;
+			}
 		}
 
-		return false;
+		if (count > 0) {
+			struct msghdr message {};
+			message.msg_iov = iovecs.data();
+			message.msg_iovlen = count;
+
+			const ssize_t bytesSent = ::sendmsg(_clientFd, &message, MSG_NOSIGNAL | (hasMore ? MSG_MORE : 0));
+
+			if (bytesSent > 0) {
+				std::size_t remaining = static_cast<std::size_t>(bytesSent);
+
+				for (auto it = _queue.begin(); it != _queue.end() && remaining > 0; ++it) {
+					remaining -= it->second.commit(remaining);
+				}
+			}
+		}
+
+		_popSentResponses();
+
+		if (hasReadyResponse()) {
+			Response& res = _queue.front().second;
+
+			if (res.getHeader().isSent() && _isZeroCopyCandidate(res)) {
+				_sendZeroCopy(res);
+				_popSentResponses();
+			} else if (res.getHeader().isSent() && !res.isBuffered()) {
+				// A file that fails to read cannot finish its response, only this connection is dropped
+				try {
+					res.send();
+				} catch (const std::ios_base::failure& e) {
+					std::cerr << e.what() << std::endl;
+					close();
+					return false;
+				}
+
+				_popSentResponses();
+			}
+		}
+
+		return !hasReadyResponse() || _queue.front().second.isPending();
+	}
+
+	/**
+	 * Reads the MSG_ZEROCOPY completions from the socket error queue and
+	 * releases the bodies the kernel is done with. Returns false when there
+	 * was none, the POLLERR then reports a real socket error.
+	 */
+	bool Connection::readErrorQueue() {
+		bool isCopied = false;
+
+		if (isClosed() || !ZeroCopyReaper::readCompletions(_clientFd, _zeroCopyCompleted, isCopied)) {
+			return false;
+		}
+
+		ZeroCopyReaper::releaseCompleted(_zeroCopyPins, _zeroCopyCompleted);
+
+		// The kernel had to copy anyway (loopback, no scatter-gather), pinning only adds overhead then
+		if (isCopied) {
+			_isZeroCopyEnabled = false;
+		}
+
+		if (_isClosing && _zeroCopyPins.empty()) {
+			this->close();
+		}
+
+		return true;
 	}
 
 	void Connection::close() {
@@ -104,13 +204,28 @@ namespace http {
 			return;
 		}
 
-		if (::close(_clientFd) < 0) {
+		// A body partly sent with MSG_ZEROCOPY is still read by the kernel
+		if (_frontZeroCopySeq.has_value() && !_isZeroCopyComplete(*_frontZeroCopySeq) && !_queue.empty()) {
+			_zeroCopyPins.emplace_back(*_frontZeroCopySeq, _queue.front().second.releaseBody());
+		}
+
+		_frontZeroCopySeq.reset();
+
+		if (!_zeroCopyPins.empty()) {
+			ZeroCopyReaper::instance().adopt(_clientFd, _zeroCopyCompleted, std::move(_zeroCopyPins));
+			_zeroCopyPins.clear();
+		} else if (::close(_clientFd) < 0) {
 			std::cerr << "Failed to close socket " << _clientFd << ": " << strerror(errno) << std::endl;
 		}
 
 		_clientFd = -1;
 	}
 
+	// `handler` returns the server block the request is for, its limits and timeouts apply from then on
+	void Connection::onHeaderComplete(std::function<const ServerConfig&(Request&)> handler) {
+		_headerCompleteHandler = handler;
+	}
+
 	bool Connection::isClosed() const {
 		return (_clientFd == -1);
 	}
@@ -122,13 +237,13 @@ namespace http {
 		if (_requestHandleStart != TimePoint::min() && now >= _requestHandleStart) {
 			const std::size_t elapsedTime = duration_cast<milliseconds>(now - _requestHandleStart).count();
 
-			if (elapsedTime >= _serverConfig.msRequestTimeout) {
+			if (elapsedTime >= _serverConfig->msRequestTimeout) {
 				std::cout << "Request took too long! Timed out" << std::endl;
 				return true;
 			}
 		}
 
-		if (idleTimeDiff >= _serverConfig.msIdleTimeout) {
+		if (idleTimeDiff >= _serverConfig->msIdleTimeout) {
 			std::cout << "Timed out due to inactivity" << std::endl;
 			return true;
 		}
@@ -136,7 +251,7 @@ namespace http {
 		if (_responseHandleStart != TimePoint::min() && now >= _responseHandleStart) {
 			const std::size_t elapsedTime = duration_cast<milliseconds>(now - _responseHandleStart).count();
 
-			if (elapsedTime >= _serverConfig.msResponseHandlingTimeout) {
+			if (elapsedTime >= _serverConfig->msResponseHandlingTimeout) {
 				std::cout << "Processing response timed out" << std::endl;
 				return true;
 			}
@@ -145,7 +260,7 @@ namespace http {
 		if (_responseDeliveryStart != TimePoint::min() && now >= _responseDeliveryStart) {
 			const std::size_t elapsedTime = duration_cast<milliseconds>(now - _responseDeliveryStart).count();
 
-			if (elapsedTime >= _serverConfig.msResponseDeliveryTimeout) {
+			if (elapsedTime >= _serverConfig->msResponseDeliveryTimeout) {
 				std::cout << "Delivery response timed out" << std::endl;
 				return true;
 			}
@@ -154,6 +269,10 @@ namespace http {
 		return false;
 	}
 
+	bool Connection::hasReadyResponse() const {
+		return (!isClosed() && !_isClosing && !_queue.empty() && _queue.front().second.getStatus() == Response::Status::READY);
+	}
+
 	Request* Connection::getRequest() {
 		if (_queue.size() == 0) {
 			return nullptr;
@@ -176,12 +295,180 @@ namespace http {
 		return _clientFd;
 	}
 
+	/**
+	 * Once the buffered part of a file-backed Content-Length body has been
+	 * flushed, the rest of it can bypass `_buffer` and go from the socket
+	 * straight into the body file.
+	 */
+	bool Connection::_canSpliceBody() const {
+		return (
+			_queue.empty()
+			&& _buffer.empty()
+			&& _request.getStatus() == Request::Status::HEADER_COMPLETE
+			&& _request.getMethod() == "POST"
+			&& !_request.isChunkEncoding()
+			&& _request.getBody().isInFile()
+			&& _request.getBody().size() < _request.getContentLength()
+		);
+	}
+
+	ssize_t Connection::_receive() {
+		unsigned char buf[4096];
+		ssize_t bytesRead = recv(_clientFd, buf, sizeof(buf), MSG_NOSIGNAL);
+
+		if (bytesRead > 0) {
+			_buffer.reserve(_buffer.size() + bytesRead);
+			_buffer.insert(_buffer.end(), buf, buf + bytesRead);
+		}
+
+		return bytesRead;
+	}
+
+	ssize_t Connection::_spliceBody() {
+		try {
+			ssize_t bytesRead = _request.spliceBody(_clientFd);
+
+			if (bytesRead == -1 && errno == EINVAL) {
+				return _receive();
+			}
+
+			return bytesRead;
+		} catch (const std::system_error& e) {
+			std::cerr << "Failed to store request body: " << e.what() << std::endl;
+			_request.setStatus(Request::Status::BAD);
+			return -1;
+		}
+	}
+
+	/**
+	 * Parses every complete request already buffered, so the responses of a
+	 * pipelining client can be flushed together. Once MAX_PIPELINED_REQUESTS
+	 * are queued, the rest waits in _buffer until earlier ones are answered.
+	 */
+	void Connection::_parseRequests() {
+		using enum Request::Status;
+
+		while (_queue.size() < MAX_PIPELINED_REQUESTS) {
+			_processBuffer();
+
+			const Request::Status status = _request.getStatus();
+
+			if (status != BAD && status != COMPLETE) {
+				return;
+			}
+
+			_requestHandleStart = TimePoint::min();
+			Response res(_clientFd);
+
+			if (!_headerBuffers.empty()) {
+				res.reuseHeaderBuffer(std::move(_headerBuffers.back()));
+				_headerBuffers.pop_back();
+			}
+
+			res.onStatusChanged([this](Response::Status status) {
+				if (status == Response::Status::PENDING) {
+					_responseHandleStart = steady_clock::now();
+				} else if (status == Response::Status::READY) {
+					_responseHandleStart = TimePoint::min();
+				}
+			});
+
+			_queue.emplace_back(std::move(_request), std::move(res));
+			_request.clear();
+
+			if (status == BAD || _buffer.empty()) {
+				return;
+			}
+		}
+	}
+
+	// Drops the fully sent responses, closing the connection after one that ends it
+	void Connection::_popSentResponses() {
+		const bool wasFull = (_queue.size() >= MAX_PIPELINED_REQUESTS);
+
+		while (!_queue.empty()) {
+			auto& [req, res] = _queue.front();
+
+			if (res.getStatus() != Response::Status::READY || !res.isSent()) {
+				break;
+			}
+
+			const bool isLast = closesConnection(req, res);
+
+			if (_frontZeroCopySeq.has_value()) {
+				if (!_isZeroCopyComplete(*_frontZeroCopySeq)) {
+					_zeroCopyPins.emplace_back(*_frontZeroCopySeq, res.releaseBody());
+				}
+
+				_frontZeroCopySeq.reset();
+			}
+
+			_headerBuffers.push_back(res.releaseHeaderBuffer());
+			_queue.pop_front();
+			_responseDeliveryStart = TimePoint::min();
+
+			if (isLast) {
+				if (_zeroCopyPins.empty()) {
+					this->close();
+				} else {
+					_isClosing = true;
+				}
+
+				return;
+			}
+		}
+
+		if (wasFull && !_buffer.empty()) {
+			_parseRequests();
+		}
+	}
+
+	bool Connection::_isZeroCopyCandidate(const Response& res) const {
+		const auto& body = res.getBody();
+
+		return (
+			_isZeroCopyEnabled
+			&& body != nullptr
+			&& !body->isSent()
+			&& body->isBuffered()
+			&& body->size() - body->bytesSent() >= _serverConfig->zeroCopyMinSize
+		);
+	}
+
+	bool Connection::_isZeroCopyComplete(std::uint32_t seq) const {
+		return static_cast<std::int32_t>(seq - _zeroCopyCompleted) < 0;
+	}
+
+	// Sends the rest of an in-memory body from its own pages, the body is kept until readErrorQueue() releases it
+	void Connection::_sendZeroCopy(Response& res) {
+		struct msghdr message {};
+		message.msg_iov = iovecs.data();
+		message.msg_iovlen = res.peek(iovecs.data(), iovecs.size());
+
+		ssize_t bytesSent = ::sendmsg(_clientFd, &message, MSG_NOSIGNAL | MSG_ZEROCOPY);
+
+		if (bytesSent == -1 && errno == ENOBUFS) {
+			// Out of optmem for pinned pages, copy this time
+			bytesSent = ::sendmsg(_clientFd, &message, MSG_NOSIGNAL);
+		} else if (bytesSent >= 0) {
+			_frontZeroCopySeq = _zeroCopySeq++;
+		}
+
+		if (bytesSent > 0) {
+			res.commit(static_cast<std::size_t>(bytesSent));
+		}
+	}
+
 	void Connection::_processBuffer() {
 		using enum Request::Status;
 
 		try {
 			if (_request.getStatus() == PENDING) {
 				parseRequestHeader(_buffer, _request);
+
+				if (_request.getStatus() == HEADER_COMPLETE && _headerCompleteHandler) {
+					_serverConfig = &_headerCompleteHandler(_request);
+				}
 			}
 
 			if (_request.getStatus() == HEADER_COMPLETE) {
@@ -191,11 +478,15 @@ namespace http {
 				}
 
 				if (_request.getMethod() == "POST") {
-					parseRequestBody(_buffer, _request, _serverConfig.clientMaxBodySize);
+					_request.setBodyBufferSize(_serverConfig->clientBodyBufferSize);
+					parseRequestBody(_buffer, _request, _serverConfig->clientMaxBodySize);
 				}
 			}
 		} catch (const std::invalid_argument &e) {
 			_request.setStatus(BAD);
+		} catch (const std::system_error &e) {
+			std::cerr << "Failed to store request body: " << e.what() << std::endl;
+			_request.setStatus(BAD);
 		}
 	}
 }
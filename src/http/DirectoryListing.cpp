@@ -0,0 +1,307 @@
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <dirent.h>
+#include <fcntl.h>
+#include <numeric>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "http/DirectoryListing.hpp"
+
+namespace fs = std::filesystem;
+
+namespace {
+	constexpr std::size_t MAX_DIRECTORIES = 32;
+	constexpr std::size_t ROWS_PER_BLOCK = 256;
+
+	const char* const sortNames[] = { "name", "size", "modified" };
+
+	std::string escapeHtml(const std::string& text) {
+		std::string escaped;
+
+		escaped.reserve(text.size());
+
+		for (const char c : text) {
+			switch (c) {
+				case '&': escaped += "&amp;"; break;
+				case '<': escaped += "&lt;"; break;
+				case '>': escaped += "&gt;"; break;
+				case '"': escaped += "&quot;"; break;
+				case '\'': escaped += "&#39;"; break;
+				default: escaped += c;
+			}
+		}
+
+		return escaped;
+	}
+
+	// Percent-encodes a file name for use as a relative link
+	std::string encodeName(const std::string& name) {
+		static const char hex[] = "0123456789ABCDEF";
+		std::string encoded;
+
+		encoded.reserve(name.size());
+
+		for (const unsigned char c : name) {
+			if (std::isalnum(c) || c == '-' || c == '.' || c == '_' || c == '~') {
+				encoded += static_cast<char>(c);
+			} else {
+				encoded += '%';
+				encoded += hex[c >> 4];
+				encoded += hex[c & 0x0F];
+			}
+		}
+
+		return encoded;
+	}
+
+	std::string formatModified(std::time_t time) {
+		struct tm tm;
+		char buffer[32];
+
+		::gmtime_r(&time, &tm);
+		return std::string(buffer, std::strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M", &tm));
+	}
+
+	bool isBefore(http::DirectoryListing::SortKey key, const http::DirectoryListing::Item& a, const http::DirectoryListing::Item& b) {
+		using enum http::DirectoryListing::SortKey;
+
+		switch (key) {
+			case SIZE: return a.size < b.size;
+			case MODIFIED: return a.modified < b.modified;
+			default: return a.name < b.name;
+		}
+	}
+}
+
+namespace http {
+	// The item at `position` in the listing sorted by `key`, ties keep the name order
+	const DirectoryListing::Item& DirectoryListing::Entries::at(SortKey key, bool isDescending, std::size_t position) const {
+		const std::size_t index = isDescending ? items.size() - 1 - position : position;
+
+		if (key == SortKey::NAME) {
+			return items[index];
+		}
+
+		auto& order = orders[static_cast<std::size_t>(key)];
+
+		if (order.size() != items.size()) {
+			order.resize(items.size());
+			std::iota(order.begin(), order.end(), 0);
+			std::stable_sort(order.begin(), order.end(), [this, key](std::uint32_t a, std::uint32_t b) {
+				return isBefore(key, items[a], items[b]);
+			});
+		}
+
+		return items[order[index]];
+	}
+
+	DirectoryListing& DirectoryListing::instance() {
+		static DirectoryListing listing;
+		return listing;
+	}
+
+	// Returns the entries of `directory`, reading it again when its mtime changed. Returns nullptr when it can not be read.
+	std::shared_ptr<const DirectoryListing::Entries> DirectoryListing::get(const fs::path& directory) {
+		struct ::stat st;
+
+		if (::stat(directory.c_str(), &st) == -1 || !S_ISDIR(st.st_mode)) {
+			return nullptr;
+		}
+
+		const std::string key = directory.lexically_normal().string();
+
+		if (auto it = _entries.find(key); it != _entries.end()) {
+			const Entries& entries = **it->second;
+
+			if (entries.mtime.tv_sec == st.st_mtim.tv_sec && entries.mtime.tv_nsec == st.st_mtim.tv_nsec) {
+				_lru.splice(_lru.begin(), _lru, it->second);
+				return *it->second;
+			}
+
+			_lru.erase(it->second);
+			_entries.erase(it);
+		}
+
+		auto entries = _read(directory, st.st_mtim);
+
+		if (entries == nullptr) {
+			return nullptr;
+		}
+
+		_lru.push_front(entries);
+		_entries[key] = _lru.begin();
+
+		if (_lru.size() > MAX_DIRECTORIES) {
+			_entries.erase(_lru.back()->path.string());
+			_lru.pop_back();
+		}
+
+		return entries;
+	}
+
+	void DirectoryListing::clear() {
+		_lru.clear();
+		_entries.clear();
+	}
+
+	// Reads `sort`, `order` and `page` from the query string, anything unknown keeps the default
+	DirectoryListing::Page DirectoryListing::pageOf(const std::string& query, std::size_t pageSize) {
+		Page page;
+
+		page.size = std::max<std::size_t>(pageSize, 1);
+
+		for (std::size_t start = 0; start < query.size();) {
+			const std::size_t end = std::min(query.find('&', start), query.size());
+			const std::string parameter = query.substr(start, end - start);
+			const std::size_t equal = parameter.find('=');
+			const std::string name = parameter.substr(0, equal);
+			const std::string value = (equal == std::string::npos) ? "" : parameter.substr(equal + 1);
+
+			if (name == "sort") {
+				for (std::size_t i = 0; i < std::size(sortNames); i++) {
+					if (value == sortNames[i]) {
+						page.key = static_cast<SortKey>(i);
+					}
+				}
+			} else if (name == "order") {
+				page.isDescending = (value == "desc");
+			} else if (name == "page" && !value.empty() && std::all_of(value.begin(), value.end(), ::isdigit)) {
+				page.number = std::max<std::size_t>(std::strtoull(value.c_str(), nullptr, 10), 1);
+			}
+
+			start = end + 1;
+		}
+
+		return page;
+	}
+
+	std::shared_ptr<const DirectoryListing::Entries> DirectoryListing::_read(const fs::path& directory, const struct timespec& mtime) {
+		int fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+		if (fd == -1) {
+			return nullptr;
+		}
+
+		DIR* dir = ::fdopendir(fd);
+
+		if (dir == nullptr) {
+			::close(fd);
+			return nullptr;
+		}
+
+		auto entries = std::make_shared<Entries>();
+
+		entries->path = directory.lexically_normal();
+		entries->mtime = mtime;
+
+		while (const struct dirent* entry = ::readdir(dir)) {
+			const std::string name(entry->d_name);
+			struct ::stat st;
+
+			// Hidden files, "." and ".." are not listed
+			if (name.starts_with('.') || ::fstatat(fd, entry->d_name, &st, AT_SYMLINK_NOFOLLOW) == -1) {
+				continue;
+			}
+
+			entries->items.push_back({ name, S_ISDIR(st.st_mode), static_cast<std::uint64_t>(st.st_size), st.st_mtim.tv_sec });
+		}
+
+		::closedir(dir);
+		std::sort(entries->items.begin(), entries->items.end(), [](const Item& a, const Item& b) {
+			return a.name < b.name;
+		});
+
+		return entries;
+	}
+
+	DirectoryListingPayload::DirectoryListingPayload(
+		std::shared_ptr<const DirectoryListing::Entries> entries,
+		const std::string& requestPath,
+		DirectoryListing::Page page
+	)
+		: StreamPayload(nullptr)
+		, _entries(std::move(entries))
+		, _requestPath(requestPath)
+		, _page(page) {
+		const std::size_t count = _entries->items.size();
+		const std::size_t pageCount = std::max<std::size_t>((count + _page.size - 1) / _page.size, 1);
+
+		_page.number = std::min(_page.number, pageCount);
+		_next = std::min((_page.number - 1) * _page.size, count);
+		_end = std::min(_next + _page.size, count);
+	}
+
+	std::unique_ptr<utils::Payload> DirectoryListingPayload::clone() const {
+		return std::make_unique<DirectoryListingPayload>(*this);
+	}
+
+	// The page head first, then up to ROWS_PER_BLOCK rows per block, then the pagination links
+	void DirectoryListingPayload::_produce() {
+		using enum DirectoryListing::SortKey;
+
+		if (!_hasStarted) {
+			const std::string title = "Index of " + escapeHtml(_requestPath);
+
+			_hasStarted = true;
+			_append(
+				"<!DOCTYPE html>\n<html><head><meta charset=\"utf-8\"><title>" + title + "</title></head>\n"
+				"<body><h1>" + title + "</h1>\n<table>\n<tr>"
+				"<th><a href=\"" + _linkTo(NAME, _page.key == NAME && !_page.isDescending, 1) + "\">Name</a></th>"
+				"<th><a href=\"" + _linkTo(SIZE, _page.key == SIZE && !_page.isDescending, 1) + "\">Size</a></th>"
+				"<th><a href=\"" + _linkTo(MODIFIED, _page.key == MODIFIED && !_page.isDescending, 1) + "\">Last modified</a></th>"
+				"</tr>\n<tr><td><a href=\"../\">../</a></td><td></td><td></td></tr>\n"
+			);
+			return;
+		}
+
+		for (std::size_t rows = 0; _next < _end && rows < ROWS_PER_BLOCK; rows++, _next++) {
+			const DirectoryListing::Item& item = _entries->at(_page.key, _page.isDescending, _next);
+			const std::string suffix = item.isDirectory ? "/" : "";
+
+			_append(
+				"<tr><td><a href=\"" + encodeName(item.name) + suffix + "\">" + escapeHtml(item.name) + suffix + "</a></td>"
+				"<td>" + (item.isDirectory ? "-" : std::to_string(item.size)) + "</td>"
+				"<td>" + formatModified(item.modified) + "</td></tr>\n"
+			);
+		}
+
+		if (_next < _end) {
+			return;
+		}
+
+		const std::size_t count = _entries->items.size();
+		const std::size_t pageCount = std::max<std::size_t>((count + _page.size - 1) / _page.size, 1);
+		std::string footer = "</table>\n";
+
+		if (pageCount > 1) {
+			footer += "<p>";
+
+			if (_page.number > 1) {
+				footer += "<a href=\"" + _linkTo(_page.key, _page.isDescending, _page.number - 1) + "\">Previous</a> ";
+			}
+
+			footer += "Page " + std::to_string(_page.number) + " of " + std::to_string(pageCount);
+
+			if (_page.number < pageCount) {
+				footer += " <a href=\"" + _linkTo(_page.key, _page.isDescending, _page.number + 1) + "\">Next</a>";
+			}
+
+			footer += "</p>\n";
+		}
+
+		_append(footer + "</body></html>\n");
+		_isFinished = true;
+	}
+
+	void DirectoryListingPayload::_append(const std::string& text) {
+		_pending.insert(_pending.end(), text.begin(), text.end());
+	}
+
+	std::string DirectoryListingPayload::_linkTo(DirectoryListing::SortKey key, bool isDescending, std::size_t page) const {
+		return std::string("?sort=") + sortNames[static_cast<std::size_t>(key)]
+			+ "&amp;order=" + (isDescending ? "desc" : "asc")
+			+ "&amp;page=" + std::to_string(page);
+	}
+}
@@ -0,0 +1,222 @@
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "http/FileCache.hpp"
+#include "http/SharedFileCache.hpp"
+#include "http/utils.hpp"
+
+namespace fs = std::filesystem;
+
+namespace http {
+	FileCache& FileCache::instance() {
+		static FileCache cache;
+		return cache;
+	}
+
+	void FileCache::configure(std::size_t capacity, std::size_t maxFileSize) {
+		_capacity = capacity;
+		_maxFileSize = std::min(maxFileSize, capacity);
+		_isShared = SharedFileCache::instance().isEnabled();
+		clear();
+	}
+
+	void FileCache::clear() {
+		_lru.clear();
+		_entries.clear();
+		_size = 0;
+	}
+
+	// Drops `path` and, when it is a directory, everything cached below it
+	void FileCache::invalidate(const fs::path& path) {
+		const std::string key = path.lexically_normal().string();
+
+		if (_isShared) {
+			SharedFileCache& shared = SharedFileCache::instance();
+
+			shared.erase(key);
+			shared.eraseBelow(key);
+			return;
+		}
+
+		if (auto it = _entries.find(key); it != _entries.end()) {
+			_erase(it);
+			return;
+		}
+
+		const std::string prefix = key.ends_with('/') ? key : key + "/";
+
+		for (auto it = _entries.begin(); it != _entries.end();) {
+			if (it->first.starts_with(prefix)) {
+				auto next = std::next(it);
+				_erase(it);
+				it = next;
+				continue;
+			}
+
+			it++;
+		}
+	}
+
+	// Loads the files below `directory` until the cache is full
+	void FileCache::prewarm(const fs::path& directory) {
+		std::error_code ec;
+
+		for (
+			auto it = fs::recursive_directory_iterator(directory, fs::directory_options::skip_permission_denied, ec);
+			!ec && it != fs::recursive_directory_iterator();
+			it.increment(ec)
+		) {
+			if (!it->is_regular_file(ec) || it->file_size(ec) > _maxFileSize) {
+				continue;
+			}
+
+			if (size() + it->file_size(ec) > _capacity) {
+				return;
+			}
+
+			load(it->path());
+		}
+	}
+
+	std::shared_ptr<const FileCache::Entry> FileCache::get(const fs::path& path) {
+		if (!isEnabled()) {
+			return nullptr;
+		}
+
+		if (_isShared) {
+			return SharedFileCache::instance().find(path.lexically_normal().string());
+		}
+
+		auto it = _entries.find(path.lexically_normal().string());
+
+		if (it == _entries.end()) {
+			return nullptr;
+		}
+
+		_lru.splice(_lru.begin(), _lru, it->second);
+		return *it->second;
+	}
+
+	// Returns the cached entry for `path`, reading the file into the cache on a miss.
+	// Returns nullptr when the file is missing, not a regular file or too large to cache.
+	std::shared_ptr<const FileCache::Entry> FileCache::load(const fs::path& path) {
+		if (auto entry = get(path)) {
+			return entry;
+		}
+
+		if (!isEnabled()) {
+			return nullptr;
+		}
+
+		int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+
+		if (fd == -1) {
+			return nullptr;
+		}
+
+		struct ::stat st;
+
+		if (::fstat(fd, &st) == -1 || !S_ISREG(st.st_mode) || static_cast<std::size_t>(st.st_size) > _maxFileSize) {
+			::close(fd);
+			return nullptr;
+		}
+
+		std::string content(static_cast<std::size_t>(st.st_size), '\0');
+		std::size_t offset = 0;
+
+		while (offset < content.size()) {
+			const ssize_t bytesRead = ::pread(fd, content.data() + offset, content.size() - offset, offset);
+
+			if (bytesRead <= 0) {
+				::close(fd);
+				return nullptr;
+			}
+
+			offset += static_cast<std::size_t>(bytesRead);
+		}
+
+		::close(fd);
+
+		auto entry = _makeEntry(path.lexically_normal().string(), content, st);
+
+		if (_isShared) {
+			return SharedFileCache::instance().insert(*entry);
+		}
+
+		const std::size_t cost = _cost(*entry);
+
+		if (cost > _capacity) {
+			return nullptr;
+		}
+
+		while (!_lru.empty() && _size + cost > _capacity) {
+			_erase(_entries.find(std::string(_lru.back()->path)));
+		}
+
+		_lru.push_front(entry);
+		_entries[std::string(entry->path)] = _lru.begin();
+		_size += cost;
+		return entry;
+	}
+
+	bool FileCache::isEnabled() const {
+		return (_capacity > 0);
+	}
+
+	std::size_t FileCache::size() const {
+		return _isShared ? SharedFileCache::instance().size() : _size;
+	}
+
+	std::size_t FileCache::getMaxFileSize() const {
+		return _maxFileSize;
+	}
+
+	// Serializes the header lines of the file once, all fields of the entry view one string
+	std::shared_ptr<FileCache::Entry> FileCache::_makeEntry(const std::string& path, const std::string& content, const struct ::stat& st) {
+		const std::string ext = fs::path(path).extension().string();
+		const std::string mimeType = getMimeType(ext.empty() ? ext : ext.substr(1));
+		const std::string entityTag = entityTagOf(st.st_ino, st.st_size, st.st_mtim);
+		const std::string headerFields =
+			stringOf(Header::CONTENT_TYPE) + ": " + mimeType + "\r\n"
+			+ stringOf(Header::CONTENT_LENGTH) + ": " + std::to_string(content.size()) + "\r\n";
+		const std::string validatorFields =
+			stringOf(Header::ETAG) + ": " + entityTag + "\r\n"
+			+ stringOf(Header::LAST_MODIFIED) + ": " + formatHttpDate(st.st_mtim.tv_sec) + "\r\n";
+		const std::string* fields[] = { &path, &content, &mimeType, &entityTag, &headerFields, &validatorFields };
+
+		auto storage = std::make_shared<std::string>();
+		std::size_t offsets[std::size(fields) + 1] = { 0 };
+
+		for (std::size_t i = 0; i < std::size(fields); i++) {
+			*storage += *fields[i];
+			offsets[i + 1] = storage->size();
+		}
+
+		const auto view = [&storage, &offsets](std::size_t i) {
+			return std::string_view(*storage).substr(offsets[i], offsets[i + 1] - offsets[i]);
+		};
+
+		auto entry = std::make_shared<Entry>();
+
+		entry->path = view(0);
+		entry->content = view(1);
+		entry->mimeType = view(2);
+		entry->entityTag = view(3);
+		entry->lastModified = st.st_mtim.tv_sec;
+		entry->headerFields = view(4);
+		entry->validatorFields = view(5);
+		entry->storage = storage;
+		return entry;
+	}
+
+	std::size_t FileCache::_cost(const Entry& entry) {
+		return entry.storage->size();
+	}
+
+	void FileCache::_erase(std::unordered_map<std::string, LruList::iterator>::iterator it) {
+		_size -= _cost(**it->second);
+		_lru.erase(it->second);
+		_entries.erase(it);
+	}
+}
@@ -15,7 +15,8 @@ namespace http {
 		_url = Url();
 		_version.clear();
 		_headerFields.clear();
-		_rawBody.clear();
+		_contentLength = 0;
+		_body.clear();
 		_status = Request::Status::PENDING;
 	}
 
@@ -27,7 +28,44 @@ namespace http {
 		return (getHeader(Header::CONTENT_TYPE).value_or("").starts_with("multipart/form-data"));
 	}
 
-	char** Request::getCgiEnvp() const {
+	/**
+	 * Evaluates If-None-Match, or If-Modified-Since when there is no
+	 * If-None-Match, against the current validators of the resource (RFC 9110 13.2.2).
+	 */
+	bool Request::isNotModified(const std::string& entityTag, std::time_t lastModified) const {
+		if (_method != "GET" && _method != "HEAD") {
+			return false;
+		}
+
+		if (auto ifNoneMatch = getHeader(Header::IF_NONE_MATCH)) {
+			std::istringstream istream(*ifNoneMatch);
+			std::string tag;
+
+			while (std::getline(istream, tag, ',')) {
+				tag = utils::trimSpace(tag);
+
+				if (tag.starts_with("W/")) {
+					tag.erase(0, 2);
+				}
+
+				if (tag == "*" || tag == entityTag) {
+					return true;
+				}
+			}
+
+			return false;
+		}
+
+		if (auto ifModifiedSince = getHeader(Header::IF_MODIFIED_SINCE)) {
+			auto date = parseHttpDate(*ifModifiedSince);
+			return (date.has_value() && lastModified <= *date);
+		}
+
+		return false;
+	}
+
+	// The NAME=value variables a CGI script gets for this request
+	std::vector<std::string> Request::getCgiEnv() const {
 		std::vector<std::string> vector;
 
 		vector.push_back("REQUEST_METHOD=" + _method);
@@ -39,7 +77,11 @@ namespace http {
 		vector.push_back("SERVER_NAME=" + _url.host);
 		vector.push_back("SERVER_PORT=" + _url.port);
 		vector.push_back("SERVER_PROTOCOL=" + _version);
+		return vector;
+	}
 
+	char** Request::getCgiEnvp() const {
+		const std::vector<std::string> vector = getCgiEnv();
 		char **envp = new char*[vector.size() + 1];
 
 		for (std::size_t i = 0; i < vector.size(); i++) {
@@ -99,40 +141,66 @@ namespace http {
 		return it->second;
 	}
 
+	/**
+	 * Returns the ranges requested for a representation of `size` bytes, or
+	 * nullopt when the full representation must be sent: no Range header, an
+	 * ignored one, or an If-Range that does not match the current validators.
+	 */
+	std::optional<std::vector<ByteRange>> Request::getRanges(std::size_t size, const std::string& entityTag, std::time_t lastModified) const {
+		auto range = getHeader(Header::RANGE);
 
-	const std::vector<std::uint8_t>& Request::getRawBody() const {
-		return _rawBody;
+		if (_method != "GET" || !range.has_value()) {
+			return std::nullopt;
+		}
+
+		if (auto ifRange = getHeader(Header::IF_RANGE)) {
+			// An entity tag must match strongly, a date must be exactly the last modification time
+			const bool matches = ifRange->starts_with('"')
+				? (*ifRange == entityTag)
+				: (parseHttpDate(*ifRange) == std::optional<std::time_t>(lastModified));
+
+			if (!matches) {
+				return std::nullopt;
+			}
+		}
+
+		return parseRange(*range, size);
+	}
+
+
+	const RequestBody& Request::getBody() const {
+		return _body;
 	}
 
 	Request::Status Request::getStatus() const {
 		return _status;
 	}
 
-	Request& Request::setRawBody(
-		std::vector<uint8_t>::const_iterator begin,
-		std::vector<uint8_t>::const_iterator end,
-		bool append
-	) {
-		if (append) {
-			_rawBody.insert(_rawBody.end(), begin, end);
-		} else {
-			_rawBody.assign(begin, end);
-		}
+	/**
+	 * Receives the rest of a Content-Length body from `fd` straight into the
+	 * body file. See RequestBody::spliceFrom for the return value.
+	 */
+	ssize_t Request::spliceBody(int fd) {
+		return _body.spliceFrom(fd, _contentLength - _body.size());
+	}
 
+	Request& Request::appendBody(const std::uint8_t* data, std::size_t size) {
+		_body.append(data, size);
 		return *this;
 	}
 
-	Request& Request::setRawBody(
-		std::move_iterator<std::vector<uint8_t>::iterator> begin,
-		std::move_iterator<std::vector<uint8_t>::iterator> end,
-		bool append
-	) noexcept {
-		if (append) {
-			_rawBody.insert(_rawBody.end(), begin, end);
-		} else {
-			_rawBody.assign(begin, end);
-		}
+	Request& Request::setBodyBufferSize(std::size_t bytes) {
+		_body.setBufferSize(bytes);
+		return *this;
+	}
 
+	/**
+	 * Keeps the body in a file inside `directory` from the start, reserving
+	 * Content-Length bytes up front. Saving the body to that directory later
+	 * is then a link instead of a copy.
+	 */
+	Request& Request::storeBodyIn(const std::filesystem::path& directory) {
+		_body.setTempDirectory(directory).preallocate(_contentLength);
 		return *this;
 	}
 
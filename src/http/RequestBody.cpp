@@ -0,0 +1,271 @@
+#include <cerrno>
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <system_error>
+#include <unistd.h>
+
+#include "http/RequestBody.hpp"
+
+namespace {
+	int openTempFile(const std::filesystem::path& directory) {
+		int fd = ::open(directory.c_str(), O_TMPFILE | O_RDWR | O_CLOEXEC, 0600);
+
+		if (fd != -1) {
+			return fd;
+		}
+
+		// O_TMPFILE is not supported by every filesystem, fall back to an unlinked mkstemp file
+		std::string pattern = (directory / "webserv_body_XXXXXX").string();
+		fd = ::mkstemp(pattern.data());
+
+		if (fd == -1) {
+			throw std::system_error(errno, std::generic_category(), "Failed to create request body file");
+		}
+
+		::unlink(pattern.c_str());
+		::fcntl(fd, F_SETFD, FD_CLOEXEC);
+		return fd;
+	}
+
+	void writeAll(int fd, const std::uint8_t* data, std::size_t size, off_t offset) {
+		while (size > 0) {
+			const ssize_t bytesWritten = ::pwrite(fd, data, size, offset);
+
+			if (bytesWritten == -1) {
+				if (errno == EINTR) {
+					continue;
+				}
+
+				throw std::system_error(errno, std::generic_category(), "Failed to write request body file");
+			}
+
+			data += bytesWritten;
+			size -= static_cast<std::size_t>(bytesWritten);
+			offset += bytesWritten;
+		}
+	}
+}
+
+namespace http {
+	struct RequestBody::TempFile {
+		int fd { -1 };
+		int pipeFds[2] { -1, -1 };
+		mutable void* mapping { MAP_FAILED };
+		mutable std::size_t mappedSize { 0 };
+
+		explicit TempFile(int fd) : fd(fd) {}
+		TempFile(const TempFile&) = delete;
+		TempFile& operator=(const TempFile&) = delete;
+
+		~TempFile() {
+			unmap();
+			::close(fd);
+
+			if (pipeFds[0] != -1) {
+				::close(pipeFds[0]);
+				::close(pipeFds[1]);
+			}
+		}
+
+		void unmap() const {
+			if (mapping != MAP_FAILED) {
+				::munmap(mapping, mappedSize);
+				mapping = MAP_FAILED;
+				mappedSize = 0;
+			}
+		}
+	};
+
+	void RequestBody::append(const std::uint8_t* data, std::size_t size) {
+		if (size == 0) {
+			return;
+		}
+
+		if (_file == nullptr && _size + size > _bufferSize) {
+			spill();
+		}
+
+		if (_file != nullptr) {
+			writeAll(_file->fd, data, size, static_cast<off_t>(_size));
+		} else {
+			_memory.insert(_memory.end(), data, data + size);
+		}
+
+		_size += size;
+	}
+
+	void RequestBody::clear() {
+		_memory.clear();
+		_memory.shrink_to_fit();
+		_file.reset();
+		_size = 0;
+	}
+
+	/**
+	 * Writes the body to `path`. A file-backed body is linked into place when
+	 * it lives on the same filesystem, otherwise it is copied inside the
+	 * kernel with copy_file_range, so the content never passes through user space.
+	 */
+	void RequestBody::saveAs(const std::filesystem::path& path) const {
+		if (_file != nullptr) {
+			std::string procPath("/proc/self/fd/" + std::to_string(_file->fd));
+
+			if (::linkat(AT_FDCWD, procPath.c_str(), AT_FDCWD, path.c_str(), AT_SYMLINK_FOLLOW) == 0) {
+				::fchmod(_file->fd, 0644);
+				return;
+			}
+		}
+
+		int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+
+		if (fd == -1) {
+			throw std::system_error(errno, std::generic_category(), "Failed to open " + path.string());
+		}
+
+		try {
+			if (_file == nullptr) {
+				writeAll(fd, _memory.data(), _memory.size(), 0);
+			} else {
+				loff_t offset = 0;
+
+				while (static_cast<std::size_t>(offset) < _size) {
+					const ssize_t bytesCopied = ::copy_file_range(_file->fd, &offset, fd, nullptr, _size - offset, 0);
+
+					if (bytesCopied > 0) {
+						continue;
+					}
+
+					if (bytesCopied == -1 && errno == EINTR) {
+						continue;
+					}
+
+					// copy_file_range may refuse some filesystem combinations, copy through the mapping instead
+					auto data = view();
+					writeAll(fd, data.data() + offset, _size - offset, offset);
+					break;
+				}
+			}
+		} catch (...) {
+			::close(fd);
+			throw;
+		}
+
+		::close(fd);
+	}
+
+	void RequestBody::preallocate(std::size_t size) {
+		spill();
+
+		// Only a hint, the body is still written correctly when the filesystem can not reserve space
+		if (size > _size) {
+			::fallocate(_file->fd, FALLOC_FL_KEEP_SIZE, static_cast<off_t>(_size), static_cast<off_t>(size - _size));
+		}
+	}
+
+	void RequestBody::spill() {
+		if (_file != nullptr) {
+			return;
+		}
+
+		_file = std::make_shared<TempFile>(openTempFile(_tempDirectory));
+		writeAll(_file->fd, _memory.data(), _memory.size(), 0);
+		_memory.clear();
+		_memory.shrink_to_fit();
+	}
+
+	/**
+	 * Moves up to `size` bytes from `fd` into the body file through a pipe,
+	 * without copying them into user space. Returns the number of bytes moved,
+	 * 0 on end of stream, or -1 with errno set (EAGAIN when nothing is ready,
+	 * EINVAL when `fd` does not support splicing).
+	 */
+	ssize_t RequestBody::spliceFrom(int fd, std::size_t size) {
+		spill();
+
+		if (_file->pipeFds[0] == -1) {
+			if (::pipe2(_file->pipeFds, O_NONBLOCK | O_CLOEXEC) == -1) {
+				return -1;
+			}
+
+			::fcntl(_file->pipeFds[1], F_SETPIPE_SZ, 1024 * 1024);
+		}
+
+		const ssize_t bytesIn = ::splice(fd, nullptr, _file->pipeFds[1], nullptr, size, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+
+		if (bytesIn <= 0) {
+			return bytesIn;
+		}
+
+		loff_t offset = static_cast<loff_t>(_size);
+		std::size_t remaining = static_cast<std::size_t>(bytesIn);
+
+		while (remaining > 0) {
+			const ssize_t bytesOut = ::splice(_file->pipeFds[0], nullptr, _file->fd, &offset, remaining, SPLICE_F_MOVE);
+
+			if (bytesOut == -1) {
+				if (errno == EINTR) {
+					continue;
+				}
+
+				throw std::system_error(errno, std::generic_category(), "Failed to splice request body");
+			}
+
+			remaining -= static_cast<std::size_t>(bytesOut);
+		}
+
+		_size += static_cast<std::size_t>(bytesIn);
+		return bytesIn;
+	}
+
+	bool RequestBody::empty() const {
+		return (_size == 0);
+	}
+
+	bool RequestBody::isInFile() const {
+		return (_file != nullptr);
+	}
+
+	int RequestBody::getFd() const {
+		return _file ? _file->fd : -1;
+	}
+
+	std::size_t RequestBody::size() const {
+		return _size;
+	}
+
+	std::span<const std::uint8_t> RequestBody::view() const {
+		if (_file == nullptr) {
+			return std::span<const std::uint8_t>(_memory.data(), _memory.size());
+		}
+
+		if (_size == 0) {
+			return {};
+		}
+
+		if (_file->mappedSize != _size) {
+			_file->unmap();
+			void* mapping = ::mmap(nullptr, _size, PROT_READ, MAP_SHARED, _file->fd, 0);
+
+			if (mapping == MAP_FAILED) {
+				throw std::system_error(errno, std::generic_category(), "Failed to map request body file");
+			}
+
+			_file->mapping = mapping;
+			_file->mappedSize = _size;
+		}
+
+		return std::span<const std::uint8_t>(static_cast<const std::uint8_t*>(_file->mapping), _size);
+	}
+
+	RequestBody& RequestBody::setBufferSize(std::size_t bytes) {
+		_bufferSize = bytes;
+		return *this;
+	}
+
+	RequestBody& RequestBody::setTempDirectory(const std::filesystem::path& directory) {
+		_tempDirectory = directory;
+		return *this;
+	}
+}
@@ -1,10 +1,20 @@
-#include <sstream>
+#include <algorithm>
+#include <string_view>
 #include <cstdint>
+#include <array>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include "http/Response.hpp"
 #include "Error.hpp"
 #include "utils/index.hpp"
+#include "utils/OpenFileCache.hpp"
 #include "http/utils.hpp"
+#include "http/CannedResponses.hpp"
+
+namespace {
+	constexpr std::size_t MAX_IOVECS = 16;
+	constexpr std::string_view SERVER_FIELD = "Server: webserv\r\n";
+}
 
 namespace http {
 	Response::Response(int clientSocket) : _clientSocket(clientSocket) , _header(utils::StringPayload("")) {}
@@ -14,6 +24,11 @@ namespace http {
 		, _status(other._status)
 		, _statusCode(other._statusCode)
 		, _headerFields(other._headerFields)
+		, _serializedFields(other._serializedFields)
+		, _fileMimeType(other._fileMimeType)
+		, _isFileBody(other._isFileBody)
+		, _isStreamBody(other._isStreamBody)
+		, _compression(other._compression)
 		, _header(other._header)
 		, _body(other._body ? other._body->clone() : nullptr) {
 	}
@@ -24,6 +39,11 @@ namespace http {
 			_status = other._status;
 			_statusCode = other._statusCode;
 			_headerFields = other._headerFields;
+			_serializedFields = other._serializedFields;
+			_fileMimeType = other._fileMimeType;
+			_isFileBody = other._isFileBody;
+			_isStreamBody = other._isStreamBody;
+			_compression = other._compression;
 			_header = other._header;
 			_body = other._body ? other._body->clone() : nullptr;
 		}
@@ -31,39 +51,94 @@ namespace http {
 		return *this;
 	}
 
+	/**
+	 * Writes as much of the response as the socket takes. The header and any
+	 * in-memory body go out together in one sendmsg. A file body follows the
+	 * header in the same pass, with MSG_MORE on the header so that the kernel
+	 * coalesces it with the first sendfile segment into full packets.
+	 */
 	bool Response::send() {
-		if (!_header.isSent()) {
-			_header.send(_clientSocket);
-			return false;
+		std::array<struct iovec, MAX_IOVECS> iov;
+		const std::size_t count = peek(iov.data(), iov.size());
+
+		if (count > 0) {
+			struct msghdr message {};
+			message.msg_iov = iov.data();
+			message.msg_iovlen = count;
+
+			const int flags = MSG_NOSIGNAL | (isBuffered() ? 0 : MSG_MORE);
+			const ssize_t bytesSent = ::sendmsg(_clientSocket, &message, flags);
+
+			if (bytesSent <= 0) {
+				return false;
+			}
+
+			commit(static_cast<std::size_t>(bytesSent));
+
+			if (!_header.isSent()) {
+				return false;
+			}
+		}
+
+		if (!isBuffered()) {
+			_body->send(_clientSocket);
 		}
 
-		if (_body == nullptr) {
-			return true;
+		return isSent();
+	}
+
+	// Describes the unsent header and in-memory body, see Payload::peek()
+	std::size_t Response::peek(struct iovec* iov, std::size_t count) const {
+		std::size_t filled = _header.peek(iov, count);
+
+		if (_body != nullptr && !_body->isSent()) {
+			filled += _body->peek(iov + filled, count - filled);
 		}
 
-		_body->send(_clientSocket);
+		return filled;
+	}
+
+	// Marks up to `bytes` bytes described by peek() as sent, returns how many were taken
+	std::size_t Response::commit(std::size_t bytes) {
+		std::size_t taken = _header.commit(bytes);
 
-		if (_body->isSent()) {
-			return true;
+		if (_body != nullptr && taken < bytes) {
+			taken += _body->commit(bytes - taken);
 		}
 
-		return false;
+		return taken;
+	}
+
+	bool Response::isSent() const {
+		return _header.isSent() && (_body == nullptr || _body->isSent());
+	}
+
+	// Whether the whole response can be written from memory, without a file or stream stage
+	bool Response::isBuffered() const {
+		return (_body == nullptr || _body->isSent() || _body->isBuffered());
+	}
+
+	// Whether the body waits for a background read, sending would not make progress until it finishes
+	bool Response::isPending() const {
+		return _header.isSent() && _body != nullptr && _body->isPending();
 	}
 
 	void Response::build() {
-		std::ostringstream ostream;
+		_compressBody();
 
-		ostream
-			<< "HTTP/1.1 "
-			<< static_cast<std::uint16_t>(_statusCode) << " "
-			<< stringOf(_statusCode) << "\r\n";
+		if (_isStreamBody && _findHeader(stringOf(Header::TRANSFER_ENCODING)) == _headerFields.end()) {
+			_body = std::make_unique<utils::ChunkedPayload>(std::move(_body));
+			setHeader(Header::TRANSFER_ENCODING, "chunked");
+		}
+
+		std::string& buffer = _serializeStatusLine();
 
 		for (const auto& [name, value] : _headerFields) {
-			ostream << name << ": " << value << "\r\n";
+			buffer.append(name).append(": ").append(value).append("\r\n");
 		}
 
-		ostream << "\r\n";
-		_header.setMessage(ostream.str());
+		buffer.append(_serializedFields).append("\r\n");
+		_header.setMessage(std::move(buffer));
 		setStatus(Response::Status::READY);
 	}
 
@@ -92,11 +167,22 @@ namespace http {
 	}
 
 	Response& Response::clear() {
+		reset();
+		_handlers.clear();
+		return *this;
+	}
+
+	// Drops what was built so far, the status handlers stay registered
+	Response& Response::reset() {
 		_statusCode = StatusCode::NONE_0;
 		_headerFields.clear();
+		_serializedFields.clear();
+		_fileMimeType.clear();
+		_isFileBody = false;
+		_isStreamBody = false;
+		_compression = nullptr;
 		_header.setMessage("");
 		_body.reset();
-		_handlers.clear();
 		return *this;
 	}
 
@@ -116,12 +202,16 @@ namespace http {
 	}
 
 	Response& Response::setHeader(Header header, const std::string& value) {
-		_headerFields[stringOf(header)] = value;
-		return *this;
+		return setHeader(stringOf(header), value);
 	}
 
 	Response& Response::setHeader(const std::string& headerName, const std::string& headerValue) {
-		_headerFields[headerName] = headerValue;
+		if (auto it = _findHeader(headerName); it != _headerFields.end()) {
+			it->second = headerValue;
+		} else {
+			_headerFields.emplace_back(headerName, headerValue);
+		}
+
 		return *this;
 	}
 
@@ -130,11 +220,51 @@ namespace http {
 		return *this;
 	}
 
+	// Hands the body over, e.g. to keep its memory alive while the kernel still reads it
+	std::unique_ptr<utils::Payload> Response::releaseBody() {
+		return std::move(_body);
+	}
+
 	Response& Response::appendBody(const std::uint8_t* data, size_t size) {
 		_body->append(data, size);
 		return *this;
 	}
 
+	Response& Response::setFileMimeType(const std::string& mimeType) {
+		_fileMimeType = mimeType;
+		return *this;
+	}
+
+	Response& Response::setCompression(const Location* location) {
+		_compression = location;
+		return *this;
+	}
+
+	// Sends the header fields and body serialized ahead of time, see CannedResponses
+	void Response::setCanned(StatusCode statusCode, std::shared_ptr<const std::string> message) {
+		_headerFields.clear();
+		_serializedFields.clear();
+		_isFileBody = false;
+		_isStreamBody = false;
+		_compression = nullptr;
+		setStatusCode(statusCode);
+		_header.setMessage(std::move(_serializeStatusLine()));
+		setBody(std::make_unique<utils::BufferPayload>(message));
+		setStatus(Response::Status::READY);
+	}
+
+	// Sends a body produced while it is sent, chunked unless build() compresses it
+	void Response::setStream(StatusCode statusCode, std::unique_ptr<utils::Payload> body, const std::string& mimeType) {
+		setStatusCode(statusCode);
+		setBody(std::move(body));
+		_isStreamBody = true;
+		_serializedFields.clear();
+		_eraseHeader(stringOf(Header::CONTENT_LENGTH));
+		setHeader(Header::CONTENT_TYPE, mimeType);
+		_setDefaultHeader(stringOf(Header::CACHE_CONTROL), "no-cache");
+		build();
+	}
+
 	void Response::setText(StatusCode statusCode, const std::string& text) {
 		setStatusCode(statusCode);
 		setBody(std::make_unique<utils::StringPayload>(text));
@@ -144,14 +274,252 @@ namespace http {
 	}
 
 	void Response::setFile(StatusCode statusCode, const std::filesystem::path &filePath) {
-		std::string ext = filePath.extension().string().erase(0, 1); // Get file extension without '.'
+		if (statusCode != StatusCode::OK_200) {
+			if (auto message = CannedResponses::instance().get(statusCode, filePath)) {
+				return setCanned(statusCode, message);
+			}
+		}
+
+		FileCache& fileCache = FileCache::instance();
+
+		if (auto entry = fileCache.get(filePath)) {
+			return setFile(statusCode, entry);
+		}
+
+		auto file = utils::OpenFileCache::instance().open(filePath);
+
+		if (file == nullptr || file->file == nullptr) {
+			throw FileNotFoundException(filePath.filename());
+		}
+
+		if (fileCache.isEnabled() && file->size() <= fileCache.getMaxFileSize()) {
+			if (auto entry = fileCache.load(filePath)) {
+				return setFile(statusCode, entry);
+			}
+		}
+
+		setStatusCode(statusCode);
+		setBody(std::make_unique<utils::FilePayload>(filePath, file->file, file->size()));
+		_isFileBody = true;
+		_serializedFields.clear();
+		setHeader(Header::CONTENT_TYPE, _mimeTypeOf(filePath));
+		setHeader(Header::CONTENT_LENGTH, std::to_string(_body->size()));
+
+		if (statusCode == StatusCode::OK_200) {
+			const struct timespec mtime { file->stat.stx_mtime.tv_sec, file->stat.stx_mtime.tv_nsec };
+
+			setHeader(Header::ETAG, entityTagOf(file->stat.stx_ino, file->stat.stx_size, mtime));
+			setHeader(Header::LAST_MODIFIED, formatHttpDate(mtime.tv_sec));
+		}
 
+		// Handlers set Cache-Control from the location, anything else must not be stored
+		_setDefaultHeader(stringOf(Header::CACHE_CONTROL), "no-store");
+		build();
+	}
+
+	// Serves a cached file, its header lines are already serialized
+	void Response::setFile(StatusCode statusCode, const std::shared_ptr<const FileCache::Entry>& entry) {
 		setStatusCode(statusCode);
-		setBody(std::make_unique<utils::FilePayload>(filePath));
-		setHeader(Header::CONTENT_TYPE, getMimeType(ext));
+		setBody(std::make_unique<utils::BufferPayload>(entry, entry->content.data(), entry->content.size()));
+		_isFileBody = true;
+		_eraseHeader(stringOf(Header::CONTENT_TYPE));
+		_eraseHeader(stringOf(Header::CONTENT_LENGTH));
+		_setDefaultHeader(stringOf(Header::CACHE_CONTROL), "no-store");
+		_serializedFields = _fileMimeType.empty()
+			? std::string(entry->headerFields)
+			: stringOf(Header::CONTENT_TYPE) + ": " + _fileMimeType + "\r\n"
+				+ stringOf(Header::CONTENT_LENGTH) + ": " + std::to_string(entry->content.size()) + "\r\n";
+
+		if (statusCode == StatusCode::OK_200) {
+			_serializedFields += entry->validatorFields;
+		}
+
+		build();
+	}
+
+	// Serves a file of a mapped bundle, its header lines were serialized by the tool that packed it
+	void Response::setBundled(const std::shared_ptr<const Bundle>& bundle, const Bundle::Variant& variant) {
+		const std::string_view content = bundle->viewOf(variant.content);
+
+		setStatusCode(StatusCode::OK_200);
+		setBody(std::make_unique<utils::BufferPayload>(bundle, content.data(), content.size()));
+		_isFileBody = true;
+		_eraseHeader(stringOf(Header::CONTENT_TYPE));
+		_eraseHeader(stringOf(Header::CONTENT_LENGTH));
+		_setDefaultHeader(stringOf(Header::CACHE_CONTROL), "no-store");
+		_serializedFields = bundle->viewOf(variant.headerFields);
+		build();
+	}
+
+	/**
+	 * Serves parts of a file with 206 Partial Content. A single range is sent
+	 * as is, several ranges as a multipart/byteranges body whose parts are
+	 * sliced from the cached content or the shared descriptor, never copied.
+	 */
+	void Response::setFileRanges(const std::filesystem::path &filePath, const std::vector<ByteRange>& ranges) {
+		std::function<std::unique_ptr<utils::Payload>(const ByteRange&)> slice;
+		std::string mimeType;
+		std::size_t size;
+
+		if (auto entry = FileCache::instance().get(filePath)) {
+			slice = [entry](const ByteRange& range) {
+				return std::make_unique<utils::BufferPayload>(entry, entry->content.data() + range.first, range.length());
+			};
+			mimeType = _fileMimeType.empty() ? std::string(entry->mimeType) : _fileMimeType;
+			size = entry->content.size();
+			_serializedFields = entry->validatorFields;
+		} else {
+			auto file = utils::OpenFileCache::instance().open(filePath);
+
+			if (file == nullptr || file->file == nullptr) {
+				throw FileNotFoundException(filePath.filename());
+			}
+
+			const struct timespec mtime { file->stat.stx_mtime.tv_sec, file->stat.stx_mtime.tv_nsec };
+
+			slice = [filePath, file](const ByteRange& range) {
+				return std::make_unique<utils::FilePayload>(filePath, file->file, range.length(), range.first);
+			};
+			mimeType = _mimeTypeOf(filePath);
+			size = file->size();
+			_serializedFields.clear();
+			setHeader(Header::ETAG, entityTagOf(file->stat.stx_ino, file->stat.stx_size, mtime));
+			setHeader(Header::LAST_MODIFIED, formatHttpDate(mtime.tv_sec));
+		}
+
+		const auto contentRangeOf = [size](const ByteRange& range) {
+			return "bytes " + std::to_string(range.first) + "-" + std::to_string(range.last) + "/" + std::to_string(size);
+		};
+
+		setStatusCode(StatusCode::PARTIAL_CONTENT_206);
+		_isFileBody = true;
+
+		if (ranges.size() == 1) {
+			setBody(slice(ranges.front()));
+			setHeader(Header::CONTENT_TYPE, mimeType);
+			setHeader(Header::CONTENT_RANGE, contentRangeOf(ranges.front()));
+		} else {
+			const std::string boundary = utils::generate_random_string();
+			auto body = std::make_unique<utils::CompositePayload>();
+
+			for (const auto& range : ranges) {
+				body->add(std::make_unique<utils::StringPayload>(
+					"\r\n--" + boundary + "\r\n"
+					+ stringOf(Header::CONTENT_TYPE) + ": " + mimeType + "\r\n"
+					+ stringOf(Header::CONTENT_RANGE) + ": " + contentRangeOf(range) + "\r\n\r\n"
+				));
+				body->add(slice(range));
+			}
+
+			body->add(std::make_unique<utils::StringPayload>("\r\n--" + boundary + "--\r\n"));
+			setBody(std::move(body));
+			setHeader(Header::CONTENT_TYPE, "multipart/byteranges; boundary=" + boundary);
+		}
+
 		setHeader(Header::CONTENT_LENGTH, std::to_string(_body->size()));
-		// setHeader(Header::CACHE_CONTROL, "public, max-age=86400");	// For production mode
-		setHeader(Header::CACHE_CONTROL, "no-store"); 				// For test mode
+		_setDefaultHeader(stringOf(Header::CACHE_CONTROL), "no-store");
+		build();
+	}
+
+	// A 304 carries the validators and caching fields of the 200 it stands for, but no content
+	void Response::setNotModified(const std::string& entityTag, std::time_t lastModified) {
+		setStatusCode(StatusCode::NOT_MODIFIED_304);
+		_body.reset();
+		_serializedFields.clear();
+		_eraseHeader(stringOf(Header::CONTENT_TYPE));
+		_eraseHeader(stringOf(Header::CONTENT_LENGTH));
+		setHeader(Header::ETAG, entityTag);
+		setHeader(Header::LAST_MODIFIED, formatHttpDate(lastModified));
+		build();
+	}
+
+	void Response::setRangeNotSatisfiable(std::size_t size) {
+		setStatusCode(StatusCode::RANGE_NOT_SATISFIABLE_416);
+		_body.reset();
+		_serializedFields.clear();
+		_eraseHeader(stringOf(Header::CONTENT_TYPE));
+		setHeader(Header::CONTENT_RANGE, "bytes */" + std::to_string(size));
+		setHeader(Header::CONTENT_LENGTH, "0");
 		build();
 	}
+
+	// Keeps the capacity of a header buffer the connection no longer needs, build() writes into it
+	Response& Response::reuseHeaderBuffer(std::string&& buffer) {
+		_headerBuffer = std::move(buffer);
+		return *this;
+	}
+
+	std::string Response::releaseHeaderBuffer() {
+		return _header.release();
+	}
+
+	std::vector<Response::HeaderField>::iterator Response::_findHeader(const std::string& name) {
+		return std::find_if(_headerFields.begin(), _headerFields.end(), [&name](const HeaderField& field) {
+			return field.first == name;
+		});
+	}
+
+	void Response::_eraseHeader(const std::string& name) {
+		if (auto it = _findHeader(name); it != _headerFields.end()) {
+			_headerFields.erase(it);
+		}
+	}
+
+	// Sets `name` unless a handler already did
+	void Response::_setDefaultHeader(const std::string& name, const std::string& value) {
+		if (_findHeader(name) == _headerFields.end()) {
+			_headerFields.emplace_back(name, value);
+		}
+	}
+
+	// Starts the header in the recycled buffer with the status line and the Date and Server fields
+	std::string& Response::_serializeStatusLine() {
+		_headerBuffer.clear();
+		_headerBuffer
+			.append(statusLineOf(_statusCode))
+			.append(dateField())
+			.append(SERVER_FIELD);
+		return _headerBuffer;
+	}
+
+	std::string Response::_mimeTypeOf(const std::filesystem::path& filePath) const {
+		if (!_fileMimeType.empty()) {
+			return _fileMimeType;
+		}
+
+		return getMimeType(filePath.extension().string().erase(0, 1)); // Get file extension without '.'
+	}
+
+	/**
+	 * Replaces a generated body with a gzip stream framed with the chunked
+	 * coding, when the matched location enables gzip, the client accepts it
+	 * and the body is large enough and of a listed type. The content is
+	 * deflated block by block as the socket drains.
+	 */
+	void Response::_compressBody() {
+		if (_compression == nullptr || _body == nullptr || _isFileBody || _findHeader(stringOf(Header::CONTENT_ENCODING)) != _headerFields.end()) {
+			return;
+		}
+
+		const Location& location = *_compression;
+		auto contentType = _findHeader(stringOf(Header::CONTENT_TYPE));
+
+		// A stream has no size up front, it is compressed whatever its length
+		if ((!_isStreamBody && _body->size() < location.gzipMinLength) || contentType == _headerFields.end()) {
+			return;
+		}
+
+		const std::string mimeType = utils::lowerCase(utils::trimSpace(contentType->second.substr(0, contentType->second.find(';'))));
+
+		if (!utils::isInVector(mimeType, location.gzipTypes)) {
+			return;
+		}
+
+		_body = std::make_unique<utils::ChunkedPayload>(std::make_unique<utils::GzipPayload>(std::move(_body), location.gzipLevel));
+		_eraseHeader(stringOf(Header::CONTENT_LENGTH));
+		setHeader(Header::CONTENT_ENCODING, "gzip");
+		setHeader(Header::TRANSFER_ENCODING, "chunked");
+		setHeader(Header::VARY, "Accept-Encoding");
+		_compression = nullptr;
+	}
 }
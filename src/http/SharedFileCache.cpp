@@ -0,0 +1,754 @@
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <memory>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <vector>
+
+#include "http/SharedFileCache.hpp"
+
+namespace {
+	constexpr std::size_t MIN_BLOCK_SIZE = 1024;			// Also the size of the pages covered by one cell
+	constexpr std::size_t MIN_PAGE_SIZE = 64 * 1024;
+	constexpr std::size_t MAX_CLASSES = 32;
+	constexpr std::size_t MAX_PROBES = 64;
+	constexpr std::size_t MAX_PINS = 4096;					// Distinct blocks one worker can hold at once
+	constexpr std::size_t FIELD_COUNT = 6;					// path, content, mimeType, entityTag, headerFields, validatorFields
+	constexpr std::uint64_t EMPTY_KEY = 0;
+	constexpr std::uint64_t TOMBSTONE_KEY = 2;				// Hashes are odd, so no path hashes to it
+	constexpr std::uint64_t REF_MASK = 0xFFFFFFFF;
+
+	static_assert(std::atomic<std::uint64_t>::is_always_lock_free, "the shared index needs lock-free 64-bit atomics");
+
+	// FNV-1a, never 0 so that 0 marks a free slot
+	std::uint64_t hashOf(std::string_view path) {
+		std::uint64_t hash = 0xcbf29ce484222325ULL;
+
+		for (const char c : path) {
+			hash ^= static_cast<std::uint8_t>(c);
+			hash *= 0x100000001b3ULL;
+		}
+
+		return hash | 1;
+	}
+
+	std::uint64_t pack(std::uint32_t generation, std::uint32_t ref) {
+		return (static_cast<std::uint64_t>(generation) << 32) | ref;
+	}
+}
+
+namespace http {
+	struct SharedFileCache::Segment {
+		std::size_t size;
+		std::size_t pageSize;
+		std::size_t pagesOffset;
+		std::uint32_t pageCount;
+		std::uint32_t cellsPerPage;
+		std::uint32_t slotCount;
+		std::uint32_t workerCount;
+		std::uint32_t classCount;
+		std::uint32_t classSizes[MAX_CLASSES];
+		std::atomic<std::uint32_t> carvedPages;
+		std::atomic<std::uint32_t> clockHand;
+		std::atomic<std::uint64_t> used;					// Bytes of the blocks in use
+		std::atomic<std::uint64_t> freePages;				// ABA tag << 32 | number of the first free page
+		std::atomic<std::uint64_t> freeLists[MAX_CLASSES];	// ABA tag << 32 | ref of the first free block
+	};
+
+	struct SharedFileCache::Slot {
+		std::atomic<std::uint64_t> key;		// Hash of the path, TOMBSTONE_KEY once its entry is gone
+		std::atomic<std::uint64_t> value;	// generation << 32 | ref of the block, 0 when absent
+	};
+
+	// Pages are numbered from 1
+	struct SharedFileCache::Page {
+		std::atomic<std::uint32_t> live;		// Blocks handed out and not freed yet
+		std::atomic<std::uint32_t> next;		// Free page list link
+		std::atomic<std::uint8_t> sizeClass;	// Set when the page is carved
+	};
+
+	// State of the block starting at this cell, a ref is the number of its cell
+	struct SharedFileCache::Cell {
+		std::atomic<std::uint32_t> refs;
+		std::atomic<std::uint32_t> generation;	// Bumped on every reuse, so a stale index value can not pin the new content
+		std::atomic<std::uint32_t> next;		// Free list link
+		std::atomic<std::uint8_t> isReferenced;	// Clock bit, set by every hit
+	};
+
+	// Followed by the fields of the entry, back to back
+	struct SharedFileCache::Block {
+		std::int64_t lastModified;
+		std::uint32_t sizes[FIELD_COUNT];
+
+		std::string_view fieldAt(std::size_t index) const {
+			const char* data = reinterpret_cast<const char*>(this + 1);
+
+			for (std::size_t i = 0; i < index; i++) {
+				data += sizes[i];
+			}
+
+			return std::string_view(data, sizes[index]);
+		}
+	};
+
+	// Written by its worker only, read by the master once the worker is dead
+	struct SharedFileCache::PinTable {
+		struct Record {
+			std::uint32_t ref;
+			std::uint32_t pins;
+		};
+
+		std::uint32_t count;
+		Record records[MAX_PINS];
+	};
+
+	// An entry viewing a block, which stays pinned until the last response sending it is gone
+	class SharedFileCache::PinnedEntry : public FileCache::Entry {
+		public:
+			PinnedEntry(SharedFileCache& cache, std::uint32_t ref) : _cache(cache), _ref(ref) {}
+			PinnedEntry(const PinnedEntry&) = delete;
+			~PinnedEntry() { _cache._unpin(_ref); }
+
+			PinnedEntry& operator=(const PinnedEntry&) = delete;
+
+		private:
+			SharedFileCache& _cache;
+			std::uint32_t _ref;
+	};
+
+	SharedFileCache& SharedFileCache::instance() {
+		static SharedFileCache cache;
+		return cache;
+	}
+
+	/**
+	 * Maps a segment of about `capacity` bytes for `workerCount` workers, to
+	 * be called before they fork. Pages are large enough for the biggest size
+	 * class, which fits a file of `maxFileSize` bytes with its path and
+	 * header lines.
+	 */
+	bool SharedFileCache::create(std::size_t capacity, std::size_t maxFileSize, std::size_t workerCount) {
+		const std::size_t pageSize = std::max(MIN_PAGE_SIZE, std::bit_ceil(maxFileSize + sizeof(Block) + 4096));
+		const std::size_t pageCount = std::max<std::size_t>(1, capacity / pageSize);
+		const std::size_t cellCount = pageCount * (pageSize / MIN_BLOCK_SIZE) + 1;
+		const std::size_t slotCount = std::bit_ceil(std::max<std::size_t>(1024, capacity / 2048));
+		const std::size_t cellsOffset = sizeof(Segment) + slotCount * sizeof(Slot);
+		const std::size_t pageTableOffset = cellsOffset + cellCount * sizeof(Cell);
+		const std::size_t pinTablesOffset = pageTableOffset + (pageCount + 1) * sizeof(Page);
+		const std::size_t pagesOffset = (pinTablesOffset + workerCount * sizeof(PinTable) + 4095) & ~std::size_t { 4095 };
+		const std::size_t size = pagesOffset + pageCount * pageSize;
+
+		const int fd = ::memfd_create("webserv-file-cache", MFD_CLOEXEC);
+
+		if (fd == -1) {
+			return false;
+		}
+
+		void* data = (::ftruncate(fd, static_cast<off_t>(size)) == 0)
+			? ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)
+			: MAP_FAILED;
+
+		::close(fd);
+
+		if (data == MAP_FAILED) {
+			return false;
+		}
+
+		// The memfd starts zeroed: every slot is free, every free list and pin table empty
+		_base = static_cast<std::uint8_t*>(data);
+		_segment = new (data) Segment {};
+		_slots = reinterpret_cast<Slot*>(_base + sizeof(Segment));
+		_cells = reinterpret_cast<Cell*>(_base + cellsOffset);
+		_pages = reinterpret_cast<Page*>(_base + pageTableOffset);
+		_pinTables = reinterpret_cast<PinTable*>(_base + pinTablesOffset);
+		std::uninitialized_value_construct_n(_slots, slotCount);
+		std::uninitialized_value_construct_n(_cells, cellCount);
+		std::uninitialized_value_construct_n(_pages, pageCount + 1);
+
+		_segment->size = size;
+		_segment->pageSize = pageSize;
+		_segment->pagesOffset = pagesOffset;
+		_segment->pageCount = static_cast<std::uint32_t>(pageCount);
+		_segment->cellsPerPage = static_cast<std::uint32_t>(pageSize / MIN_BLOCK_SIZE);
+		_segment->slotCount = static_cast<std::uint32_t>(slotCount);
+		_segment->workerCount = static_cast<std::uint32_t>(workerCount);
+
+		for (std::size_t blockSize = MIN_BLOCK_SIZE; blockSize <= pageSize && _segment->classCount < MAX_CLASSES; blockSize *= 2) {
+			_segment->classSizes[_segment->classCount++] = static_cast<std::uint32_t>(blockSize);
+		}
+
+		return true;
+	}
+
+	// Unmaps the segment, once no worker and no entry uses it anymore
+	void SharedFileCache::destroy() {
+		if (!isEnabled()) {
+			return;
+		}
+
+		::munmap(_base, _segment->size);
+		_segment = nullptr;
+		_slots = nullptr;
+		_pages = nullptr;
+		_cells = nullptr;
+		_pinTables = nullptr;
+		_pins = nullptr;
+		_base = nullptr;
+	}
+
+	bool SharedFileCache::isEnabled() const {
+		return (_segment != nullptr);
+	}
+
+	// Called in a freshly forked worker, its references are recorded in the pin table of `worker`
+	void SharedFileCache::attach(std::size_t worker) {
+		if (isEnabled() && worker < _segment->workerCount) {
+			_pins = &_pinTables[worker];
+		}
+	}
+
+	// Drops the references a dead worker still held, called by the master before replacing it
+	void SharedFileCache::releasePins(std::size_t worker) {
+		if (!isEnabled() || worker >= _segment->workerCount) {
+			return;
+		}
+
+		PinTable& table = _pinTables[worker];
+
+		for (std::uint32_t i = 0; i < table.count; i++) {
+			for (std::uint32_t pins = 0; pins < table.records[i].pins; pins++) {
+				_release(table.records[i].ref);
+			}
+		}
+
+		table.count = 0;
+	}
+
+	std::shared_ptr<const FileCache::Entry> SharedFileCache::find(std::string_view path) {
+		Slot* slot = _findSlot(hashOf(path), false);
+
+		if (slot == nullptr) {
+			return nullptr;
+		}
+
+		const std::uint64_t value = slot->value.load(std::memory_order_acquire);
+		const std::uint32_t ref = static_cast<std::uint32_t>(value & REF_MASK);
+
+		if (value == 0 || !_pin(ref, static_cast<std::uint32_t>(value >> 32))) {
+			return nullptr;
+		}
+
+		// Another path with the same hash
+		if (_blockAt(ref)->fieldAt(0) != path) {
+			_unpin(ref);
+			return nullptr;
+		}
+
+		_cells[ref].isReferenced.store(1, std::memory_order_relaxed);
+		return _entryOf(ref);
+	}
+
+	// Copies `entry` into a block and publishes it, returns the shared copy or nullptr when there is no room
+	std::shared_ptr<const FileCache::Entry> SharedFileCache::insert(const FileCache::Entry& entry) {
+		const std::string_view fields[FIELD_COUNT] = {
+			entry.path, entry.content, entry.mimeType, entry.entityTag, entry.headerFields, entry.validatorFields
+		};
+		std::size_t size = sizeof(Block);
+
+		for (const auto& field : fields) {
+			size += field.size();
+		}
+
+		const std::uint32_t* classEnd = _segment->classSizes + _segment->classCount;
+		const std::uint32_t* sizeClass = std::lower_bound(static_cast<const std::uint32_t*>(_segment->classSizes), classEnd, size);
+		const std::uint64_t hash = hashOf(entry.path);
+		Slot* slot = _findSlot(hash, true);
+
+		if (sizeClass == classEnd || slot == nullptr) {
+			return nullptr;
+		}
+
+		const std::uint32_t ref = _allocate(static_cast<std::uint8_t>(sizeClass - _segment->classSizes));
+
+		if (ref == 0) {
+			return nullptr;
+		}
+
+		Block* block = _blockAt(ref);
+		Cell& cell = _cells[ref];
+		char* data = reinterpret_cast<char*>(block + 1);
+		const std::uint32_t generation = cell.generation.fetch_add(1, std::memory_order_relaxed) + 1;
+
+		block->lastModified = entry.lastModified;
+
+		for (std::size_t i = 0; i < FIELD_COUNT; i++) {
+			block->sizes[i] = static_cast<std::uint32_t>(fields[i].size());
+			data = std::copy(fields[i].begin(), fields[i].end(), data);
+		}
+
+		cell.isReferenced.store(1, std::memory_order_relaxed);
+
+		// One reference for the index, one for the returned entry
+		cell.refs.store(2, std::memory_order_release);
+		_segment->used.fetch_add(*sizeClass, std::memory_order_relaxed);
+
+		const bool isTracked = _track(ref);
+		const std::uint64_t previous = slot->value.exchange(pack(generation, ref), std::memory_order_acq_rel);
+
+		if (previous != 0) {
+			_release(static_cast<std::uint32_t>(previous & REF_MASK));
+		}
+
+		if (!isTracked) {
+			_release(ref);
+			return nullptr;
+		}
+
+		return _entryOf(ref);
+	}
+
+	// Every slot of the probe sequence holding the hash, two inserts racing for one path may have claimed two
+	void SharedFileCache::erase(std::string_view path) {
+		const std::uint64_t hash = hashOf(path);
+		const std::uint32_t mask = _segment->slotCount - 1;
+
+		for (std::size_t i = 0; i < MAX_PROBES; i++) {
+			Slot& slot = _slots[(hash + i) & mask];
+			const std::uint64_t key = slot.key.load(std::memory_order_acquire);
+
+			if (key == EMPTY_KEY) {
+				return;
+			}
+
+			if (key == hash) {
+				_unlink(slot, slot.value.load(std::memory_order_acquire));
+			}
+		}
+	}
+
+	// Drops every entry below `directory`, a walk over the whole index
+	void SharedFileCache::eraseBelow(std::string_view directory) {
+		const std::string prefix = directory.ends_with('/') ? std::string(directory) : std::string(directory) + "/";
+
+		for (std::uint32_t i = 0; i < _segment->slotCount; i++) {
+			const std::uint64_t value = _slots[i].value.load(std::memory_order_acquire);
+			const std::uint32_t ref = static_cast<std::uint32_t>(value & REF_MASK);
+
+			if (value == 0 || !_pin(ref, static_cast<std::uint32_t>(value >> 32))) {
+				continue;
+			}
+
+			if (_blockAt(ref)->fieldAt(0).starts_with(prefix)) {
+				_unlink(_slots[i], value);
+			}
+
+			_unpin(ref);
+		}
+	}
+
+	std::size_t SharedFileCache::size() const {
+		return isEnabled() ? _segment->used.load(std::memory_order_relaxed) : 0;
+	}
+
+	SharedFileCache::Block* SharedFileCache::_blockAt(std::uint32_t ref) const {
+		return reinterpret_cast<Block*>(_base + _segment->pagesOffset + static_cast<std::size_t>(ref - 1) * MIN_BLOCK_SIZE);
+	}
+
+	std::uint32_t SharedFileCache::_pageOf(std::uint32_t ref) const {
+		return (ref - 1) / _segment->cellsPerPage + 1;
+	}
+
+	/**
+	 * A free block of `sizeClass`, from its free list, a free page or an
+	 * eviction. Evicting a block of the same class frees one right away, so
+	 * those go first; other classes only help once a whole page of theirs is
+	 * free, so those evictions empty the page of their victim. Returns 0 when
+	 * all fail.
+	 */
+	std::uint32_t SharedFileCache::_allocate(std::uint8_t sizeClass) {
+		if (const std::uint32_t ref = _take(sizeClass)) {
+			return ref;
+		}
+
+		if (const std::uint32_t page = _takePage()) {
+			return _carve(page, sizeClass);
+		}
+
+		for (const bool isAnyClass : { false, true }) {
+			for (std::uint32_t i = 0; i < _segment->cellsPerPage && _evict(sizeClass, isAnyClass); i++) {
+				if (const std::uint32_t ref = _take(sizeClass)) {
+					return ref;
+				}
+
+				if (const std::uint32_t page = _takePage()) {
+					return _carve(page, sizeClass);
+				}
+			}
+		}
+
+		return 0;
+	}
+
+	std::uint32_t SharedFileCache::_take(std::uint8_t sizeClass) {
+		const std::uint32_t ref = _pop(sizeClass);
+
+		if (ref != 0) {
+			_pages[_pageOf(ref)].live.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		return ref;
+	}
+
+	// Splits `page` into blocks of `sizeClass`, returns the first and frees the others
+	std::uint32_t SharedFileCache::_carve(std::uint32_t page, std::uint8_t sizeClass) {
+		const std::uint32_t cellsPerBlock = static_cast<std::uint32_t>(_segment->classSizes[sizeClass] / MIN_BLOCK_SIZE);
+		const std::uint32_t first = (page - 1) * _segment->cellsPerPage + 1;
+
+		_pages[page].sizeClass.store(sizeClass, std::memory_order_relaxed);
+		_pages[page].live.store(1, std::memory_order_relaxed);
+
+		for (std::uint32_t ref = first + cellsPerBlock; ref < first + _segment->cellsPerPage; ref += cellsPerBlock) {
+			_push(sizeClass, ref);
+		}
+
+		return first;
+	}
+
+	// A page never carved yet, or one given back by _reclaim. Returns 0 when there is none.
+	std::uint32_t SharedFileCache::_takePage() {
+		std::uint32_t carved = _segment->carvedPages.load(std::memory_order_relaxed);
+
+		while (carved < _segment->pageCount && !_segment->carvedPages.compare_exchange_weak(carved, carved + 1, std::memory_order_relaxed)) {
+		}
+
+		if (carved < _segment->pageCount) {
+			return carved + 1;
+		}
+
+		std::atomic<std::uint64_t>& head = _segment->freePages;
+		std::uint64_t current = head.load(std::memory_order_acquire);
+
+		while (true) {
+			const std::uint32_t page = static_cast<std::uint32_t>(current & REF_MASK);
+
+			if (page == 0) {
+				return 0;
+			}
+
+			const std::uint64_t next = (((current >> 32) + 1) << 32) | _pages[page].next.load(std::memory_order_relaxed);
+
+			if (head.compare_exchange_weak(current, next, std::memory_order_acquire, std::memory_order_acquire)) {
+				return page;
+			}
+		}
+	}
+
+	/**
+	 * Clock sweep over the index: a block that was hit since the hand last
+	 * passed gets a second chance, one that is only referenced by the index
+	 * is unlinked and freed. Only blocks of `sizeClass` unless `isAnyClass`,
+	 * which takes the other idle blocks of the victim's page along.
+	 */
+	bool SharedFileCache::_evict(std::uint8_t sizeClass, bool isAnyClass) {
+		const std::uint32_t mask = _segment->slotCount - 1;
+
+		for (std::uint32_t step = 0; step < 2 * _segment->slotCount; step++) {
+			Slot& slot = _slots[_segment->clockHand.fetch_add(1, std::memory_order_relaxed) & mask];
+			const std::uint64_t value = slot.value.load(std::memory_order_acquire);
+
+			if (value == 0) {
+				continue;
+			}
+
+			const std::uint32_t ref = static_cast<std::uint32_t>(value & REF_MASK);
+			Cell& cell = _cells[ref];
+
+			if (
+				(!isAnyClass && _pages[_pageOf(ref)].sizeClass.load(std::memory_order_relaxed) != sizeClass)
+				|| cell.isReferenced.exchange(0, std::memory_order_relaxed) != 0
+			) {
+				continue;
+			}
+
+			if (cell.refs.load(std::memory_order_acquire) == 1 && slot.value.load(std::memory_order_acquire) == value) {
+				_unlink(slot, value);
+
+				if (isAnyClass) {
+					_evictPage(_pageOf(ref));
+				}
+
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	// Unlinks every block of `page` that only the index references, so that the page can be given back
+	void SharedFileCache::_evictPage(std::uint32_t page) {
+		const std::uint8_t sizeClass = _pages[page].sizeClass.load(std::memory_order_relaxed);
+		const std::uint32_t cellsPerBlock = static_cast<std::uint32_t>(_segment->classSizes[sizeClass] / MIN_BLOCK_SIZE);
+		const std::uint32_t first = (page - 1) * _segment->cellsPerPage + 1;
+
+		for (std::uint32_t ref = first; ref < first + _segment->cellsPerPage; ref += cellsPerBlock) {
+			const std::uint32_t generation = _cells[ref].generation.load(std::memory_order_acquire);
+
+			if (_cells[ref].refs.load(std::memory_order_acquire) != 1 || !_pin(ref, generation)) {
+				continue;
+			}
+
+			Slot* slot = _findSlot(hashOf(_blockAt(ref)->fieldAt(0)), false);
+			const std::uint64_t value = pack(generation, ref);
+
+			_unpin(ref);
+
+			if (slot != nullptr) {
+				_unlink(*slot, value);
+			}
+		}
+	}
+
+	/**
+	 * Takes the whole free list of `sizeClass` and gives back every page it
+	 * holds all blocks of, the others go back on the list. Holding every
+	 * block of a page with none handed out means nothing else can reach it.
+	 */
+	void SharedFileCache::_reclaim(std::uint8_t sizeClass) {
+		std::atomic<std::uint64_t>& head = _segment->freeLists[sizeClass];
+		std::uint64_t current = head.load(std::memory_order_acquire);
+
+		// Bumping the tag makes every pop that read the old head fail
+		while (!head.compare_exchange_weak(current, ((current >> 32) + 1) << 32, std::memory_order_acquire, std::memory_order_acquire)) {
+		}
+
+		std::vector<std::uint32_t> refs;
+
+		for (std::uint32_t ref = static_cast<std::uint32_t>(current & REF_MASK); ref != 0; ref = _cells[ref].next.load(std::memory_order_relaxed)) {
+			refs.push_back(ref);
+		}
+
+		std::ranges::sort(refs);
+
+		const std::size_t blocksPerPage = _segment->pageSize / _segment->classSizes[sizeClass];
+
+		for (auto it = refs.begin(); it != refs.end();) {
+			const std::uint32_t page = _pageOf(*it);
+			const auto end = std::find_if(it, refs.end(), [&](std::uint32_t ref) { return _pageOf(ref) != page; });
+
+			if (static_cast<std::size_t>(end - it) == blocksPerPage && _pages[page].live.load(std::memory_order_acquire) == 0) {
+				std::atomic<std::uint64_t>& pages = _segment->freePages;
+				std::uint64_t first = pages.load(std::memory_order_relaxed);
+				std::uint64_t next;
+
+				do {
+					_pages[page].next.store(static_cast<std::uint32_t>(first & REF_MASK), std::memory_order_relaxed);
+					next = (((first >> 32) + 1) << 32) | page;
+				} while (!pages.compare_exchange_weak(first, next, std::memory_order_release, std::memory_order_relaxed));
+			} else {
+				std::for_each(it, end, [&](std::uint32_t ref) { _push(sizeClass, ref); });
+			}
+
+			it = end;
+		}
+	}
+
+	void SharedFileCache::_push(std::uint8_t sizeClass, std::uint32_t ref) {
+		std::atomic<std::uint64_t>& head = _segment->freeLists[sizeClass];
+		std::uint64_t current = head.load(std::memory_order_relaxed);
+		std::uint64_t next;
+
+		do {
+			_cells[ref].next.store(static_cast<std::uint32_t>(current & REF_MASK), std::memory_order_relaxed);
+			next = (((current >> 32) + 1) << 32) | ref;
+		} while (!head.compare_exchange_weak(current, next, std::memory_order_release, std::memory_order_relaxed));
+	}
+
+	// The tag in the upper half of the head makes a pop fail when the list changed under it (ABA)
+	std::uint32_t SharedFileCache::_pop(std::uint8_t sizeClass) {
+		std::atomic<std::uint64_t>& head = _segment->freeLists[sizeClass];
+		std::uint64_t current = head.load(std::memory_order_acquire);
+
+		while (true) {
+			const std::uint32_t ref = static_cast<std::uint32_t>(current & REF_MASK);
+
+			if (ref == 0) {
+				return 0;
+			}
+
+			const std::uint64_t next = (((current >> 32) + 1) << 32) | _cells[ref].next.load(std::memory_order_relaxed);
+
+			if (head.compare_exchange_weak(current, next, std::memory_order_acquire, std::memory_order_acquire)) {
+				return ref;
+			}
+		}
+	}
+
+	// Takes a reference on a block still holding `generation`, a freed block (no reference left) can not be revived
+	bool SharedFileCache::_pin(std::uint32_t ref, std::uint32_t generation) {
+		Cell& cell = _cells[ref];
+		std::uint32_t refs = cell.refs.load(std::memory_order_relaxed);
+
+		do {
+			if (refs == 0) {
+				return false;
+			}
+		} while (!cell.refs.compare_exchange_weak(refs, refs + 1, std::memory_order_acquire, std::memory_order_relaxed));
+
+		if (cell.generation.load(std::memory_order_acquire) != generation || !_track(ref)) {
+			_release(ref);
+			return false;
+		}
+
+		return true;
+	}
+
+	void SharedFileCache::_unpin(std::uint32_t ref) {
+		_untrack(ref);
+		_release(ref);
+	}
+
+	// Drops a reference, the last one frees the block. Once every page is carved, a page left without blocks in use is given back.
+	void SharedFileCache::_release(std::uint32_t ref) {
+		if (_cells[ref].refs.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+			return;
+		}
+
+		Page& page = _pages[_pageOf(ref)];
+		const std::uint8_t sizeClass = page.sizeClass.load(std::memory_order_relaxed);
+
+		_segment->used.fetch_sub(_segment->classSizes[sizeClass], std::memory_order_relaxed);
+		_push(sizeClass, ref);
+
+		if (
+			page.live.fetch_sub(1, std::memory_order_acq_rel) == 1
+			&& _segment->carvedPages.load(std::memory_order_relaxed) == _segment->pageCount
+		) {
+			_reclaim(sizeClass);
+		}
+	}
+
+	/**
+	 * Records a reference this worker took, false when its pin table is full.
+	 * The table is updated after the reference is taken and before it is
+	 * dropped, so a worker dying in between leaks a reference rather than
+	 * letting the master drop one twice.
+	 */
+	bool SharedFileCache::_track(std::uint32_t ref) {
+		if (_pins == nullptr) {
+			return true;
+		}
+
+		for (std::uint32_t i = 0; i < _pins->count; i++) {
+			if (_pins->records[i].ref == ref) {
+				_pins->records[i].pins++;
+				return true;
+			}
+		}
+
+		if (_pins->count == MAX_PINS) {
+			return false;
+		}
+
+		_pins->records[_pins->count] = { ref, 1 };
+		_pins->count++;
+		return true;
+	}
+
+	void SharedFileCache::_untrack(std::uint32_t ref) {
+		if (_pins == nullptr) {
+			return;
+		}
+
+		for (std::uint32_t i = 0; i < _pins->count; i++) {
+			if (_pins->records[i].ref != ref) {
+				continue;
+			}
+
+			if (--_pins->records[i].pins == 0) {
+				const PinTable::Record last = _pins->records[_pins->count - 1];
+
+				_pins->count--;
+				_pins->records[i] = last;
+			}
+
+			return;
+		}
+	}
+
+	/**
+	 * The slot of `hash`, claiming the first free or tombstoned one of its
+	 * probe sequence when `isClaiming`. Returns nullptr when the sequence is
+	 * full, or when another insert took the slot first.
+	 */
+	SharedFileCache::Slot* SharedFileCache::_findSlot(std::uint64_t hash, bool isClaiming) {
+		const std::uint32_t mask = _segment->slotCount - 1;
+		Slot* reusable = nullptr;
+
+		for (std::size_t i = 0; i < MAX_PROBES; i++) {
+			Slot& slot = _slots[(hash + i) & mask];
+			const std::uint64_t key = slot.key.load(std::memory_order_acquire);
+
+			if (key == hash) {
+				return &slot;
+			}
+
+			if (key == EMPTY_KEY || key == TOMBSTONE_KEY) {
+				reusable = (reusable != nullptr) ? reusable : &slot;
+			}
+
+			// Lookups stop at a slot never claimed, tombstones keep the sequences behind them reachable
+			if (key == EMPTY_KEY) {
+				break;
+			}
+		}
+
+		if (!isClaiming || reusable == nullptr) {
+			return nullptr;
+		}
+
+		std::uint64_t key = reusable->key.load(std::memory_order_acquire);
+
+		if ((key == EMPTY_KEY || key == TOMBSTONE_KEY) && reusable->key.compare_exchange_strong(key, hash, std::memory_order_acq_rel)) {
+			return reusable;
+		}
+
+		return (key == hash) ? reusable : nullptr;
+	}
+
+	// Wraps a pinned block, the entry releases it when dropped
+	std::shared_ptr<const FileCache::Entry> SharedFileCache::_entryOf(std::uint32_t ref) {
+		const Block* block = _blockAt(ref);
+		auto entry = std::make_shared<PinnedEntry>(*this, ref);
+
+		entry->path = block->fieldAt(0);
+		entry->content = block->fieldAt(1);
+		entry->mimeType = block->fieldAt(2);
+		entry->entityTag = block->fieldAt(3);
+		entry->lastModified = block->lastModified;
+		entry->headerFields = block->fieldAt(4);
+		entry->validatorFields = block->fieldAt(5);
+		return entry;
+	}
+
+	/**
+	 * Removes the block from the index if the slot still holds `value`,
+	 * dropping the index reference, and tombstones the key so that another
+	 * path can claim the slot. An insert of the same path racing with this
+	 * may leave its value under the tombstone, out of reach of lookups, until
+	 * the clock sweep or the next claim of the slot drops it.
+	 */
+	void SharedFileCache::_unlink(Slot& slot, std::uint64_t value) {
+		if (value == 0 || !slot.value.compare_exchange_strong(value, 0, std::memory_order_acq_rel)) {
+			return;
+		}
+
+		std::uint64_t key = slot.key.load(std::memory_order_acquire);
+
+		if (key != EMPTY_KEY && key != TOMBSTONE_KEY) {
+			slot.key.compare_exchange_strong(key, TOMBSTONE_KEY, std::memory_order_acq_rel);
+		}
+
+		_release(static_cast<std::uint32_t>(value & REF_MASK));
+	}
+}
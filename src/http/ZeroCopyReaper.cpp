@@ -0,0 +1,119 @@
+#include <unistd.h>
+#include <sys/socket.h>
+#include <string.h>
+#include <errno.h>
+#include <iostream>
+#include <linux/errqueue.h>
+#include <netinet/in.h>
+
+#include "http/ZeroCopyReaper.hpp"
+
+using std::chrono::steady_clock;
+
+namespace http {
+	ZeroCopyReaper& ZeroCopyReaper::instance() {
+		static ZeroCopyReaper reaper;
+		return reaper;
+	}
+
+	// Takes over the socket of a closed connection until its pinned bodies are released
+	void ZeroCopyReaper::adopt(int fd, std::uint32_t completed, Pins pins) {
+		// Nothing more is read, the queued data still goes out before the FIN
+		::shutdown(fd, SHUT_RDWR);
+
+		_sockets.push_back({ fd, completed, std::move(pins), steady_clock::now() + LINGER_TIMEOUT });
+		collect();
+	}
+
+	// Polled from the event loop, closes the sockets the kernel is done with
+	void ZeroCopyReaper::collect() {
+		const auto now = steady_clock::now();
+
+		std::erase_if(_sockets, [now](Socket& socket) {
+			bool isCopied = false;
+
+			if (readCompletions(socket.fd, socket.completed, isCopied)) {
+				releaseCompleted(socket.pins, socket.completed);
+			}
+
+			if (!socket.pins.empty() && now < socket.deadline) {
+				return false;
+			}
+
+			_close(socket.fd, !socket.pins.empty());
+			return true;
+		});
+	}
+
+	void ZeroCopyReaper::shutdown() {
+		for (const auto& socket : _sockets) {
+			_close(socket.fd, true);
+		}
+
+		_sockets.clear();
+	}
+
+	/**
+	 * Reads the MSG_ZEROCOPY completions from the error queue of `fd` into
+	 * `completed`. Returns false when there was none. `isCopied` is set when
+	 * the kernel had to copy the data anyway.
+	 */
+	bool ZeroCopyReaper::readCompletions(int fd, std::uint32_t& completed, bool& isCopied) {
+		bool hasCompletion = false;
+
+		while (true) {
+			char control[CMSG_SPACE(sizeof(struct sock_extended_err)) * 4];
+			struct msghdr message {};
+			message.msg_control = control;
+			message.msg_controllen = sizeof(control);
+
+			if (::recvmsg(fd, &message, MSG_ERRQUEUE | MSG_DONTWAIT) == -1) {
+				break;
+			}
+
+			for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&message); cmsg != nullptr; cmsg = CMSG_NXTHDR(&message, cmsg)) {
+				const bool isRecvErr = (cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR)
+					|| (cmsg->cmsg_level == SOL_IPV6 && cmsg->cmsg_type == IPV6_RECVERR);
+
+				if (!isRecvErr) {
+					continue;
+				}
+
+				const auto* error = reinterpret_cast<const struct sock_extended_err*>(CMSG_DATA(cmsg));
+
+				if (error->ee_errno != 0 || error->ee_origin != SO_EE_ORIGIN_ZEROCOPY) {
+					continue;
+				}
+
+				// TCP completes the sends in order, ee_data is the last one of the range
+				hasCompletion = true;
+				completed = error->ee_data + 1;
+
+				if (error->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) {
+					isCopied = true;
+				}
+			}
+		}
+
+		return hasCompletion;
+	}
+
+	// Drops the pins of the sends before `completed`
+	void ZeroCopyReaper::releaseCompleted(Pins& pins, std::uint32_t completed) {
+		while (!pins.empty() && static_cast<std::int32_t>(pins.front().first - completed) < 0) {
+			pins.pop_front();
+		}
+	}
+
+	// A reset drops the sends still queued instead of retransmitting them to a peer that does not read
+	void ZeroCopyReaper::_close(int fd, bool isReset) {
+		if (isReset) {
+			const struct linger linger { 1, 0 };
+			::setsockopt(fd, SOL_SOCKET, SO_LINGER, &linger, sizeof(linger));
+		}
+
+		if (::close(fd) < 0) {
+			std::cerr << "Failed to close socket " << fd << ": " << strerror(errno) << std::endl;
+		}
+	}
+}
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <regex>
 #include <ranges>
 #include <sstream>
@@ -120,15 +121,11 @@ namespace {
 			currentPos += chunkSize + 2;
 		}
 
-		if (request.getRawBody().size() + rawData.size() >= clientMaxBodySize) {
+		if (request.getBody().size() + rawData.size() >= clientMaxBodySize) {
 			throw std::invalid_argument("Exceeded request max body size");
 		}
 
-		request.setRawBody(
-			std::make_move_iterator(rawData.begin()),
-			std::make_move_iterator(rawData.end()),
-			true
-		);
+		request.appendBody(rawData.data(), rawData.size());
 
 		if (isChunkEnd) {
 			request.setStatus(http::Request::Status::COMPLETE);
@@ -235,23 +232,25 @@ namespace http {
 			throw std::invalid_argument("Exceeded request max body size");
 		}
 
-		if (buffer.size() < contentLength) {
+		// Move what has arrived so far out of the connection buffer, so a large
+		// body never sits in memory twice (and may be spilled to disk meanwhile)
+		const std::size_t bytes = std::min(contentLength - request.getBody().size(), buffer.size());
+
+		request.appendBody(buffer.data(), bytes);
+		buffer.erase(buffer.begin(), buffer.begin() + bytes);
+
+		if (request.getBody().size() < contentLength) {
 			return;
 		}
 
-		request
-			.setRawBody(
-				std::make_move_iterator(buffer.begin()),
-				std::make_move_iterator(buffer.begin() + contentLength),
-				false
-			)
-			.setStatus(Request::Status::COMPLETE);
+		request.setStatus(Request::Status::COMPLETE);
 
 		if (request.isMultipart()) {
 			std::cout << "request.isMultipart" << std::endl;
 			std::string finalBoundary("--" + request.getBoundary() + "--\r\n");
-			auto begin = request.getRawBody().begin();
-			auto end = request.getRawBody().end();
+			auto body = request.getBody().view();
+			auto begin = body.begin();
+			auto end = body.end();
 
 			if (std::search(begin, end, finalBoundary.begin(), finalBoundary.end()) == end) {
 				std::cout << "Could not find finalBoundary" << finalBoundary << std::endl;
@@ -260,7 +259,7 @@ namespace http {
 		}
 	}
 
-	std::vector<MultipartElement> parseMultipart(const std::vector<uint8_t>& rawMultipart, const std::string& boundary) {
+	std::vector<MultipartElement> parseMultipart(std::span<const std::uint8_t> rawMultipart, const std::string& boundary) {
 		std::vector<MultipartElement> elements;
 		std::string startBoundary("--" + boundary);
 		std::string finalBoundary("--" + boundary + "--\r\n");
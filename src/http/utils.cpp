@@ -1,9 +1,200 @@
+#include <algorithm>
+#include <cstdio>
 #include <sstream>
 #include <regex>
 #include "utils/common.hpp"
 #include "http/utils.hpp"
 
 namespace http {
+	namespace {
+		std::time_t dateFieldSecond = -1;
+		std::string cachedDateField;
+	}
+
+	// "HTTP/1.1 404 Not Found\r\n", formatted once per status code
+	const std::string& statusLineOf(StatusCode code) {
+		static std::array<std::string, 600> statusLines;
+		std::string& statusLine = statusLines[static_cast<std::size_t>(code) % statusLines.size()];
+
+		if (statusLine.empty()) {
+			statusLine = "HTTP/1.1 " + std::to_string(static_cast<std::uint16_t>(code)) + " " + stringOf(code) + "\r\n";
+		}
+
+		return statusLine;
+	}
+
+	// The "Date: ...\r\n" header line, see updateDateField()
+	const std::string& dateField() {
+		if (dateFieldSecond == -1) {
+			updateDateField(std::time(nullptr));
+		}
+
+		return cachedDateField;
+	}
+
+	// Formats the Date line again when the second changed, the event loop calls it on every iteration
+	void updateDateField(std::time_t now) {
+		if (now == dateFieldSecond) {
+			return;
+		}
+
+		dateFieldSecond = now;
+		cachedDateField = stringOf(Header::DATE) + ": " + formatHttpDate(now) + "\r\n";
+	}
+
+	// IMF-fixdate, e.g. "Sun, 06 Nov 1994 08:49:37 GMT"
+	std::string formatHttpDate(std::time_t time) {
+		struct tm tm;
+		char buffer[32];
+
+		::gmtime_r(&time, &tm);
+		std::size_t length = std::strftime(buffer, sizeof(buffer), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+		return std::string(buffer, length);
+	}
+
+	std::optional<std::time_t> parseHttpDate(const std::string& date) {
+		struct tm tm {};
+		const char* end = ::strptime(date.c_str(), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+
+		if (end == nullptr || *end != '\0') {
+			return std::nullopt;
+		}
+
+		return ::timegm(&tm);
+	}
+
+	// A strong validator that changes whenever the file is replaced, resized or written to
+	std::string entityTagOf(std::uint64_t inode, std::uint64_t size, const struct timespec& mtime) {
+		char buffer[64];
+		int length = std::snprintf(
+			buffer,
+			sizeof(buffer),
+			"\"%llx-%llx-%llx\"",
+			static_cast<unsigned long long>(inode),
+			static_cast<unsigned long long>(size),
+			static_cast<unsigned long long>(mtime.tv_sec) * 1000000000ULL + static_cast<unsigned long long>(mtime.tv_nsec)
+		);
+		return std::string(buffer, static_cast<std::size_t>(length));
+	}
+
+	/**
+	 * Parses a `Range: bytes=...` header against a representation of `size` bytes.
+	 *
+	 * Returns nullopt when the header must be ignored (bad syntax, another unit
+	 * or too many ranges), an empty vector when no range is satisfiable, or
+	 * the satisfiable ranges sorted, with overlapping and adjacent ones merged.
+	 */
+	std::optional<std::vector<ByteRange>> parseRange(const std::string& value, std::size_t size) {
+		constexpr std::size_t MAX_RANGES = 16;
+		constexpr std::string_view UNIT("bytes=");
+
+		if (utils::lowerCase(value.substr(0, UNIT.size())) != UNIT) {
+			return std::nullopt;
+		}
+
+		std::istringstream istream(value.substr(UNIT.size()));
+		std::string spec;
+		std::vector<ByteRange> ranges;
+		std::size_t count = 0;
+
+		while (std::getline(istream, spec, ',')) {
+			spec = utils::trimSpace(spec);
+			const std::size_t dashPos = spec.find('-');
+
+			if (spec.empty() || dashPos == std::string::npos || ++count > MAX_RANGES) {
+				return std::nullopt;
+			}
+
+			const std::string first = spec.substr(0, dashPos);
+			const std::string last = spec.substr(dashPos + 1);
+			const auto isNumber = [](const std::string& str) {
+				return !str.empty() && str.size() <= 19 && std::ranges::all_of(str, ::isdigit);
+			};
+
+			if ((!first.empty() && !isNumber(first)) || (!last.empty() && !isNumber(last)) || (first.empty() && last.empty())) {
+				return std::nullopt;
+			}
+
+			if (first.empty()) {
+				// Suffix range, the last N bytes
+				const std::size_t suffix = std::stoull(last);
+
+				if (suffix > 0 && size > 0) {
+					ranges.push_back({ size - std::min(suffix, size), size - 1 });
+				}
+
+				continue;
+			}
+
+			const std::size_t firstPos = std::stoull(first);
+			const std::size_t lastPos = last.empty() ? size - 1 : std::stoull(last);
+
+			if (!last.empty() && lastPos < firstPos) {
+				return std::nullopt;
+			}
+
+			if (firstPos < size) {
+				ranges.push_back({ firstPos, std::min(lastPos, size - 1) });
+			}
+		}
+
+		if (count == 0) {
+			return std::nullopt;
+		}
+
+		std::ranges::sort(ranges, {}, &ByteRange::first);
+		std::vector<ByteRange> merged;
+
+		for (const auto& range : ranges) {
+			if (!merged.empty() && range.first <= merged.back().last + 1) {
+				merged.back().last = std::max(merged.back().last, range.last);
+			} else {
+				merged.push_back(range);
+			}
+		}
+
+		return merged;
+	}
+
+	/**
+	 * Returns the q-value given to `token` by an Accept-style header
+	 * (e.g. "gzip;q=0.8, br, *;q=0.1"). An explicit entry wins over "*",
+	 * a token that is not listed at all gets 0.
+	 */
+	double qualityOf(const std::string& acceptHeader, const std::string& token) {
+		std::istringstream istream(acceptHeader);
+		std::string item;
+		std::optional<double> exact;
+		std::optional<double> wildcard;
+
+		while (std::getline(istream, item, ',')) {
+			const std::size_t semicolonPos = item.find(';');
+			const std::string name = utils::lowerCase(utils::trimSpace(item.substr(0, semicolonPos)));
+			double quality = 1.0;
+
+			if (semicolonPos != std::string::npos) {
+				std::string params = utils::lowerCase(item.substr(semicolonPos + 1));
+				params.erase(std::remove_if(params.begin(), params.end(), ::isspace), params.end());
+
+				if (params.starts_with("q=")) {
+					try {
+						quality = std::stod(params.substr(2));
+					} catch (const std::exception&) {
+						quality = 0.0;
+					}
+				}
+			}
+
+			if (name == token) {
+				exact = quality;
+			} else if (name == "*") {
+				wildcard = quality;
+			}
+		}
+
+		return exact.value_or(wildcard.value_or(0.0));
+	}
+
 	std::string getMimeType(const std::string &extension) {
 		if (extension == "aac") return "audio/aac";
 		if (extension == "abw") return "application/x-abiword";
@@ -170,7 +361,7 @@ namespace http {
 			case RETRY_AFTER: return "Retry-After";
 			case VARY: return "Vary";
 			case WARNING: return "Warning";
-			case ETAG: return "Etag";
+			case ETAG: return "ETag";
 			case LAST_MODIFIED: return "Last-Modified";
 			case WWW_AUTHENTICATE: return "Www-Authenticate";
 			case PROXY_AUTHENTICATE: return "Proxy-Authenticate";
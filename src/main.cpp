@@ -6,6 +6,7 @@
 #include <thread>
 #include "SignalHandle.hpp"
 #include "ServerManager.hpp"
+#include "WorkerPool.hpp"
 #include "http/index.hpp"
 
 int main(int argc, char **argv) {
@@ -18,6 +19,11 @@ int main(int argc, char **argv) {
 		handleSignals();
 		ConfigParser parser(argv[1]);
 		Config config = parser.load();
+
+		if (config.workerProcesses > 1) {
+			return WorkerPool(config).run();
+		}
+
 		ServerManager serverManager(config);
 		serverManager.listen();
 		serverManager.shutdown();
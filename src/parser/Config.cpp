@@ -3,6 +3,8 @@
 #include "Error.hpp"
 //#include "Server.hpp"
 #include <sstream> // std::istringstream
+#include <sys/un.h>
+#include <thread>
 
 // Define namespaces
 using std::string;
@@ -20,11 +22,51 @@ void ConfigParser::parseHttpBlock(ifstream &file, Config &config) {
 			parseServerBlock(file, server);
 			config.servers.push_back(server);
 		} else {
-			THROW_CONFIG_ERROR(EINVAL, "Invalid directive in http block: " + line);
+			parseHttp(line, config);
 		}
 	});
 }
 
+// Function to parse directives shared by all servers
+void ConfigParser::parseHttp(const string &line, Config &config) {
+	const ParserMap httpParsers = {
+		{"worker_processes", [&](const string &value) {
+			config.workerProcesses = (value == "auto")
+				? std::max(1u, std::thread::hardware_concurrency())
+				: utils::parseCount(value);
+			if (config.workerProcesses == 0) {
+				THROW_CONFIG_ERROR(EINVAL, "Invalid worker_processes");
+			}
+		}},
+		{"file_cache_size", [&](const string &value) {
+			if (!utils::isValidSize(value)) {
+				THROW_CONFIG_ERROR(EINVAL, "Invalid file_cache_size");
+			}
+			config.fileCacheSize = utils::convertSizeToBytes(value);
+		}},
+		{"file_cache_max_file_size", [&](const string &value) {
+			if (!utils::isValidSize(value)) {
+				THROW_CONFIG_ERROR(EINVAL, "Invalid file_cache_max_file_size");
+			}
+			config.fileCacheMaxFileSize = utils::convertSizeToBytes(value);
+		}},
+		{"file_cache_prewarm", [&](const string &value) {
+			config.fileCachePrewarm = utils::parseBool(value);
+		}},
+		{"open_file_cache", [&](const string &value) {
+			config.openFileCacheSize = utils::parseCount(value);
+		}},
+		{"open_file_cache_valid", [&](const string &value) {
+			config.openFileCacheValid = utils::parseDuration(value);
+		}},
+		{"missing_path_cache", [&](const string &value) {
+			config.missingPathCacheSize = utils::parseCount(value);
+		}}
+	};
+
+	utils::parseKeyValue(line, httpParsers);
+}
+
 void ConfigParser::parseServerBlock(ifstream &file, ServerConfig &server) {
 	utils::parseBlock(file, "server", [&](const string &line) {
 		if (line.find("location ") == 0) {
@@ -58,10 +100,15 @@ void ConfigParser::parseGlobal(const string &line, ServerConfig &server) {
 			server.ports.push_back(utils::parsePort(value));
 		}},
 		{"server_name", [&](const string &value) {
-			if (!server.serverName.empty()) {
-				THROW_CONFIG_ERROR(EINVAL, "Invalid server_name");
+			istringstream iss(value);
+			string name;
+			while (iss >> name) {
+				const std::size_t wildcards = std::count(name.begin(), name.end(), '*');
+				if (wildcards > 1 || (wildcards == 1 && !name.starts_with("*.") && !name.ends_with(".*"))) {
+					THROW_CONFIG_ERROR(EINVAL, "Invalid server_name");
+				}
+				server.serverNames.push_back(name);
 			}
-			server.serverName = value;
 		}},
 		{"error_page", [&](const string &value) {
 			istringstream iss(value);
@@ -76,6 +123,25 @@ void ConfigParser::parseGlobal(const string &line, ServerConfig &server) {
 				THROW_CONFIG_ERROR(EINVAL, "Invalid client_max_body_size");
 			}
 			server.clientMaxBodySize = utils::convertSizeToBytes(value);
+		}},
+		{"client_body_buffer_size", [&](const string &value) {
+			if (!server.clientBodyBufferSizeStr.empty() || !utils::isValidSize(value)) {
+				THROW_CONFIG_ERROR(EINVAL, "Invalid client_body_buffer_size");
+			}
+			server.clientBodyBufferSizeStr = value;
+			server.clientBodyBufferSize = utils::convertSizeToBytes(value);
+		}},
+		{"zerocopy_min_size", [&](const string &value) {
+			if (value == "off") {
+				server.zeroCopyMinSize = 0;
+				return;
+			}
+
+			if (!utils::isValidSize(value)) {
+				THROW_CONFIG_ERROR(EINVAL, "Invalid zerocopy_min_size");
+			}
+
+			server.zeroCopyMinSize = utils::convertSizeToBytes(value);
 		}}
 	};
 
@@ -104,6 +170,13 @@ void ConfigParser::parseLocation(const string &line, Location &currentLocation)
 			}
 			currentLocation.root = fullPath;
 		}},
+		{"bundle", [&](const string &value) {
+			fullPath = getConfigPath(value);
+			if (!currentLocation.bundle.empty() || !utils::isValidFilePath(fullPath)) {
+				THROW_CONFIG_ERROR(EINVAL, "Invalid bundle");
+			}
+			currentLocation.bundle = fullPath;
+		}},
 		{"index", [&](const string &value) {
 			fullPath = currentLocation.root/value;
 			if (!currentLocation.index.empty() || !utils::isValidFilePath(fullPath)) {
@@ -118,6 +191,13 @@ void ConfigParser::parseLocation(const string &line, Location &currentLocation)
 			currentLocation.autoIndex = value;
 			currentLocation.isAutoIndex = utils::parseBool(value);
 		}},
+		{"autoindex_page_size", [&](const string &value) {
+			std::size_t pageSize = utils::parseCount(value);
+			if (pageSize == 0) {
+				THROW_CONFIG_ERROR(ERANGE, "Invalid autoindex_page_size");
+			}
+			currentLocation.autoIndexPageSize = pageSize;
+		}},
 		{"methods", [&](const string &value) {
 			if (!currentLocation.methods.empty()) {
 				THROW_CONFIG_ERROR(EINVAL, "Invalid methods");
@@ -138,6 +218,89 @@ void ConfigParser::parseLocation(const string &line, Location &currentLocation)
 			}
 			currentLocation.cgiExtension.push_back(extension);
 		}},
+		{"cgi_workers", [&](const string &value) {
+			istringstream iss(value);
+			string min, max, extra;
+			if (!(iss >> min >> max) || (iss >> extra)) {
+				THROW_CONFIG_ERROR(EINVAL, "Invalid cgi_workers");
+			}
+			currentLocation.cgiWorkersMin = utils::parseCount(min);
+			currentLocation.cgiWorkersMax = utils::parseCount(max);
+			if (currentLocation.cgiWorkersMax == 0 || currentLocation.cgiWorkersMin > currentLocation.cgiWorkersMax) {
+				THROW_CONFIG_ERROR(ERANGE, "Invalid cgi_workers");
+			}
+		}},
+		{"cgi_worker_requests", [&](const string &value) {
+			currentLocation.cgiWorkerRequests = utils::parseCount(value);
+			if (currentLocation.cgiWorkerRequests == 0) {
+				THROW_CONFIG_ERROR(ERANGE, "Invalid cgi_worker_requests");
+			}
+		}},
+		{"cgi_worker_timeout", [&](const string &value) {
+			currentLocation.cgiWorkerTimeout = utils::parseDuration(value);
+		}},
+		{"fastcgi_pass", [&](const string &value) {
+			if (value.starts_with("unix:")) {
+				if (value.size() == 5 || value.size() - 5 >= sizeof(sockaddr_un::sun_path)) {
+					THROW_CONFIG_ERROR(EINVAL, "Invalid fastcgi_pass");
+				}
+			} else {
+				const std::size_t colon = value.rfind(':');
+				if (colon == string::npos || !utils::isValidIP(value.substr(0, colon))) {
+					THROW_CONFIG_ERROR(EINVAL, "Invalid fastcgi_pass");
+				}
+				utils::parsePort(value.substr(colon + 1));
+			}
+			currentLocation.fastCgiPass = value;
+		}},
+		{"fastcgi_connections", [&](const string &value) {
+			currentLocation.fastCgiConnections = utils::parseCount(value);
+			if (currentLocation.fastCgiConnections == 0) {
+				THROW_CONFIG_ERROR(ERANGE, "Invalid fastcgi_connections");
+			}
+		}},
+		{"expires", [&](const string &value) {
+			if (currentLocation.expires.has_value()) {
+				THROW_CONFIG_ERROR(EINVAL, "Invalid expires");
+			}
+			if (value != "off") {
+				currentLocation.expires = utils::parseDuration(value);
+			}
+		}},
+		{"immutable", [&](const string &value) {
+			currentLocation.isImmutable = utils::parseBool(value);
+		}},
+		{"precompressed", [&](const string &value) {
+			currentLocation.isPrecompressed = utils::parseBool(value);
+		}},
+		{"gzip", [&](const string &value) {
+			currentLocation.isGzip = utils::parseBool(value);
+		}},
+		{"gzip_comp_level", [&](const string &value) {
+			std::size_t level = utils::parseCount(value);
+			if (level < 1 || level > 9) {
+				THROW_CONFIG_ERROR(ERANGE, "Invalid gzip_comp_level");
+			}
+			currentLocation.gzipLevel = static_cast<int>(level);
+		}},
+		{"gzip_min_length", [&](const string &value) {
+			if (!utils::isValidSize(value)) {
+				THROW_CONFIG_ERROR(EINVAL, "Invalid gzip_min_length");
+			}
+			currentLocation.gzipMinLength = utils::convertSizeToBytes(value);
+		}},
+		{"gzip_types", [&](const string &value) {
+			istringstream iss(value);
+			vector<string> types;
+			string type;
+			while (iss >> type) {
+				types.push_back(utils::lowerCase(type));
+			}
+			if (types.empty()) {
+				THROW_CONFIG_ERROR(EINVAL, "Invalid gzip_types");
+			}
+			currentLocation.gzipTypes = types;
+		}},
 		{"return", [&](const string &value) {
 			if (!currentLocation.returnUrl.empty()) {
 				THROW_CONFIG_ERROR(EINVAL, "Invalid return");
@@ -0,0 +1,54 @@
+#include "CgiScriptCache.hpp"
+#include "utils/OpenFileCache.hpp"
+
+namespace fs = std::filesystem;
+using std::chrono::steady_clock;
+
+CgiScriptCache& CgiScriptCache::instance() {
+	static CgiScriptCache cache;
+	return cache;
+}
+
+void CgiScriptCache::configure(std::size_t maxEntries, std::chrono::seconds validity, bool isWatched) {
+	_maxEntries = maxEntries;
+	_validity = validity;
+	_isWatched = isWatched;
+	_entries.clear();
+}
+
+// Drops the decision for `path` and, when it is a directory, every one below it
+void CgiScriptCache::invalidate(const fs::path& path) {
+	const std::string key = path.lexically_normal().string();
+	const std::string prefix = key.ends_with('/') ? key : key + "/";
+
+	std::erase_if(_entries, [&key, &prefix](const auto& item) {
+		return item.first == key || item.first.starts_with(prefix);
+	});
+}
+
+bool CgiScriptCache::isRunnable(std::string_view scriptPath) {
+	if (auto it = _entries.find(scriptPath); it != _entries.end() && (_isWatched || steady_clock::now() < it->second.validUntil)) {
+		return it->second.isRunnable;
+	}
+
+	const fs::path path(scriptPath);
+	auto script = utils::OpenFileCache::instance().stat(path);
+	const bool isRunnable = (script != nullptr && script->isRegularFile() && script->isOwnerExecutable());
+
+	// invalidate() matches normalized paths, a path with dot segments would never be dropped
+	if (!isEnabled() || path.lexically_normal() != path) {
+		return isRunnable;
+	}
+
+	// Evicting one by one is not worth it, the scripts of a server fit many times over
+	if (_entries.size() >= _maxEntries) {
+		_entries.clear();
+	}
+
+	_entries.insert_or_assign(std::string(scriptPath), Entry { isRunnable, steady_clock::now() + _validity });
+	return isRunnable;
+}
+
+bool CgiScriptCache::isEnabled() const {
+	return (_maxEntries > 0);
+}
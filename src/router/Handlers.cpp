@@ -1,6 +1,13 @@
+#include <array>
+#include <optional>
+#include "MissingPaths.hpp"
 #include "Router.hpp"
 #include "http/index.hpp"
+#include "http/Bundle.hpp"
+#include "http/CannedResponses.hpp"
+#include "http/DirectoryListing.hpp"
 #include "utils/common.hpp"
+#include "utils/OpenFileCache.hpp"
 
 using http::StatusCode;
 using http::Request;
@@ -8,30 +15,205 @@ using http::Response;
 using std::string;
 namespace fs = std::filesystem;
 
-// Function to generate directory listing
-string generateDirectoryListing(const string& path) {
-	string listing = "<html><head><title>Directory Listing</title></head><body><h1>Directory Listing</h1><ul>";
+// Cache-Control of the files served from a location
+string cacheControlOf(const Location& loc) {
+	if (!loc.expires.has_value()) {
+		return "no-cache";
+	}
+
+	string cacheControl = "public, max-age=" + std::to_string(loc.expires->count());
+
+	if (loc.isImmutable) {
+		cacheControl += ", immutable";
+	}
+
+	return cacheControl;
+}
+
+// Function to serve one representation of a file, answering conditional and range requests before it is opened
+void serveRepresentation(const fs::path& filePath, Request& req, Response& res) {
+	auto entry = http::FileCache::instance().get(filePath);
+	string entityTag;
+	std::time_t lastModified;
+	std::size_t size;
+
+	if (entry != nullptr) {
+		entityTag = entry->entityTag;
+		lastModified = entry->lastModified;
+		size = entry->content.size();
+	} else if (auto file = utils::OpenFileCache::instance().stat(filePath)) {
+		const struct timespec mtime { file->stat.stx_mtime.tv_sec, file->stat.stx_mtime.tv_nsec };
+		entityTag = http::entityTagOf(file->stat.stx_ino, file->stat.stx_size, mtime);
+		lastModified = mtime.tv_sec;
+		size = file->size();
+	} else {
+		res.setFile(StatusCode::OK_200, filePath);
+		return;
+	}
+
+	if (req.isNotModified(entityTag, lastModified)) {
+		res.setNotModified(entityTag, lastModified);
+	} else if (auto ranges = req.getRanges(size, entityTag, lastModified)) {
+		if (ranges->empty()) {
+			res.setRangeNotSatisfiable(size);
+		} else {
+			res.setFileRanges(filePath, *ranges);
+		}
+	} else if (entry != nullptr) {
+		res.setFile(StatusCode::OK_200, entry);
+	} else {
+		res.setFile(StatusCode::OK_200, filePath);
+	}
+}
+
+// Returns the precompressed sidecar (foo.css.br, foo.css.gz) preferred by the client's Accept-Encoding, if any
+std::optional<std::pair<fs::path, string>> findPrecompressed(const fs::path& filePath, const Request& req) {
+	auto acceptEncoding = req.getHeader(http::Header::ACCEPT_ENCODING);
+
+	if (!acceptEncoding.has_value()) {
+		return std::nullopt;
+	}
+
+	utils::OpenFileCache& openFileCache = utils::OpenFileCache::instance();
+	auto file = openFileCache.stat(filePath);
+
+	if (file == nullptr) {
+		return std::nullopt;
+	}
+
+	// Brotli wins ties, it compresses text better than gzip
+	std::array<std::pair<string, string>, 2> encodings { { { "br", ".br" }, { "gzip", ".gz" } } };
+	std::ranges::stable_sort(encodings, std::greater<>(), [&](const auto& encoding) {
+		return http::qualityOf(*acceptEncoding, encoding.first);
+	});
+
+	for (const auto& [encoding, suffix] : encodings) {
+		if (http::qualityOf(*acceptEncoding, encoding) <= 0) {
+			continue;
+		}
+
+		fs::path sidecarPath = filePath.string() + suffix;
+		auto sidecar = openFileCache.stat(sidecarPath);
+
+		// A sidecar older than the file it was made from is stale
+		if (sidecar != nullptr && sidecar->isRegularFile() && sidecar->stat.stx_mtime.tv_sec >= file->stat.stx_mtime.tv_sec) {
+			return std::make_pair(sidecarPath, encoding);
+		}
+	}
+
+	return std::nullopt;
+}
+
+// Function to serve a regular file
+void handleFileRequest(const Location& loc, const fs::path& filePath, Request& req, Response& res) {
+	res.setHeader(http::Header::CACHE_CONTROL, cacheControlOf(loc));
+	res.setHeader(http::Header::ACCEPT_RANGES, "bytes");
+
+	if (loc.isPrecompressed) {
+		res.setHeader(http::Header::VARY, "Accept-Encoding");
+
+		if (auto sidecar = findPrecompressed(filePath, req)) {
+			res.setHeader(http::Header::CONTENT_ENCODING, sidecar->second);
+			res.setFileMimeType(http::getMimeType(filePath.extension().string().erase(0, 1)));
+			serveRepresentation(sidecar->first, req, res);
+			return;
+		}
+	}
+
+	serveRepresentation(filePath, req, res);
+}
+
+// Serves a file packed into the location bundle, preferring the variant the client's Accept-Encoding ranks first
+void handleBundleRequest(const Location& loc, const string& requestPath, Request& req, Response& res) {
+	using http::Bundle;
+
+	auto bundle = http::Bundles::instance().get(loc.bundle);
+
+	if (bundle == nullptr) {
+		res.setFile(StatusCode::INTERNAL_SERVER_ERROR_500, loc.root / "500.html");
+		return;
+	}
+
+	string path = requestPath.substr(std::min(loc.path.size(), requestPath.size()));
+
+	if (path.starts_with('/')) {
+		path.erase(0, 1);
+	}
+
+	if (path.empty() || path.ends_with('/')) {
+		path += loc.index.empty() ? "index.html" : loc.index;
+	}
+
+	const Bundle::Entry* entry = bundle->find(path);
+
+	if (entry == nullptr) {
+		res.setFile(StatusCode::NOT_FOUND_404, loc.root / "404.html");
+		return;
+	}
+
+	const Bundle::Variant* variant = &entry->variants[Bundle::IDENTITY];
+	auto acceptEncoding = req.getHeader(http::Header::ACCEPT_ENCODING);
+
+	res.setHeader(http::Header::CACHE_CONTROL, cacheControlOf(loc));
 
-	for (const auto& entry : fs::directory_iterator(path)) {
-		const string& name = entry.path().filename().string();
-		listing += "<li><a href=\"" + name + "\">" + name + "</a></li>";
+	if (entry->variants[Bundle::GZIP].entityTag.size > 0 || entry->variants[Bundle::BROTLI].entityTag.size > 0) {
+		res.setHeader(http::Header::VARY, "Accept-Encoding");
 	}
 
-	listing += "</ul></body></html>";
-	return listing;
+	if (acceptEncoding.has_value()) {
+		// Brotli wins ties, it compresses text better than gzip
+		std::array<std::pair<string, Bundle::Encoding>, 2> encodings { { { "br", Bundle::BROTLI }, { "gzip", Bundle::GZIP } } };
+		std::ranges::stable_sort(encodings, std::greater<>(), [&](const auto& encoding) {
+			return http::qualityOf(*acceptEncoding, encoding.first);
+		});
+
+		for (const auto& [name, encoding] : encodings) {
+			if (http::qualityOf(*acceptEncoding, name) > 0 && entry->variants[encoding].entityTag.size > 0) {
+				variant = &entry->variants[encoding];
+				break;
+			}
+		}
+	}
+
+	const string entityTag(bundle->viewOf(variant->entityTag));
+
+	if (req.isNotModified(entityTag, entry->lastModified)) {
+		res.setNotModified(entityTag, entry->lastModified);
+	} else {
+		res.setBundled(bundle, *variant);
+	}
+}
+
+// Streams one page of the cached listing, sorted and paged by the query string
+void handleListingRequest(const Location& loc, const fs::path& directory, Request& req, Response& res) {
+	auto entries = http::DirectoryListing::instance().get(directory);
+
+	if (entries == nullptr) {
+		res.setFile(StatusCode::INTERNAL_SERVER_ERROR_500, loc.root / "500.html");
+		return;
+	}
+
+	auto page = http::DirectoryListing::pageOf(req.getUrl().query, loc.autoIndexPageSize);
+
+	res.setStream(
+		StatusCode::OK_200,
+		std::make_unique<http::DirectoryListingPayload>(entries, req.getUrl().path, page),
+		http::getMimeType("html")
+	);
 }
 
 // Function to handle directory requests
-void handleDirectoryRequest(const Location& loc, const fs::path& filePath, Response& res) {
+void handleDirectoryRequest(const Location& loc, const fs::path& filePath, Request& req, Response& res) {
+	utils::OpenFileCache& openFileCache = utils::OpenFileCache::instance();
 	fs::path indexPath = filePath / loc.index;
-	if (!fs::exists(indexPath)) {
+	if (openFileCache.stat(indexPath) == nullptr) {
 		indexPath = loc.root / loc.index;
 	}
 
-	if (fs::exists(indexPath)) {
-		res.setFile(StatusCode::OK_200, indexPath);
+	if (!loc.index.empty() && openFileCache.stat(indexPath) != nullptr) {
+		handleFileRequest(loc, indexPath, req, res);
 	} else if (loc.isAutoIndex) {
-		res.setFile(StatusCode::OK_200, generateDirectoryListing(filePath));
+		handleListingRequest(loc, filePath, req, res);
 	} else {
 		res.setFile(StatusCode::FORBIDDEN_403, loc.root / "403.html");
 	}
@@ -39,12 +221,14 @@ void handleDirectoryRequest(const Location& loc, const fs::path& filePath, Respo
 
 // Function to handle multipart POST requests
 void handleMultipartPostRequest(fs::path uploadPath, fs::path rootPath, Request& req, Response& res) {
-	auto elements = http::parseMultipart(req.getRawBody(), req.getBoundary());
+	auto elements = http::parseMultipart(req.getBody().view(), req.getBoundary());
 	string responseMessage;
 
 	for (auto& element : elements) {
 		try {
-			std::ofstream file(uploadPath.string() + utils::generate_random_string() + "_" + element.fileName, std::ios::binary);
+			const fs::path filePath = uploadPath.string() + utils::generate_random_string() + "_" + element.fileName;
+			std::ofstream file(filePath, std::ios::binary);
+			MissingPaths::instance().invalidate(filePath);
 
 			if (!file) {
 				std::cerr<< YELLOW "Failed to open file" RESET << std::endl;
@@ -66,21 +250,45 @@ void handleMultipartPostRequest(fs::path uploadPath, fs::path rootPath, Request&
 
 // Function to handle GET requests
 void handleGetRequest(const Location& loc, const string& requestPath, Request& req, Response& res) {
-	(void) req;
 	try {
+		if (!loc.bundle.empty()) {
+			handleBundleRequest(loc, requestPath, req, res);
+			return;
+		}
+
 		// Compute the full file path by appending the request subpath
 		fs::path filePath = utils::computeFilePath(loc, requestPath);
-		if (fs::is_directory(filePath)) {
+		http::FileCache& cache = http::FileCache::instance();
+		MissingPaths& missingPaths = MissingPaths::instance();
+
+		// A path that was missing before gets the canned 404 without another stat
+		if (missingPaths.contains(filePath.native())) {
+			res.setFile(StatusCode::NOT_FOUND_404, loc.root / "404.html");
+			return;
+		}
+
+		// A cached file (or cached directory index) is served without touching the filesystem
+		fs::path cachedPath = requestPath.ends_with('/') ? filePath / loc.index : filePath;
+		if (cache.get(cachedPath) != nullptr) {
+			handleFileRequest(loc, cachedPath, req, res);
+			return;
+		}
+
+		auto file = utils::OpenFileCache::instance().stat(filePath);
+
+		if (file != nullptr && file->isDirectory()) {
 			std::cout << YELLOW "Directory request detected" RESET << std::endl;
-			handleDirectoryRequest(loc, filePath, res);
-		} else if (fs::is_regular_file(filePath)) {
+			handleDirectoryRequest(loc, filePath, req, res);
+		} else if (file != nullptr && file->isRegularFile()) {
 			std::cout << YELLOW "File request detected" RESET << std::endl;
-			res.setFile(StatusCode::OK_200, filePath);
+			handleFileRequest(loc, filePath, req, res);
 		} else {
 			std::cout << YELLOW "File not found" RESET << std::endl;
+			missingPaths.insert(filePath.native());
 			res.setFile(StatusCode::NOT_FOUND_404, loc.root / "404.html");
 		}
 	} catch (const std::exception& e) {
+		res.reset();
 		res.setFile(StatusCode::INTERNAL_SERVER_ERROR_500, loc.root / "500.html");
 	}
 }
@@ -97,15 +305,10 @@ void handlePostRequest(const Location& loc, const string& requestPath, Request&
 		const std::string& contentType = req.getHeader(http::Header::CONTENT_TYPE).value_or("");
 		const std::string& ext = http::getExtensionFromMimeType(contentType);
 
-		std::ofstream file(uploadPath.string() + utils::generate_random_string() + ext, std::ios::binary);
+		const fs::path filePath = uploadPath.string() + utils::generate_random_string() + ext;
 
-		if (!file) {
-			std::cerr << YELLOW "Failed to open file" RESET << std::endl;
-			res.setFile(StatusCode::INTERNAL_SERVER_ERROR_500, loc.root / "500.html");
-			return;
-		}
-
-		file.write(reinterpret_cast<const char*>(req.getRawBody().data()), req.getRawBody().size());
+		req.getBody().saveAs(filePath);
+		MissingPaths::instance().invalidate(filePath);
 		res.setText(http::StatusCode::OK_200, "File uploaded successfully\n");
 	} catch (const std::exception& e) {
 		res.setFile(http::StatusCode::INTERNAL_SERVER_ERROR_500, loc.root / "500.html");
@@ -122,6 +325,8 @@ void handleDeleteRequest(const Location& loc, const string& requestPath, Request
 			return;
 		}
 		if (fs::remove(filePath)) {
+			// The tree changed under the path, drop what was recorded missing below it
+			MissingPaths::instance().invalidate(filePath);
 			res.setText(http::StatusCode::OK_200, "File deleted successfully");
 			return;
 		} else {
@@ -133,17 +338,10 @@ void handleDeleteRequest(const Location& loc, const string& requestPath, Request
 	}
 }
 
-// Handler function to handle redirect requests
-void Router::handleRedirectRequest(const Location& loc, Response& res, Request& req) {
-	std::string redirectUrl = loc.returnUrl[1];  // Extract redirect target
-	std::cout << YELLOW "Redirecting to: " RESET << redirectUrl << std::endl;
-
-	// Correctly set HTTP 301 redirect
-	res.setStatusCode(http::StatusCode::MOVED_PERMANENTLY_301);
-	res.setHeader(http::Header::LOCATION, redirectUrl);
-	res.setHeader(http::Header::CONTENT_LENGTH, "0");  // Explicitly indicate no body
+// Handler function to handle redirect requests, the response is serialized when the config loads
+void Router::handleRedirectRequest(const RouteTable::Route& route, Response& res, Request& req) {
+	std::cout << YELLOW "Redirecting to: " RESET << route.location.returnUrl[1] << std::endl;
 
-	// Ensure response is fully constructed and sent
-	res.build();
+	res.setCanned(http::StatusCode::MOVED_PERMANENTLY_301, route.redirect);
 	req.setStatus(Request::Status::COMPLETE);
 }
\ No newline at end of file
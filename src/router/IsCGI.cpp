@@ -1,55 +1,42 @@
 #include "Router.hpp"
+#include "CgiScriptCache.hpp"
 
 using std::string;
-namespace fs = std::filesystem;
 
-bool Router::isCGI(const Location& location, const string& requestPath) const {
-	std::cout << "Checking for CGI" << std::endl;
-	// 1. Check if CGI is enabled in this location
-	if (location.cgiExtension.empty()) {
-		std::cout << "CGI extension is empty" << std::endl;
-		return false;
-	}
+// Whether the request names a runnable script with one of the CGI extensions of the route.
+// A FastCGI application has the scripts, without extensions it gets every request of the route
+bool Router::isCGI(const RouteTable::Route& route, const string& requestPath) const {
+	const bool isFastCgi = !route.location.fastCgiPass.empty();
 
-	// 2. Extract file extension from request path
-	size_t dotPos = requestPath.find_last_of('.');
-	if (dotPos == string::npos) {
-		std::cout << "No file extension found" << std::endl;
-		return false;  // No file extension found
+	if (route.cgiExtensions.empty()) {
+		return isFastCgi;
 	}
 
-	string ext = requestPath.substr(dotPos + 1);
-	std::cout << "File extension: " << ext << std::endl;
+	const std::size_t dotPos = requestPath.find_last_of('.');
 
-	// 3. Check if the file extension is in the cgiExtension vector
-	bool isCgiExtension = false;
-	for (const auto& cgiExt : location.cgiExtension) {
-		if (ext == cgiExt) {
-			isCgiExtension = true;
-			break;
-		}
+	if (dotPos == string::npos || !route.isCgiExtension(std::string_view(requestPath).substr(dotPos + 1))) {
+		return false;
 	}
 
-	if (!isCgiExtension) {
-		std::cout << "File extension is not a valid CGI script type" << std::endl;
-		return false;  // File extension is not a valid CGI script type
+	if (isFastCgi) {
+		return true;
 	}
 
-	// 4. Compute the full path of the script
-	fs::path scriptPath = location.root / requestPath.substr(location.path.size());
-	std::cout << "Script path: " << scriptPath << std::endl;
-	// 5. Check if the requested file exists and is executable
-	if (!fs::exists(scriptPath) || !fs::is_regular_file(scriptPath)) {
-		std::cout << "Script does not exist or is not a regular file" << std::endl;
-		return false;
+	// location.root joined with the rest of the path, built in a reused buffer. A location without a
+	// trailing slash leaves the rest starting with one, which must not make the path absolute.
+	std::string_view relative = std::string_view(requestPath).substr(route.location.path.size());
+
+	while (relative.starts_with('/')) {
+		relative.remove_prefix(1);
 	}
 
-	// 6. Check if the file has execute permissions for the owner
-	fs::perms permissions = fs::status(scriptPath).permissions();
-	if ((permissions & fs::perms::owner_exec) == fs::perms::none) {
-		std::cout << "Script does not have execute permissions" << std::endl;
-		return false;
+	_scriptPath.assign(route.location.root.native());
+
+	if (!_scriptPath.ends_with('/')) {
+		_scriptPath += '/';
 	}
-	std::cout << "CGI detected and set to true" << std::endl;
-	return true;
-}
\ No newline at end of file
+
+	_scriptPath += relative;
+
+	return CgiScriptCache::instance().isRunnable(_scriptPath);
+}
@@ -1,15 +0,0 @@
-#include "Router.hpp"
-
-using std::string;
-
-const Location* Router::findBestMatchingLocation(const string& url) const {
-	const Location* bestMatch = nullptr;
-	size_t longestMatch = 0;
-	for (const auto& [path, config] : _locationConfigs) {
-		if (url.substr(0, path.size()) == path && path.length() > longestMatch) {
-			bestMatch = &config;
-			longestMatch = path.length();
-		}
-	}
-	return bestMatch;
-}
\ No newline at end of file
@@ -0,0 +1,101 @@
+#include <algorithm>
+
+#include "LocationTrie.hpp"
+
+LocationTrie::LocationTrie() {
+	clear();
+}
+
+// Adds `prefix`, or replaces its value when it is already there
+void LocationTrie::insert(std::string_view prefix, std::size_t value) {
+	std::uint32_t current = 0;
+
+	while (true) {
+		if (prefix.empty()) {
+			_nodes[current].value = value;
+			return;
+		}
+
+		const Node* child = _childOf(_nodes[current], prefix.front());
+
+		if (child == nullptr) {
+			_addChild(current, std::string(prefix), value);
+			return;
+		}
+
+		const std::uint32_t index = static_cast<std::uint32_t>(child - _nodes.data());
+		const std::string_view label = child->label;
+		const std::size_t common = std::mismatch(label.begin(), label.end(), prefix.begin(), prefix.end()).first - label.begin();
+
+		// The edge ends inside `prefix`, or exactly at its end
+		if (common == label.size()) {
+			prefix.remove_prefix(common);
+			current = index;
+			continue;
+		}
+
+		// Split the edge: the shared part becomes a new node above the old child
+		std::string shared(label.substr(0, common));
+		Node tail = std::move(_nodes[index]);
+		tail.label.erase(0, common);
+
+		_nodes[index] = Node { std::move(shared), NONE, {} };
+		_nodes.push_back(std::move(tail));
+		_nodes[index].children.push_back(static_cast<std::uint32_t>(_nodes.size() - 1));
+
+		prefix.remove_prefix(common);
+		current = index;
+	}
+}
+
+std::size_t LocationTrie::find(std::string_view path) const {
+	const Node* node = &_nodes.front();
+	std::size_t best = node->value;
+
+	while (!path.empty()) {
+		node = _childOf(*node, path.front());
+
+		if (node == nullptr || !path.starts_with(node->label)) {
+			break;
+		}
+
+		path.remove_prefix(node->label.size());
+
+		if (node->value != NONE) {
+			best = node->value;
+		}
+	}
+
+	return best;
+}
+
+void LocationTrie::clear() {
+	_nodes.assign(1, Node {});
+}
+
+const LocationTrie::Node* LocationTrie::_childOf(const Node& node, char c) const {
+	auto it = std::lower_bound(node.children.begin(), node.children.end(), c, [this](std::uint32_t child, char value) {
+		return _nodes[child].label.front() < value;
+	});
+
+	if (it == node.children.end() || _nodes[*it].label.front() != c) {
+		return nullptr;
+	}
+
+	return &_nodes[*it];
+}
+
+std::uint32_t LocationTrie::_addChild(std::uint32_t parent, std::string label, std::size_t value) {
+	const char first = label.front();
+
+	_nodes.push_back(Node { std::move(label), value, {} });
+
+	const std::uint32_t child = static_cast<std::uint32_t>(_nodes.size() - 1);
+	std::vector<std::uint32_t>& children = _nodes[parent].children;
+	auto it = std::lower_bound(children.begin(), children.end(), first, [this](std::uint32_t other, char c) {
+		return _nodes[other].label.front() < c;
+	});
+
+	children.insert(it, child);
+	return child;
+}
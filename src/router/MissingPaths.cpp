@@ -0,0 +1,151 @@
+#include <bit>
+#include <functional>
+#include <limits>
+#include "MissingPaths.hpp"
+
+namespace fs = std::filesystem;
+using std::chrono::steady_clock;
+
+MissingPaths& MissingPaths::instance() {
+	static MissingPaths cache;
+	return cache;
+}
+
+// Eight counters per entry keep false positives of the three probes around 3% when the LRU is full
+void MissingPaths::configure(std::size_t maxEntries, std::chrono::seconds validity, bool isWatched) {
+	_maxEntries = maxEntries;
+	_validity = validity;
+	_isWatched = isWatched;
+	_index.clear();
+	_entries.clear();
+	_counters.assign(maxEntries > 0 ? std::bit_ceil(maxEntries * COUNTERS_PER_ENTRY) : 0, 0);
+	_mask = _counters.empty() ? 0 : _counters.size() - 1;
+	_index.reserve(maxEntries);
+}
+
+// Drops `path` and, when it is a directory, every path below it
+void MissingPaths::invalidate(const fs::path& path) {
+	if (_entries.empty()) {
+		return;
+	}
+
+	const std::string key = path.lexically_normal().string();
+
+	// An overflowed inotify queue reports "/", which is no prefix of relative roots
+	if (key == "/") {
+		configure(_maxEntries, _validity, _isWatched);
+		return;
+	}
+
+	if (auto it = _index.find(key); it != _index.end()) {
+		_erase(it->second);
+	}
+
+	const std::string prefix = key.ends_with('/') ? key : key + "/";
+
+	for (auto it = _entries.begin(); it != _entries.end();) {
+		if (it->path.starts_with(prefix)) {
+			auto next = std::next(it);
+			_erase(it);
+			it = next;
+			continue;
+		}
+
+		it++;
+	}
+}
+
+bool MissingPaths::contains(std::string_view path) {
+	if (_entries.empty()) {
+		return false;
+	}
+
+	const std::uint64_t hash = std::hash<std::string_view>()(path);
+
+	if (!_mayContain(hash)) {
+		return false;
+	}
+
+	auto it = _index.find(path);
+
+	if (it == _index.end()) {
+		return false;
+	}
+
+	if (!_isWatched && steady_clock::now() >= it->second->validUntil) {
+		_erase(it->second);
+		return false;
+	}
+
+	_entries.splice(_entries.begin(), _entries, it->second);
+	return true;
+}
+
+void MissingPaths::insert(std::string_view path) {
+	if (!isEnabled()) {
+		return;
+	}
+
+	// invalidate() matches normalized paths, a path with dot segments would never be dropped
+	if (fs::path(path).lexically_normal().native() != path) {
+		return;
+	}
+
+	if (auto it = _index.find(path); it != _index.end()) {
+		it->second->validUntil = steady_clock::now() + _validity;
+		_entries.splice(_entries.begin(), _entries, it->second);
+		return;
+	}
+
+	if (_entries.size() >= _maxEntries) {
+		_erase(std::prev(_entries.end()));
+	}
+
+	const std::uint64_t hash = std::hash<std::string_view>()(path);
+
+	_entries.push_front(Entry { std::string(path), hash, steady_clock::now() + _validity });
+	_index.emplace(_entries.front().path, _entries.begin());
+	_count(hash, true);
+}
+
+bool MissingPaths::isEnabled() const {
+	return (_maxEntries > 0);
+}
+
+std::size_t MissingPaths::size() const {
+	return _entries.size();
+}
+
+// The probes are derived from the two halves of one hash (Kirsch-Mitzenmacher)
+bool MissingPaths::_mayContain(std::uint64_t hash) const {
+	const std::uint64_t step = (hash >> 32) | 1;
+
+	for (std::size_t i = 0; i < HASH_COUNT; i++) {
+		if (_counters[(hash + i * step) & _mask] == 0) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// A counter that saturated can no longer tell how many entries share it, so it stays set
+void MissingPaths::_count(std::uint64_t hash, bool isAdding) {
+	const std::uint64_t step = (hash >> 32) | 1;
+
+	for (std::size_t i = 0; i < HASH_COUNT; i++) {
+		std::uint8_t& counter = _counters[(hash + i * step) & _mask];
+
+		if (counter == std::numeric_limits<std::uint8_t>::max()) {
+			continue;
+		}
+
+		counter += isAdding ? 1 : -1;
+	}
+}
+
+void MissingPaths::_erase(Entries::iterator it) {
+	_count(it->hash, false);
+	_index.erase(it->path);
+	_entries.erase(it);
+}
@@ -0,0 +1,88 @@
+#include <algorithm>
+
+#include "RouteTable.hpp"
+#include "http/CannedResponses.hpp"
+
+namespace {
+	constexpr std::uint8_t bitOf(RouteTable::Method method) {
+		return static_cast<std::uint8_t>(1 << static_cast<std::uint8_t>(method));
+	}
+}
+
+RouteTable::RouteTable(const ServerConfig& serverConfig)
+	: _errorPages(serverConfig.errorPages)
+	, _clientBodyBufferSize(serverConfig.clientBodyBufferSize)
+	, _clientMaxBodySize(serverConfig.clientMaxBodySize) {
+	_routes.reserve(serverConfig.locations.size());
+
+	for (const auto& location : serverConfig.locations) {
+		Route route { location, 0, location.cgiExtension, nullptr };
+
+		for (const auto& method : location.methods) {
+			if (const Method m = methodOf(method); m != Method::UNKNOWN) {
+				route.methods |= bitOf(m);
+			}
+		}
+
+		std::ranges::sort(route.cgiExtensions);
+
+		if (!location.returnUrl.empty()) {
+			route.redirect = http::CannedResponses::serializeRedirect(location.returnUrl[1]);
+		}
+
+		// A later location with the same path replaces the earlier one
+		_routes.push_back(std::move(route));
+		_trie.insert(location.path, _routes.size() - 1);
+	}
+}
+
+RouteTable::Method RouteTable::methodOf(std::string_view method) {
+	if (method == "GET") {
+		return Method::GET;
+	}
+
+	if (method == "POST") {
+		return Method::POST;
+	}
+
+	if (method == "DELETE") {
+		return Method::DELETE;
+	}
+
+	return Method::UNKNOWN;
+}
+
+// The route of the longest location path that prefixes `path`
+const RouteTable::Route* RouteTable::match(std::string_view path) const {
+	const std::size_t index = _trie.find(path);
+
+	return (index == LocationTrie::NONE) ? nullptr : &_routes[index];
+}
+
+const std::vector<RouteTable::Route>& RouteTable::getRoutes() const {
+	return _routes;
+}
+
+// The configured page, empty when there is none
+const std::string& RouteTable::getErrorPage(int code) const {
+	static const std::string none;
+	auto it = _errorPages.find(code);
+
+	return (it == _errorPages.end()) ? none : it->second;
+}
+
+std::size_t RouteTable::getClientBodyBufferSize() const {
+	return _clientBodyBufferSize;
+}
+
+std::size_t RouteTable::getClientMaxBodySize() const {
+	return _clientMaxBodySize;
+}
+
+bool RouteTable::Route::allows(Method method) const {
+	return method != Method::UNKNOWN && (methods & bitOf(method)) != 0;
+}
+
+bool RouteTable::Route::isCgiExtension(std::string_view extension) const {
+	return std::ranges::binary_search(cgiExtensions, extension, std::less<>());
+}
@@ -2,6 +2,7 @@
 #include "Router.hpp"
 #include "http/index.hpp"
 #include "utils/index.hpp"
+#include "http/CannedResponses.hpp"
 
 using http::StatusCode;
 using http::Request;
@@ -17,94 +18,142 @@ namespace fs = std::filesystem;
 */
 
 void Router::addLocations(const ServerConfig& serverConfig) {
-	_serverConfig = serverConfig;
-	for (const auto& location : serverConfig.locations) {
-		_locationConfigs[location.path] = location;
-	}
+	_routeTable = std::make_shared<const RouteTable>(serverConfig);
+}
+
+const RouteTable& Router::getRouteTable() const {
+	return *_routeTable;
 }
 
 void Router::get(Handler handler) {
-	_routes["GET"] = handler;
+	_handlers[static_cast<std::size_t>(RouteTable::Method::GET)] = handler;
 }
 
 void Router::post(Handler handler) {
-	_routes["POST"] = handler;
+	_handlers[static_cast<std::size_t>(RouteTable::Method::POST)] = handler;
 }
 
 void Router::del(Handler handler) {
-	_routes["DELETE"] = handler;
+	_handlers[static_cast<std::size_t>(RouteTable::Method::DELETE)] = handler;
 }
 
 // Hander function to handle requests based on the method and matching location
 void Router::handle(Request& request, Response& response) {
 	std::cout << "handle(): " << request.getUri() << response.getClientSocket() << std::endl;
 	if (request.getStatus() == Request::Status::BAD) {
-		response.setFile(StatusCode::BAD_REQUEST_400, _serverConfig.errorPages[400]);
+		response.setFile(StatusCode::BAD_REQUEST_400, _routeTable->getErrorPage(400));
 		return;
 	}
 
 	// Get the request path and normalize it
-	std::string requestPath = utils::lowerCase(request.getUrl().path);
+	const std::string& requestPath = normalizeRequestPath(request.getUrl().path);
 	std::cout << "Request path: " << requestPath << std::endl;
-	// Ensure directory paths have a trailing slash, but files do not
-	if (!requestPath.empty() && requestPath.back() != '/' && !fs::path(requestPath).has_extension()) {
-		requestPath += "/";
-	}
 
 	// Validate the request path
 	if (!utils::isValidPath(requestPath)) {
-		response.setFile(StatusCode::BAD_REQUEST_400, _serverConfig.errorPages[400]);
+		response.setFile(StatusCode::BAD_REQUEST_400, _routeTable->getErrorPage(400));
 		return;
 	}
 
 	// Find the best matching location
-	const Location* location = findBestMatchingLocation(requestPath);
-	if (!location) {
-		response.setFile(StatusCode::NOT_FOUND_404, _serverConfig.errorPages[404]);
+	const RouteTable::Route* route = _routeTable->match(requestPath);
+	if (!route) {
+		response.setFile(StatusCode::NOT_FOUND_404, _routeTable->getErrorPage(404));
 		return;
 	}
 
+	const Location& location = route->location;
+
+	if (location.isGzip && http::qualityOf(request.getHeader(http::Header::ACCEPT_ENCODING).value_or(""), "gzip") > 0) {
+		response.setCompression(&location);
+	}
+
 	// Check for redirect
-	if (!location->returnUrl.empty()) {
-		handleRedirectRequest(*location, response, request);
+	if (route->redirect != nullptr) {
+		handleRedirectRequest(*route, response, request);
 		std::cout << "SHOULD STOP HERE" << std::endl;
 		return;
 	}
 
-	if (isCGI(*location, requestPath)) {
+	if (isCGI(*route, requestPath)) {
 		std::cout << YELLOW "CGI request detected" RESET << std::endl;
 		if (_cgiHandler) {  // Ensure handler is set
-			_cgiHandler(*location, requestPath, request, response);
+			_cgiHandler(location, requestPath, request, response);
 		} else {
 			std::cerr << "[ERROR] CGI Handler is not registered!" << std::endl;
-			response.setFile(StatusCode::INTERNAL_SERVER_ERROR_500, _serverConfig.errorPages[500]);
+			response.setFile(StatusCode::INTERNAL_SERVER_ERROR_500, _routeTable->getErrorPage(500));
 		}
 		return;
 	}
 
-	// Find the handler for the requested http method
-	const auto it = _routes.find(request.getMethod());
+	// Check if the method is allowed via the location config, and find its handler
+	const RouteTable::Method method = RouteTable::methodOf(request.getMethod());
 
-	// Check if the method is allowed via the location config
-	const auto it2 = std::find(location->methods.begin(), location->methods.end(), request.getMethod());
-	if (it2 == location->methods.end()) {
-		response.setFile(StatusCode::METHOD_NOT_ALLOWED_405, _serverConfig.errorPages[405]);
+	if (!route->allows(method) || !_handlers[static_cast<std::size_t>(method)]) {
+		response.setFile(StatusCode::METHOD_NOT_ALLOWED_405, _routeTable->getErrorPage(405));
 		return;
 	}
 
 	// Matched a route
-	if (it != _routes.end()) {
-		try {
-			const auto handler = it->second;
-			handler(*location, requestPath, request, response);
-			request.setStatus(Request::Status::COMPLETE);
-		} catch(const std::exception& e) {
-			response.clear();
-			response.setFile(StatusCode::INTERNAL_SERVER_ERROR_500, _serverConfig.errorPages[500]);
-		}
+	try {
+		_handlers[static_cast<std::size_t>(method)](location, requestPath, request, response);
+		request.setStatus(Request::Status::COMPLETE);
+	} catch(const std::exception& e) {
+		response.clear();
+		response.setFile(StatusCode::INTERNAL_SERVER_ERROR_500, _routeTable->getErrorPage(500));
+	}
+}
+
+// Called once the request header is parsed. A plain upload that will end up
+// on disk anyway is received straight into the destination directory, so
+// handlePostRequest only has to link the finished file into place.
+void Router::prepareUpload(Request& request) const {
+	if (
+		request.getMethod() != "POST"
+		|| request.isChunkEncoding()
+		|| request.isMultipart()
+		|| request.getContentLength() <= _routeTable->getClientBodyBufferSize()
+		|| request.getContentLength() >= _routeTable->getClientMaxBodySize()
+		|| !_handlers[static_cast<std::size_t>(RouteTable::Method::POST)]
+	) {
+		return;
+	}
+
+	const std::string& requestPath = normalizeRequestPath(request.getUrl().path);
+
+	if (!utils::isValidPath(requestPath)) {
 		return;
-	} else {
-		response.setFile(StatusCode::METHOD_NOT_ALLOWED_405, _serverConfig.errorPages[405]);
+	}
+
+	const RouteTable::Route* route = _routeTable->match(requestPath);
+
+	if (
+		route == nullptr
+		|| route->redirect != nullptr
+		|| !route->allows(RouteTable::Method::POST)
+		|| isCGI(*route, requestPath)
+	) {
 		return;
 	}
+
+	request.storeBodyIn(utils::computeFilePath(route->location, requestPath).parent_path());
+}
+
+// Lower-cased, with a trailing slash for directory paths but not for files. Written to a buffer that is reused for every request.
+const std::string& Router::normalizeRequestPath(const std::string& path) const {
+	_requestPath.resize(path.size());
+	std::transform(path.begin(), path.end(), _requestPath.begin(), [](unsigned char c) {
+		return std::tolower(c);
+	});
+
+	// What fs::path::has_extension() tells of the last segment
+	const std::string_view name = std::string_view(_requestPath).substr(_requestPath.rfind('/') + 1);
+	const std::size_t dot = name.rfind('.');
+	const bool hasExtension = (dot != std::string_view::npos && dot != 0 && name != "..");
+
+	if (!_requestPath.empty() && _requestPath.back() != '/' && !hasExtension) {
+		_requestPath += '/';
+	}
+
+	return _requestPath;
 }
@@ -0,0 +1,381 @@
+#include <algorithm>
+#include <cerrno>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "CgiWorkerPool.hpp"
+#include "utils/index.hpp"
+
+using std::chrono::steady_clock;
+
+namespace {
+	// Runs the scripts the server sends over stdin, in the protocol of CgiWorkerPool
+	constexpr const char* RUNNER = R"PY(
+import io, os, runpy, signal, struct, sys, traceback
+
+signal.signal(signal.SIGINT, signal.SIG_IGN)
+
+def receive(size):
+	data = bytearray()
+	while len(data) < size:
+		chunk = os.read(0, size - len(data))
+		if not chunk:
+			sys.exit(0)
+		data += chunk
+	return bytes(data)
+
+def send(kind, payload):
+	data = struct.pack('>cI', kind, len(payload)) + payload
+	while data:
+		data = data[os.write(0, data):]
+
+while True:
+	params, body = {}, []
+	while True:
+		kind, size = struct.unpack('>cI', receive(5))
+		payload = receive(size)
+		if kind == b'P':
+			for variable in payload.split(b'\0'):
+				name, _, value = os.fsdecode(variable).partition('=')
+				if name:
+					params[name] = value
+		elif kind == b'I' and payload:
+			body.append(payload)
+		elif kind == b'I':
+			break
+	script = params.get('SCRIPT_FILENAME', '')
+	output = io.BytesIO()
+	stdout = io.TextIOWrapper(output, encoding='utf-8', write_through=True)
+	sys.stdin = io.TextIOWrapper(io.BytesIO(b''.join(body)), encoding='utf-8')
+	sys.stdout = stdout
+	sys.argv = [script]
+	sys.path[0] = os.path.dirname(os.path.abspath(script))
+	os.environ.clear()
+	os.environ.update(params)
+	try:
+		runpy.run_path(script, run_name='__main__')
+	except SystemExit:
+		pass
+	except BaseException:
+		traceback.print_exc()
+	stdout.flush()
+	send(b'O', output.getvalue())
+	send(b'E', b'')
+)PY";
+
+	constexpr std::uint8_t PARAMS_FRAME = 'P';
+	constexpr std::uint8_t STDIN_FRAME = 'I';
+	constexpr std::uint8_t STDOUT_FRAME = 'O';
+	constexpr std::uint8_t END_FRAME = 'E';
+
+	constexpr std::size_t STDIN_CHUNK_SIZE = 32 * 1024;
+	constexpr std::size_t OUTPUT_LOW_WATER = 64 * 1024;	// Less queued than this pulls more of the body
+
+	void appendFrame(std::string& output, std::uint8_t type, const void* data, std::size_t size) {
+		const char header[] = {
+			static_cast<char>(type),
+			static_cast<char>(size >> 24),
+			static_cast<char>(size >> 16),
+			static_cast<char>(size >> 8),
+			static_cast<char>(size)
+		};
+
+		output.append(header, sizeof(header));
+		output.append(static_cast<const char*>(data), size);
+	}
+}
+
+bool CgiWorkerPool::Worker::hasOutput() const {
+	return outputOffset < output.size() || (state == State::BUSY && !isStdinDone);
+}
+
+CgiWorkerPool::CgiWorkerPool(const Location& location)
+	: _min(location.cgiWorkersMin),
+	_max(location.cgiWorkersMax),
+	_maxRequests(location.cgiWorkerRequests),
+	_timeout(location.cgiWorkerTimeout) {}
+
+void CgiWorkerPool::start() {
+	while (_workers.size() < _min && _spawn()) {}
+}
+
+// An idle worker, started when all are busy and the pool has room, null when it has none
+CgiWorkerPool::Worker* CgiWorkerPool::acquire() {
+	auto it = std::ranges::find_if(_workers, [](Worker& worker) {
+		if (worker.state != State::IDLE) {
+			return false;
+		}
+
+		// An idle worker only has something to say when it died
+		struct pollfd pfd { worker.fd, POLLIN, 0 };
+
+		if (::poll(&pfd, 1, 0) != 0) {
+			worker.state = State::FAILED;
+			return false;
+		}
+
+		return true;
+	});
+
+	if (it == _workers.end()) {
+		if (_workers.size() >= _max || !_spawn()) {
+			return nullptr;
+		}
+
+		it = std::prev(_workers.end());
+	}
+
+	it->state = State::BUSY;
+	it->since = steady_clock::now();
+	it->requestCount++;
+	it->headerSize = 0;
+	it->frameRemaining = 0;
+	return &*it;
+}
+
+// Queues the request and writes what the socket takes, the loop polls for POLLOUT while the rest waits
+bool CgiWorkerPool::send(Worker& worker, const http::Request& request, const std::string& scriptPath) {
+	std::string params;
+
+	for (const std::string& variable : request.getCgiEnv()) {
+		params += variable;
+		params += '\0';
+	}
+
+	params += "SCRIPT_FILENAME=" + scriptPath;
+
+	worker.output.clear();
+	worker.outputOffset = 0;
+	worker.body = request.getBody();
+	worker.bodySent = 0;
+	worker.isStdinDone = false;
+	appendFrame(worker.output, PARAMS_FRAME, params.data(), params.size());
+	flush(worker);
+	return worker.state == State::BUSY;
+}
+
+// Writes until the socket is full or the request is out, the body a chunk at a time
+void CgiWorkerPool::flush(Worker& worker) {
+	while (worker.state == State::BUSY) {
+		if (!worker.isStdinDone && worker.output.size() - worker.outputOffset < OUTPUT_LOW_WATER) {
+			const auto body = worker.body.view();
+			const std::size_t size = std::min(STDIN_CHUNK_SIZE, body.size() - worker.bodySent);
+
+			if (size > 0) {
+				appendFrame(worker.output, STDIN_FRAME, body.data() + worker.bodySent, size);
+				worker.bodySent += size;
+			}
+
+			// An empty stdin frame ends the request
+			if (worker.bodySent == body.size()) {
+				appendFrame(worker.output, STDIN_FRAME, nullptr, 0);
+				worker.body.clear();
+				worker.isStdinDone = true;
+			}
+		}
+
+		if (worker.outputOffset == worker.output.size()) {
+			worker.output.clear();
+			worker.outputOffset = 0;
+			return;
+		}
+
+		const ssize_t bytesSent = ::send(
+			worker.fd,
+			worker.output.data() + worker.outputOffset,
+			worker.output.size() - worker.outputOffset,
+			MSG_NOSIGNAL
+		);
+
+		if (bytesSent == -1) {
+			if (errno == EINTR) {
+				continue;
+			}
+
+			if (errno != EAGAIN && errno != EWOULDBLOCK) {
+				fail(worker);
+			}
+
+			return;
+		}
+
+		worker.outputOffset += static_cast<std::size_t>(bytesSent);
+	}
+}
+
+// Appends what the worker wrote to the response, the worker is DONE after the end frame
+void CgiWorkerPool::receive(Worker& worker, short revents, http::Response& response) {
+	if (worker.state != State::BUSY) {
+		return;
+	}
+
+	if (revents & POLLIN) {
+		std::uint8_t buffer[16 * 1024];
+		const ssize_t bytesRead = ::read(worker.fd, buffer, sizeof(buffer));
+
+		if (bytesRead > 0) {
+			_decode(worker, buffer, static_cast<std::size_t>(bytesRead), response);
+			return;
+		}
+
+		if (bytesRead == -1 && errno == EINTR) {
+			return;
+		}
+	}
+
+	if (revents & (POLLIN | POLLHUP | POLLERR)) {
+		fail(worker);
+	}
+}
+
+void CgiWorkerPool::fail(Worker& worker) {
+	worker.state = State::FAILED;
+	worker.since = steady_clock::now();
+}
+
+bool CgiWorkerPool::isTimedOut(const Worker& worker, steady_clock::time_point now) const {
+	return worker.state == State::BUSY && now - worker.since >= _timeout;
+}
+
+// Returns finished workers to the pool, replaces the spent and failed ones and retires idle extras
+void CgiWorkerPool::update() {
+	const auto now = steady_clock::now();
+
+	std::erase_if(_exited, [](pid_t pid) {
+		return ::waitpid(pid, NULL, WNOHANG) != 0;
+	});
+
+	for (auto it = _workers.begin(); it != _workers.end();) {
+		auto next = std::next(it);
+
+		if (it->state == State::DONE && it->requestCount < _maxRequests) {
+			it->state = State::IDLE;
+			it->since = now;
+		} else if (
+			it->state == State::DONE
+			|| it->state == State::FAILED
+			|| (it->state == State::IDLE && _workers.size() > _min && now - it->since >= _timeout)
+		) {
+			_retire(it);
+		}
+
+		it = next;
+	}
+
+	start();
+}
+
+void CgiWorkerPool::shutdown() {
+	while (!_workers.empty()) {
+		_retire(_workers.begin());
+	}
+}
+
+bool CgiWorkerPool::_spawn() {
+	int fds[2];
+
+	if (::socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) == -1) {
+		return false;
+	}
+
+	// Only the server's end, the runner reads and writes its end blocking
+	if (!utils::setNonBlocking(fds[0])) {
+		::close(fds[0]);
+		::close(fds[1]);
+		return false;
+	}
+
+	// Built before fork(), the read-ahead threads may hold the allocator lock
+	std::string interpreter(INTERPRETER);
+	std::string option("-c");
+	std::string runner(RUNNER);
+	char* argv[] = { interpreter.data(), option.data(), runner.data(), NULL };
+	char* envp[] = { NULL };
+
+	const pid_t pid = ::fork();
+
+	if (pid == -1) {
+		::close(fds[0]);
+		::close(fds[1]);
+		return false;
+	}
+
+	if (pid == 0) {
+		// The worker only talks over stdin, an inherited client socket would outlive its connection
+		::dup2(fds[1], STDIN_FILENO);
+		::close_range(STDERR_FILENO + 1, ~0U, 0);
+		::execve(argv[0], argv, envp);
+		::_exit(127);
+	}
+
+	::close(fds[1]);
+
+	Worker& worker = _workers.emplace_back();
+
+	worker.pid = pid;
+	worker.fd = fds[0];
+	worker.since = steady_clock::now();
+	return true;
+}
+
+void CgiWorkerPool::_retire(std::list<Worker>::iterator it) {
+	::kill(it->pid, SIGTERM);
+	::close(it->fd);
+
+	if (::waitpid(it->pid, NULL, WNOHANG) == 0) {
+		_exited.push_back(it->pid);
+	}
+
+	_workers.erase(it);
+}
+
+void CgiWorkerPool::_decode(Worker& worker, const std::uint8_t* data, std::size_t size, http::Response& response) {
+	for (std::size_t offset = 0; offset < size;) {
+		// Nothing follows the end frame
+		if (worker.state != State::BUSY) {
+			fail(worker);
+			return;
+		}
+
+		if (worker.headerSize < worker.header.size()) {
+			const std::size_t count = std::min(worker.header.size() - worker.headerSize, size - offset);
+
+			std::copy_n(data + offset, count, worker.header.data() + worker.headerSize);
+			worker.headerSize += count;
+			offset += count;
+
+			if (worker.headerSize < worker.header.size()) {
+				return;
+			}
+
+			if (worker.header[0] != STDOUT_FRAME && worker.header[0] != END_FRAME) {
+				fail(worker);
+				return;
+			}
+
+			worker.frameRemaining = (std::size_t(worker.header[1]) << 24) | (std::size_t(worker.header[2]) << 16)
+				| (std::size_t(worker.header[3]) << 8) | std::size_t(worker.header[4]);
+		}
+
+		const std::size_t count = std::min(worker.frameRemaining, size - offset);
+
+		if (worker.header[0] == STDOUT_FRAME && count > 0) {
+			response.appendBody(data + offset, count);
+		}
+
+		offset += count;
+		worker.frameRemaining -= count;
+
+		if (worker.frameRemaining == 0) {
+			worker.headerSize = 0;
+
+			if (worker.header[0] == END_FRAME) {
+				worker.state = State::DONE;
+				worker.since = steady_clock::now();
+			}
+		}
+	}
+}
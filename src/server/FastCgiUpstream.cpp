@@ -0,0 +1,536 @@
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <netinet/in.h>
+#include <poll.h>
+#include <string_view>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "FastCgiUpstream.hpp"
+
+namespace {
+	constexpr std::uint8_t VERSION_1 = 1;
+
+	constexpr std::uint8_t BEGIN_REQUEST = 1;
+	constexpr std::uint8_t ABORT_REQUEST = 2;
+	constexpr std::uint8_t END_REQUEST = 3;
+	constexpr std::uint8_t PARAMS = 4;
+	constexpr std::uint8_t STDIN = 5;
+	constexpr std::uint8_t STDOUT = 6;
+	constexpr std::uint8_t STDERR = 7;
+	constexpr std::uint8_t GET_VALUES = 9;
+	constexpr std::uint8_t GET_VALUES_RESULT = 10;
+
+	constexpr std::uint8_t RESPONDER = 1;
+	constexpr std::uint8_t KEEP_CONN = 1;
+	constexpr std::uint8_t REQUEST_COMPLETE = 0;
+
+	constexpr std::size_t HEADER_SIZE = 8;
+	constexpr std::size_t MAX_CONTENT_SIZE = 65535;
+	constexpr std::size_t STDIN_CHUNK_SIZE = 32 * 1024;
+	constexpr std::size_t OUTPUT_LOW_WATER = 64 * 1024;	// Less queued than this pulls more stdin
+
+	void appendRecord(std::string& output, std::uint8_t type, std::uint16_t id, const void* content, std::size_t size) {
+		const char header[HEADER_SIZE] = {
+			static_cast<char>(VERSION_1),
+			static_cast<char>(type),
+			static_cast<char>(id >> 8),
+			static_cast<char>(id),
+			static_cast<char>(size >> 8),
+			static_cast<char>(size),
+			0,
+			0
+		};
+
+		output.append(header, HEADER_SIZE);
+		output.append(static_cast<const char*>(content), size);
+	}
+
+	// Splits `content` into as many records as it needs, params may not fit in one
+	void appendRecords(std::string& output, std::uint8_t type, std::uint16_t id, std::string_view content) {
+		for (std::size_t offset = 0; offset < content.size(); offset += MAX_CONTENT_SIZE) {
+			const std::size_t size = std::min(MAX_CONTENT_SIZE, content.size() - offset);
+
+			appendRecord(output, type, id, content.data() + offset, size);
+		}
+	}
+
+	void appendLength(std::string& output, std::size_t length) {
+		if (length < 128) {
+			output += static_cast<char>(length);
+			return;
+		}
+
+		output += static_cast<char>((length >> 24) | 0x80);
+		output += static_cast<char>(length >> 16);
+		output += static_cast<char>(length >> 8);
+		output += static_cast<char>(length);
+	}
+
+	void appendPair(std::string& output, std::string_view name, std::string_view value) {
+		appendLength(output, name.size());
+		appendLength(output, value.size());
+		output += name;
+		output += value;
+	}
+
+	bool readLength(const std::uint8_t*& data, const std::uint8_t* end, std::size_t& length) {
+		if (data < end && (*data & 0x80) == 0) {
+			length = *data++;
+			return true;
+		}
+
+		if (end - data < 4) {
+			return false;
+		}
+
+		length = (std::size_t(data[0] & 0x7f) << 24) | (std::size_t(data[1]) << 16) | (std::size_t(data[2]) << 8) | data[3];
+		data += 4;
+		return true;
+	}
+}
+
+bool FastCgiUpstream::Connection::hasOutput() const {
+	return isConnecting || outputOffset < output.size();
+}
+
+// `fastcgi_pass` was validated by the parser, "unix:/path" or "ip:port"
+FastCgiUpstream::FastCgiUpstream(const Location& location)
+	: _maxConnections(location.fastCgiConnections),
+	_documentRoot(location.root.string()) {
+	const std::string_view pass = location.fastCgiPass;
+
+	if (pass.starts_with("unix:")) {
+		auto* address = reinterpret_cast<struct sockaddr_un*>(&_address);
+		const std::string_view path = pass.substr(5);
+
+		address->sun_family = AF_UNIX;
+		path.copy(address->sun_path, sizeof(address->sun_path) - 1);
+		_addressLength = sizeof(struct sockaddr_un);
+		return;
+	}
+
+	auto* address = reinterpret_cast<struct sockaddr_in*>(&_address);
+	const std::size_t colon = pass.rfind(':');
+
+	address->sin_family = AF_INET;
+	address->sin_port = htons(static_cast<std::uint16_t>(std::stoi(std::string(pass.substr(colon + 1)))));
+	::inet_pton(AF_INET, std::string(pass.substr(0, colon)).c_str(), &address->sin_addr);
+	_addressLength = sizeof(struct sockaddr_in);
+}
+
+void FastCgiUpstream::submit(const http::Request& request, const std::string& scriptPath, http::Response& response, const std::filesystem::path& errorPage) {
+	Exchange exchange;
+
+	exchange.response = &response;
+	exchange.clientFd = response.getClientSocket();
+	exchange.errorPage = errorPage;
+	exchange.body = request.getBody();
+
+	for (const std::string& variable : request.getCgiEnv()) {
+		const std::size_t equals = variable.find('=');
+
+		appendPair(exchange.params, std::string_view(variable).substr(0, equals), std::string_view(variable).substr(equals + 1));
+	}
+
+	appendPair(exchange.params, "SCRIPT_FILENAME", scriptPath);
+	appendPair(exchange.params, "DOCUMENT_ROOT", _documentRoot);
+	appendPair(exchange.params, "REQUEST_URI", request.getUri());
+
+	_waiting.push_back(std::move(exchange));
+	_dispatchWaiting();
+}
+
+// Handles the events of one of the connections, false when `fd` is none of them
+bool FastCgiUpstream::process(int fd, short revents) {
+	auto it = std::ranges::find(_connections, fd, &Connection::fd);
+
+	if (it == _connections.end()) {
+		return false;
+	}
+
+	Connection& connection = *it;
+
+	if (connection.isClosed) {
+		return true;
+	}
+
+	if (connection.isConnecting && (revents & (POLLOUT | POLLERR | POLLHUP))) {
+		int error = 0;
+		socklen_t length = sizeof(error);
+
+		::getsockopt(connection.fd, SOL_SOCKET, SO_ERROR, &error, &length);
+
+		if (error != 0) {
+			std::cerr << "FastCGI connect: " << std::strerror(error) << std::endl;
+			_close(connection);
+			return true;
+		}
+
+		connection.isConnecting = false;
+	}
+
+	if (revents & POLLOUT) {
+		_flush(connection);
+	}
+
+	if (!connection.isClosed && (revents & (POLLIN | POLLHUP | POLLERR))) {
+		_receive(connection);
+	}
+
+	return true;
+}
+
+// The client went away, its requests are aborted and their output dropped
+void FastCgiUpstream::abandon(int clientFd) {
+	const auto isOfClient = [clientFd](const Exchange& exchange) {
+		return exchange.clientFd == clientFd;
+	};
+
+	std::erase_if(_waiting, isOfClient);
+	std::erase_if(_finished, isOfClient);
+
+	for (auto& connection : _connections) {
+		bool isAborting = false;
+
+		for (auto& [id, exchange] : connection.exchanges) {
+			if (exchange.clientFd != clientFd || exchange.response == nullptr) {
+				continue;
+			}
+
+			// The rest of stdin still goes out, the application may not read the abort before it
+			exchange.response = nullptr;
+			appendRecord(connection.output, ABORT_REQUEST, id, nullptr, 0);
+			isAborting = true;
+		}
+
+		if (isAborting && !connection.isClosed) {
+			_flush(connection);
+		}
+	}
+}
+
+std::vector<FastCgiUpstream::Exchange> FastCgiUpstream::takeFinished() {
+	return std::exchange(_finished, {});
+}
+
+const std::list<FastCgiUpstream::Connection>& FastCgiUpstream::getConnections() const {
+	return _connections;
+}
+
+// Releases the connections that were closed, once the loop stopped polling them
+void FastCgiUpstream::collect() {
+	std::erase_if(_connections, [](const Connection& connection) {
+		if (connection.isClosed) {
+			::close(connection.fd);
+		}
+
+		return connection.isClosed;
+	});
+}
+
+void FastCgiUpstream::shutdown() {
+	for (const auto& connection : _connections) {
+		::close(connection.fd);
+	}
+
+	_connections.clear();
+	_waiting.clear();
+	_finished.clear();
+}
+
+// An idle connection, else the least busy one that multiplexes, else a new one
+FastCgiUpstream::Connection* FastCgiUpstream::_pick() {
+	Connection* leastBusy = nullptr;
+	std::size_t openCount = 0;
+
+	for (auto& connection : _connections) {
+		if (connection.isClosed) {
+			continue;
+		}
+
+		if (connection.exchanges.empty()) {
+			return &connection;
+		}
+
+		if (
+			connection.isMultiplexed
+			&& connection.exchanges.size() < MAX_REQUESTS_PER_CONNECTION
+			&& (leastBusy == nullptr || connection.exchanges.size() < leastBusy->exchanges.size())
+		) {
+			leastBusy = &connection;
+		}
+
+		openCount++;
+	}
+
+	if (leastBusy != nullptr) {
+		return leastBusy;
+	}
+
+	return (openCount < _maxConnections) ? _open() : nullptr;
+}
+
+FastCgiUpstream::Connection* FastCgiUpstream::_open() {
+	const int fd = ::socket(_address.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+
+	if (fd == -1) {
+		return nullptr;
+	}
+
+	const bool isConnecting = (::connect(fd, reinterpret_cast<struct sockaddr*>(&_address), _addressLength) == -1);
+
+	if (isConnecting && errno != EINPROGRESS) {
+		std::cerr << "FastCGI connect: " << std::strerror(errno) << std::endl;
+		::close(fd);
+		return nullptr;
+	}
+
+	Connection& connection = _connections.emplace_back();
+	std::string query;
+
+	connection.fd = fd;
+	connection.isConnecting = isConnecting;
+
+	// An empty value asks the application for its own
+	appendPair(query, "FCGI_MPXS_CONNS", "");
+	appendRecord(connection.output, GET_VALUES, 0, query.data(), query.size());
+	return &connection;
+}
+
+void FastCgiUpstream::_start(Connection& connection, Exchange&& exchange) {
+	do {
+		connection.lastId = (connection.lastId == UINT16_MAX) ? 1 : connection.lastId + 1;
+	} while (connection.exchanges.contains(connection.lastId));
+
+	const std::uint16_t id = connection.lastId;
+	const std::uint8_t body[HEADER_SIZE] = { 0, RESPONDER, KEEP_CONN, 0, 0, 0, 0, 0 };
+
+	appendRecord(connection.output, BEGIN_REQUEST, id, body, sizeof(body));
+	appendRecords(connection.output, PARAMS, id, exchange.params);
+	appendRecord(connection.output, PARAMS, id, nullptr, 0);
+	exchange.params.clear();
+
+	connection.exchanges.emplace(id, std::move(exchange));
+	_flush(connection);
+}
+
+// Starts the waiting requests the connections can take, fails them when no connection can be opened
+void FastCgiUpstream::_dispatchWaiting() {
+	while (!_waiting.empty()) {
+		Connection* connection = _pick();
+
+		if (connection == nullptr) {
+			const bool hasOpenConnection = std::ranges::any_of(_connections, [](const Connection& other) {
+				return !other.isClosed;
+			});
+
+			if (!hasOpenConnection) {
+				while (!_waiting.empty()) {
+					Exchange exchange = std::move(_waiting.front());
+					_waiting.pop_front();
+					_finish(std::move(exchange), false);
+				}
+			}
+
+			return;
+		}
+
+		Exchange exchange = std::move(_waiting.front());
+		_waiting.pop_front();
+		_start(*connection, std::move(exchange));
+	}
+}
+
+// Writes until the socket is full or nothing is left, so the loop only polls for POLLOUT while output waits
+void FastCgiUpstream::_flush(Connection& connection) {
+	if (connection.isConnecting || connection.isClosed) {
+		return;
+	}
+
+	while (true) {
+		_fillStdin(connection);
+
+		if (connection.outputOffset == connection.output.size()) {
+			connection.output.clear();
+			connection.outputOffset = 0;
+			return;
+		}
+
+		const ssize_t bytesSent = ::send(
+			connection.fd,
+			connection.output.data() + connection.outputOffset,
+			connection.output.size() - connection.outputOffset,
+			MSG_NOSIGNAL
+		);
+
+		if (bytesSent == -1) {
+			if (errno == EINTR) {
+				continue;
+			}
+
+			if (errno != EAGAIN && errno != EWOULDBLOCK) {
+				_close(connection);
+			}
+
+			return;
+		}
+
+		connection.outputOffset += static_cast<std::size_t>(bytesSent);
+	}
+}
+
+// Queues one chunk of stdin of every request still sending its body, so they take turns
+void FastCgiUpstream::_fillStdin(Connection& connection) {
+	for (auto& [id, exchange] : connection.exchanges) {
+		if (connection.output.size() - connection.outputOffset >= OUTPUT_LOW_WATER) {
+			return;
+		}
+
+		if (exchange.isStdinDone) {
+			continue;
+		}
+
+		const auto body = exchange.body.view();
+		const std::size_t size = std::min(STDIN_CHUNK_SIZE, body.size() - exchange.bodySent);
+
+		if (size > 0) {
+			appendRecord(connection.output, STDIN, id, body.data() + exchange.bodySent, size);
+			exchange.bodySent += size;
+		}
+
+		if (exchange.bodySent == body.size()) {
+			appendRecord(connection.output, STDIN, id, nullptr, 0);
+			exchange.isStdinDone = true;
+		}
+	}
+}
+
+void FastCgiUpstream::_receive(Connection& connection) {
+	std::uint8_t buffer[16 * 1024];
+
+	while (true) {
+		const ssize_t bytesRead = ::read(connection.fd, buffer, sizeof(buffer));
+
+		if (bytesRead == -1 && errno == EINTR) {
+			continue;
+		}
+
+		if (bytesRead == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+			return;
+		}
+
+		if (bytesRead <= 0) {
+			_close(connection);
+			return;
+		}
+
+		std::vector<std::uint8_t>& input = connection.input;
+		std::size_t offset = 0;
+
+		input.insert(input.end(), buffer, buffer + bytesRead);
+
+		while (input.size() - offset >= HEADER_SIZE) {
+			const std::uint8_t* header = input.data() + offset;
+			const std::size_t contentSize = (std::size_t(header[4]) << 8) | header[5];
+			const std::size_t recordSize = HEADER_SIZE + contentSize + header[6];
+
+			if (input.size() - offset < recordSize) {
+				break;
+			}
+
+			const std::uint16_t id = static_cast<std::uint16_t>((header[2] << 8) | header[3]);
+
+			_handleRecord(connection, header[1], id, header + HEADER_SIZE, contentSize);
+			offset += recordSize;
+
+			if (connection.isClosed) {
+				return;
+			}
+		}
+
+		input.erase(input.begin(), input.begin() + offset);
+	}
+}
+
+void FastCgiUpstream::_handleRecord(Connection& connection, std::uint8_t type, std::uint16_t id, const std::uint8_t* content, std::size_t size) {
+	if (id == 0) {
+		if (type != GET_VALUES_RESULT) {
+			return;
+		}
+
+		for (const std::uint8_t* data = content; data < content + size;) {
+			std::size_t nameLength = 0;
+			std::size_t valueLength = 0;
+
+			if (
+				!readLength(data, content + size, nameLength)
+				|| !readLength(data, content + size, valueLength)
+				|| std::size_t(content + size - data) < nameLength + valueLength
+			) {
+				break;
+			}
+
+			const std::string_view name(reinterpret_cast<const char*>(data), nameLength);
+			const std::string_view value(reinterpret_cast<const char*>(data) + nameLength, valueLength);
+
+			if (name == "FCGI_MPXS_CONNS") {
+				connection.isMultiplexed = (value == "1");
+			}
+
+			data += nameLength + valueLength;
+		}
+
+		_dispatchWaiting();
+		return;
+	}
+
+	// Records of an aborted request may still arrive
+	auto it = connection.exchanges.find(id);
+
+	if (it == connection.exchanges.end()) {
+		return;
+	}
+
+	Exchange& exchange = it->second;
+
+	if (type == STDOUT && exchange.response != nullptr && size > 0) {
+		exchange.response->appendBody(content, size);
+	} else if (type == STDERR) {
+		std::cerr << "FastCGI: " << std::string_view(reinterpret_cast<const char*>(content), size) << std::flush;
+	} else if (type == END_REQUEST) {
+		const bool isOk = (size >= 5 && content[4] == REQUEST_COMPLETE);
+		Exchange ended = std::move(exchange);
+
+		connection.exchanges.erase(it);
+		_finish(std::move(ended), isOk);
+		_dispatchWaiting();
+	}
+}
+
+// Fails the requests of a connection that hung up, the waiting ones may still get a new connection
+void FastCgiUpstream::_close(Connection& connection) {
+	connection.isClosed = true;
+	connection.output.clear();
+	connection.outputOffset = 0;
+	connection.input.clear();
+
+	for (auto& [_, exchange] : connection.exchanges) {
+		_finish(std::move(exchange), false);
+	}
+
+	connection.exchanges.clear();
+	_dispatchWaiting();
+}
+
+void FastCgiUpstream::_finish(Exchange&& exchange, bool isOk) {
+	if (exchange.response == nullptr) {
+		return;
+	}
+
+	exchange.isOk = isOk;
+	_finished.push_back(std::move(exchange));
+}
@@ -3,28 +3,43 @@
 #include <netinet/in.h>
 #include <sys/wait.h>
 #include <unistd.h>
+#include <system_error>
 
 #include "Server.hpp"
 #include "utils/index.hpp"
 #include "SignalHandle.hpp"
 
-Server::Server(const ServerConfig& serverConfig) : _serverConfig(serverConfig) , _router(serverConfig) {
-	_serverFds.reserve(serverConfig.ports.size());
-
-	for (const int port : serverConfig.ports) {
-		int serverFd = utils::createPassiveSocket(serverConfig.host.data(), port, 128, true);
-		std::cout << "listening on " << serverConfig.host << ":" << port << std::endl;
-		_serverFds.emplace(serverFd);
+// Listens on one address for every server block that has it, the first of them is the default
+Server::Server(const std::string& host, int port, const std::vector<std::reference_wrapper<const ServerConfig>>& serverConfigs)
+	: _serverConfig(serverConfigs.front()) {
+	for (const ServerConfig& serverConfig : serverConfigs) {
+		_virtualHosts.add(serverConfig);
 	}
+
+	int serverFd = utils::createPassiveSocket(host.data(), port, 128, true, _serverConfig.isReusePort);
+	std::cout << "listening on " << host << ":" << port << std::endl;
+	_serverFds.emplace(serverFd);
 }
 
 void Server::addRouterHandlers() {
-	_router.get(handleGetRequest);
-	_router.post(handlePostRequest);
-	_router.del(handleDeleteRequest);
-	_router.setCgiHandler([this](const Location& loc, const std::string& requestPath, http::Request& req, http::Response& res) {
-		this->_handleCGI(loc, requestPath, req, res);
-	});
+	for (Router& router : _virtualHosts.getRouters()) {
+		router.get(handleGetRequest);
+		router.post(handlePostRequest);
+		router.del(handleDeleteRequest);
+		router.setCgiHandler([this](const Location& loc, const std::string& requestPath, http::Request& req, http::Response& res) {
+			this->_handleCGI(loc, requestPath, req, res);
+		});
+
+		for (const auto& route : router.getRouteTable().getRoutes()) {
+			if (route.location.cgiWorkersMax > 0) {
+				_cgiWorkerPools.try_emplace(&route.location, route.location).first->second.start();
+			}
+
+			if (!route.location.fastCgiPass.empty()) {
+				fastCgiUpstreams.try_emplace(&route.location, route.location);
+			}
+		}
+	}
 }
 
 void Server::onShutdown(std::function<void()> shutdownHandler) {
@@ -32,27 +47,43 @@ void Server::onShutdown(std::function<void()> shutdownHandler) {
 }
 
 void Server::closeConnection(http::Connection& con) {
-	int clientFd = con.getClientFd();
 	con.close();
+	releaseConnection(con.getClientFd());
+}
 
+// Stops the CGI work writing into the responses of a closed connection, before the loop frees them.
+// A connection can also close itself, after a `Connection: close` response, so the loop calls this too.
+void Server::releaseConnection(int clientFd) {
 	for (auto& [_, process] : workerProcesses) {
-		if (process.clientFd == clientFd) {
-			if (::kill(process.pid, 0) == 0) {
-				::kill(process.pid, SIGTERM);
-			}
+		if (process.clientFd != clientFd || process.pipeFds[0] == -1) {
+			continue;
+		}
 
-			if (process.pipeFds[0] != -1) {
-				::close(process.pipeFds[0]);
-				process.pipeFds[0] = -1;
-			}
+		// A worker abandoned mid-request would answer the next one with this output, so it is replaced
+		if (process.worker != nullptr) {
+			process.pool->fail(*process.worker);
+			process.pipeFds[0] = -1;
+			continue;
+		}
 
-			pid_t pid = ::waitpid(process.pid, NULL, WNOHANG);
+		if (::kill(process.pid, 0) == 0) {
+			::kill(process.pid, SIGTERM);
+		}
 
-			if (pid == 0) {
-				unreapedProcesses.push_back(pid);
-			}
+		::close(process.pipeFds[0]);
+		process.pipeFds[0] = -1;
+
+		pid_t pid = ::waitpid(process.pid, NULL, WNOHANG);
+
+		if (pid == 0) {
+			unreapedProcesses.push_back(process.pid);
 		}
 	}
+
+	for (auto& [_, upstream] : fastCgiUpstreams) {
+		upstream.abandon(clientFd);
+		_finishFastCgiExchanges(upstream);
+	}
 }
 
 void Server::process(const int fd, short& events, const short revents) {
@@ -63,7 +94,12 @@ void Server::process(const int fd, short& events, const short revents) {
 
 		if (clientFd >= 0) {
 			std::cout << "clientFd " << fd << " has connected" << std::endl;
-			connections.emplace(clientFd, http::Connection(clientFd, _serverConfig));
+			auto [it, _] = connections.emplace(clientFd, http::Connection(clientFd, _serverConfig));
+
+			it->second.onHeaderComplete([this](http::Request& req) -> const ServerConfig& {
+				_routerFor(req).prepareUpload(req);
+				return _virtualHosts.findServerConfig(req.getHeader(http::Header::HOST).value_or(""));
+			});
 		}
 
 		return;
@@ -76,12 +112,42 @@ void Server::process(const int fd, short& events, const short revents) {
 	if (auto it = workerProcesses.find(fd); it != workerProcesses.end()) {
 		return _processWorkerProcess(it->second, revents);
 	}
+
+	for (auto& [_, upstream] : fastCgiUpstreams) {
+		if (upstream.process(fd, revents)) {
+			return _finishFastCgiExchanges(upstream);
+		}
+	}
+}
+
+// Lets the pools take back finished workers and replace failed ones, then fails the requests that
+// ran too long. The loop calls this after dropping finished WorkerProcess entries, see CgiWorkerPool
+void Server::updateCgiWorkerPools() {
+	for (auto& [_, pool] : _cgiWorkerPools) {
+		pool.update();
+	}
+
+	const auto now = std::chrono::steady_clock::now();
+
+	for (auto& [_, process] : workerProcesses) {
+		if (process.worker != nullptr && process.pipeFds[0] != -1 && process.pool->isTimedOut(*process.worker, now)) {
+			std::cerr << "CGI worker timed out" << std::endl;
+			process.pool->fail(*process.worker);
+			process.response->reset().setFile(http::StatusCode::INTERNAL_SERVER_ERROR_500, process.errorPage);
+			process.pipeFds[0] = -1;
+		}
+	}
 }
 
 const std::unordered_set<int>& Server::getServerFds() const {
 	return _serverFds;
 }
 
+// The router of the server block named by the Host header
+Router& Server::_routerFor(const http::Request& request) {
+	return _virtualHosts.find(request.getHeader(http::Header::HOST).value_or(""));
+}
+
 void Server::_processConnection(http::Connection& con, short& events, const short revents) {
 	if (con.isClosed()) {
 		return;
@@ -94,24 +160,49 @@ void Server::_processConnection(http::Connection& con, short& events, const shor
 		return;
 	}
 
-	if (revents & POLLIN) {
-		con.read();
-		auto* req = con.getRequest();
-		auto* res = con.getResponse();
+	if ((revents & POLLERR) && !con.readErrorQueue()) {
+		closeConnection(con);
+		return;
+	}
 
-		if (req != nullptr && res != nullptr && res->getStatus() == PENDING) {
-			res->setStatus(IN_PROGRESS);
-			_router.handle(*req, *res);
+	if (con.isClosed()) {
+		return;
+	}
 
-			if (res->getStatus() == READY) {
-				events |= POLLOUT;
-			}
-		}
+	if (revents & POLLIN) {
+		con.read();
 	}
 
 	if ((revents & POLLOUT) && con.sendResponse()) {
 		events &= ~POLLOUT;
 	}
+
+	if (con.isClosed()) {
+		return;
+	}
+
+	// Routes what read() parsed, and pipelined requests released once earlier responses went out
+	con.handleRequests([this](http::Request& req, http::Response& res) {
+		res.setStatus(IN_PROGRESS);
+		_routerFor(req).handle(req, res);
+	});
+
+	if (con.hasReadyResponse()) {
+		events |= POLLOUT;
+	}
+}
+
+// Builds the response from the CGI output, once all of it arrived
+static void completeCgiResponse(http::Response& res) {
+	auto* cgiPayload = dynamic_cast<utils::CgiPayload*>(res.getBody().get());
+
+	for (auto& [name, value] : cgiPayload->headerFields()) {
+		res.setHeader(name, value);
+	}
+
+	res.setStatusCode(http::StatusCode::OK_200)
+		.setHeader(http::Header::CONTENT_LENGTH, std::to_string(cgiPayload->size()))
+		.build();
 }
 
 void Server::_processWorkerProcess(WorkerProcess& process, const short revents) {
@@ -119,9 +210,13 @@ void Server::_processWorkerProcess(WorkerProcess& process, const short revents)
 		return;
 	}
 
-	http::Response* res = connections.at(process.clientFd).getResponse();
+	if (process.worker != nullptr) {
+		return _processPooledWorker(process, revents);
+	}
+
+	http::Response* res = process.response;
 
-	if (res == nullptr || res->getStatus() == http::Response::Status::READY) {
+	if (res->getStatus() == http::Response::Status::READY) {
 		return;
 	}
 
@@ -148,15 +243,7 @@ void Server::_processWorkerProcess(WorkerProcess& process, const short revents)
 		if (hasError) {
 			res->clear().setFile(http::StatusCode::INTERNAL_SERVER_ERROR_500, process.rootPath / "500.html");
 		} else {
-			auto* cgiPayload = dynamic_cast<utils::CgiPayload*>(res->getBody().get());
-
-			for (auto& [name, value] : cgiPayload->headerFields()) {
-				res->setHeader(name, value);
-			}
-
-			res->setStatusCode(http::StatusCode::OK_200)
-				.setHeader(http::Header::CONTENT_LENGTH, std::to_string(cgiPayload->size()))
-				.build();
+			completeCgiResponse(*res);
 		}
 
 		::close(process.pipeFds[0]);
@@ -169,24 +256,93 @@ void Server::_processWorkerProcess(WorkerProcess& process, const short revents)
 		pid_t pid = ::waitpid(process.pid, NULL, WNOHANG);
 
 		if (pid == 0) {
-			unreapedProcesses.push_back(pid);
+			unreapedProcesses.push_back(process.pid);
 		}
 	}
 }
 
+// The worker stays open for the next request, so the response ends with its end frame rather than a hangup
+void Server::_processPooledWorker(WorkerProcess& process, const short revents) {
+	using enum CgiWorkerPool::State;
+
+	http::Response& res = *process.response;
+
+	if (revents & POLLOUT) {
+		process.pool->flush(*process.worker);
+	}
+
+	process.pool->receive(*process.worker, revents, res);
+
+	if (process.worker->state == BUSY) {
+		return;
+	}
+
+	if (process.worker->state == DONE) {
+		completeCgiResponse(res);
+	} else {
+		std::cerr << "CGI worker failed" << std::endl;
+		res.reset().setFile(http::StatusCode::INTERNAL_SERVER_ERROR_500, process.errorPage);
+	}
+
+	process.pipeFds[0] = -1;
+}
+
+// Builds the responses of the requests the application ended, or a 502 for those it failed or dropped
+void Server::_finishFastCgiExchanges(FastCgiUpstream& upstream) {
+	for (auto& exchange : upstream.takeFinished()) {
+		if (exchange.isOk) {
+			completeCgiResponse(*exchange.response);
+		} else {
+			std::cerr << "FastCGI request failed" << std::endl;
+			exchange.response->reset().setFile(http::StatusCode::BAD_GATEWAY_502, exchange.errorPage);
+		}
+
+		readyClientFds.push_back(exchange.clientFd);
+	}
+}
+
 void Server::_handleCGI(
 	const Location& loc,
 	const std::string& requestPath,
 	const http::Request& request,
 	http::Response& response
 ) {
-	(void)request;
-	std::string scriptPath = loc.root / requestPath.substr(loc.path.size());
+	std::string scriptPath = utils::computeFilePath(loc, requestPath);
+
+	if (auto it = fastCgiUpstreams.find(&loc); it != fastCgiUpstreams.end()) {
+		const RouteTable& routes = _routerFor(request).getRouteTable();
+		const std::string& errorPage = routes.getErrorPage(502).empty() ? routes.getErrorPage(500) : routes.getErrorPage(502);
+
+		response.setBody(std::make_unique<utils::CgiPayload>());
+		it->second.submit(request, scriptPath, response, errorPage);
+		return _finishFastCgiExchanges(it->second);
+	}
 
 	WorkerProcess process;
 
 	process.clientFd = response.getClientSocket();
 	process.rootPath = loc.root;
+	process.response = &response;
+
+	if (auto it = _cgiWorkerPools.find(&loc); it != _cgiWorkerPools.end()) {
+		CgiWorkerPool& pool = it->second;
+
+		if (CgiWorkerPool::Worker* worker = pool.acquire()) {
+			if (pool.send(*worker, request, scriptPath)) {
+				process.pipeFds[0] = worker->fd;
+				process.pipeFds[1] = -1;
+				process.pid = worker->pid;
+				process.pool = &pool;
+				process.worker = worker;
+				process.errorPage = _routerFor(request).getRouteTable().getErrorPage(500);
+				response.setBody(std::make_unique<utils::CgiPayload>());
+				workerProcesses.emplace(worker->fd, process);
+				return;
+			}
+
+			pool.fail(*worker);
+		}
+	}
 
 	if (::pipe(process.pipeFds) == -1 || !utils::setNonBlocking(process.pipeFds[0])) {
 		response.setFile(http::StatusCode::INTERNAL_SERVER_ERROR_500, loc.root / "500.html");
@@ -207,7 +363,19 @@ void Server::_handleCGI(
 		::dup2(process.pipeFds[1], STDOUT_FILENO);
 		::close(process.pipeFds[1]);
 
-		std::string interpreter("/usr/bin/python1");
+		if (!request.getBody().empty()) {
+			// The script reads the body from stdin until EOF, a file-backed body is passed as is
+			try {
+				http::RequestBody body = request.getBody();
+				body.spill();
+				::lseek(body.getFd(), 0, SEEK_SET);
+				::dup2(body.getFd(), STDIN_FILENO);
+			} catch (const std::system_error& e) {
+				std::cerr << "CGI stdin: " << e.what() << std::endl;
+			}
+		}
+
+		std::string interpreter(CgiWorkerPool::INTERPRETER);
 		char* argv[] = { interpreter.data(), scriptPath.data(), NULL };
 		char** envp = request.getCgiEnvp();
 		::execve(argv[0], argv, envp);
@@ -244,6 +412,14 @@ void Server::shutdown() {
 		::kill(process.pid, SIGTERM);
 	}
 
+	for (auto& [_, pool] : _cgiWorkerPools) {
+		pool.shutdown();
+	}
+
+	for (auto& [_, upstream] : fastCgiUpstreams) {
+		upstream.shutdown();
+	}
+
 	for (const int fd : _serverFds) {
 		::close(fd);
 	}
@@ -1,39 +1,86 @@
+#include <algorithm>
+#include <ctime>
+#include <map>
 #include <sys/socket.h>
 #include <sys/wait.h>
 #include "ServerManager.hpp"
 #include "utils/index.hpp"
+#include "utils/OpenFileCache.hpp"
+#include "utils/ReadAhead.hpp"
+#include "http/Bundle.hpp"
+#include "CgiScriptCache.hpp"
+#include "MissingPaths.hpp"
+#include "http/CannedResponses.hpp"
+#include "http/ZeroCopyReaper.hpp"
 #include "SignalHandle.hpp"
 
+// One Server per listening address, holding every server block that listens there
 ServerManager::ServerManager(const Config& config) : _config(config) {
-	_servers.reserve(_config.servers.size());
+	using ServerConfigs = std::vector<std::reference_wrapper<const ServerConfig>>;
+	std::vector<std::pair<std::string, int>> addresses;
+	std::map<std::pair<std::string, int>, ServerConfigs> serverConfigsOf;
 
-	for (std::size_t i = 0; i < _config.servers.size(); i++) {
-		const ServerConfig& serverConfig = _config.servers[i];
-		_servers.push_back(Server(serverConfig));
+	for (const auto& serverConfig : _config.servers) {
+		for (const int port : serverConfig.ports) {
+			auto [it, isNew] = serverConfigsOf.try_emplace({ serverConfig.host, port });
+
+			if (isNew) {
+				addresses.push_back(it->first);
+			}
+
+			if (std::ranges::none_of(it->second, [&serverConfig](const ServerConfig& other) { return &other == &serverConfig; })) {
+				it->second.push_back(serverConfig);
+			}
+		}
+	}
+
+	// Routers capture their Server, so the vector must never reallocate
+	_servers.reserve(addresses.size());
+
+	for (const auto& address : addresses) {
+		_servers.push_back(Server(address.first, address.second, serverConfigsOf[address]));
 		Server& server = _servers.back();
 		server.addRouterHandlers();
 		server.onShutdown([this]() {
 			this->shutdown();
 		});
-    }
+	}
 
 	for (auto& server : _servers) {
 		for (const int serverFd : server.getServerFds()) {
 			_track(serverFd, server);
 		}
 	}
+
+	_setupCannedResponses();
+	_setupBundles();
+	_setupFileCache();
+	_setupReadAhead();
 }
 
 void ServerManager::listen() {
 	while (_pollFds.size() > 0 && !isInterrupted) {
         int ret = ::poll(_pollFds.data(), _pollFds.size(), 100);
 
+		http::updateDateField(std::time(nullptr));
+
 		if (ret == -1 && errno == EINTR) {
 			break;
 		}
 
 		if (ret > 0) {
 			for (auto& [fd, events, revents] : _pollFds) {
+				if (fd == _fileWatcher.getFd()) {
+					_fileWatcher.process();
+					continue;
+				}
+
+				if (fd == utils::ReadAhead::instance().getFd()) {
+					utils::ReadAhead::instance().process();
+					_resumePendingConnections();
+					continue;
+				}
+
 				auto& server = _serverMap.at(fd).get();
 				server.process(fd, events, revents);
 			}
@@ -44,9 +91,13 @@ void ServerManager::listen() {
 }
 
 void ServerManager::_updatePollFds() {
+	http::ZeroCopyReaper::instance().collect();
+
 	for (auto& server: _servers) {
 		_updateClientConnections(server);
 		_updatePipeConnections(server);
+		server.updateCgiWorkerPools();
+		_updateFastCgiConnections(server);
 
 		for (auto it = server.unreapedProcesses.begin(); it != server.unreapedProcesses.end();) {
 			pid_t pid = ::waitpid(*it, NULL, WNOHANG);
@@ -80,6 +131,7 @@ void ServerManager::_updateClientConnections(Server& server) {
 
 		if (connection.isClosed()) {
 			std::cout << "clientFd " << fd << " has closed" << std::endl;
+			server.releaseConnection(fd);
 			_untrack(fd);
 			it = server.connections.erase(it);
 			continue;
@@ -96,6 +148,13 @@ void ServerManager::_updatePipeConnections(Server& server) {
 
 		if (process.pipeFds[0] != -1 && !isBeingTracked) {
 			_track(fd, server);
+		}
+
+		// A pooled worker is written to as well, while its request is not out yet
+		if (process.pipeFds[0] != -1) {
+			const bool hasOutput = process.worker != nullptr && process.worker->hasOutput();
+
+			_pollFds[_pollfdIndexMap[fd]].events = hasOutput ? (POLLIN | POLLOUT) : POLLIN;
 			it++;
 			continue;
 		}
@@ -105,8 +164,7 @@ void ServerManager::_updatePipeConnections(Server& server) {
 
 			if (
 				conIt != server.connections.end()
-				&& (conIt->second.getResponse() != nullptr)
-				&& conIt->second.getResponse()->getStatus() == http::Response::Status::READY
+				&& conIt->second.hasReadyResponse()
 			) {
 				const std::size_t index = _pollfdIndexMap[process.clientFd];
 				_pollFds[index].events |= POLLOUT;
@@ -124,11 +182,38 @@ void ServerManager::_updatePipeConnections(Server& server) {
 	}
 }
 
+// Polls the FastCGI connections for POLLOUT while they have records to write, and the clients whose response ended
+void ServerManager::_updateFastCgiConnections(Server& server) {
+	for (auto& [_, upstream] : server.fastCgiUpstreams) {
+		for (const auto& connection : upstream.getConnections()) {
+			if (connection.isClosed) {
+				_untrack(connection.fd);
+				continue;
+			}
+
+			_track(connection.fd, server);
+			_pollFds[_pollfdIndexMap[connection.fd]].events = connection.hasOutput() ? (POLLIN | POLLOUT) : POLLIN;
+		}
+
+		upstream.collect();
+	}
+
+	for (const int clientFd : server.readyClientFds) {
+		if (auto it = _pollfdIndexMap.find(clientFd); it != _pollfdIndexMap.end()) {
+			_pollFds[it->second].events |= POLLOUT;
+		}
+	}
+
+	server.readyClientFds.clear();
+}
+
 void ServerManager::shutdown() {
 	for (auto& server : _servers) {
 		server.shutdown();
 	}
 
+	http::ZeroCopyReaper::instance().shutdown();
+
 	while (1) {
 		if (::wait(NULL) == -1 && errno == ECHILD) {
 			break;
@@ -136,6 +221,131 @@ void ServerManager::shutdown() {
 	}
 }
 
+// The file cache is only enabled when inotify can tell it about changes below the location roots.
+// The open file cache also expires its entries on its own, so it works without inotify.
+void ServerManager::_setupFileCache() {
+	http::FileCache& cache = http::FileCache::instance();
+	utils::OpenFileCache& openFileCache = utils::OpenFileCache::instance();
+
+	openFileCache.configure(_config.openFileCacheSize, _config.openFileCacheValid);
+	CgiScriptCache::instance().configure(_config.openFileCacheSize, _config.openFileCacheValid, _fileWatcher.isActive());
+	MissingPaths::instance().configure(_config.missingPathCacheSize, _config.openFileCacheValid, _fileWatcher.isActive());
+
+	if (!_fileWatcher.isActive()) {
+		return;
+	}
+
+	if (_config.fileCacheSize > 0) {
+		cache.configure(_config.fileCacheSize, _config.fileCacheMaxFileSize);
+	}
+
+	const bool hasBundles = std::ranges::any_of(_config.servers, [](const ServerConfig& serverConfig) {
+		return std::ranges::any_of(serverConfig.locations, [](const Location& location) {
+			return !location.bundle.empty();
+		});
+	});
+
+	if (!cache.isEnabled() && !openFileCache.isEnabled() && !MissingPaths::instance().isEnabled() && !hasBundles) {
+		return;
+	}
+
+	_fileWatcher.onChange([&cache, &openFileCache](const std::filesystem::path& path) {
+		cache.invalidate(path);
+		openFileCache.invalidate(path);
+		CgiScriptCache::instance().invalidate(path);
+		MissingPaths::instance().invalidate(path);
+		http::CannedResponses::instance().refresh(path);
+		http::Bundles::instance().refresh(path);
+	});
+
+	for (const auto& serverConfig : _config.servers) {
+		for (const auto& [_, errorPage] : serverConfig.errorPages) {
+			_fileWatcher.watch(std::filesystem::path(errorPage).parent_path());
+		}
+
+		for (const auto& location : serverConfig.locations) {
+			// The bundle tool renames the new archive into place
+			if (!location.bundle.empty()) {
+				_fileWatcher.watch(location.bundle.parent_path());
+			}
+
+			if (location.root.empty()) {
+				continue;
+			}
+
+			_fileWatcher.watch(location.root);
+
+			if (cache.isEnabled() && _config.fileCachePrewarm) {
+				cache.prewarm(location.root);
+			}
+		}
+	}
+
+	_pollFds.push_back({ _fileWatcher.getFd(), POLLIN, 0 });
+	_pollfdIndexMap[_fileWatcher.getFd()] = _pollFds.size() - 1;
+}
+
+// Serializes the error pages of the config, and the ones the handlers look up in the location roots
+void ServerManager::_setupCannedResponses() {
+	using enum http::StatusCode;
+
+	http::CannedResponses& canned = http::CannedResponses::instance();
+
+	for (const auto& serverConfig : _config.servers) {
+		for (const auto& [code, errorPage] : serverConfig.errorPages) {
+			canned.add(static_cast<http::StatusCode>(code), errorPage);
+		}
+
+		for (const auto& location : serverConfig.locations) {
+			if (location.root.empty()) {
+				continue;
+			}
+
+			canned.add(FORBIDDEN_403, location.root / "403.html");
+			canned.add(NOT_FOUND_404, location.root / "404.html");
+			canned.add(INTERNAL_SERVER_ERROR_500, location.root / "500.html");
+		}
+	}
+}
+
+// Maps the bundles of the config once, requests look files up in the mapping
+void ServerManager::_setupBundles() {
+	http::Bundles& bundles = http::Bundles::instance();
+
+	for (const auto& serverConfig : _config.servers) {
+		for (const auto& location : serverConfig.locations) {
+			if (!location.bundle.empty()) {
+				bundles.add(location.bundle);
+			}
+		}
+	}
+}
+
+// Cold files are read on the ReadAhead threads, their eventfd tells the loop when to resume sending
+void ServerManager::_setupReadAhead() {
+	utils::ReadAhead& readAhead = utils::ReadAhead::instance();
+
+	if (!readAhead.isActive()) {
+		return;
+	}
+
+	_pollFds.push_back({ readAhead.getFd(), POLLIN, 0 });
+	_pollfdIndexMap[readAhead.getFd()] = _pollFds.size() - 1;
+}
+
+// Polls every connection with a ready response for POLLOUT again, the ones still waiting drop it on the next send
+void ServerManager::_resumePendingConnections() {
+	for (auto& server : _servers) {
+		for (auto& [fd, connection] : server.connections) {
+			auto it = _pollfdIndexMap.find(fd);
+
+			if (it != _pollfdIndexMap.end() && connection.hasReadyResponse()) {
+				_pollFds[it->second].events |= POLLOUT;
+			}
+		}
+	}
+}
+
 void ServerManager::_track(int fd, Server& server) {
 	auto it = _pollfdIndexMap.find(fd);
 
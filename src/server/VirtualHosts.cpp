@@ -0,0 +1,82 @@
+#include <algorithm>
+
+#include "VirtualHosts.hpp"
+
+// The first server added for an address is its default
+void VirtualHosts::add(const ServerConfig& serverConfig) {
+	const std::size_t index = _routers.size();
+
+	_routers.emplace_back(serverConfig);
+	_serverConfigs.push_back(&serverConfig);
+
+	for (const auto& name : serverConfig.serverNames) {
+		if (name.starts_with("*.")) {
+			_insert(_leadingWildcards, name.substr(1), index);
+		} else if (name.starts_with(".")) {
+			_insert(_exactNames, name.substr(1), index);
+			_insert(_leadingWildcards, name, index);
+		} else if (name.ends_with(".*")) {
+			_insert(_trailingWildcards, name.substr(0, name.size() - 1), index);
+		} else {
+			_insert(_exactNames, name, index);
+		}
+	}
+}
+
+// The router for `host`, a Host header value which may carry a port
+Router& VirtualHosts::find(std::string_view host) {
+	return _routers[_indexOf(host)];
+}
+
+// The config of the server block for `host`, looked up like find()
+const ServerConfig& VirtualHosts::findServerConfig(std::string_view host) {
+	return *_serverConfigs[_indexOf(host)];
+}
+
+std::vector<Router>& VirtualHosts::getRouters() {
+	return _routers;
+}
+
+// The first server when no name matches
+std::size_t VirtualHosts::_indexOf(std::string_view host) {
+	host = host.substr(0, host.find(':'));
+
+	if (host.ends_with('.')) {
+		host.remove_suffix(1);
+	}
+
+	_host.resize(host.size());
+	std::transform(host.begin(), host.end(), _host.begin(), [](unsigned char c) {
+		return std::tolower(c);
+	});
+
+	const std::string_view name(_host);
+
+	if (auto it = _exactNames.find(name); it != _exactNames.end()) {
+		return it->second;
+	}
+
+	// Suffixes from the longest: ".b.example.com", ".example.com", ".com"
+	for (std::size_t dot = name.find('.'); dot != std::string_view::npos; dot = name.find('.', dot + 1)) {
+		if (auto it = _leadingWildcards.find(name.substr(dot)); it != _leadingWildcards.end()) {
+			return it->second;
+		}
+	}
+
+	// Prefixes from the longest: "www.example.", "www."
+	for (std::size_t dot = name.rfind('.'); dot != std::string_view::npos && dot > 0; dot = name.rfind('.', dot - 1)) {
+		if (auto it = _trailingWildcards.find(name.substr(0, dot + 1)); it != _trailingWildcards.end()) {
+			return it->second;
+		}
+	}
+
+	return 0;
+}
+
+// A name claimed by an earlier server stays with it, like nginx does
+void VirtualHosts::_insert(NameMap& names, std::string name, std::size_t index) {
+	std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) {
+		return std::tolower(c);
+	});
+	names.emplace(std::move(name), index);
+}
@@ -0,0 +1,108 @@
+#include <cstdlib>
+#include <iostream>
+#include <csignal>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "WorkerPool.hpp"
+#include "ServerManager.hpp"
+#include "SignalHandle.hpp"
+#include "http/SharedFileCache.hpp"
+
+WorkerPool::WorkerPool(const Config& config) : _config(config) {
+	for (auto& server : _config.servers) {
+		server.isReusePort = true;
+	}
+}
+
+int WorkerPool::run() {
+	if (
+		_config.fileCacheSize > 0
+		&& !http::SharedFileCache::instance().create(_config.fileCacheSize, _config.fileCacheMaxFileSize, _config.workerProcesses)
+	) {
+		std::cerr << "Failed to map the shared file cache, every worker caches on its own" << std::endl;
+	}
+
+	for (std::size_t i = 0; i < _config.workerProcesses; i++) {
+		_spawn(i);
+	}
+
+	bool isForwarded = false;
+
+	while (!_workers.empty()) {
+		if (isInterrupted && !isForwarded) {
+			_interrupt();
+			isForwarded = true;
+		}
+
+		int status = 0;
+		const pid_t pid = ::waitpid(-1, &status, WNOHANG);
+
+		if (pid == -1 && errno == ECHILD) {
+			break;
+		}
+
+		if (pid <= 0) {
+			::usleep(100000);
+			continue;
+		}
+
+		auto it = _workers.find(pid);
+
+		if (it == _workers.end()) {
+			continue;
+		}
+
+		const std::size_t index = it->second;
+
+		_workers.erase(it);
+
+		// Responses of a crashed worker never dropped the blocks they were sending
+		http::SharedFileCache::instance().releasePins(index);
+
+		if (WIFSIGNALED(status) && WTERMSIG(status) != SIGINT && !isInterrupted) {
+			std::cerr << "worker " << pid << " was killed by signal " << WTERMSIG(status) << ", restarting it" << std::endl;
+			_spawn(index);
+		}
+	}
+
+	http::SharedFileCache::instance().destroy();
+	return 0;
+}
+
+void WorkerPool::_spawn(std::size_t index) {
+	const pid_t pid = ::fork();
+
+	if (pid == -1) {
+		std::cerr << "Failed to fork a worker process" << std::endl;
+		return;
+	}
+
+	if (pid == 0) {
+		_work(index);
+	}
+
+	_workers[pid] = index;
+}
+
+// The event loop of one worker, never returns
+void WorkerPool::_work(std::size_t index) {
+	http::SharedFileCache::instance().attach(index);
+
+	try {
+		ServerManager serverManager(_config);
+		serverManager.listen();
+		serverManager.shutdown();
+	} catch (const std::exception& e) {
+		std::cerr << e.what() << std::endl;
+		std::exit(1);
+	}
+
+	std::exit(0);
+}
+
+void WorkerPool::_interrupt() {
+	for (const auto& [pid, _] : _workers) {
+		::kill(pid, SIGINT);
+	}
+}
@@ -0,0 +1,61 @@
+#include <algorithm>
+#include <sys/socket.h>
+#include "utils/Payload.hpp"
+
+namespace utils {
+	BufferPayload::BufferPayload(std::shared_ptr<const void> owner, const void* data, std::size_t size)
+		: Payload()
+		, _owner(std::move(owner))
+		, _data(static_cast<const std::uint8_t*>(data)) {
+		_totalBytes = size;
+	}
+
+	BufferPayload::BufferPayload(std::shared_ptr<const std::string> buffer)
+		: BufferPayload(buffer, buffer->data(), buffer->size()) {
+	}
+
+	void BufferPayload::send(int fd) {
+		if (Payload::_bytesSent >= _totalBytes) {
+			return;
+		}
+
+		const std::uint8_t* buf = _data + Payload::_bytesSent;
+		const std::size_t size = _totalBytes - Payload::_bytesSent;
+
+		const ssize_t bytesSent = ::send(fd, buf, size, MSG_NOSIGNAL);
+
+		if (bytesSent > 0) {
+			Payload::_bytesSent += static_cast<std::size_t>(bytesSent);
+		}
+	}
+
+	std::size_t BufferPayload::read(std::uint8_t* buffer, std::size_t size) {
+		const std::size_t count = std::min(size, _totalBytes - std::min(Payload::_bytesSent, _totalBytes));
+
+		std::copy_n(_data + Payload::_bytesSent, count, buffer);
+		Payload::_bytesSent += count;
+		return count;
+	}
+
+	std::size_t BufferPayload::peek(struct iovec* iov, std::size_t count) const {
+		if (count == 0 || Payload::_bytesSent >= _totalBytes) {
+			return 0;
+		}
+
+		iov[0].iov_base = const_cast<std::uint8_t*>(_data) + Payload::_bytesSent;
+		iov[0].iov_len = _totalBytes - Payload::_bytesSent;
+		return 1;
+	}
+
+	std::string BufferPayload::toString() const {
+		return std::string(reinterpret_cast<const char*>(_data), _totalBytes);
+	}
+
+	std::unique_ptr<Payload> BufferPayload::clone() const {
+		return std::make_unique<BufferPayload>(*this);
+	}
+
+	bool BufferPayload::isBuffered() const {
+		return true;
+	}
+}
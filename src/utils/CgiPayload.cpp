@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <array>
 #include <sys/socket.h>
 #include "utils/Payload.hpp"
@@ -20,6 +21,24 @@ namespace utils {
 		}
 	}
 
+	std::size_t CgiPayload::read(std::uint8_t* buffer, std::size_t size) {
+		const std::size_t count = std::min(size, _totalBytes - std::min(Payload::_bytesSent, _totalBytes));
+
+		std::copy_n(_buffer.data() + Payload::_bytesSent, count, buffer);
+		Payload::_bytesSent += count;
+		return count;
+	}
+
+	std::size_t CgiPayload::peek(struct iovec* iov, std::size_t count) const {
+		if (count == 0 || Payload::_bytesSent >= _totalBytes) {
+			return 0;
+		}
+
+		iov[0].iov_base = const_cast<std::uint8_t*>(_buffer.data()) + Payload::_bytesSent;
+		iov[0].iov_len = _totalBytes - Payload::_bytesSent;
+		return 1;
+	}
+
 	void CgiPayload::append(const std::uint8_t* data, size_t size) {
 		_buffer.insert(_buffer.end(), data, data + size);
 
@@ -38,6 +57,10 @@ namespace utils {
 		return std::make_unique<CgiPayload>(*this);
 	}
 
+	bool CgiPayload::isBuffered() const {
+		return true;
+	}
+
 	const std::unordered_map<std::string, std::string>& CgiPayload::headerFields() const {
 		return _headerFields;
 	}
@@ -0,0 +1,130 @@
+#include <algorithm>
+#include "utils/Payload.hpp"
+
+namespace utils {
+	CompositePayload::CompositePayload(const CompositePayload& other)
+		: Payload(other)
+		, _current(other._current) {
+		for (const auto& part : other._parts) {
+			_parts.push_back(part->clone());
+		}
+	}
+
+	CompositePayload& CompositePayload::operator=(const CompositePayload& other) {
+		if (this != &other) {
+			Payload::operator=(other);
+			_parts.clear();
+			_current = other._current;
+
+			for (const auto& part : other._parts) {
+				_parts.push_back(part->clone());
+			}
+		}
+
+		return *this;
+	}
+
+	// Moves on to the next part as soon as one is fully sent, until the socket stops accepting data
+	void CompositePayload::send(int fd) {
+		while (_current < _parts.size()) {
+			Payload& part = *_parts[_current];
+			const std::size_t bytesBefore = part.bytesSent();
+
+			part.send(fd);
+			Payload::_bytesSent += part.bytesSent() - bytesBefore;
+
+			if (!part.isSent()) {
+				return;
+			}
+
+			_current++;
+		}
+	}
+
+	std::size_t CompositePayload::read(std::uint8_t* buffer, std::size_t size) {
+		std::size_t count = 0;
+
+		while (count < size && _current < _parts.size()) {
+			const std::size_t bytesRead = _parts[_current]->read(buffer + count, size - count);
+
+			if (_parts[_current]->isSent()) {
+				_current++;
+			} else if (bytesRead == 0) {
+				break;
+			}
+
+			count += bytesRead;
+		}
+
+		Payload::_bytesSent += count;
+		return count;
+	}
+
+	// Gathers the in-memory parts up to the first one that has to go through send()
+	std::size_t CompositePayload::peek(struct iovec* iov, std::size_t count) const {
+		std::size_t filled = 0;
+
+		for (std::size_t i = _current; i < _parts.size() && filled < count; i++) {
+			if (_parts[i]->isSent()) {
+				continue;
+			}
+
+			const std::size_t n = _parts[i]->peek(iov + filled, count - filled);
+
+			if (n == 0) {
+				break;
+			}
+
+			filled += n;
+		}
+
+		return filled;
+	}
+
+	std::size_t CompositePayload::commit(std::size_t bytes) {
+		std::size_t taken = 0;
+
+		while (taken < bytes && _current < _parts.size()) {
+			taken += _parts[_current]->commit(bytes - taken);
+
+			if (!_parts[_current]->isSent()) {
+				break;
+			}
+
+			_current++;
+		}
+
+		Payload::_bytesSent += taken;
+		return taken;
+	}
+
+	std::string CompositePayload::toString() const {
+		std::string content;
+
+		for (const auto& part : _parts) {
+			content += part->toString();
+		}
+
+		return content;
+	}
+
+	std::unique_ptr<Payload> CompositePayload::clone() const {
+		return std::make_unique<CompositePayload>(*this);
+	}
+
+	bool CompositePayload::isBuffered() const {
+		return std::all_of(_parts.begin() + _current, _parts.end(), [](const auto& part) {
+			return part->isSent() || part->isBuffered();
+		});
+	}
+
+	bool CompositePayload::isPending() const {
+		return _current < _parts.size() && _parts[_current]->isPending();
+	}
+
+	CompositePayload& CompositePayload::add(std::unique_ptr<Payload> part) {
+		_totalBytes += part->size();
+		_parts.push_back(std::move(part));
+		return *this;
+	}
+}
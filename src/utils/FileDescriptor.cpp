@@ -0,0 +1,16 @@
+#include <unistd.h>
+#include "utils/FileDescriptor.hpp"
+
+namespace utils {
+	FileDescriptor::FileDescriptor(int fd) : _fd(fd) {}
+
+	FileDescriptor::~FileDescriptor() {
+		if (_fd != -1) {
+			::close(_fd);
+		}
+	}
+
+	int FileDescriptor::get() const {
+		return _fd;
+	}
+}
@@ -1,42 +1,91 @@
-#include <array>
-#include <iterator>
+#include <atomic>
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/sendfile.h>
 #include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
 #include "utils/Payload.hpp"
+#include "utils/ReadAhead.hpp"
 #include "Error.hpp"
 
+namespace {
+	// Upper bound handed to a single sendfile call, the kernel sends as much as the socket accepts
+	constexpr std::size_t SENDFILE_CHUNK_SIZE = 4 * 1024 * 1024;
+	constexpr std::size_t FALLBACK_CHUNK_SIZE = 64 * 1024;
+
+	// Smaller files are sent inline even when cold, one disk read is not worth the round trip through a thread
+	constexpr std::size_t READ_AHEAD_MIN_SIZE = 1024 * 1024;
+	constexpr std::size_t READ_AHEAD_BLOCK_SIZE = 512 * 1024;
+
+	enum BlockStatus : int { READING, READY, FAILED };
+}
+
 namespace utils {
+	// Two blocks of the file, the event loop sends one while a ReadAhead thread fills the other
+	struct FilePayload::ReadAheadState {
+		struct Block {
+			std::vector<std::uint8_t> data;
+			std::size_t offset { 0 };
+			std::size_t length { 0 };
+			std::size_t sent { 0 };
+			std::atomic<int> status { READY };
+		};
+
+		std::shared_ptr<const FileDescriptor> file;
+		Block blocks[2];
+		std::size_t current { 0 };
+		std::size_t nextOffset { 0 };	// File offset of the next block to read
+		std::size_t end { 0 };
+	};
+
 	FilePayload::FilePayload(const std::filesystem::path &filePath) : Payload(), _filePath(filePath) {
-		if (!std::filesystem::exists(filePath)) {
-			throw FileNotFoundException(_filePath.filename());
-		}
+		int fd = ::open(filePath.c_str(), O_RDONLY | O_CLOEXEC);
 
-		_ifstream.open(filePath, std::ios::binary);
+		if (fd == -1) {
+			if (errno == ENOENT) {
+				throw FileNotFoundException(filePath.filename());
+			}
 
-		if (!_ifstream.is_open()) {
 			throw std::ios_base::failure("Failed to open " + filePath.string());
 		}
 
-		_totalBytes = std::filesystem::file_size(filePath);
-	}
+		_file = std::make_shared<const FileDescriptor>(fd);
 
-	FilePayload::FilePayload(const FilePayload& other) : Payload(other), _filePath(other._filePath) {
-		_ifstream.open(_filePath, std::ios::binary);
+		struct ::stat st;
 
-		if (!_ifstream.is_open()) {
-			throw std::ios_base::failure("Failed to open " + _filePath.string());
+		if (::fstat(fd, &st) == -1) {
+			throw std::ios_base::failure("Failed to stat " + filePath.string());
 		}
+
+		_totalBytes = static_cast<std::size_t>(st.st_size);
+	}
+
+	FilePayload::FilePayload(const std::filesystem::path &filePath, std::shared_ptr<const FileDescriptor> file, std::size_t size, std::size_t offset)
+		: Payload()
+		, _filePath(filePath)
+		, _file(std::move(file))
+		, _offset(offset) {
+		_totalBytes = size;
 	}
 
+	// A copy starts over with its own read-ahead, the buffers belong to the payload that filled them
+	FilePayload::FilePayload(const FilePayload& other)
+		: Payload(other)
+		, _filePath(other._filePath)
+		, _file(other._file)
+		, _offset(other._offset)
+		, _useSendfile(other._useSendfile) {}
+
 	FilePayload& FilePayload::operator=(const FilePayload& other) {
 		if (this != &other) {
 			Payload::operator=(other);
 			_filePath = other._filePath;
-
-			_ifstream.open(_filePath, std::ios::binary);
-
-			if (!_ifstream.is_open()) {
-				throw std::ios_base::failure("Failed to open " + _filePath.string());
-			}
+			_file = other._file;
+			_offset = other._offset;
+			_useSendfile = other._useSendfile;
+			_readAhead.reset();
 		}
 
 		return *this;
@@ -47,36 +96,207 @@ namespace utils {
 			return;
 		}
 
-		char buffer[4096];
+		const std::size_t remaining = _totalBytes - Payload::_bytesSent;
+		ssize_t bytesSent = -1;
 
-		_ifstream.seekg(Payload::_bytesSent, std::ios::beg);
-		const auto bytesRead = _ifstream.read(buffer, sizeof(buffer)).gcount();
+		// A file found warm is probed again one read-ahead block later, not on every POLLOUT
+		if (_readAhead == nullptr && remaining >= READ_AHEAD_MIN_SIZE && Payload::_bytesSent >= _nextProbe) {
+			if (_isCold(std::min(remaining, SENDFILE_CHUNK_SIZE))) {
+				_startReadAhead();
+			} else {
+				_nextProbe = Payload::_bytesSent + READ_AHEAD_BLOCK_SIZE;
+			}
+		}
 
-		if (_ifstream.bad() || (_ifstream.fail() && !_ifstream.eof())) {
-			_ifstream.close();
-			throw std::ios_base::failure("Failed to read " + _filePath.string());
+		if (_readAhead != nullptr) {
+			bytesSent = _sendReadAhead(fd);
+		} else if (_useSendfile) {
+			off_t offset = static_cast<off_t>(_offset + Payload::_bytesSent);
+			bytesSent = ::sendfile(fd, _file->get(), &offset, std::min(remaining, SENDFILE_CHUNK_SIZE));
+
+			if (bytesSent == -1 && (errno == EINVAL || errno == ENOSYS)) {
+				_useSendfile = false;
+			}
+
+			// End of file before the size taken when the response was built, the file was truncated
+			if (bytesSent == 0) {
+				_file.reset();
+				throw std::ios_base::failure("Failed to read " + _filePath.string());
+			}
 		}
 
-		const ssize_t bytesSent = ::send(fd, buffer, bytesRead, MSG_NOSIGNAL);
+		if (_readAhead == nullptr && !_useSendfile) {
+			bytesSent = _readAndSend(fd, std::min(remaining, FALLBACK_CHUNK_SIZE));
+		}
 
 		if (bytesSent > 0) {
 			Payload::_bytesSent += static_cast<std::size_t>(bytesSent);
 
 			if (Payload::_bytesSent >= _totalBytes) {
-				_ifstream.close();
+				_file.reset();
+				_readAhead.reset();
 			}
 		}
 	}
 
+	std::size_t FilePayload::read(std::uint8_t* buffer, std::size_t size) {
+		const std::size_t remaining = _totalBytes - std::min(Payload::_bytesSent, _totalBytes);
+
+		if (remaining == 0 || size == 0 || _file == nullptr) {
+			return 0;
+		}
+
+		const ssize_t bytesRead = ::pread(_file->get(), buffer, std::min(size, remaining), static_cast<off_t>(_offset + Payload::_bytesSent));
+
+		if (bytesRead <= 0) {
+			throw std::ios_base::failure("Failed to read " + _filePath.string());
+		}
+
+		Payload::_bytesSent += static_cast<std::size_t>(bytesRead);
+		return static_cast<std::size_t>(bytesRead);
+	}
+
 	std::string FilePayload::toString() const {
-		_ifstream.seekg(0, std::ios::beg);
-		return std::string(
-			std::istreambuf_iterator<char>(_ifstream),
-			std::istreambuf_iterator<char>()
-		);
+		std::string content(_totalBytes, '\0');
+		std::size_t offset = 0;
+
+		while (_file != nullptr && offset < _totalBytes) {
+			const ssize_t bytesRead = ::pread(_file->get(), content.data() + offset, _totalBytes - offset, _offset + offset);
+
+			if (bytesRead <= 0) {
+				break;
+			}
+
+			offset += static_cast<std::size_t>(bytesRead);
+		}
+
+		content.resize(offset);
+		return content;
 	}
 
 	std::unique_ptr<Payload> FilePayload::clone() const {
 		return std::make_unique<FilePayload>(*this);
 	}
+
+	bool FilePayload::isPending() const {
+		return _readAhead != nullptr
+			&& !isSent()
+			&& _readAhead->blocks[_readAhead->current].status.load(std::memory_order_acquire) == READING;
+	}
+
+	FilePayload& FilePayload::useSendfile(bool enabled) {
+		_useSendfile = enabled;
+		return *this;
+	}
+
+	// The read/send loop used where sendfile is not available
+	ssize_t FilePayload::_readAndSend(int fd, std::size_t size) {
+		char buffer[FALLBACK_CHUNK_SIZE];
+		const ssize_t bytesRead = ::pread(_file->get(), buffer, size, static_cast<off_t>(_offset + Payload::_bytesSent));
+
+		// An early end of file would make no progress at all
+		if (bytesRead <= 0) {
+			_file.reset();
+			throw std::ios_base::failure("Failed to read " + _filePath.string());
+		}
+
+		return ::send(fd, buffer, static_cast<std::size_t>(bytesRead), MSG_NOSIGNAL);
+	}
+
+	// Probes the first and last page of the next `size` bytes without waiting for the disk
+	bool FilePayload::_isCold(std::size_t size) const {
+		if (!ReadAhead::instance().isActive()) {
+			return false;
+		}
+
+		const std::size_t offset = _offset + Payload::_bytesSent;
+		char probe;
+		struct iovec iov { &probe, 1 };
+
+		for (const std::size_t position : { offset, offset + size - 1 }) {
+			if (::preadv2(_file->get(), &iov, 1, static_cast<off_t>(position), RWF_NOWAIT) == -1 && errno == EAGAIN) {
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	void FilePayload::_startReadAhead() {
+		const std::size_t offset = _offset + Payload::_bytesSent;
+
+		_readAhead = std::make_shared<ReadAheadState>();
+		_readAhead->file = _file;
+		_readAhead->nextOffset = offset;
+		_readAhead->end = _offset + _totalBytes;
+		::posix_fadvise(_file->get(), static_cast<off_t>(offset), static_cast<off_t>(_readAhead->end - offset), POSIX_FADV_SEQUENTIAL);
+
+		for (std::size_t i = 0; i < std::size(_readAhead->blocks) && _readAhead->nextOffset < _readAhead->end; i++) {
+			_readAhead->blocks[i].data.resize(READ_AHEAD_BLOCK_SIZE);
+			_scheduleRead(i);
+		}
+	}
+
+	// Refills block `index` with the next part of the file, the job keeps the state alive if the payload goes away
+	void FilePayload::_scheduleRead(std::size_t index) {
+		ReadAheadState::Block& block = _readAhead->blocks[index];
+
+		block.offset = _readAhead->nextOffset;
+		block.length = std::min(READ_AHEAD_BLOCK_SIZE, _readAhead->end - block.offset);
+		block.sent = 0;
+		block.status.store(READING, std::memory_order_relaxed);
+		_readAhead->nextOffset += block.length;
+
+		ReadAhead::instance().submit([state = _readAhead, &block]() {
+			const int fd = state->file->get();
+			std::size_t bytesRead = 0;
+
+			while (bytesRead < block.length) {
+				const ssize_t n = ::pread(fd, block.data.data() + bytesRead, block.length - bytesRead, static_cast<off_t>(block.offset + bytesRead));
+
+				if (n <= 0) {
+					block.status.store(FAILED, std::memory_order_release);
+					return;
+				}
+
+				bytesRead += static_cast<std::size_t>(n);
+			}
+
+			// Gets the disk going on the block that will reuse this buffer
+			::readahead(fd, static_cast<off64_t>(block.offset + 2 * READ_AHEAD_BLOCK_SIZE), READ_AHEAD_BLOCK_SIZE);
+			block.status.store(READY, std::memory_order_release);
+		});
+	}
+
+	// Sends from the current block once it has been read, moves on to the other one when it is done
+	ssize_t FilePayload::_sendReadAhead(int fd) {
+		ReadAheadState::Block& block = _readAhead->blocks[_readAhead->current];
+		const int status = block.status.load(std::memory_order_acquire);
+
+		if (status == READING) {
+			return 0;
+		}
+
+		if (status == FAILED) {
+			_file.reset();
+			_readAhead.reset();
+			throw std::ios_base::failure("Failed to read " + _filePath.string());
+		}
+
+		const ssize_t bytesSent = ::send(fd, block.data.data() + block.sent, block.length - block.sent, MSG_NOSIGNAL);
+
+		if (bytesSent > 0) {
+			block.sent += static_cast<std::size_t>(bytesSent);
+
+			if (block.sent == block.length) {
+				if (_readAhead->nextOffset < _readAhead->end) {
+					_scheduleRead(_readAhead->current);
+				}
+
+				_readAhead->current ^= 1;
+			}
+		}
+
+		return bytesSent;
+	}
 }
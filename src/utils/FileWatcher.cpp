@@ -0,0 +1,124 @@
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include "utils/FileWatcher.hpp"
+
+namespace fs = std::filesystem;
+
+namespace {
+	constexpr uint32_t WATCH_MASK =
+		IN_ATTRIB | IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_DELETE_SELF
+		| IN_MODIFY | IN_MOVE_SELF | IN_MOVED_FROM | IN_MOVED_TO;
+}
+
+namespace utils {
+	FileWatcher::FileWatcher() : _fd(::inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) {
+		if (_fd == -1) {
+			std::cerr << "inotify is not available, cached files will not be invalidated" << std::endl;
+		}
+	}
+
+	FileWatcher::~FileWatcher() {
+		if (_fd != -1) {
+			::close(_fd);
+		}
+	}
+
+	// Watches `directory` and every directory below it
+	void FileWatcher::watch(const fs::path& directory) {
+		if (_fd == -1) {
+			return;
+		}
+
+		std::error_code ec;
+
+		if (!fs::is_directory(directory, ec)) {
+			return;
+		}
+
+		_addWatch(directory);
+
+		for (
+			auto it = fs::recursive_directory_iterator(directory, fs::directory_options::skip_permission_denied, ec);
+			!ec && it != fs::recursive_directory_iterator();
+			it.increment(ec)
+		) {
+			if (it->is_directory(ec)) {
+				_addWatch(it->path());
+			}
+		}
+	}
+
+	void FileWatcher::onChange(Handler handler) {
+		_handlers.push_back(handler);
+	}
+
+	void FileWatcher::process() {
+		alignas(struct inotify_event) char buffer[16 * 1024];
+
+		while (true) {
+			const ssize_t length = ::read(_fd, buffer, sizeof(buffer));
+
+			if (length <= 0) {
+				return;
+			}
+
+			for (char* ptr = buffer; ptr < buffer + length;) {
+				const auto* event = reinterpret_cast<const struct inotify_event*>(ptr);
+				ptr += sizeof(struct inotify_event) + event->len;
+
+				if (event->mask & IN_Q_OVERFLOW) {
+					_notify("/");
+					continue;
+				}
+
+				auto it = _watches.find(event->wd);
+
+				if (it == _watches.end()) {
+					continue;
+				}
+
+				const fs::path path = (event->len > 0) ? it->second / event->name : it->second;
+
+				if (event->mask & IN_IGNORED) {
+					_watches.erase(it);
+					continue;
+				}
+
+				if ((event->mask & IN_ISDIR) && (event->mask & (IN_CREATE | IN_MOVED_TO))) {
+					watch(path);
+				}
+
+				_notify(path);
+			}
+		}
+	}
+
+	int FileWatcher::getFd() const {
+		return _fd;
+	}
+
+	bool FileWatcher::isActive() const {
+		return (_fd != -1);
+	}
+
+	void FileWatcher::_addWatch(const fs::path& directory) {
+		const int wd = ::inotify_add_watch(_fd, directory.c_str(), WATCH_MASK);
+
+		if (wd == -1) {
+			std::cerr << "Failed to watch " << directory << ": " << strerror(errno) << std::endl;
+			return;
+		}
+
+		_watches[wd] = directory.lexically_normal();
+	}
+
+	void FileWatcher::_notify(const fs::path& path) {
+		for (const auto& handler : _handlers) {
+			handler(path);
+		}
+	}
+}
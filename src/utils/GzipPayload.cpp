@@ -0,0 +1,71 @@
+#include <stdexcept>
+#include <zlib.h>
+#include "utils/Payload.hpp"
+
+namespace {
+	constexpr std::size_t BLOCK_SIZE = 16 * 1024;
+}
+
+namespace utils {
+	struct GzipPayload::Stream {
+		z_stream zstream {};
+
+		Stream() = default;
+		Stream(const Stream&) = delete;
+		Stream& operator=(const Stream&) = delete;
+
+		~Stream() {
+			::deflateEnd(&zstream);
+		}
+	};
+
+	GzipPayload::GzipPayload(std::unique_ptr<Payload> source, int level)
+		: StreamPayload(std::move(source))
+		, _stream(std::make_unique<Stream>()) {
+		// windowBits 15 + 16 writes a gzip header and trailer instead of a zlib one
+		if (::deflateInit2(&_stream->zstream, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+			throw std::runtime_error("Failed to initialize gzip stream");
+		}
+	}
+
+	GzipPayload::GzipPayload(const GzipPayload& other)
+		: StreamPayload(other)
+		, _stream(std::make_unique<Stream>()) {
+		if (::deflateCopy(&_stream->zstream, const_cast<z_stream*>(&other._stream->zstream)) != Z_OK) {
+			throw std::runtime_error("Failed to copy gzip stream");
+		}
+	}
+
+	GzipPayload::~GzipPayload() = default;
+
+	std::unique_ptr<Payload> GzipPayload::clone() const {
+		return std::make_unique<GzipPayload>(*this);
+	}
+
+	// Deflates the next block of the source, finishing the stream with the last one
+	void GzipPayload::_produce() {
+		std::uint8_t input[BLOCK_SIZE];
+		std::uint8_t output[BLOCK_SIZE];
+		const std::size_t bytesRead = _source->read(input, sizeof(input));
+		const int flush = (bytesRead == 0 || _source->isSent()) ? Z_FINISH : Z_NO_FLUSH;
+		z_stream& zstream = _stream->zstream;
+		int status;
+
+		zstream.next_in = input;
+		zstream.avail_in = static_cast<uInt>(bytesRead);
+
+		do {
+			zstream.next_out = output;
+			zstream.avail_out = sizeof(output);
+			status = ::deflate(&zstream, flush);
+
+			if (status == Z_STREAM_ERROR) {
+				throw std::runtime_error("Failed to deflate payload");
+			}
+
+			_pending.insert(_pending.end(), output, output + (sizeof(output) - zstream.avail_out));
+		} while (zstream.avail_out == 0 || (flush == Z_FINISH && status != Z_STREAM_END));
+
+		_isFinished = (status == Z_STREAM_END);
+	}
+}
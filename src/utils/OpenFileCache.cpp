@@ -0,0 +1,157 @@
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "utils/OpenFileCache.hpp"
+
+namespace fs = std::filesystem;
+using std::chrono::steady_clock;
+
+namespace utils {
+	bool OpenFileCache::Entry::isDirectory() const {
+		return S_ISDIR(stat.stx_mode);
+	}
+
+	bool OpenFileCache::Entry::isRegularFile() const {
+		return S_ISREG(stat.stx_mode);
+	}
+
+	bool OpenFileCache::Entry::isOwnerExecutable() const {
+		return (stat.stx_mode & S_IXUSR) != 0;
+	}
+
+	std::size_t OpenFileCache::Entry::size() const {
+		return static_cast<std::size_t>(stat.stx_size);
+	}
+
+	OpenFileCache& OpenFileCache::instance() {
+		static OpenFileCache cache;
+		return cache;
+	}
+
+	void OpenFileCache::configure(std::size_t maxEntries, std::chrono::seconds validity) {
+		_maxEntries = maxEntries;
+		_validity = validity;
+		clear();
+	}
+
+	void OpenFileCache::clear() {
+		_lru.clear();
+		_entries.clear();
+	}
+
+	// Drops `path` and, when it is a directory, everything cached below it
+	void OpenFileCache::invalidate(const fs::path& path) {
+		const std::string key = path.lexically_normal().string();
+
+		if (auto it = _entries.find(key); it != _entries.end()) {
+			_erase(it);
+		}
+
+		const std::string prefix = key.ends_with('/') ? key : key + "/";
+
+		for (auto it = _entries.begin(); it != _entries.end();) {
+			if (it->first.starts_with(prefix)) {
+				auto next = std::next(it);
+				_erase(it);
+				it = next;
+				continue;
+			}
+
+			it++;
+		}
+	}
+
+	// Returns the metadata of `path`, or nullptr when it can not be stat'ed (errno is set)
+	std::shared_ptr<const OpenFileCache::Entry> OpenFileCache::stat(const fs::path& path) {
+		const std::string key = path.lexically_normal().string();
+
+		if (auto entry = _find(key)) {
+			return entry;
+		}
+
+		auto entry = std::make_shared<Entry>();
+
+		if (::statx(AT_FDCWD, key.c_str(), AT_STATX_SYNC_AS_STAT, STATX_BASIC_STATS, &entry->stat) == -1) {
+			return nullptr;
+		}
+
+		entry->path = key;
+		entry->validUntil = steady_clock::now() + _validity;
+		_insert(entry);
+		return entry;
+	}
+
+	// Same as stat(), with a shared descriptor attached when `path` is a regular file
+	std::shared_ptr<const OpenFileCache::Entry> OpenFileCache::open(const fs::path& path) {
+		const std::string key = path.lexically_normal().string();
+		auto entry = _find(key);
+
+		if (entry != nullptr && (entry->file != nullptr || !entry->isRegularFile())) {
+			return entry;
+		}
+
+		int fd = ::open(key.c_str(), O_RDONLY | O_CLOEXEC);
+
+		if (fd == -1) {
+			return nullptr;
+		}
+
+		auto file = std::make_shared<const FileDescriptor>(fd);
+
+		if (entry == nullptr) {
+			entry = std::make_shared<Entry>();
+
+			if (::statx(fd, "", AT_EMPTY_PATH, STATX_BASIC_STATS, &entry->stat) == -1) {
+				return nullptr;
+			}
+
+			entry->path = key;
+			entry->validUntil = steady_clock::now() + _validity;
+			_insert(entry);
+		}
+
+		if (entry->isRegularFile()) {
+			entry->file = file;
+		}
+
+		return entry;
+	}
+
+	bool OpenFileCache::isEnabled() const {
+		return (_maxEntries > 0);
+	}
+
+	std::shared_ptr<OpenFileCache::Entry> OpenFileCache::_find(const std::string& key) {
+		auto it = _entries.find(key);
+
+		if (it == _entries.end()) {
+			return nullptr;
+		}
+
+		if (steady_clock::now() >= (*it->second)->validUntil) {
+			_erase(it);
+			return nullptr;
+		}
+
+		_lru.splice(_lru.begin(), _lru, it->second);
+		return *it->second;
+	}
+
+	void OpenFileCache::_insert(const std::shared_ptr<Entry>& entry) {
+		if (!isEnabled()) {
+			return;
+		}
+
+		while (_lru.size() >= _maxEntries) {
+			_erase(_entries.find(_lru.back()->path));
+		}
+
+		_lru.push_front(entry);
+		_entries[entry->path] = _lru.begin();
+	}
+
+	void OpenFileCache::_erase(std::unordered_map<std::string, LruList::iterator>::iterator it) {
+		_lru.erase(it->second);
+		_entries.erase(it);
+	}
+}
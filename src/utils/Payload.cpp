@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <typeinfo>
 #include "utils/Payload.hpp"
 
@@ -9,11 +10,54 @@ namespace utils {
 		throw std::runtime_error(className + " does not support method append(const std::uint8_t*, size_t)");
 	}
 
+	// Consumes the next bytes of the payload, for stages that transform it instead of sending it
+	std::size_t Payload::read(std::uint8_t* buffer, std::size_t size) {
+		const std::string content = toString();
+		const std::size_t count = std::min(size, content.size() - std::min(_bytesSent, content.size()));
+
+		std::copy_n(content.data() + _bytesSent, count, buffer);
+		_bytesSent += count;
+		return count;
+	}
+
+	/**
+	 * Describes the unsent bytes that are already in memory, so they can be
+	 * written together with other buffers in one writev. Returns the number
+	 * of iovecs filled, 0 for payloads that must go through send().
+	 */
+	std::size_t Payload::peek(struct iovec* iov, std::size_t count) const {
+		(void)iov;
+		(void)count;
+		return 0;
+	}
+
+	// Marks up to `bytes` bytes described by peek() as sent, returns how many were taken
+	std::size_t Payload::commit(std::size_t bytes) {
+		const std::size_t taken = std::min(bytes, _totalBytes - std::min(_bytesSent, _totalBytes));
+
+		_bytesSent += taken;
+		return taken;
+	}
+
 	bool Payload::isSent() const {
 		return (_bytesSent >= _totalBytes);
 	}
 
+	// Whether peek() describes everything that is left, so nothing has to go through send()
+	bool Payload::isBuffered() const {
+		return false;
+	}
+
+	// Whether the next bytes are still being read in the background, send() would not make progress
+	bool Payload::isPending() const {
+		return false;
+	}
+
 	std::size_t Payload::size() const {
 		return _totalBytes;
 	}
+
+	std::size_t Payload::bytesSent() const {
+		return _bytesSent;
+	}
 }
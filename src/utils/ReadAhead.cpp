@@ -0,0 +1,74 @@
+#include <cstdint>
+#include <iostream>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include "utils/ReadAhead.hpp"
+
+namespace {
+	constexpr std::size_t THREAD_COUNT = 2;
+}
+
+namespace utils {
+	// Never destroyed: exit() takes the threads down with the process, and a forked CGI child must not join threads it does not have
+	ReadAhead& ReadAhead::instance() {
+		static ReadAhead* pool = new ReadAhead();
+		return *pool;
+	}
+
+	ReadAhead::ReadAhead() : _fd(::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) {
+		if (_fd == -1) {
+			std::cerr << "eventfd is not available, cold files are read inline" << std::endl;
+		}
+	}
+
+	void ReadAhead::submit(Job job) {
+		{
+			std::lock_guard lock(_mutex);
+
+			if (_threads.empty()) {
+				for (std::size_t i = 0; i < THREAD_COUNT; i++) {
+					_threads.emplace_back(&ReadAhead::_run, this);
+				}
+			}
+
+			_jobs.push_back(std::move(job));
+		}
+
+		_hasJobs.notify_one();
+	}
+
+	// Drains the eventfd, the caller then resumes whatever was waiting for a job
+	void ReadAhead::process() {
+		std::uint64_t count;
+
+		while (::read(_fd, &count, sizeof(count)) > 0) {
+		}
+	}
+
+	int ReadAhead::getFd() const {
+		return _fd;
+	}
+
+	bool ReadAhead::isActive() const {
+		return (_fd != -1);
+	}
+
+	void ReadAhead::_run() {
+		while (true) {
+			Job job;
+
+			{
+				std::unique_lock lock(_mutex);
+				_hasJobs.wait(lock, [this]() { return !_jobs.empty(); });
+				job = std::move(_jobs.front());
+				_jobs.pop_front();
+			}
+
+			job();
+
+			const std::uint64_t one = 1;
+			(void)!::write(_fd, &one, sizeof(one));
+		}
+	}
+}
@@ -0,0 +1,127 @@
+#include <algorithm>
+#include <cstdio>
+#include <sys/socket.h>
+#include "utils/Payload.hpp"
+
+namespace {
+	constexpr std::size_t BLOCK_SIZE = 16 * 1024;
+}
+
+namespace utils {
+	StreamPayload::StreamPayload(std::unique_ptr<Payload> source) : Payload(), _source(std::move(source)) {}
+
+	StreamPayload::StreamPayload(const StreamPayload& other)
+		: Payload(other)
+		, _source(other._source ? other._source->clone() : nullptr)
+		, _pending(other._pending)
+		, _pendingOffset(other._pendingOffset)
+		, _isFinished(other._isFinished) {
+	}
+
+	void StreamPayload::send(int fd) {
+		while (_pendingOffset == _pending.size()) {
+			if (_isFinished) {
+				return;
+			}
+
+			_pending.clear();
+			_pendingOffset = 0;
+			_produce();
+		}
+
+		const ssize_t bytesSent = ::send(fd, _pending.data() + _pendingOffset, _pending.size() - _pendingOffset, MSG_NOSIGNAL);
+
+		if (bytesSent > 0) {
+			_pendingOffset += static_cast<std::size_t>(bytesSent);
+			Payload::_bytesSent += static_cast<std::size_t>(bytesSent);
+		}
+	}
+
+	std::size_t StreamPayload::read(std::uint8_t* buffer, std::size_t size) {
+		std::size_t count = 0;
+
+		while (count < size) {
+			if (_pendingOffset == _pending.size()) {
+				if (_isFinished) {
+					break;
+				}
+
+				_pending.clear();
+				_pendingOffset = 0;
+				_produce();
+				continue;
+			}
+
+			const std::size_t n = std::min(size - count, _pending.size() - _pendingOffset);
+			std::copy_n(_pending.data() + _pendingOffset, n, buffer + count);
+			_pendingOffset += n;
+			count += n;
+		}
+
+		Payload::_bytesSent += count;
+		return count;
+	}
+
+	std::size_t StreamPayload::peek(struct iovec* iov, std::size_t count) const {
+		if (count == 0 || _pendingOffset == _pending.size()) {
+			return 0;
+		}
+
+		iov[0].iov_base = const_cast<std::uint8_t*>(_pending.data()) + _pendingOffset;
+		iov[0].iov_len = _pending.size() - _pendingOffset;
+		return 1;
+	}
+
+	std::size_t StreamPayload::commit(std::size_t bytes) {
+		const std::size_t taken = std::min(bytes, _pending.size() - _pendingOffset);
+
+		_pendingOffset += taken;
+		Payload::_bytesSent += taken;
+		return taken;
+	}
+
+	std::string StreamPayload::toString() const {
+		auto copy = clone();
+		std::string content;
+		std::uint8_t buffer[BLOCK_SIZE];
+
+		while (!copy->isSent()) {
+			const std::size_t bytesRead = copy->read(buffer, sizeof(buffer));
+			content.append(reinterpret_cast<const char*>(buffer), bytesRead);
+		}
+
+		return content;
+	}
+
+	bool StreamPayload::isSent() const {
+		return (_isFinished && _pendingOffset == _pending.size());
+	}
+
+	ChunkedPayload::ChunkedPayload(std::unique_ptr<Payload> source) : StreamPayload(std::move(source)) {}
+
+	std::unique_ptr<Payload> ChunkedPayload::clone() const {
+		return std::make_unique<ChunkedPayload>(*this);
+	}
+
+	// One chunk per block of the source, followed by the last-chunk once the source is drained
+	void ChunkedPayload::_produce() {
+		std::uint8_t buffer[BLOCK_SIZE];
+		const std::size_t bytesRead = _source->read(buffer, sizeof(buffer));
+
+		if (bytesRead > 0) {
+			char sizeLine[32];
+			const int length = std::snprintf(sizeLine, sizeof(sizeLine), "%zx\r\n", bytesRead);
+
+			_pending.insert(_pending.end(), sizeLine, sizeLine + length);
+			_pending.insert(_pending.end(), buffer, buffer + bytesRead);
+			_pending.insert(_pending.end(), { '\r', '\n' });
+		}
+
+		if (bytesRead == 0 || _source->isSent()) {
+			const std::string_view lastChunk("0\r\n\r\n");
+
+			_pending.insert(_pending.end(), lastChunk.begin(), lastChunk.end());
+			_isFinished = true;
+		}
+	}
+}
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <array>
 #include <sys/socket.h>
 #include "utils/Payload.hpp"
@@ -23,6 +24,24 @@ namespace utils {
 		}
 	}
 
+	std::size_t StringPayload::read(std::uint8_t* buffer, std::size_t size) {
+		const std::size_t count = std::min(size, _totalBytes - std::min(Payload::_bytesSent, _totalBytes));
+
+		std::copy_n(_message.data() + Payload::_bytesSent, count, buffer);
+		Payload::_bytesSent += count;
+		return count;
+	}
+
+	std::size_t StringPayload::peek(struct iovec* iov, std::size_t count) const {
+		if (count == 0 || Payload::_bytesSent >= _totalBytes) {
+			return 0;
+		}
+
+		iov[0].iov_base = const_cast<char*>(_message.data()) + Payload::_bytesSent;
+		iov[0].iov_len = _totalBytes - Payload::_bytesSent;
+		return 1;
+	}
+
 	void StringPayload::append(const std::uint8_t* data, size_t size) {
 		_message.append(reinterpret_cast<const char*>(data), size);
 		_totalBytes = _message.size();
@@ -32,12 +51,26 @@ namespace utils {
 		return _message;
 	}
 
-	void StringPayload::setMessage(const std::string& message) {
-		_message = message;
+	void StringPayload::setMessage(std::string message) {
+		_message = std::move(message);
 		_totalBytes = _message.size();
 	}
 
+	// Hands the message over and empties the payload, so its buffer can be reused
+	std::string StringPayload::release() {
+		std::string message = std::move(_message);
+
+		_message.clear();
+		_totalBytes = 0;
+		Payload::_bytesSent = 0;
+		return message;
+	}
+
 	std::unique_ptr<Payload> StringPayload::clone() const {
 		return std::make_unique<StringPayload>(*this);
 	}
+
+	bool StringPayload::isBuffered() const {
+		return true;
+	}
 }
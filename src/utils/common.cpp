@@ -58,6 +58,34 @@ namespace utils {
 		return port;
 	}
 
+	std::size_t parseCount(const string &value) {
+		std::regex count_regex("^[0-9]+$");
+		if (!std::regex_match(value, count_regex)) {
+			THROW_CONFIG_ERROR(EINVAL, "Invalid number");
+		}
+		return std::stoul(value);
+	}
+
+	// Accepts a number of seconds with an optional s, m, h or d suffix
+	std::chrono::seconds parseDuration(const string &value) {
+		std::regex duration_regex("^([0-9]+)([smhd]?)$");
+		std::smatch match;
+		if (!std::regex_match(value, match, duration_regex)) {
+			THROW_CONFIG_ERROR(EINVAL, "Invalid duration");
+		}
+		std::chrono::seconds duration(std::stol(match[1].str()));
+		switch (match[2].str().empty() ? 's' : match[2].str()[0]) {
+			case 'm':
+				return duration * 60;
+			case 'h':
+				return duration * 3600;
+			case 'd':
+				return duration * 86400;
+			default:
+				return duration;
+		}
+	}
+
 	void validateMethods(const vector<string> &methods) {
 		vector<string> validMethods = {"GET", "POST", "DELETE"};
 		for (const auto &method : methods) {
@@ -257,8 +285,11 @@ namespace utils {
 		return true;
 	}
 
+	// The rest of the path always goes below the root, even after a location without a trailing slash
 	fs::path computeFilePath(const Location& loc, const string& requestPath) {
-		return loc.root / requestPath.substr(loc.path.size());
+		const std::size_t start = requestPath.find_first_not_of('/', loc.path.size());
+
+		return loc.root / ((start == string::npos) ? string() : requestPath.substr(start));
 	}
 
 	string getFileExtension(const string& filePath) {
@@ -20,7 +20,7 @@ namespace utils {
 		return true;
 	}
 
-	int createPassiveSocket(const char* host, int port, int backlog, bool isNonBlocking) {
+	int createPassiveSocket(const char* host, int port, int backlog, bool isNonBlocking, bool isReusePort) {
 		int fd = ::socket(AF_INET, SOCK_STREAM, 0);
 
         if (fd == -1) {
@@ -31,6 +31,13 @@ namespace utils {
 			throw std::runtime_error("Failed to set non-blocking");
 		}
 
+		// Lets every worker process bind the same address, the kernel spreads connections among them
+		const int isEnabled = 1;
+
+		if (isReusePort && ::setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &isEnabled, sizeof(isEnabled)) == -1) {
+			throw std::runtime_error("Failed to set SO_REUSEPORT");
+		}
+
         sockaddr_in address {};
         address.sin_family = AF_INET;
         address.sin_addr.s_addr = inet_addr(host);
@@ -0,0 +1,166 @@
+#include <gtest/gtest.h>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include "http/Bundle.hpp"
+
+using http::Bundle;
+
+namespace {
+    std::uint64_t alignUp(std::uint64_t offset) {
+        return (offset + 7) & ~std::uint64_t { 7 };
+    }
+
+    // Packs `files` the way tools/bundle.cpp lays them out, with one bucket and identity variants only
+    std::string pack(const std::map<std::string, std::string>& files) {
+        const std::vector<std::pair<std::string, std::string>> items(files.begin(), files.end());
+        const std::uint32_t count = static_cast<std::uint32_t>(items.size());
+        std::vector<std::uint32_t> slots(count + count / 4 + 1, Bundle::EMPTY_SLOT);
+        std::uint32_t seed = 1;
+
+        for (;; seed++) {
+            std::set<std::uint64_t> taken;
+            for (const auto& item : items) {
+                taken.insert(Bundle::hashOf(item.first, seed) % slots.size());
+            }
+            if (taken.size() == count) {
+                break;
+            }
+        }
+        for (std::uint32_t i = 0; i < count; i++) {
+            slots[Bundle::hashOf(items[i].first, seed) % slots.size()] = i;
+        }
+
+        Bundle::Header header {};
+        std::memcpy(header.magic, Bundle::MAGIC, sizeof(Bundle::MAGIC));
+        header.entryCount = count;
+        header.bucketCount = 1;
+        header.slotCount = static_cast<std::uint32_t>(slots.size());
+        header.seedsOffset = alignUp(sizeof(header));
+        header.slotsOffset = alignUp(header.seedsOffset + sizeof(seed));
+        header.entriesOffset = alignUp(header.slotsOffset + slots.size() * sizeof(std::uint32_t));
+
+        std::string archive(header.entriesOffset + count * sizeof(Bundle::Entry), '\0');
+        std::vector<Bundle::Entry> entries(count);
+
+        auto append = [&archive](const std::string& data) {
+            const Bundle::Span span { archive.size(), data.size() };
+            archive += data;
+            return span;
+        };
+
+        for (std::uint32_t i = 0; i < count; i++) {
+            entries[i].path = append(items[i].first);
+            entries[i].variants[Bundle::IDENTITY].content = append(items[i].second);
+            entries[i].variants[Bundle::IDENTITY].entityTag = append("\"" + std::to_string(i) + "\"");
+        }
+
+        std::memcpy(archive.data(), &header, sizeof(header));
+        std::memcpy(archive.data() + header.seedsOffset, &seed, sizeof(seed));
+        std::memcpy(archive.data() + header.slotsOffset, slots.data(), slots.size() * sizeof(std::uint32_t));
+        std::memcpy(archive.data() + header.entriesOffset, entries.data(), entries.size() * sizeof(Bundle::Entry));
+        return archive;
+    }
+}
+
+class BundleTest : public ::testing::Test {
+protected:
+    const std::map<std::string, std::string> files {
+        { "index.html", "<h1>home</h1>" },
+        { "css/site.css", "body {}" },
+        { "img/logo.png", std::string("\x89PNG\0\1", 6) },
+        { "a", "a" },
+        { "docs/a", "nested a" },
+    };
+    std::string path;
+
+    void SetUp() override {
+        path = ::testing::TempDir() + "/test.bundle";
+        write(pack(files));
+    }
+
+    // Renamed into place like the tool does, a mapping of the old file stays valid
+    void write(const std::string& archive) {
+        std::ofstream(path + ".tmp", std::ios::binary | std::ios::trunc) << archive;
+        std::filesystem::rename(path + ".tmp", path);
+    }
+};
+
+TEST_F(BundleTest, FindsEveryPackedPath) {
+    auto bundle = Bundle::open(path);
+    ASSERT_NE(bundle, nullptr);
+    EXPECT_EQ(bundle->size(), files.size());
+
+    for (const auto& [name, content] : files) {
+        const Bundle::Entry* entry = bundle->find(name);
+        ASSERT_NE(entry, nullptr) << name;
+        EXPECT_EQ(bundle->viewOf(entry->path), name);
+        EXPECT_EQ(bundle->viewOf(entry->variants[Bundle::IDENTITY].content), content);
+        EXPECT_EQ(entry->variants[Bundle::GZIP].entityTag.size, 0u);
+    }
+}
+
+TEST_F(BundleTest, MissesPathsNotPacked) {
+    auto bundle = Bundle::open(path);
+    ASSERT_NE(bundle, nullptr);
+
+    EXPECT_EQ(bundle->find(""), nullptr);
+    EXPECT_EQ(bundle->find("/index.html"), nullptr);
+    EXPECT_EQ(bundle->find("index.htm"), nullptr);
+    EXPECT_EQ(bundle->find("docs"), nullptr);
+
+    // Most of these land on an occupied slot, the path comparison tells them apart
+    for (int i = 0; i < 1000; i++) {
+        EXPECT_EQ(bundle->find("missing/" + std::to_string(i)), nullptr);
+    }
+}
+
+TEST_F(BundleTest, RejectsBrokenArchives) {
+    std::string archive = pack(files);
+
+    archive[0] = 'X';
+    write(archive);
+    EXPECT_EQ(Bundle::open(path), nullptr);
+
+    // A slot pointing past the entries
+    archive = pack(files);
+    Bundle::Header header;
+    std::memcpy(&header, archive.data(), sizeof(header));
+    const std::uint32_t outOfRange = header.entryCount;
+    std::memcpy(archive.data() + header.slotsOffset, &outOfRange, sizeof(outOfRange));
+    write(archive);
+    EXPECT_EQ(Bundle::open(path), nullptr);
+
+    // Truncated contents
+    archive = pack(files);
+    write(archive.substr(0, archive.size() - 1));
+    EXPECT_EQ(Bundle::open(path), nullptr);
+
+    EXPECT_EQ(Bundle::open(::testing::TempDir() + "/none.bundle"), nullptr);
+}
+
+TEST_F(BundleTest, RefreshKeepsOldMappingAlive) {
+    http::Bundles& bundles = http::Bundles::instance();
+    ASSERT_TRUE(bundles.add(path));
+
+    auto before = bundles.get(path);
+    ASSERT_NE(before, nullptr);
+
+    write(pack({ { "new.html", "new" } }));
+    bundles.refresh(::testing::TempDir());
+
+    auto after = bundles.get(path);
+    ASSERT_NE(after, before);
+    EXPECT_NE(after->find("new.html"), nullptr);
+    EXPECT_EQ(after->find("index.html"), nullptr);
+    EXPECT_EQ(before->viewOf(before->find("index.html")->variants[Bundle::IDENTITY].content), "<h1>home</h1>");
+
+    // A broken replacement keeps the last good mapping
+    write("broken");
+    bundles.refresh(path);
+    EXPECT_EQ(bundles.get(path), after);
+}
@@ -0,0 +1,80 @@
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <string>
+#include "TempTree.hpp"
+#include "http/index.hpp"
+#include "http/CannedResponses.hpp"
+
+namespace fs = std::filesystem;
+
+class CannedResponsesTest : public ::testing::Test {
+protected:
+    http::CannedResponses& canned = http::CannedResponses::instance();
+    TempTree tree { "canned", { "errors" } };
+    const fs::path& root = tree.root;
+
+    void SetUp() override {
+        tree.write("errors/404.html", "<h1>missing</h1>");
+    }
+
+    // Removing the pages and refreshing drops their entries from the singleton
+    void TearDown() override {
+        fs::remove_all(root);
+        canned.refresh(root);
+    }
+};
+
+TEST_F(CannedResponsesTest, SerializesPageOnce) {
+    canned.add(http::StatusCode::NOT_FOUND_404, root / "errors/404.html");
+
+    auto message = canned.get(http::StatusCode::NOT_FOUND_404, root / "errors" / "." / "404.html");
+    ASSERT_NE(message, nullptr);
+    EXPECT_NE(message->find("Content-Type: text/html"), std::string::npos);
+    EXPECT_NE(message->find("Cache-Control: no-store\r\n"), std::string::npos);
+    EXPECT_TRUE(message->ends_with("Content-Length: 16\r\n\r\n<h1>missing</h1>"));
+
+    // Keyed by status code and page
+    EXPECT_EQ(canned.get(http::StatusCode::INTERNAL_SERVER_ERROR_500, root / "errors/404.html"), nullptr);
+}
+
+TEST_F(CannedResponsesTest, UnreadablePagesAreLeftOut) {
+    canned.add(http::StatusCode::NOT_FOUND_404, root / "errors/none.html");
+    canned.add(http::StatusCode::NOT_FOUND_404, root / "errors");
+
+    EXPECT_EQ(canned.get(http::StatusCode::NOT_FOUND_404, root / "errors/none.html"), nullptr);
+    EXPECT_EQ(canned.get(http::StatusCode::NOT_FOUND_404, root / "errors"), nullptr);
+}
+
+TEST_F(CannedResponsesTest, RefreshRereadsAndDrops) {
+    const fs::path page = root / "errors/404.html";
+    canned.add(http::StatusCode::NOT_FOUND_404, page);
+
+    tree.write("errors/404.html", "<h1>gone</h1>");
+    canned.refresh(root / "errors");
+    auto message = canned.get(http::StatusCode::NOT_FOUND_404, page);
+    ASSERT_NE(message, nullptr);
+    EXPECT_TRUE(message->ends_with("<h1>gone</h1>"));
+
+    fs::remove(page);
+    canned.refresh(page);
+    EXPECT_EQ(canned.get(http::StatusCode::NOT_FOUND_404, page), nullptr);
+}
+
+TEST_F(CannedResponsesTest, ResponseSendsCannedPage) {
+    const fs::path page = root / "errors/404.html";
+    canned.add(http::StatusCode::NOT_FOUND_404, page);
+
+    http::Response res(-1);
+    res.setFile(http::StatusCode::NOT_FOUND_404, page);
+
+    const std::string header = res.getHeader().toString();
+    EXPECT_TRUE(header.starts_with("HTTP/1.1 404 Not Found\r\nDate: "));
+    EXPECT_EQ(res.getStatus(), http::Response::Status::READY);
+    EXPECT_EQ(res.getBody()->toString(), *canned.get(http::StatusCode::NOT_FOUND_404, page));
+}
+
+TEST(CannedRedirectTest, SerializesLocation) {
+    auto message = http::CannedResponses::serializeRedirect("https://example.com/new");
+
+    EXPECT_EQ(*message, "Location: https://example.com/new\r\nContent-Length: 0\r\n\r\n");
+}
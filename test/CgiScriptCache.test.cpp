@@ -0,0 +1,101 @@
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <string>
+#include "TempTree.hpp"
+#include "Router.hpp"
+#include "CgiScriptCache.hpp"
+
+namespace fs = std::filesystem;
+
+class IsCgiTest : public ::testing::Test {
+protected:
+    CgiScriptCache& cache = CgiScriptCache::instance();
+    TempTree tree { "cgi", { "sub" } };
+    const fs::path& root = tree.root;
+    ServerConfig server;
+
+    void SetUp() override {
+        write("hello.py", fs::perms::owner_all);
+        write("sub/nested.py", fs::perms::owner_all);
+        write("data.py", fs::perms::owner_read | fs::perms::owner_write);
+        write("hello.txt", fs::perms::owner_all);
+        cache.configure(16, std::chrono::seconds(60), true);
+
+        Location cgi;
+        cgi.path = "/cgi-bin";
+        cgi.root = root;
+        cgi.cgiExtension = { "py" };
+        server.locations.push_back(cgi);
+    }
+
+    void TearDown() override {
+        cache.configure(0, std::chrono::seconds(0), false);
+    }
+
+    void write(const std::string& name, fs::perms perms) {
+        fs::permissions(tree.write(name, "#!/usr/bin/env python3\n"), perms);
+    }
+
+    bool isCGI(const std::string& path) {
+        const Router router(server);
+        const RouteTable::Route* route = router.getRouteTable().match(path);
+        return route != nullptr && router.isCGI(*route, path);
+    }
+};
+
+// The rest of the path after a location without trailing slash starts with one, the script is still below root
+TEST_F(IsCgiTest, JoinsRootAndRestOfPath) {
+    EXPECT_TRUE(isCGI("/cgi-bin/hello.py"));
+    EXPECT_TRUE(isCGI("/cgi-bin//sub/nested.py"));
+
+    server.locations[0].path = "/cgi-bin/";
+    EXPECT_TRUE(isCGI("/cgi-bin/hello.py"));
+    EXPECT_TRUE(isCGI("/cgi-bin/sub/nested.py"));
+}
+
+TEST_F(IsCgiTest, NeedsRunnableScriptWithExtension) {
+    EXPECT_FALSE(isCGI("/cgi-bin/data.py"));
+    EXPECT_FALSE(isCGI("/cgi-bin/missing.py"));
+    EXPECT_FALSE(isCGI("/cgi-bin/hello.txt"));
+    EXPECT_FALSE(isCGI("/cgi-bin/hello"));
+    EXPECT_FALSE(isCGI("/cgi-bin/sub"));
+}
+
+TEST_F(IsCgiTest, FastCgiApplicationHasTheScripts) {
+    server.locations[0].fastCgiPass = "unix:/run/app.sock";
+    EXPECT_TRUE(isCGI("/cgi-bin/missing.py"));
+    EXPECT_FALSE(isCGI("/cgi-bin/hello.txt"));
+
+    server.locations[0].cgiExtension.clear();
+    EXPECT_TRUE(isCGI("/cgi-bin/anything"));
+}
+
+TEST_F(IsCgiTest, WatchedDecisionsHoldUntilInvalidated) {
+    EXPECT_TRUE(isCGI("/cgi-bin/hello.py"));
+    EXPECT_FALSE(isCGI("/cgi-bin/new.py"));
+
+    fs::permissions(root / "hello.py", fs::perms::owner_read);
+    write("new.py", fs::perms::owner_all);
+    EXPECT_TRUE(isCGI("/cgi-bin/hello.py"));
+    EXPECT_FALSE(isCGI("/cgi-bin/new.py"));
+
+    cache.invalidate(root);
+    EXPECT_FALSE(isCGI("/cgi-bin/hello.py"));
+    EXPECT_TRUE(isCGI("/cgi-bin/new.py"));
+}
+
+TEST_F(IsCgiTest, UnwatchedDecisionsExpire) {
+    cache.configure(16, std::chrono::seconds(0), false);
+    EXPECT_TRUE(isCGI("/cgi-bin/hello.py"));
+
+    fs::permissions(root / "hello.py", fs::perms::owner_read);
+    EXPECT_FALSE(isCGI("/cgi-bin/hello.py"));
+}
+
+TEST_F(IsCgiTest, DisabledCacheChecksEveryTime) {
+    cache.configure(0, std::chrono::seconds(60), true);
+    EXPECT_TRUE(isCGI("/cgi-bin/hello.py"));
+
+    fs::permissions(root / "hello.py", fs::perms::owner_read);
+    EXPECT_FALSE(isCGI("/cgi-bin/hello.py"));
+}
@@ -0,0 +1,163 @@
+#include <gtest/gtest.h>
+#include <fstream>
+#include <poll.h>
+#include <signal.h>
+#include <string>
+#include "CgiWorkerPool.hpp"
+
+class CgiWorkerPoolTest : public ::testing::Test {
+protected:
+    Location location;
+    std::string script;
+
+    void SetUp() override {
+        script = ::testing::TempDir() + "/worker_echo.py";
+        std::ofstream(script) <<
+            "import os, sys\n"
+            "body = sys.stdin.read()\n"
+            "print('Content-Type: text/plain')\n"
+            "print()\n"
+            "print(os.environ.get('REQUEST_METHOD'), len(body), body[:8], os.getpid())\n";
+
+        location.cgiWorkersMin = 1;
+        location.cgiWorkersMax = 1;
+        location.cgiWorkerRequests = 100;
+        location.cgiWorkerTimeout = std::chrono::seconds(30);
+    }
+
+    // Drives one request through `worker` like the event loop does, returns the script output
+    std::string run(CgiWorkerPool& pool, CgiWorkerPool::Worker& worker, const std::string& method, const std::string& body = "") {
+        http::Request request;
+        request.setMethod(method);
+        request.appendBody(reinterpret_cast<const std::uint8_t*>(body.data()), body.size());
+
+        http::Response response(-1);
+        response.setBody(std::make_unique<utils::CgiPayload>());
+
+        if (!pool.send(worker, request, script)) {
+            return "send failed";
+        }
+
+        for (int i = 0; i < 5000 && worker.state == CgiWorkerPool::State::BUSY; i++) {
+            struct pollfd pfd { worker.fd, static_cast<short>(POLLIN | (worker.hasOutput() ? POLLOUT : 0)), 0 };
+
+            if (::poll(&pfd, 1, 1) <= 0) {
+                continue;
+            }
+
+            if (pfd.revents & POLLOUT) {
+                pool.flush(worker);
+            }
+
+            pool.receive(worker, pfd.revents, response);
+        }
+
+        return response.getBody()->toString();
+    }
+
+    // The pid the script printed last
+    static std::string pidOf(const std::string& output) {
+        return output.substr(output.find_last_of(' ') + 1);
+    }
+};
+
+TEST_F(CgiWorkerPoolTest, RunsRequestsInOneInterpreter) {
+    CgiWorkerPool pool(location);
+    pool.start();
+
+    CgiWorkerPool::Worker* worker = pool.acquire();
+    ASSERT_NE(worker, nullptr);
+
+    const std::string first = run(pool, *worker, "GET");
+    EXPECT_TRUE(first.starts_with("Content-Type: text/plain\n\nGET 0 ")) << first;
+    EXPECT_EQ(worker->state, CgiWorkerPool::State::DONE);
+
+    pool.update();
+    EXPECT_EQ(worker->state, CgiWorkerPool::State::IDLE);
+    ASSERT_EQ(pool.acquire(), worker);
+
+    const std::string second = run(pool, *worker, "POST", "name=value");
+    EXPECT_NE(second.find("POST 10 name=val"), std::string::npos) << second;
+    EXPECT_EQ(pidOf(second), pidOf(first));
+    pool.shutdown();
+}
+
+// Much more than the socket buffer takes, the rest goes out as the worker reads
+TEST_F(CgiWorkerPoolTest, StreamsLargeBody) {
+    CgiWorkerPool pool(location);
+    pool.start();
+
+    CgiWorkerPool::Worker* worker = pool.acquire();
+    ASSERT_NE(worker, nullptr);
+
+    const std::string body(4 * 1024 * 1024, 'b');
+    const std::string output = run(pool, *worker, "POST", body);
+
+    EXPECT_NE(output.find("POST 4194304 bbbbbbbb"), std::string::npos) << output.substr(0, 200);
+    pool.shutdown();
+}
+
+TEST_F(CgiWorkerPoolTest, BusyPoolHandsOutNothing) {
+    CgiWorkerPool pool(location);
+    pool.start();
+
+    ASSERT_NE(pool.acquire(), nullptr);
+    EXPECT_EQ(pool.acquire(), nullptr);
+    pool.shutdown();
+}
+
+TEST_F(CgiWorkerPoolTest, ReplacesSpentWorker) {
+    location.cgiWorkerRequests = 1;
+    CgiWorkerPool pool(location);
+    pool.start();
+
+    CgiWorkerPool::Worker* worker = pool.acquire();
+    ASSERT_NE(worker, nullptr);
+    const std::string first = run(pool, *worker, "GET");
+
+    pool.update();
+    worker = pool.acquire();
+    ASSERT_NE(worker, nullptr);
+    EXPECT_NE(pidOf(run(pool, *worker, "GET")), pidOf(first));
+    pool.shutdown();
+}
+
+TEST_F(CgiWorkerPoolTest, DeadWorkersFailAndAreReplaced) {
+    CgiWorkerPool pool(location);
+    pool.start();
+
+    CgiWorkerPool::Worker* worker = pool.acquire();
+    ASSERT_NE(worker, nullptr);
+    ::kill(worker->pid, SIGKILL);
+
+    // The loop sees the hang-up of a busy worker
+    http::Response response(-1);
+    struct pollfd pfd { worker->fd, POLLIN, 0 };
+    ASSERT_EQ(::poll(&pfd, 1, 5000), 1);
+    pool.receive(*worker, pfd.revents, response);
+    EXPECT_EQ(worker->state, CgiWorkerPool::State::FAILED);
+
+    pool.update();
+    worker = pool.acquire();
+    ASSERT_NE(worker, nullptr);
+    EXPECT_NE(run(pool, *worker, "GET").find("GET 0"), std::string::npos);
+
+    // An idle worker that died is found out when it is acquired
+    pool.update();
+    ::kill(worker->pid, SIGKILL);
+    ::usleep(100000);
+    EXPECT_EQ(pool.acquire(), nullptr);
+    EXPECT_EQ(worker->state, CgiWorkerPool::State::FAILED);
+    pool.shutdown();
+}
+
+TEST_F(CgiWorkerPoolTest, LongRequestsTimeOut) {
+    location.cgiWorkerTimeout = std::chrono::seconds(0);
+    CgiWorkerPool pool(location);
+    pool.start();
+
+    CgiWorkerPool::Worker* worker = pool.acquire();
+    ASSERT_NE(worker, nullptr);
+    EXPECT_TRUE(pool.isTimedOut(*worker, std::chrono::steady_clock::now()));
+    pool.shutdown();
+}
@@ -0,0 +1,91 @@
+#include <gtest/gtest.h>
+#include <string>
+#include "http/index.hpp"
+
+namespace {
+    const std::string TAG = "\"1a-2b-3c\"";
+    constexpr std::time_t MODIFIED = 784111777; // Sun, 06 Nov 1994 08:49:37 GMT
+
+    http::Request get() {
+        http::Request req;
+        req.setMethod("GET");
+        return req;
+    }
+}
+
+TEST(ConditionalTest, HttpDateRoundTrip) {
+    EXPECT_EQ(http::formatHttpDate(MODIFIED), "Sun, 06 Nov 1994 08:49:37 GMT");
+    EXPECT_EQ(http::parseHttpDate("Sun, 06 Nov 1994 08:49:37 GMT"), MODIFIED);
+    EXPECT_EQ(http::parseHttpDate("Sunday, 06-Nov-94 08:49:37 GMT"), std::nullopt);
+    EXPECT_EQ(http::parseHttpDate("Sun, 06 Nov 1994 08:49:37 GMT trailing"), std::nullopt);
+}
+
+TEST(ConditionalTest, EntityTagFollowsTheFile) {
+    const struct timespec mtime { 100, 5 };
+    const struct timespec touched { 100, 6 };
+    const std::string tag = http::entityTagOf(7, 42, mtime);
+
+    EXPECT_TRUE(tag.starts_with('"') && tag.ends_with('"'));
+    EXPECT_EQ(http::entityTagOf(7, 42, mtime), tag);
+    EXPECT_NE(http::entityTagOf(8, 42, mtime), tag);
+    EXPECT_NE(http::entityTagOf(7, 43, mtime), tag);
+    EXPECT_NE(http::entityTagOf(7, 42, touched), tag);
+}
+
+TEST(ConditionalTest, IfNoneMatch) {
+    auto req = get();
+
+    req.setHeader(http::Header::IF_NONE_MATCH, TAG);
+    EXPECT_TRUE(req.isNotModified(TAG, MODIFIED));
+
+    req.setHeader(http::Header::IF_NONE_MATCH, "\"other\", W/" + TAG);
+    EXPECT_TRUE(req.isNotModified(TAG, MODIFIED));
+
+    req.setHeader(http::Header::IF_NONE_MATCH, "*");
+    EXPECT_TRUE(req.isNotModified(TAG, MODIFIED));
+
+    req.setHeader(http::Header::IF_NONE_MATCH, "\"other\"");
+    EXPECT_FALSE(req.isNotModified(TAG, MODIFIED));
+
+    // If-None-Match takes precedence over If-Modified-Since
+    req.setHeader(http::Header::IF_MODIFIED_SINCE, http::formatHttpDate(MODIFIED));
+    EXPECT_FALSE(req.isNotModified(TAG, MODIFIED));
+}
+
+TEST(ConditionalTest, IfModifiedSince) {
+    auto req = get();
+
+    req.setHeader(http::Header::IF_MODIFIED_SINCE, http::formatHttpDate(MODIFIED));
+    EXPECT_TRUE(req.isNotModified(TAG, MODIFIED));
+    EXPECT_TRUE(req.isNotModified(TAG, MODIFIED - 1));
+    EXPECT_FALSE(req.isNotModified(TAG, MODIFIED + 1));
+
+    req.setHeader(http::Header::IF_MODIFIED_SINCE, "yesterday");
+    EXPECT_FALSE(req.isNotModified(TAG, MODIFIED));
+}
+
+TEST(ConditionalTest, OnlyGetAndHead) {
+    auto req = get();
+    req.setHeader(http::Header::IF_NONE_MATCH, TAG);
+
+    req.setMethod("HEAD");
+    EXPECT_TRUE(req.isNotModified(TAG, MODIFIED));
+
+    req.setMethod("POST");
+    EXPECT_FALSE(req.isNotModified(TAG, MODIFIED));
+}
+
+TEST(ConditionalTest, NotModifiedResponseHasNoBody) {
+    http::Response res(-1);
+    res.setText(http::StatusCode::OK_200, "body");
+    res.setNotModified(TAG, MODIFIED);
+
+    const std::string header = res.getHeader().toString();
+
+    EXPECT_TRUE(header.starts_with("HTTP/1.1 304 "));
+    EXPECT_NE(header.find("ETag: " + TAG + "\r\n"), std::string::npos);
+    EXPECT_NE(header.find("Last-Modified: Sun, 06 Nov 1994 08:49:37 GMT\r\n"), std::string::npos);
+    EXPECT_EQ(header.find("Content-Length"), std::string::npos);
+    EXPECT_EQ(header.find("Content-Type"), std::string::npos);
+    EXPECT_EQ(res.getBody(), nullptr);
+}
@@ -37,37 +37,44 @@ TEST_F(ConfigParserTest, ParseHost) {
 TEST_F(ConfigParserTest, ParsePort) {
     // Valid cases
     EXPECT_NO_THROW(parser.parseGlobal("port 8080", server));
-    EXPECT_EQ(server.port, 8080);
+    EXPECT_EQ(server.ports, std::vector<int>{ 8080 });
 
     // Invalid cases
     EXPECT_THROW(parser.parseGlobal("host invalid_port", server), ConfigError);
     EXPECT_THROW(parser.parseGlobal("port ", server), ConfigError);
     EXPECT_THROW(parser.parseGlobal("port 8081578", server), ConfigError);
 
-    // Duplicate host
-    EXPECT_THROW(parser.parseGlobal("port 8081", server), ConfigError);
+    // A server may listen on several ports
+    EXPECT_NO_THROW(parser.parseGlobal("port 8081", server));
+    EXPECT_EQ(server.ports, (std::vector<int>{ 8080, 8081 }));
 }
 
-// ServerName is optional so it can be empty
+// ServerName is optional so it can be empty, a server may have several names
 TEST_F(ConfigParserTest, ParseServerName) {
     // Valid cases
     EXPECT_NO_THROW(parser.parseGlobal("server_name localhost", server));
-/*         // Optional server_name (empty value)
-    EXPECT_NO_THROW(parser.parseGlobal("server_name ", server));
-    EXPECT_EQ(server.serverName, ""); */
-
-    // Duplicate server name
-    EXPECT_THROW(parser.parseGlobal("server_name localhost", server), ConfigError);
+    EXPECT_NO_THROW(parser.parseGlobal("server_name example.com *.example.com www.example.* .example.org", server));
+    EXPECT_EQ(server.serverNames, (std::vector<std::string> { "localhost", "example.com", "*.example.com", "www.example.*", ".example.org" }));
+
+    // Wildcards only as a whole first or last label
+    EXPECT_THROW(parser.parseGlobal("server_name *", server), ConfigError);
+    EXPECT_THROW(parser.parseGlobal("server_name www.*.com", server), ConfigError);
+    EXPECT_THROW(parser.parseGlobal("server_name *example.com", server), ConfigError);
+    EXPECT_THROW(parser.parseGlobal("server_name *.example.*", server), ConfigError);
 }
 
+// Error pages are relative to the directory of the config file
 TEST_F(ConfigParserTest, ParseErrorPage) {
+    ConfigParser configured("config/webserv.conf");
+
     // Valid cases
-    EXPECT_NO_THROW(parser.parseGlobal("error_page 404 default/404.html", server));
+    EXPECT_NO_THROW(configured.parseGlobal("error_page 404 default/404.html", server));
+    EXPECT_TRUE(server.errorPages[404].ends_with("/config/default/404.html"));
 
     // Invalid cases
-    //EXPECT_THROW(parser.parseGlobal("error_page 404 default//404.html", server), ConfigError);
-    //EXPECT_THROW(parser.parseGlobal("error_page 404 default/505.html", server), ConfigError);
-
+    EXPECT_ANY_THROW(configured.parseGlobal("error_page 404 default/missing.html", server));
+    EXPECT_THROW(configured.parseGlobal("error_page 40 default/404.html", server), ConfigError);
+    EXPECT_THROW(parser.parseGlobal("error_page 404 default/404.html", server), ConfigError);
 }
 
 /* TEST_F(ConfigParserTest, ParseValidClientMaxBodySize) {
@@ -158,24 +165,11 @@ TEST_F(ConfigParserTest, ParseLocationMethods) {
     EXPECT_THROW(parser.parseLocation("methods GET POST", location), ConfigError);
 }
 
+// One extension per directive, with or without the leading dot
 TEST_F(ConfigParserTest, ParseLocationCGIExtension) {
-    // Valid cases
     EXPECT_NO_THROW(parser.parseLocation("cgi_extension .php", location));
-
-    // Invalid cases
-    EXPECT_THROW(parser.parseLocation("cgi_extension .php", location), ConfigError);
-
-    EXPECT_THROW(parser.parseLocation("cgi_extension .php", location), ConfigError);
-}
-
-TEST_F(ConfigParserTest, ParseLocationUploadDir) {
-    // Valid cases
-    EXPECT_NO_THROW(parser.parseLocation("upload_dir config/http/static", location));
-
-    // Invalid cases
-    EXPECT_THROW(parser.parseLocation("upload_dir //config/http/static", location), ConfigError);
-
-    EXPECT_THROW(parser.parseLocation("upload_dir config/http/static", location), ConfigError);
+    EXPECT_NO_THROW(parser.parseLocation("cgi_extension py", location));
+    EXPECT_EQ(location.cgiExtension, (std::vector<std::string>{ "php", "py" }));
 }
 
 TEST_F(ConfigParserTest, ParseLocationReturn) {
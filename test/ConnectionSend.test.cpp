@@ -0,0 +1,292 @@
+#include <gtest/gtest.h>
+#include <fcntl.h>
+#include <fstream>
+#include <netinet/in.h>
+#include <poll.h>
+#include <string>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include "http/index.hpp"
+#include "http/ZeroCopyReaper.hpp"
+
+class ConnectionSendTest : public ::testing::Test {
+protected:
+    ServerConfig config;
+    int fds[2] { -1, -1 };
+
+    void SetUp() override {
+        config.zeroCopyMinSize = 0;
+        ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds), 0);
+    }
+
+    void TearDown() override {
+        ::close(fds[1]);
+    }
+
+    void request(const std::string& data) {
+        ASSERT_EQ(::write(fds[1], data.data(), data.size()), static_cast<ssize_t>(data.size()));
+    }
+
+    std::string receive() {
+        std::string received;
+        char buffer[65536];
+
+        for (ssize_t bytes; (bytes = ::read(fds[1], buffer, sizeof(buffer))) > 0;) {
+            received.append(buffer, static_cast<std::size_t>(bytes));
+        }
+        return received;
+    }
+};
+
+TEST(ResponseWriteTest, PeekChainsHeaderAndBody) {
+    http::Response res(-1);
+    res.setText(http::StatusCode::OK_200, "hello");
+
+    const std::string header = res.getHeader().toString();
+    struct iovec iov[4];
+
+    ASSERT_EQ(res.peek(iov, 4), 2u);
+    EXPECT_EQ(std::string(static_cast<char*>(iov[0].iov_base), iov[0].iov_len), header);
+    EXPECT_EQ(std::string(static_cast<char*>(iov[1].iov_base), iov[1].iov_len), "hello");
+    EXPECT_TRUE(res.isBuffered());
+
+    // A short write that ends inside the body
+    EXPECT_EQ(res.commit(header.size() + 2), header.size() + 2);
+    ASSERT_EQ(res.peek(iov, 4), 1u);
+    EXPECT_EQ(std::string(static_cast<char*>(iov[0].iov_base), iov[0].iov_len), "llo");
+
+    EXPECT_EQ(res.commit(100), 3u);
+    EXPECT_TRUE(res.isSent());
+    EXPECT_EQ(res.peek(iov, 4), 0u);
+}
+
+TEST_F(ConnectionSendTest, WritesHeaderAndBodyTogether) {
+    http::Connection con(fds[0], config);
+
+    request("GET /a HTTP/1.1\r\nHost: localhost\r\n\r\n");
+    con.read();
+    con.handleRequests([](http::Request&, http::Response& res) {
+        res.setText(http::StatusCode::OK_200, "body of a");
+    });
+
+    EXPECT_TRUE(con.sendResponse());
+
+    const std::string response = receive();
+    EXPECT_TRUE(response.starts_with("HTTP/1.1 200 "));
+    EXPECT_TRUE(response.ends_with("\r\n\r\nbody of a"));
+    EXPECT_FALSE(con.isClosed());
+    con.close();
+}
+
+TEST_F(ConnectionSendTest, FlushesPipelinedResponsesInOrder) {
+    http::Connection con(fds[0], config);
+
+    request(
+        "GET /1 HTTP/1.1\r\nHost: localhost\r\n\r\n"
+        "GET /2 HTTP/1.1\r\nHost: localhost\r\n\r\n"
+        "GET /3 HTTP/1.1\r\nHost: localhost\r\n\r\n"
+    );
+    con.read();
+
+    // The second response is ready before the first, nothing may go out yet
+    con.handleRequests([](http::Request& req, http::Response& res) {
+        if (req.getUrl().path == "/2") {
+            res.setText(http::StatusCode::OK_200, "two");
+        }
+    });
+    EXPECT_FALSE(con.hasReadyResponse());
+    EXPECT_TRUE(con.sendResponse());
+    EXPECT_EQ(receive(), "");
+
+    con.handleRequests([](http::Request& req, http::Response& res) {
+        res.setText(http::StatusCode::OK_200, req.getUrl().path == "/1" ? "one" : "three");
+    });
+    EXPECT_TRUE(con.sendResponse());
+
+    const std::string responses = receive();
+    const std::size_t one = responses.find("\r\n\r\none");
+    const std::size_t two = responses.find("\r\n\r\ntwo");
+    const std::size_t three = responses.find("\r\n\r\nthree");
+
+    ASSERT_NE(one, std::string::npos);
+    ASSERT_NE(two, std::string::npos);
+    ASSERT_NE(three, std::string::npos);
+    EXPECT_LT(one, two);
+    EXPECT_LT(two, three);
+    EXPECT_FALSE(con.hasReadyResponse());
+    con.close();
+}
+
+TEST_F(ConnectionSendTest, StopsAfterResponseClosingConnection) {
+    http::Connection con(fds[0], config);
+
+    request(
+        "GET /1 HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n"
+        "GET /2 HTTP/1.1\r\nHost: localhost\r\n\r\n"
+    );
+    con.read();
+    con.handleRequests([](http::Request& req, http::Response& res) {
+        res.setText(http::StatusCode::OK_200, req.getUrl().path == "/1" ? "first" : "second");
+    });
+    con.sendResponse();
+
+    const std::string responses = receive();
+    EXPECT_TRUE(responses.ends_with("\r\n\r\nfirst"));
+    EXPECT_EQ(responses.find("second"), std::string::npos);
+    EXPECT_TRUE(con.isClosed());
+}
+
+// Only this connection goes away, the loop keeps serving the others
+TEST_F(ConnectionSendTest, TruncatedFileClosesConnection) {
+    const std::string path = ::testing::TempDir() + "/connection_truncated";
+    std::ofstream(path) << std::string(300000, 'f');
+
+    http::Connection con(fds[0], config);
+    request("GET /a HTTP/1.1\r\nHost: localhost\r\n\r\n");
+    con.read();
+    con.handleRequests([&path](http::Request&, http::Response& res) {
+        res.setFile(http::StatusCode::OK_200, path);
+    });
+
+    ASSERT_EQ(::truncate(path.c_str(), 1000), 0);
+
+    for (int i = 0; i < 10 && !con.isClosed(); i++) {
+        EXPECT_NO_THROW(con.sendResponse());
+        receive();
+    }
+
+    EXPECT_TRUE(con.isClosed());
+}
+
+TEST(ZeroCopyReaperTest, ReleasesCompletedPinsAcrossWraparound) {
+    http::ZeroCopyReaper::Pins pins;
+    for (const std::uint32_t seq : { 0xfffffffeu, 0xffffffffu, 0u, 1u }) {
+        pins.emplace_back(seq, std::make_shared<utils::StringPayload>("pinned"));
+    }
+
+    http::ZeroCopyReaper::releaseCompleted(pins, 0xffffffffu);
+    ASSERT_EQ(pins.size(), 3u);
+    EXPECT_EQ(pins.front().first, 0xffffffffu);
+
+    http::ZeroCopyReaper::releaseCompleted(pins, 1);
+    ASSERT_EQ(pins.size(), 1u);
+    EXPECT_EQ(pins.front().first, 1u);
+}
+
+// MSG_ZEROCOPY needs a TCP socket, the loopback peer stands in for the client
+class ZeroCopyTest : public ::testing::Test {
+protected:
+    ServerConfig config;
+    int serverFd { -1 };
+    int clientFd { -1 };
+
+    void SetUp() override {
+        config.zeroCopyMinSize = 1024;
+
+        const int listenFd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        struct sockaddr_in address {};
+        socklen_t length = sizeof(address);
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+        ASSERT_EQ(::bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)), 0);
+        ASSERT_EQ(::listen(listenFd, 1), 0);
+        ASSERT_EQ(::getsockname(listenFd, reinterpret_cast<sockaddr*>(&address), &length), 0);
+
+        clientFd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        ASSERT_EQ(::connect(clientFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)), 0);
+        serverFd = ::accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        ::close(listenFd);
+        ASSERT_NE(serverFd, -1);
+
+        const std::string data = "GET /big HTTP/1.1\r\nHost: localhost\r\n\r\n";
+        ASSERT_EQ(::write(clientFd, data.data(), data.size()), static_cast<ssize_t>(data.size()));
+    }
+
+    void TearDown() override {
+        ::close(clientFd);
+    }
+
+    // Reads up to `size` bytes, waiting at most `ms` for each read
+    std::string receive(std::size_t size, int ms = 1000) {
+        std::string received;
+        char buffer[65536];
+        struct pollfd pfd { clientFd, POLLIN, 0 };
+
+        while (received.size() < size && ::poll(&pfd, 1, ms) == 1) {
+            const ssize_t bytes = ::read(clientFd, buffer, std::min(sizeof(buffer), size - received.size()));
+            if (bytes <= 0) {
+                break;
+            }
+            received.append(buffer, static_cast<std::size_t>(bytes));
+        }
+        return received;
+    }
+
+    void answer(http::Connection& con, const std::string& body) {
+        for (int i = 0; i < 100 && !con.hasReadyResponse(); i++) {
+            ::usleep(1000);
+            con.read();
+            con.handleRequests([&body](http::Request&, http::Response& res) {
+                res.setText(http::StatusCode::OK_200, body);
+            });
+        }
+    }
+};
+
+TEST_F(ZeroCopyTest, SendsBodyFromItsPages) {
+    const std::string body(256 * 1024, 'z');
+    http::Connection con(serverFd, config);
+    answer(con, body);
+    ASSERT_TRUE(con.hasReadyResponse());
+
+    std::string received;
+    for (int i = 0; i < 1000 && con.hasReadyResponse(); i++) {
+        con.sendResponse();
+        received += receive(body.size(), 10);
+    }
+    received += receive(body.size() + 1024 - received.size(), 100);
+
+    const std::size_t headerEnd = received.find("\r\n\r\n");
+    ASSERT_NE(headerEnd, std::string::npos);
+    EXPECT_EQ(received.size() - headerEnd - 4, body.size());
+    EXPECT_TRUE(received.substr(headerEnd + 4) == body);
+
+    // The completions arrive on the error queue
+    bool hasCompletion = false;
+    for (int i = 0; i < 100 && !hasCompletion; i++) {
+        hasCompletion = con.readErrorQueue();
+        ::usleep(1000);
+    }
+    EXPECT_TRUE(hasCompletion);
+    con.close();
+}
+
+TEST_F(ZeroCopyTest, CloseKeepsPinnedBodiesUntilCompleted) {
+    const std::string body(4 * 1024 * 1024, 'p');
+    http::Connection con(serverFd, config);
+    answer(con, body);
+    ASSERT_TRUE(con.hasReadyResponse());
+
+    // The peer does not read yet, so part of the body is still in flight when the connection closes
+    for (int i = 0; i < 10; i++) {
+        con.sendResponse();
+    }
+    con.close();
+
+    EXPECT_TRUE(con.isClosed());
+    EXPECT_NE(::fcntl(serverFd, F_GETFD), -1);
+
+    // What was queued still reaches the peer, then the reaper closes the socket
+    const std::string received = receive(body.size() * 2, 200);
+    const std::size_t headerEnd = received.find("\r\n\r\n");
+    ASSERT_NE(headerEnd, std::string::npos);
+    EXPECT_TRUE(received.substr(headerEnd + 4) == body.substr(0, received.size() - headerEnd - 4));
+
+    for (int i = 0; i < 500 && ::fcntl(serverFd, F_GETFD) != -1; i++) {
+        http::ZeroCopyReaper::instance().collect();
+        ::usleep(10000);
+    }
+    EXPECT_EQ(::fcntl(serverFd, F_GETFD), -1);
+}
@@ -0,0 +1,137 @@
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <string>
+#include "TempTree.hpp"
+#include "http/DirectoryListing.hpp"
+
+namespace fs = std::filesystem;
+using http::DirectoryListing;
+
+namespace {
+    std::string render(std::shared_ptr<const DirectoryListing::Entries> entries, const std::string& query, std::size_t pageSize) {
+        http::DirectoryListingPayload payload(entries, "/files/", DirectoryListing::pageOf(query, pageSize));
+        std::string html;
+        std::uint8_t buffer[4096];
+
+        for (std::size_t bytes; (bytes = payload.read(buffer, sizeof(buffer))) > 0;) {
+            html.append(reinterpret_cast<char*>(buffer), bytes);
+        }
+        return html;
+    }
+}
+
+TEST(DirectoryListingPageTest, ParsesQuery) {
+    auto page = DirectoryListing::pageOf("", 50);
+    EXPECT_EQ(page.key, DirectoryListing::SortKey::NAME);
+    EXPECT_FALSE(page.isDescending);
+    EXPECT_EQ(page.number, 1u);
+    EXPECT_EQ(page.size, 50u);
+
+    page = DirectoryListing::pageOf("sort=size&order=desc&page=3", 50);
+    EXPECT_EQ(page.key, DirectoryListing::SortKey::SIZE);
+    EXPECT_TRUE(page.isDescending);
+    EXPECT_EQ(page.number, 3u);
+
+    // Unknown values keep the defaults
+    page = DirectoryListing::pageOf("sort=owner&page=-1&page=0&extra", 0);
+    EXPECT_EQ(page.key, DirectoryListing::SortKey::NAME);
+    EXPECT_EQ(page.number, 1u);
+    EXPECT_EQ(page.size, 1u);
+}
+
+class DirectoryListingTest : public ::testing::Test {
+protected:
+    TempTree tree { "listing", { "dir" } };
+    const fs::path& root = tree.root;
+
+    void SetUp() override {
+        tree.write("c.txt", std::string(30, 'c'));
+        tree.write("a.txt", std::string(10, 'a'));
+        tree.write("b.txt", std::string(20, 'b'));
+        tree.write("e.txt", std::string(5, 'e'));
+        tree.write(".hidden", "");
+        DirectoryListing::instance().clear();
+    }
+
+    void TearDown() override {
+        DirectoryListing::instance().clear();
+    }
+};
+
+TEST_F(DirectoryListingTest, ReadsSortedEntriesOnce) {
+    auto entries = DirectoryListing::instance().get(root);
+    ASSERT_NE(entries, nullptr);
+
+    std::vector<std::string> names;
+    for (const auto& item : entries->items) {
+        names.push_back(item.name);
+    }
+    EXPECT_EQ(names, (std::vector<std::string> { "a.txt", "b.txt", "c.txt", "dir", "e.txt" }));
+    EXPECT_TRUE(entries->items[3].isDirectory);
+
+    EXPECT_EQ(DirectoryListing::instance().get(root), entries);
+    EXPECT_EQ(DirectoryListing::instance().get(root / "a.txt"), nullptr);
+}
+
+TEST_F(DirectoryListingTest, RereadsChangedDirectory) {
+    auto entries = DirectoryListing::instance().get(root);
+
+    // Make sure the directory mtime moves even on a coarse clock
+    tree.write("f.txt", "f");
+    fs::last_write_time(root, fs::last_write_time(root) + std::chrono::seconds(1));
+
+    auto fresh = DirectoryListing::instance().get(root);
+    ASSERT_NE(fresh, entries);
+    EXPECT_EQ(fresh->items.size(), entries->items.size() + 1);
+}
+
+TEST_F(DirectoryListingTest, SortsBySizeBothWays) {
+    auto entries = DirectoryListing::instance().get(root);
+
+    // Directory sizes depend on the filesystem, only the files are compared
+    auto filesBySize = [&entries](bool isDescending) {
+        std::vector<std::string> names;
+        for (std::size_t i = 0; i < entries->items.size(); i++) {
+            const auto& item = entries->at(DirectoryListing::SortKey::SIZE, isDescending, i);
+            if (!item.isDirectory) {
+                names.push_back(item.name);
+            }
+        }
+        return names;
+    };
+
+    EXPECT_EQ(filesBySize(false), (std::vector<std::string> { "e.txt", "a.txt", "b.txt", "c.txt" }));
+    EXPECT_EQ(filesBySize(true), (std::vector<std::string> { "c.txt", "b.txt", "a.txt", "e.txt" }));
+}
+
+TEST_F(DirectoryListingTest, RendersOnePage) {
+    auto entries = DirectoryListing::instance().get(root);
+    const std::string html = render(entries, "page=2", 2);
+
+    EXPECT_NE(html.find("<title>Index of /files/</title>"), std::string::npos);
+    EXPECT_NE(html.find("href=\"c.txt\""), std::string::npos);
+    EXPECT_NE(html.find("href=\"dir/\">dir/</a>"), std::string::npos);
+    EXPECT_EQ(html.find("href=\"a.txt\""), std::string::npos);
+    EXPECT_EQ(html.find("href=\"e.txt\""), std::string::npos);
+    EXPECT_NE(html.find("?sort=name&amp;order=asc&amp;page=1\">Previous</a> Page 2 of 3 <a href=\"?sort=name&amp;order=asc&amp;page=3\">Next"), std::string::npos);
+    EXPECT_TRUE(html.ends_with("</body></html>\n"));
+}
+
+TEST_F(DirectoryListingTest, ClampsPageNumber) {
+    auto entries = DirectoryListing::instance().get(root);
+    const std::string html = render(entries, "page=99", 2);
+
+    EXPECT_NE(html.find("href=\"e.txt\""), std::string::npos);
+    EXPECT_NE(html.find("Page 3 of 3</p>"), std::string::npos);
+    EXPECT_EQ(html.find(">Next</a>"), std::string::npos);
+}
+
+TEST_F(DirectoryListingTest, EscapesNames) {
+    tree.write("<b>&x y.txt", "");
+    fs::last_write_time(root, fs::last_write_time(root) + std::chrono::seconds(1));
+
+    const std::string html = render(DirectoryListing::instance().get(root), "", 100);
+
+    EXPECT_NE(html.find("href=\"%3Cb%3E%26x%20y.txt\">&lt;b&gt;&amp;x y.txt</a>"), std::string::npos);
+    EXPECT_EQ(html.find("Page "), std::string::npos);
+}
@@ -0,0 +1,341 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <poll.h>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include "FastCgiUpstream.hpp"
+
+namespace {
+    constexpr std::uint8_t BEGIN_REQUEST = 1;
+    constexpr std::uint8_t ABORT_REQUEST = 2;
+    constexpr std::uint8_t END_REQUEST = 3;
+    constexpr std::uint8_t STDIN = 5;
+    constexpr std::uint8_t STDOUT = 6;
+    constexpr std::uint8_t GET_VALUES = 9;
+    constexpr std::uint8_t GET_VALUES_RESULT = 10;
+
+    bool readExactly(int fd, std::uint8_t* data, std::size_t size) {
+        while (size > 0) {
+            const ssize_t bytes = ::read(fd, data, size);
+            if (bytes <= 0) {
+                return false;
+            }
+            data += bytes;
+            size -= static_cast<std::size_t>(bytes);
+        }
+        return true;
+    }
+
+    void writeRecord(int fd, std::uint8_t type, std::uint16_t id, const std::string& content) {
+        std::string record {
+            1, static_cast<char>(type), static_cast<char>(id >> 8), static_cast<char>(id),
+            static_cast<char>(content.size() >> 8), static_cast<char>(content.size()), 0, 0
+        };
+        record += content;
+        (void)!::send(fd, record.data(), record.size(), MSG_NOSIGNAL);
+    }
+}
+
+/**
+ * A FastCGI application on a unix socket, served by its own thread one
+ * connection at a time. It answers a request once its stdin ended and
+ * `holdUntil` requests are waiting, the last one first, and records what
+ * the server sent.
+ */
+class FakeApplication {
+    public:
+        struct Options {
+            bool isMultiplexed { true };
+            std::size_t holdUntil { 1 };
+            bool isClosingMidResponse { false };
+        };
+
+        const std::string path;
+
+        FakeApplication(const std::string& socketPath, Options options) : path(socketPath), _options(options) {
+            struct sockaddr_un address {};
+            address.sun_family = AF_UNIX;
+            path.copy(address.sun_path, sizeof(address.sun_path) - 1);
+
+            ::unlink(path.c_str());
+            _listenFd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            if (::bind(_listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0 && ::listen(_listenFd, 8) == 0) {
+                _thread = std::thread(&FakeApplication::_serve, this);
+            }
+        }
+
+        ~FakeApplication() {
+            ::shutdown(_listenFd, SHUT_RDWR);
+            ::shutdown(_connectionFd.load(), SHUT_RDWR);
+            if (_thread.joinable()) {
+                _thread.join();
+            }
+            ::close(_listenFd);
+            ::unlink(path.c_str());
+        }
+
+        bool isListening() const {
+            return _thread.joinable();
+        }
+
+        std::vector<std::uint16_t> aborted() {
+            std::lock_guard lock(_mutex);
+            return _aborted;
+        }
+
+        std::size_t maxInFlight() {
+            std::lock_guard lock(_mutex);
+            return _maxInFlight;
+        }
+
+    private:
+        struct Pending {
+            std::size_t stdinBytes { 0 };
+            std::size_t stdinRecords { 0 };
+        };
+
+        Options _options;
+        int _listenFd { -1 };
+        std::atomic<int> _connectionFd { -1 };
+        std::thread _thread;
+        std::mutex _mutex;
+        std::vector<std::uint16_t> _aborted;
+        std::size_t _maxInFlight { 0 };
+
+        void _serve() {
+            for (int fd; (fd = ::accept4(_listenFd, nullptr, nullptr, SOCK_CLOEXEC)) != -1;) {
+                _connectionFd = fd;
+                _talk(fd);
+                _connectionFd = -1;
+                ::close(fd);
+            }
+        }
+
+        void _talk(int fd) {
+            std::map<std::uint16_t, Pending> requests;
+            std::vector<std::uint16_t> ready;
+            std::uint8_t header[8];
+            std::vector<std::uint8_t> content;
+
+            while (readExactly(fd, header, sizeof(header))) {
+                const std::uint8_t type = header[1];
+                const std::uint16_t id = static_cast<std::uint16_t>((header[2] << 8) | header[3]);
+                content.resize(((header[4] << 8) | header[5]) + header[6]);
+
+                if (!readExactly(fd, content.data(), content.size())) {
+                    return;
+                }
+
+                const std::size_t size = content.size() - header[6];
+
+                if (type == GET_VALUES) {
+                    writeRecord(fd, GET_VALUES_RESULT, 0, std::string("\x0f\x01" "FCGI_MPXS_CONNS") + (_options.isMultiplexed ? "1" : "0"));
+                } else if (type == BEGIN_REQUEST) {
+                    requests[id] = {};
+                    std::lock_guard lock(_mutex);
+                    _maxInFlight = std::max(_maxInFlight, requests.size());
+                } else if (type == ABORT_REQUEST) {
+                    {
+                        std::lock_guard lock(_mutex);
+                        _aborted.push_back(id);
+                    }
+                    requests.erase(id);
+                    std::erase(ready, id);
+                    writeRecord(fd, END_REQUEST, id, std::string(8, '\0'));
+                } else if (type == STDIN && size > 0) {
+                    requests[id].stdinBytes += size;
+                    requests[id].stdinRecords++;
+                } else if (type == STDIN) {
+                    ready.push_back(id);
+                }
+
+                if (_options.isClosingMidResponse && !ready.empty()) {
+                    writeRecord(fd, STDOUT, ready.front(), "Content-Type: text/plain\r\n\r\npart");
+                    return;
+                }
+
+                if (ready.size() < _options.holdUntil) {
+                    continue;
+                }
+
+                for (auto it = ready.rbegin(); it != ready.rend(); it++) {
+                    const Pending& request = requests[*it];
+                    writeRecord(fd, STDOUT, *it, "Content-Type: text/plain\r\n\r\n");
+                    writeRecord(fd, STDOUT, *it, "id=" + std::to_string(*it) + " stdin=" + std::to_string(request.stdinBytes)
+                        + " records=" + std::to_string(request.stdinRecords));
+                    writeRecord(fd, END_REQUEST, *it, std::string(8, '\0'));
+                    requests.erase(*it);
+                }
+                ready.clear();
+            }
+        }
+};
+
+class FastCgiUpstreamTest : public ::testing::Test {
+protected:
+    Location location;
+
+    void SetUp() override {
+        location.fastCgiPass = "unix:" + ::testing::TempDir() + "fastcgi_test.sock";
+        location.fastCgiConnections = 1;
+        location.root = ::testing::TempDir();
+    }
+
+    std::string socketPath() const {
+        return location.fastCgiPass.substr(5);
+    }
+
+    void submit(FastCgiUpstream& upstream, http::Response& response, const std::string& body) {
+        http::Request request;
+        request.setMethod("POST");
+        request.appendBody(reinterpret_cast<const std::uint8_t*>(body.data()), body.size());
+        response.setBody(std::make_unique<utils::CgiPayload>());
+        upstream.submit(request, "/srv/app.php", response, "errors/502.html");
+    }
+
+    // Runs the loop until `count` requests ended and `until` holds, or five seconds passed
+    std::vector<FastCgiUpstream::Exchange> drive(FastCgiUpstream& upstream, std::size_t count, const std::function<bool()>& until = [] { return true; }) {
+        std::vector<FastCgiUpstream::Exchange> finished;
+
+        for (int i = 0; i < 500 && (finished.size() < count || !until()); i++) {
+            std::vector<struct pollfd> pfds;
+            for (const auto& connection : upstream.getConnections()) {
+                if (!connection.isClosed) {
+                    pfds.push_back({ connection.fd, static_cast<short>(POLLIN | (connection.hasOutput() ? POLLOUT : 0)), 0 });
+                }
+            }
+
+            ::poll(pfds.data(), pfds.size(), 10);
+
+            for (const auto& pfd : pfds) {
+                if (pfd.revents != 0) {
+                    upstream.process(pfd.fd, pfd.revents);
+                }
+            }
+
+            upstream.collect();
+
+            for (auto& exchange : upstream.takeFinished()) {
+                finished.push_back(std::move(exchange));
+            }
+        }
+
+        return finished;
+    }
+};
+
+// The application answers the last request first, so all three are in flight on the one connection
+TEST_F(FastCgiUpstreamTest, MultiplexesRequestsOnOneConnection) {
+    FakeApplication application(socketPath(), { .isMultiplexed = true, .holdUntil = 3 });
+    ASSERT_TRUE(application.isListening());
+
+    FastCgiUpstream upstream(location);
+    http::Response responses[3] { http::Response(10), http::Response(11), http::Response(12) };
+    const std::size_t sizes[3] { 0, 100000, 70000 };
+
+    for (std::size_t i = 0; i < 3; i++) {
+        submit(upstream, responses[i], std::string(sizes[i], 'x'));
+    }
+
+    const auto finished = drive(upstream, 3);
+    ASSERT_EQ(finished.size(), 3u);
+    EXPECT_EQ(finished[0].response, &responses[2]);
+    EXPECT_EQ(application.maxInFlight(), 3u);
+    EXPECT_EQ(upstream.getConnections().size(), 1u);
+
+    for (const auto& exchange : finished) {
+        EXPECT_TRUE(exchange.isOk);
+    }
+
+    // A body goes out in 32 KiB stdin records
+    EXPECT_EQ(responses[0].getBody()->toString(), "id=1 stdin=0 records=0");
+    EXPECT_EQ(responses[1].getBody()->toString(), "id=2 stdin=100000 records=4");
+    EXPECT_EQ(responses[2].getBody()->toString(), "id=3 stdin=70000 records=3");
+
+    const auto* payload = dynamic_cast<const utils::CgiPayload*>(responses[1].getBody().get());
+    ASSERT_NE(payload, nullptr);
+    EXPECT_EQ(payload->headerFields().at("Content-Type"), "text/plain");
+    upstream.shutdown();
+}
+
+TEST_F(FastCgiUpstreamTest, OneRequestAtATimeWithoutMultiplexing) {
+    FakeApplication application(socketPath(), { .isMultiplexed = false });
+    ASSERT_TRUE(application.isListening());
+
+    FastCgiUpstream upstream(location);
+    http::Response first(10);
+    http::Response second(11);
+
+    submit(upstream, first, "one");
+    submit(upstream, second, "two");
+
+    const auto finished = drive(upstream, 2);
+    ASSERT_EQ(finished.size(), 2u);
+    EXPECT_EQ(finished[0].response, &first);
+    EXPECT_EQ(finished[1].response, &second);
+    EXPECT_EQ(application.maxInFlight(), 1u);
+    EXPECT_EQ(second.getBody()->toString(), "id=2 stdin=3 records=1");
+    upstream.shutdown();
+}
+
+// The server answers such a request with a 502
+TEST_F(FastCgiUpstreamTest, ApplicationClosingMidResponseFails) {
+    FakeApplication application(socketPath(), { .isClosingMidResponse = true });
+    ASSERT_TRUE(application.isListening());
+
+    FastCgiUpstream upstream(location);
+    http::Response response(10);
+    submit(upstream, response, "body");
+
+    const auto finished = drive(upstream, 1);
+    ASSERT_EQ(finished.size(), 1u);
+    EXPECT_FALSE(finished[0].isOk);
+    EXPECT_EQ(finished[0].errorPage, "errors/502.html");
+    EXPECT_TRUE(upstream.getConnections().empty());
+    upstream.shutdown();
+}
+
+TEST_F(FastCgiUpstreamTest, UnreachableApplicationFails) {
+    FastCgiUpstream upstream(location);
+    http::Response response(10);
+    submit(upstream, response, "");
+
+    const auto finished = drive(upstream, 1);
+    ASSERT_EQ(finished.size(), 1u);
+    EXPECT_FALSE(finished[0].isOk);
+    upstream.shutdown();
+}
+
+TEST_F(FastCgiUpstreamTest, AbandonedRequestIsAborted) {
+    FakeApplication application(socketPath(), {});
+    ASSERT_TRUE(application.isListening());
+
+    FastCgiUpstream upstream(location);
+    http::Response abandoned(10);
+
+    // The client goes away while its body is still being sent
+    submit(upstream, abandoned, std::string(1024 * 1024, 'a'));
+    upstream.abandon(10);
+
+    const auto finished = drive(upstream, 0, [&application] { return !application.aborted().empty(); });
+    EXPECT_TRUE(finished.empty());
+    EXPECT_EQ(application.aborted(), std::vector<std::uint16_t> { 1 });
+    EXPECT_EQ(abandoned.getBody()->toString(), "");
+
+    // The connection carries on with the next request
+    http::Response next(11);
+    submit(upstream, next, "next");
+
+    const auto after = drive(upstream, 1);
+    ASSERT_EQ(after.size(), 1u);
+    EXPECT_TRUE(after[0].isOk);
+    EXPECT_EQ(upstream.getConnections().size(), 1u);
+    upstream.shutdown();
+}
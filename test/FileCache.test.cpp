@@ -0,0 +1,87 @@
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <string>
+#include "TempTree.hpp"
+#include "http/FileCache.hpp"
+
+namespace fs = std::filesystem;
+
+class FileCacheTest : public ::testing::Test {
+protected:
+    http::FileCache& cache = http::FileCache::instance();
+    TempTree tree { "file_cache", { "sub" } };
+    const fs::path& root = tree.root;
+
+    void SetUp() override {
+        cache.configure(3000, 1500);
+    }
+
+    void TearDown() override {
+        cache.configure(0, 0);
+    }
+};
+
+TEST_F(FileCacheTest, LoadsOnceAndServesHits) {
+    const fs::path path = tree.write("index.html", "<p>hello</p>");
+
+    EXPECT_EQ(cache.get(path), nullptr);
+
+    auto entry = cache.load(path);
+    ASSERT_NE(entry, nullptr);
+    EXPECT_EQ(entry->content, "<p>hello</p>");
+    EXPECT_EQ(entry->mimeType, "text/html; charset=utf-8");
+    EXPECT_NE(entry->headerFields.find("Content-Length: 12\r\n"), std::string_view::npos);
+    EXPECT_NE(entry->validatorFields.find(entry->entityTag), std::string_view::npos);
+
+    // A hit does not look at the file again
+    tree.write("index.html", "changed");
+    EXPECT_EQ(cache.get(root / "." / "index.html"), entry);
+}
+
+TEST_F(FileCacheTest, SkipsLargeAndMissingFiles) {
+    EXPECT_EQ(cache.load(tree.write("large.bin", std::string(1501, 'x'))), nullptr);
+    EXPECT_EQ(cache.load(root / "missing.txt"), nullptr);
+    EXPECT_EQ(cache.load(root / "sub"), nullptr);
+    EXPECT_EQ(cache.size(), 0u);
+}
+
+TEST_F(FileCacheTest, EvictsLeastRecentlyUsed) {
+    const fs::path a = tree.write("a.txt", std::string(1000, 'a'));
+    const fs::path b = tree.write("b.txt", std::string(1000, 'b'));
+    const fs::path c = tree.write("c.txt", std::string(1000, 'c'));
+
+    ASSERT_NE(cache.load(a), nullptr);
+    ASSERT_NE(cache.load(b), nullptr);
+    ASSERT_NE(cache.get(a), nullptr);
+    ASSERT_NE(cache.load(c), nullptr);
+
+    EXPECT_NE(cache.get(a), nullptr);
+    EXPECT_EQ(cache.get(b), nullptr);
+    EXPECT_NE(cache.get(c), nullptr);
+    EXPECT_LE(cache.size(), 3000u);
+}
+
+TEST_F(FileCacheTest, InvalidatesFilesAndDirectories) {
+    const fs::path top = tree.write("top.txt", "top");
+    const fs::path one = tree.write("sub/one.txt", "one");
+    const fs::path two = tree.write("sub/two.txt", "two");
+
+    ASSERT_NE(cache.load(top), nullptr);
+    ASSERT_NE(cache.load(one), nullptr);
+    ASSERT_NE(cache.load(two), nullptr);
+
+    cache.invalidate(one);
+    EXPECT_EQ(cache.get(one), nullptr);
+    EXPECT_NE(cache.get(two), nullptr);
+
+    cache.invalidate(root / "sub");
+    EXPECT_EQ(cache.get(two), nullptr);
+    EXPECT_NE(cache.get(top), nullptr);
+}
+
+TEST_F(FileCacheTest, DisabledCacheLoadsNothing) {
+    cache.configure(0, 0);
+
+    EXPECT_FALSE(cache.isEnabled());
+    EXPECT_EQ(cache.load(tree.write("off.txt", "off")), nullptr);
+}
@@ -0,0 +1,59 @@
+#include <gtest/gtest.h>
+#include <ctime>
+#include <string>
+#include "http/index.hpp"
+
+TEST(HeaderSerializerTest, StatusLinesAreFormattedOnce) {
+    const std::string& notFound = http::statusLineOf(http::StatusCode::NOT_FOUND_404);
+
+    EXPECT_EQ(notFound, "HTTP/1.1 404 Not Found\r\n");
+    EXPECT_EQ(&http::statusLineOf(http::StatusCode::NOT_FOUND_404), &notFound);
+    EXPECT_EQ(http::statusLineOf(http::StatusCode::OK_200), "HTTP/1.1 200 OK\r\n");
+}
+
+TEST(HeaderSerializerTest, DateFieldChangesOncePerSecond) {
+    http::updateDateField(784111777);
+    EXPECT_EQ(http::dateField(), "Date: Sun, 06 Nov 1994 08:49:37 GMT\r\n");
+
+    const std::string* field = &http::dateField();
+    http::updateDateField(784111777);
+    EXPECT_EQ(&http::dateField(), field);
+    EXPECT_EQ(http::dateField(), "Date: Sun, 06 Nov 1994 08:49:37 GMT\r\n");
+
+    http::updateDateField(784111778);
+    EXPECT_EQ(http::dateField(), "Date: Sun, 06 Nov 1994 08:49:38 GMT\r\n");
+
+    http::updateDateField(std::time(nullptr));
+}
+
+TEST(HeaderSerializerTest, HeaderLayout) {
+    http::Response res(-1);
+    res.setHeader("X-First", "1");
+    res.setHeader("X-Second", "2");
+    res.setHeader("X-First", "one");
+    res.setText(http::StatusCode::OK_200, "abc");
+
+    const std::string header = res.getHeader().toString();
+
+    EXPECT_TRUE(header.starts_with("HTTP/1.1 200 OK\r\n" + http::dateField()));
+    EXPECT_TRUE(header.ends_with("Content-Length: 3\r\n\r\n"));
+    EXPECT_NE(header.find("X-First: one\r\nX-Second: 2\r\n"), std::string::npos);
+    EXPECT_EQ(header.find("X-First: 1\r\n"), std::string::npos);
+}
+
+TEST(HeaderSerializerTest, ReusesRecycledBuffer) {
+    std::string buffer;
+    buffer.reserve(4096);
+    const char* storage = buffer.data();
+
+    http::Response res(-1);
+    res.reuseHeaderBuffer(std::move(buffer));
+    res.setText(http::StatusCode::OK_200, "reused");
+
+    const std::string header = res.getHeader().toString();
+    const std::string released = res.releaseHeaderBuffer();
+
+    EXPECT_EQ(released, header);
+    EXPECT_EQ(released.data(), storage);
+    EXPECT_GE(released.capacity(), 4096u);
+}
@@ -0,0 +1,79 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "LocationTrie.hpp"
+
+TEST(LocationTrieTest, EmptyTrieFindsNothing) {
+    LocationTrie trie;
+
+    EXPECT_EQ(trie.find(""), LocationTrie::NONE);
+    EXPECT_EQ(trie.find("/index.html"), LocationTrie::NONE);
+}
+
+TEST(LocationTrieTest, FindsLongestPrefix) {
+    LocationTrie trie;
+    trie.insert("/", 0);
+    trie.insert("/static", 1);
+    trie.insert("/static/img/", 2);
+    trie.insert("/api/v1", 3);
+
+    EXPECT_EQ(trie.find("/"), 0u);
+    EXPECT_EQ(trie.find("/index.html"), 0u);
+    EXPECT_EQ(trie.find("/static"), 1u);
+    EXPECT_EQ(trie.find("/static/app.js"), 1u);
+    EXPECT_EQ(trie.find("/static/img"), 1u);
+    EXPECT_EQ(trie.find("/static/img/logo.png"), 2u);
+    EXPECT_EQ(trie.find("/api/v1/users"), 3u);
+    EXPECT_EQ(trie.find("/api/v2"), 0u);
+    EXPECT_EQ(trie.find("/api"), 0u);
+}
+
+// Location paths are plain string prefixes, as with the linear scan they replaced
+TEST(LocationTrieTest, MatchesInsidePathSegments) {
+    LocationTrie trie;
+    trie.insert("/static", 1);
+
+    EXPECT_EQ(trie.find("/staticx"), 1u);
+    EXPECT_EQ(trie.find("/stati"), LocationTrie::NONE);
+    EXPECT_EQ(trie.find("static"), LocationTrie::NONE);
+}
+
+TEST(LocationTrieTest, SplitsEdgesInAnyInsertOrder) {
+    const std::vector<std::string> prefixes { "/api/v1", "/api", "/apx", "/a", "/api/v10", "/" };
+    std::vector<std::size_t> order { 0, 1, 2, 3, 4, 5 };
+
+    do {
+        LocationTrie trie;
+        for (const std::size_t i : order) {
+            trie.insert(prefixes[i], i);
+        }
+
+        EXPECT_EQ(trie.find("/api/v1/x"), 0u);
+        EXPECT_EQ(trie.find("/api/v2"), 1u);
+        EXPECT_EQ(trie.find("/apx/y"), 2u);
+        EXPECT_EQ(trie.find("/ap"), 3u);
+        EXPECT_EQ(trie.find("/api/v10/x"), 4u);
+        EXPECT_EQ(trie.find("/b"), 5u);
+    } while (std::ranges::next_permutation(order).found);
+}
+
+TEST(LocationTrieTest, LaterInsertReplacesValue) {
+    LocationTrie trie;
+    trie.insert("/static", 1);
+    trie.insert("/static", 4);
+
+    EXPECT_EQ(trie.find("/static/a"), 4u);
+}
+
+TEST(LocationTrieTest, ClearDropsEverything) {
+    LocationTrie trie;
+    trie.insert("/", 0);
+    trie.insert("/static", 1);
+    trie.clear();
+
+    EXPECT_EQ(trie.find("/static"), LocationTrie::NONE);
+
+    trie.insert("/new", 2);
+    EXPECT_EQ(trie.find("/new/a"), 2u);
+}
@@ -0,0 +1,115 @@
+#include <gtest/gtest.h>
+#include <string>
+#include "MissingPaths.hpp"
+
+class MissingPathsTest : public ::testing::Test {
+protected:
+    MissingPaths& missing = MissingPaths::instance();
+
+    void SetUp() override {
+        missing.configure(4, std::chrono::seconds(60), true);
+    }
+
+    void TearDown() override {
+        missing.configure(0, std::chrono::seconds(0), false);
+    }
+};
+
+TEST_F(MissingPathsTest, RemembersMissedPaths) {
+    missing.insert("/www/a.html");
+
+    EXPECT_TRUE(missing.contains("/www/a.html"));
+    EXPECT_FALSE(missing.contains("/www/b.html"));
+    EXPECT_FALSE(missing.contains("/www/a.htm"));
+    EXPECT_EQ(missing.size(), 1u);
+
+    missing.insert("/www/a.html");
+    EXPECT_EQ(missing.size(), 1u);
+}
+
+// Only the path is compared after a filter hit, other paths sharing its counters are never reported
+TEST_F(MissingPathsTest, FilterHitsAreConfirmed) {
+    missing.configure(2, std::chrono::seconds(60), true);
+    missing.insert("/www/a");
+    missing.insert("/www/b");
+
+    for (int i = 0; i < 10000; i++) {
+        EXPECT_FALSE(missing.contains("/www/" + std::to_string(i)));
+    }
+}
+
+TEST_F(MissingPathsTest, EvictsLeastRecentlyMissed) {
+    for (const char* path : { "/1", "/2", "/3", "/4" }) {
+        missing.insert(path);
+    }
+
+    // A hit makes "/1" the most recent, "/2" goes first
+    EXPECT_TRUE(missing.contains("/1"));
+    missing.insert("/5");
+
+    EXPECT_EQ(missing.size(), 4u);
+    EXPECT_FALSE(missing.contains("/2"));
+    EXPECT_TRUE(missing.contains("/1"));
+    EXPECT_TRUE(missing.contains("/5"));
+}
+
+TEST_F(MissingPathsTest, InvalidatesPathAndEverythingBelow) {
+    missing.insert("/www/dir/a.html");
+    missing.insert("/www/dir/sub/b.html");
+    missing.insert("/www/directory.html");
+    missing.insert("/www/c.html");
+
+    missing.invalidate("/www/c.html");
+    EXPECT_FALSE(missing.contains("/www/c.html"));
+
+    missing.invalidate("/www/./dir/");
+    EXPECT_FALSE(missing.contains("/www/dir/a.html"));
+    EXPECT_FALSE(missing.contains("/www/dir/sub/b.html"));
+    EXPECT_TRUE(missing.contains("/www/directory.html"));
+    EXPECT_EQ(missing.size(), 1u);
+
+    // An overflowed inotify queue drops everything
+    missing.invalidate("/");
+    EXPECT_EQ(missing.size(), 0u);
+    EXPECT_FALSE(missing.contains("/www/directory.html"));
+}
+
+TEST_F(MissingPathsTest, CountersDropWithEntries) {
+    missing.configure(1000, std::chrono::seconds(60), true);
+
+    for (int round = 0; round < 3; round++) {
+        for (int i = 0; i < 1000; i++) {
+            missing.insert("/www/" + std::to_string(i));
+        }
+        missing.invalidate("/www");
+        EXPECT_EQ(missing.size(), 0u);
+    }
+
+    missing.insert("/other");
+    EXPECT_TRUE(missing.contains("/other"));
+    EXPECT_FALSE(missing.contains("/www/1"));
+}
+
+TEST_F(MissingPathsTest, SkipsPathsWithDotSegments) {
+    missing.insert("/www/../etc/passwd");
+    missing.insert("/www/./a.html");
+    missing.insert("/www//a.html");
+
+    EXPECT_EQ(missing.size(), 0u);
+}
+
+TEST_F(MissingPathsTest, UnwatchedEntriesExpire) {
+    missing.configure(4, std::chrono::seconds(0), false);
+    missing.insert("/www/a.html");
+
+    EXPECT_FALSE(missing.contains("/www/a.html"));
+    EXPECT_EQ(missing.size(), 0u);
+}
+
+TEST_F(MissingPathsTest, DisabledCacheKeepsNothing) {
+    missing.configure(0, std::chrono::seconds(60), true);
+    missing.insert("/www/a.html");
+
+    EXPECT_FALSE(missing.isEnabled());
+    EXPECT_FALSE(missing.contains("/www/a.html"));
+}
@@ -0,0 +1,96 @@
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <string>
+#include "TempTree.hpp"
+#include "utils/OpenFileCache.hpp"
+
+namespace fs = std::filesystem;
+
+class OpenFileCacheTest : public ::testing::Test {
+protected:
+    utils::OpenFileCache& cache = utils::OpenFileCache::instance();
+    TempTree tree { "open_file_cache", { "dir" } };
+    const fs::path& root = tree.root;
+
+    void SetUp() override {
+        cache.configure(2, std::chrono::seconds(60));
+    }
+
+    void TearDown() override {
+        cache.configure(0, std::chrono::seconds(0));
+    }
+};
+
+TEST_F(OpenFileCacheTest, StatIsCachedUntilInvalidated) {
+    const fs::path path = tree.write("file.txt", "12345");
+
+    auto entry = cache.stat(path);
+    ASSERT_NE(entry, nullptr);
+    EXPECT_TRUE(entry->isRegularFile());
+    EXPECT_EQ(entry->size(), 5u);
+
+    // The cached result is served even after the file changed
+    tree.write("file.txt", "1234567890");
+    EXPECT_EQ(cache.stat(path), entry);
+
+    cache.invalidate(path);
+    auto fresh = cache.stat(path);
+    ASSERT_NE(fresh, nullptr);
+    EXPECT_EQ(fresh->size(), 10u);
+}
+
+TEST_F(OpenFileCacheTest, OpenSharesOneDescriptor) {
+    const fs::path path = tree.write("file.txt", "content");
+
+    auto first = cache.open(path);
+    ASSERT_NE(first, nullptr);
+    ASSERT_NE(first->file, nullptr);
+
+    auto second = cache.open(root / "dir" / ".." / "file.txt");
+    EXPECT_EQ(second->file, first->file);
+
+    // Directories are stat'ed but get no descriptor
+    auto directory = cache.open(root / "dir");
+    ASSERT_NE(directory, nullptr);
+    EXPECT_TRUE(directory->isDirectory());
+    EXPECT_EQ(directory->file, nullptr);
+}
+
+TEST_F(OpenFileCacheTest, MissingPathsAreNotCached) {
+    EXPECT_EQ(cache.stat(root / "late.txt"), nullptr);
+
+    tree.write("late.txt", "now here");
+    EXPECT_NE(cache.stat(root / "late.txt"), nullptr);
+}
+
+TEST_F(OpenFileCacheTest, EvictsBeyondMaxEntries) {
+    const fs::path a = tree.write("a.txt", "a");
+    const fs::path b = tree.write("b.txt", "b");
+    const fs::path c = tree.write("c.txt", "c");
+
+    auto entryA = cache.stat(a);
+    auto entryB = cache.stat(b);
+    EXPECT_EQ(cache.stat(a), entryA);
+    cache.stat(c);
+
+    // b was the least recently used
+    EXPECT_EQ(cache.stat(a), entryA);
+    EXPECT_NE(cache.stat(b), entryB);
+}
+
+TEST_F(OpenFileCacheTest, InvalidatingDirectoryDropsEntriesBelow) {
+    const fs::path inner = tree.write("dir/inner.txt", "inner");
+
+    auto entry = cache.stat(inner);
+    cache.invalidate(root / "dir");
+
+    EXPECT_NE(cache.stat(inner), entry);
+}
+
+TEST_F(OpenFileCacheTest, EntriesExpire) {
+    cache.configure(8, std::chrono::seconds(0));
+    const fs::path path = tree.write("file.txt", "x");
+
+    auto entry = cache.stat(path);
+    EXPECT_NE(cache.stat(path), entry);
+}
@@ -0,0 +1,298 @@
+#include <gtest/gtest.h>
+#include <fcntl.h>
+#include <fstream>
+#include <memory>
+#include <poll.h>
+#include <string>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <zlib.h>
+#include "http/index.hpp"
+#include "utils/Payload.hpp"
+#include "utils/ReadAhead.hpp"
+
+namespace {
+    std::string writeFile(const std::string& name, const std::string& content) {
+        const std::string path = ::testing::TempDir() + "/" + name;
+        std::ofstream(path, std::ios::binary) << content;
+        return path;
+    }
+
+    std::string patternOf(std::size_t size) {
+        std::string content(size, '\0');
+        for (std::size_t i = 0; i < size; i++) {
+            content[i] = static_cast<char>('a' + (i * 7) % 26);
+        }
+        return content;
+    }
+
+    // Sends the payload into a socket pair and returns what came out of the other end
+    std::string sendThrough(utils::Payload& payload) {
+        int fds[2];
+        if (::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds) == -1) {
+            return {};
+        }
+
+        std::string received;
+        char buffer[65536];
+
+        while (!payload.isSent()) {
+            if (!payload.isPending()) {
+                payload.send(fds[1]);
+            }
+
+            for (ssize_t bytes; (bytes = ::read(fds[0], buffer, sizeof(buffer))) > 0;) {
+                received.append(buffer, static_cast<std::size_t>(bytes));
+            }
+        }
+
+        ::close(fds[1]);
+        for (ssize_t bytes; (bytes = ::read(fds[0], buffer, sizeof(buffer))) > 0;) {
+            received.append(buffer, static_cast<std::size_t>(bytes));
+        }
+        ::close(fds[0]);
+        return received;
+    }
+}
+
+TEST(FilePayloadTest, SendsWholeFile) {
+    const std::string content = patternOf(300000);
+    utils::FilePayload payload(writeFile("file_payload_whole", content));
+
+    EXPECT_EQ(payload.size(), content.size());
+    EXPECT_EQ(sendThrough(payload), content);
+    EXPECT_TRUE(payload.isSent());
+}
+
+TEST(FilePayloadTest, SendsRangeOfSharedDescriptor) {
+    const std::string content = patternOf(100000);
+    const std::string path = writeFile("file_payload_range", content);
+    auto file = std::make_shared<const utils::FileDescriptor>(::open(path.c_str(), O_RDONLY | O_CLOEXEC));
+
+    utils::FilePayload first(path, file, 1000, 5);
+    utils::FilePayload second(path, file, 50000, 40000);
+
+    EXPECT_EQ(sendThrough(first), content.substr(5, 1000));
+    EXPECT_EQ(sendThrough(second), content.substr(40000, 50000));
+}
+
+TEST(FilePayloadTest, FallbackSendsSameBytes) {
+    const std::string content = patternOf(200000);
+    utils::FilePayload payload(writeFile("file_payload_fallback", content));
+    payload.useSendfile(false);
+
+    EXPECT_EQ(sendThrough(payload), content);
+}
+
+// A file cut short under the response fails instead of waiting for the missing bytes
+TEST(FilePayloadTest, TruncatedFileFails) {
+    for (const bool isSendfile : { true, false }) {
+        const std::string path = writeFile("file_payload_truncated", patternOf(100000));
+        utils::FilePayload payload(path);
+        payload.useSendfile(isSendfile);
+
+        ASSERT_EQ(::truncate(path.c_str(), 1000), 0);
+        EXPECT_THROW(sendThrough(payload), std::ios_base::failure);
+    }
+
+    const std::string path = writeFile("file_payload_truncated", patternOf(1000));
+    auto file = std::make_shared<const utils::FileDescriptor>(::open(path.c_str(), O_RDONLY | O_CLOEXEC));
+    utils::FilePayload payload(path, file, 100000, 0);
+    std::uint8_t buffer[4096];
+
+    EXPECT_EQ(payload.read(buffer, sizeof(buffer)), 1000u);
+    EXPECT_THROW(payload.read(buffer, sizeof(buffer)), std::ios_base::failure);
+}
+
+TEST(FilePayloadTest, CopyStartsWhereOriginalIs) {
+    const std::string content = patternOf(5000);
+    utils::FilePayload payload(writeFile("file_payload_copy", content));
+    std::uint8_t buffer[1000];
+
+    ASSERT_EQ(payload.read(buffer, sizeof(buffer)), sizeof(buffer));
+
+    utils::FilePayload copy(payload);
+    EXPECT_EQ(sendThrough(copy), content.substr(1000));
+    EXPECT_EQ(payload.toString(), content);
+}
+
+namespace {
+    // Drops the pages of the file from the page cache, false when they stay there anyway
+    bool evict(const std::string& path) {
+        const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        char probe;
+        struct iovec iov { &probe, 1 };
+
+        ::fsync(fd);
+        ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        const bool isCold = ::preadv2(fd, &iov, 1, 0, RWF_NOWAIT) == -1 && errno == EAGAIN;
+        ::close(fd);
+        return isCold;
+    }
+
+    // Read-ahead jobs finished since the last call, waiting up to `ms` for `expected` of them
+    std::uint64_t finishedReads(std::uint64_t expected = 0, int ms = 0) {
+        struct pollfd pfd { utils::ReadAhead::instance().getFd(), POLLIN, 0 };
+        std::uint64_t total = 0;
+        std::uint64_t count;
+
+        do {
+            while (::read(pfd.fd, &count, sizeof(count)) > 0) {
+                total += count;
+            }
+        } while (total < expected && ::poll(&pfd, 1, ms) == 1);
+
+        return total;
+    }
+}
+
+TEST(FilePayloadTest, ReadsColdFileAhead) {
+    const std::string content = patternOf(3 * 1024 * 1024);
+    const std::string path = writeFile("file_payload_cold", content);
+
+    if (!evict(path)) {
+        GTEST_SKIP() << "The page cache of " << path << " can not be dropped";
+    }
+
+    finishedReads();
+    utils::FilePayload payload(path);
+
+    EXPECT_EQ(sendThrough(payload), content);
+
+    // One job per 512 KiB block
+    EXPECT_EQ(finishedReads(6, 1000), 6u);
+}
+
+TEST(FilePayloadTest, SendsWarmFileInline) {
+    const std::string content = patternOf(3 * 1024 * 1024);
+    utils::FilePayload payload(writeFile("file_payload_warm", content));
+
+    finishedReads();
+    EXPECT_EQ(sendThrough(payload), content);
+    EXPECT_EQ(finishedReads(), 0u);
+}
+
+namespace {
+    // Undoes the chunked transfer coding, fails the test on a framing error
+    std::string dechunk(const std::string& framed) {
+        std::string content;
+        std::size_t pos = 0;
+
+        while (true) {
+            const std::size_t lineEnd = framed.find("\r\n", pos);
+            if (lineEnd == std::string::npos) {
+                ADD_FAILURE() << "Unterminated chunk size line";
+                return content;
+            }
+
+            const std::size_t size = std::stoul(framed.substr(pos, lineEnd - pos), nullptr, 16);
+            pos = lineEnd + 2;
+
+            if (size == 0) {
+                EXPECT_EQ(framed.substr(pos), "\r\n");
+                return content;
+            }
+
+            content += framed.substr(pos, size);
+            pos += size;
+            EXPECT_EQ(framed.substr(pos, 2), "\r\n");
+            pos += 2;
+        }
+    }
+
+    std::string gunzip(const std::string& compressed) {
+        z_stream stream {};
+        std::string content;
+        char buffer[65536];
+
+        if (::inflateInit2(&stream, 16 + MAX_WBITS) != Z_OK) {
+            return {};
+        }
+
+        stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(compressed.data()));
+        stream.avail_in = static_cast<uInt>(compressed.size());
+        int status = Z_OK;
+
+        while (status == Z_OK) {
+            stream.next_out = reinterpret_cast<Bytef*>(buffer);
+            stream.avail_out = sizeof(buffer);
+            status = ::inflate(&stream, Z_NO_FLUSH);
+            content.append(buffer, sizeof(buffer) - stream.avail_out);
+        }
+
+        EXPECT_EQ(status, Z_STREAM_END);
+        ::inflateEnd(&stream);
+        return content;
+    }
+}
+
+TEST(ChunkedPayloadTest, FramesEveryBlock) {
+    const std::string content = patternOf(40000);
+    utils::ChunkedPayload payload(std::make_unique<utils::StringPayload>(content));
+
+    const std::string framed = sendThrough(payload);
+
+    EXPECT_TRUE(framed.starts_with("4000\r\n"));
+    EXPECT_TRUE(framed.ends_with("\r\n0\r\n\r\n"));
+    EXPECT_EQ(dechunk(framed), content);
+}
+
+TEST(ChunkedPayloadTest, EmptySourceIsLastChunkOnly) {
+    utils::ChunkedPayload payload(std::make_unique<utils::StringPayload>(""));
+
+    EXPECT_EQ(sendThrough(payload), "0\r\n\r\n");
+}
+
+TEST(GzipPayloadTest, CompressesWholeStream) {
+    const std::string content = patternOf(200000);
+    utils::GzipPayload payload(std::make_unique<utils::StringPayload>(content), 1);
+
+    const std::string compressed = sendThrough(payload);
+
+    EXPECT_LT(compressed.size(), content.size());
+    EXPECT_EQ(gunzip(compressed), content);
+}
+
+TEST(GzipPayloadTest, ReadsInSmallSteps) {
+    const std::string content = patternOf(50000);
+    utils::GzipPayload payload(std::make_unique<utils::StringPayload>(content), 6);
+    std::string compressed;
+    std::uint8_t buffer[100];
+
+    for (std::size_t bytes; (bytes = payload.read(buffer, sizeof(buffer))) > 0;) {
+        compressed.append(reinterpret_cast<char*>(buffer), bytes);
+    }
+
+    EXPECT_TRUE(payload.isSent());
+    EXPECT_EQ(gunzip(compressed), content);
+}
+
+TEST(GzipPayloadTest, ResponseCompressesListedTypes) {
+    Location location;
+    location.isGzip = true;
+    location.gzipMinLength = 100;
+
+    http::Response res(-1);
+    res.setCompression(&location).setText(http::StatusCode::OK_200, patternOf(1000));
+    const std::string header = res.getHeader().toString();
+
+    EXPECT_NE(header.find("Content-Encoding: gzip\r\n"), std::string::npos);
+    EXPECT_NE(header.find("Transfer-Encoding: chunked\r\n"), std::string::npos);
+    EXPECT_NE(header.find("Vary: Accept-Encoding\r\n"), std::string::npos);
+    EXPECT_EQ(header.find("Content-Length"), std::string::npos);
+    EXPECT_EQ(gunzip(dechunk(sendThrough(*res.getBody()))), patternOf(1000));
+}
+
+TEST(GzipPayloadTest, ResponseSkipsShortBodies) {
+    Location location;
+    location.isGzip = true;
+    location.gzipMinLength = 100;
+
+    http::Response res(-1);
+    res.setCompression(&location).setText(http::StatusCode::OK_200, "short");
+    const std::string header = res.getHeader().toString();
+
+    EXPECT_EQ(header.find("Content-Encoding"), std::string::npos);
+    EXPECT_NE(header.find("Content-Length: 5\r\n"), std::string::npos);
+}
@@ -0,0 +1,95 @@
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <string>
+#include "TempTree.hpp"
+#include "Router.hpp"
+
+namespace fs = std::filesystem;
+
+TEST(QualityTest, AcceptEncodingValues) {
+    EXPECT_DOUBLE_EQ(http::qualityOf("gzip, br", "br"), 1.0);
+    EXPECT_DOUBLE_EQ(http::qualityOf("gzip;q=0.5, br;q=0.8", "gzip"), 0.5);
+    EXPECT_DOUBLE_EQ(http::qualityOf("GZIP ; Q = 0.3", "gzip"), 0.3);
+    EXPECT_DOUBLE_EQ(http::qualityOf("deflate", "gzip"), 0.0);
+    EXPECT_DOUBLE_EQ(http::qualityOf("*;q=0.1", "br"), 0.1);
+    EXPECT_DOUBLE_EQ(http::qualityOf("br;q=0, *", "br"), 0.0);
+    EXPECT_DOUBLE_EQ(http::qualityOf("gzip;q=oops", "gzip"), 0.0);
+}
+
+class PrecompressedTest : public ::testing::Test {
+protected:
+    TempTree tree { "precompressed" };
+    Location loc;
+
+    void SetUp() override {
+        loc.path = "/";
+        loc.root = tree.root;
+        loc.index = "index.html";
+        loc.isPrecompressed = true;
+        tree.write("style.css", "body { color: red; }");
+        tree.write("style.css.gz", "gzip bytes");
+        tree.write("style.css.br", "brotli bytes");
+        tree.write("500.html", "<h1>500</h1>");
+    }
+
+    http::Response get(const std::string& path, const std::string& acceptEncoding) {
+        http::Request req;
+        req.setMethod("GET");
+        if (!acceptEncoding.empty()) {
+            req.setHeader(http::Header::ACCEPT_ENCODING, acceptEncoding);
+        }
+
+        http::Response res(-1);
+        handleGetRequest(loc, path, req, res);
+        return res;
+    }
+};
+
+TEST_F(PrecompressedTest, ServesPreferredSidecar) {
+    auto res = get("/style.css", "gzip, br");
+    std::string header = res.getHeader().toString();
+
+    EXPECT_EQ(res.getBody()->toString(), "brotli bytes");
+    EXPECT_NE(header.find("Content-Encoding: br\r\n"), std::string::npos);
+    EXPECT_NE(header.find("Content-Type: text/css"), std::string::npos);
+    EXPECT_NE(header.find("Vary: Accept-Encoding\r\n"), std::string::npos);
+
+    res = get("/style.css", "gzip, br;q=0.5");
+    EXPECT_EQ(res.getBody()->toString(), "gzip bytes");
+    EXPECT_NE(res.getHeader().toString().find("Content-Encoding: gzip\r\n"), std::string::npos);
+}
+
+TEST_F(PrecompressedTest, ServesIdentityWithoutAcceptedSidecar) {
+    for (const std::string acceptEncoding : { "", "deflate", "br;q=0, gzip;q=0" }) {
+        auto res = get("/style.css", acceptEncoding);
+        const std::string header = res.getHeader().toString();
+
+        EXPECT_EQ(res.getBody()->toString(), "body { color: red; }");
+        EXPECT_EQ(header.find("Content-Encoding"), std::string::npos);
+        EXPECT_NE(header.find("Vary: Accept-Encoding\r\n"), std::string::npos);
+    }
+}
+
+TEST_F(PrecompressedTest, IgnoresStaleSidecar) {
+    fs::last_write_time(loc.root / "style.css.br", fs::last_write_time(loc.root / "style.css") - std::chrono::hours(1));
+
+    auto res = get("/style.css", "br");
+
+    EXPECT_EQ(res.getBody()->toString(), "body { color: red; }");
+}
+
+TEST_F(PrecompressedTest, ErrorPageKeepsStatusHandlers) {
+    // The 404 page is missing, so the handler falls back to the 500 page
+    http::Request req;
+    req.setMethod("GET");
+    http::Response res(-1);
+    bool isReady = false;
+
+    res.onStatusChanged([&isReady](http::Response::Status status) {
+        isReady = (status == http::Response::Status::READY);
+    });
+    handleGetRequest(loc, "/missing.css", req, res);
+
+    EXPECT_EQ(res.getStatusCode(), http::StatusCode::INTERNAL_SERVER_ERROR_500);
+    EXPECT_TRUE(isReady);
+}
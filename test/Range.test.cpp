@@ -0,0 +1,145 @@
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "http/index.hpp"
+
+namespace {
+    using Ranges = std::vector<std::pair<std::size_t, std::size_t>>;
+
+    std::optional<Ranges> rangesOf(const std::string& value, std::size_t size) {
+        auto ranges = http::parseRange(value, size);
+        if (!ranges.has_value()) {
+            return std::nullopt;
+        }
+
+        Ranges pairs;
+        for (const auto& range : *ranges) {
+            pairs.emplace_back(range.first, range.last);
+        }
+        return pairs;
+    }
+}
+
+TEST(RangeTest, ParsesSingleRanges) {
+    EXPECT_EQ(rangesOf("bytes=0-99", 1000), (Ranges { { 0, 99 } }));
+    EXPECT_EQ(rangesOf("bytes=900-", 1000), (Ranges { { 900, 999 } }));
+    EXPECT_EQ(rangesOf("bytes=-100", 1000), (Ranges { { 900, 999 } }));
+    EXPECT_EQ(rangesOf("BYTES=0-0", 1000), (Ranges { { 0, 0 } }));
+
+    // Clamped to the representation
+    EXPECT_EQ(rangesOf("bytes=500-5000", 1000), (Ranges { { 500, 999 } }));
+    EXPECT_EQ(rangesOf("bytes=-5000", 1000), (Ranges { { 0, 999 } }));
+}
+
+TEST(RangeTest, MergesOverlappingAndAdjacentRanges) {
+    EXPECT_EQ(rangesOf("bytes=500-599, 0-99, 50-149", 1000), (Ranges { { 0, 149 }, { 500, 599 } }));
+    EXPECT_EQ(rangesOf("bytes=0-99,100-199", 1000), (Ranges { { 0, 199 } }));
+}
+
+TEST(RangeTest, UnsatisfiableRanges) {
+    EXPECT_EQ(rangesOf("bytes=1000-", 1000), Ranges {});
+    EXPECT_EQ(rangesOf("bytes=-0", 1000), Ranges {});
+    EXPECT_EQ(rangesOf("bytes=0-10", 0), Ranges {});
+}
+
+TEST(RangeTest, IgnoresInvalidHeaders) {
+    EXPECT_EQ(rangesOf("items=0-10", 1000), std::nullopt);
+    EXPECT_EQ(rangesOf("bytes=10-5", 1000), std::nullopt);
+    EXPECT_EQ(rangesOf("bytes=-", 1000), std::nullopt);
+    EXPECT_EQ(rangesOf("bytes=a-b", 1000), std::nullopt);
+    EXPECT_EQ(rangesOf("bytes=", 1000), std::nullopt);
+    EXPECT_EQ(rangesOf("bytes=0-1,,2-3", 1000), std::nullopt);
+
+    std::string many = "bytes=0-0";
+    for (int i = 1; i <= 16; i++) {
+        many += "," + std::to_string(i * 2) + "-" + std::to_string(i * 2);
+    }
+    EXPECT_EQ(rangesOf(many, 1000), std::nullopt);
+}
+
+TEST(RangeTest, IfRangeMustMatch) {
+    const std::string tag = "\"abc\"";
+    const std::time_t modified = 784111777;
+
+    http::Request req;
+    req.setMethod("GET");
+    EXPECT_EQ(req.getRanges(1000, tag, modified), std::nullopt);
+
+    req.setHeader(http::Header::RANGE, "bytes=0-9");
+    ASSERT_TRUE(req.getRanges(1000, tag, modified).has_value());
+
+    req.setHeader(http::Header::IF_RANGE, tag);
+    EXPECT_TRUE(req.getRanges(1000, tag, modified).has_value());
+
+    req.setHeader(http::Header::IF_RANGE, "W/" + tag);
+    EXPECT_EQ(req.getRanges(1000, tag, modified), std::nullopt);
+
+    req.setHeader(http::Header::IF_RANGE, http::formatHttpDate(modified));
+    EXPECT_TRUE(req.getRanges(1000, tag, modified).has_value());
+    EXPECT_EQ(req.getRanges(1000, tag, modified + 1), std::nullopt);
+
+    // Only GET has ranges
+    req.setMethod("HEAD");
+    EXPECT_EQ(req.getRanges(1000, tag, modified), std::nullopt);
+}
+
+class RangeResponseTest : public ::testing::Test {
+protected:
+    std::filesystem::path path;
+    std::string content;
+
+    void SetUp() override {
+        path = std::filesystem::path(::testing::TempDir()) / "range.txt";
+        for (int i = 0; i < 100; i++) {
+            content += static_cast<char>('a' + i % 26);
+        }
+        std::ofstream(path, std::ios::binary) << content;
+    }
+
+    void TearDown() override {
+        std::filesystem::remove(path);
+    }
+};
+
+TEST_F(RangeResponseTest, SingleRange) {
+    http::Response res(-1);
+    res.setFileRanges(path, { { 10, 19 } });
+
+    const std::string header = res.getHeader().toString();
+
+    EXPECT_TRUE(header.starts_with("HTTP/1.1 206 "));
+    EXPECT_NE(header.find("Content-Range: bytes 10-19/100\r\n"), std::string::npos);
+    EXPECT_NE(header.find("Content-Length: 10\r\n"), std::string::npos);
+    EXPECT_NE(header.find("ETag: "), std::string::npos);
+    EXPECT_EQ(res.getBody()->toString(), content.substr(10, 10));
+}
+
+TEST_F(RangeResponseTest, MultipleRanges) {
+    http::Response res(-1);
+    res.setFileRanges(path, { { 0, 4 }, { 95, 99 } });
+
+    const std::string header = res.getHeader().toString();
+    const std::string body = res.getBody()->toString();
+    const std::string marker = "multipart/byteranges; boundary=";
+    const std::size_t boundaryPos = header.find(marker);
+
+    ASSERT_NE(boundaryPos, std::string::npos);
+    const std::string boundary = header.substr(boundaryPos + marker.size(), header.find("\r\n", boundaryPos) - boundaryPos - marker.size());
+
+    EXPECT_NE(header.find("Content-Length: " + std::to_string(body.size()) + "\r\n"), std::string::npos);
+    EXPECT_NE(body.find("Content-Range: bytes 0-4/100\r\n\r\n" + content.substr(0, 5) + "\r\n--" + boundary), std::string::npos);
+    EXPECT_NE(body.find("Content-Range: bytes 95-99/100\r\n\r\n" + content.substr(95, 5) + "\r\n--" + boundary + "--\r\n"), std::string::npos);
+}
+
+TEST_F(RangeResponseTest, NotSatisfiable) {
+    http::Response res(-1);
+    res.setRangeNotSatisfiable(100);
+
+    const std::string header = res.getHeader().toString();
+
+    EXPECT_TRUE(header.starts_with("HTTP/1.1 416 "));
+    EXPECT_NE(header.find("Content-Range: bytes */100\r\n"), std::string::npos);
+    EXPECT_NE(header.find("Content-Length: 0\r\n"), std::string::npos);
+}
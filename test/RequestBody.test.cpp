@@ -0,0 +1,127 @@
+#include <gtest/gtest.h>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "http/RequestBody.hpp"
+
+namespace {
+    void append(http::RequestBody& body, const std::string& data) {
+        body.append(reinterpret_cast<const std::uint8_t*>(data.data()), data.size());
+    }
+
+    std::string contentOf(const http::RequestBody& body) {
+        auto view = body.view();
+        return std::string(view.begin(), view.end());
+    }
+}
+
+TEST(RequestBodyTest, SmallBodyStaysInMemory) {
+    http::RequestBody body;
+    body.setBufferSize(16);
+
+    append(body, "0123456789");
+    append(body, "abcdef");
+
+    EXPECT_FALSE(body.isInFile());
+    EXPECT_EQ(body.getFd(), -1);
+    EXPECT_EQ(body.size(), 16u);
+    EXPECT_EQ(contentOf(body), "0123456789abcdef");
+}
+
+TEST(RequestBodyTest, SpillsPastBufferSize) {
+    http::RequestBody body;
+    body.setBufferSize(16);
+
+    append(body, "0123456789abcdef");
+    append(body, "!");
+
+    EXPECT_TRUE(body.isInFile());
+    EXPECT_NE(body.getFd(), -1);
+    EXPECT_EQ(body.size(), 17u);
+    EXPECT_EQ(contentOf(body), "0123456789abcdef!");
+
+    // The mapping follows the file as it grows
+    append(body, std::string(4096, 'x'));
+    EXPECT_EQ(contentOf(body), "0123456789abcdef!" + std::string(4096, 'x'));
+}
+
+TEST(RequestBodyTest, CopiesShareTheFile) {
+    http::RequestBody body;
+    body.setBufferSize(4);
+    append(body, "spilled");
+
+    http::RequestBody copy(body);
+
+    EXPECT_EQ(copy.getFd(), body.getFd());
+    EXPECT_EQ(contentOf(copy), "spilled");
+}
+
+TEST(RequestBodyTest, ClearDropsTheFile) {
+    http::RequestBody body;
+    body.setBufferSize(4);
+    append(body, "spilled");
+    body.clear();
+
+    EXPECT_TRUE(body.empty());
+    EXPECT_FALSE(body.isInFile());
+    EXPECT_TRUE(body.view().empty());
+}
+
+TEST(RequestBodyTest, SaveAsWritesEitherStorage) {
+    const std::string directory = ::testing::TempDir();
+
+    for (const std::size_t bufferSize : { std::size_t(1024), std::size_t(4) }) {
+        http::RequestBody body;
+        body.setBufferSize(bufferSize).setTempDirectory(directory);
+        append(body, "saved body");
+
+        const std::string path = directory + "/request_body_" + std::to_string(bufferSize);
+        ::unlink(path.c_str());
+        body.saveAs(path);
+
+        std::ifstream file(path, std::ios::binary);
+        EXPECT_EQ(std::string(std::istreambuf_iterator<char>(file), {}), "saved body");
+        ::unlink(path.c_str());
+    }
+}
+
+TEST(RequestBodyTest, SpliceFromSocket) {
+    int fds[2];
+    ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds), 0);
+
+    http::RequestBody body;
+    append(body, "head:");
+
+    // Nothing ready yet
+    errno = 0;
+    EXPECT_EQ(body.spliceFrom(fds[0], 1024), -1);
+    EXPECT_EQ(errno, EAGAIN);
+    EXPECT_TRUE(body.isInFile());
+
+    const std::string data(100000, 'u');
+    std::size_t written = 0;
+    std::size_t received = 0;
+
+    while (received < data.size()) {
+        if (written < data.size()) {
+            const ssize_t bytes = ::write(fds[1], data.data() + written, data.size() - written);
+            if (bytes > 0) {
+                written += static_cast<std::size_t>(bytes);
+            }
+        }
+
+        const ssize_t bytes = body.spliceFrom(fds[0], data.size() - received);
+        if (bytes > 0) {
+            received += static_cast<std::size_t>(bytes);
+        }
+    }
+
+    ::close(fds[1]);
+    EXPECT_EQ(body.spliceFrom(fds[0], 1024), 0);
+    ::close(fds[0]);
+
+    EXPECT_EQ(body.size(), 5 + data.size());
+    EXPECT_EQ(contentOf(body), "head:" + data);
+}
@@ -0,0 +1,116 @@
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include "RouteTable.hpp"
+
+namespace {
+    Location locationOf(const std::string& path, std::vector<std::string> methods) {
+        Location location;
+        location.path = path;
+        location.methods = std::move(methods);
+        return location;
+    }
+}
+
+class RouteTableTest : public ::testing::Test {
+protected:
+    ServerConfig server;
+
+    void SetUp() override {
+        server.locations.push_back(locationOf("/", { "GET" }));
+        server.locations.push_back(locationOf("/upload", { "POST", "DELETE", "PUT" }));
+
+        Location cgi = locationOf("/cgi-bin", { "GET", "POST" });
+        cgi.cgiExtension = { "py", "php", "cgi" };
+        server.locations.push_back(cgi);
+
+        Location old = locationOf("/old", { "GET" });
+        old.returnUrl = { "301", "https://example.com/new" };
+        server.locations.push_back(old);
+
+        server.errorPages[404] = "errors/404.html";
+        server.clientMaxBodySize = 1234;
+    }
+};
+
+TEST(RouteTableMethodTest, ParsesKnownMethodsOnly) {
+    EXPECT_EQ(RouteTable::methodOf("GET"), RouteTable::Method::GET);
+    EXPECT_EQ(RouteTable::methodOf("POST"), RouteTable::Method::POST);
+    EXPECT_EQ(RouteTable::methodOf("DELETE"), RouteTable::Method::DELETE);
+    EXPECT_EQ(RouteTable::methodOf("get"), RouteTable::Method::UNKNOWN);
+    EXPECT_EQ(RouteTable::methodOf("PUT"), RouteTable::Method::UNKNOWN);
+    EXPECT_EQ(RouteTable::methodOf(""), RouteTable::Method::UNKNOWN);
+}
+
+TEST_F(RouteTableTest, MatchesLongestLocation) {
+    const RouteTable table(server);
+
+    EXPECT_EQ(table.match("/index.html")->location.path, "/");
+    EXPECT_EQ(table.match("/upload/file.txt")->location.path, "/upload");
+    EXPECT_EQ(table.match("/cgi-bin/hello.py")->location.path, "/cgi-bin");
+    EXPECT_EQ(table.match("nothing"), nullptr);
+}
+
+TEST_F(RouteTableTest, MethodMasks) {
+    const RouteTable table(server);
+    const RouteTable::Route* root = table.match("/");
+    const RouteTable::Route* upload = table.match("/upload");
+
+    EXPECT_TRUE(root->allows(RouteTable::Method::GET));
+    EXPECT_FALSE(root->allows(RouteTable::Method::POST));
+    EXPECT_FALSE(root->allows(RouteTable::Method::DELETE));
+
+    // Unknown methods in the config are left out of the mask
+    EXPECT_FALSE(upload->allows(RouteTable::Method::GET));
+    EXPECT_TRUE(upload->allows(RouteTable::Method::POST));
+    EXPECT_TRUE(upload->allows(RouteTable::Method::DELETE));
+    EXPECT_FALSE(upload->allows(RouteTable::Method::UNKNOWN));
+}
+
+TEST_F(RouteTableTest, CgiExtensions) {
+    const RouteTable table(server);
+    const RouteTable::Route* cgi = table.match("/cgi-bin/");
+
+    EXPECT_EQ(cgi->cgiExtensions, (std::vector<std::string> { "cgi", "php", "py" }));
+    EXPECT_TRUE(cgi->isCgiExtension("py"));
+    EXPECT_TRUE(cgi->isCgiExtension("cgi"));
+    EXPECT_FALSE(cgi->isCgiExtension(".py"));
+    EXPECT_FALSE(cgi->isCgiExtension("pl"));
+    EXPECT_FALSE(table.match("/")->isCgiExtension("py"));
+}
+
+TEST_F(RouteTableTest, SerializesRedirectOnce) {
+    const RouteTable table(server);
+
+    ASSERT_NE(table.match("/old/page")->redirect, nullptr);
+    EXPECT_EQ(*table.match("/old/page")->redirect, "Location: https://example.com/new\r\nContent-Length: 0\r\n\r\n");
+    EXPECT_EQ(table.match("/")->redirect, nullptr);
+}
+
+TEST_F(RouteTableTest, LaterLocationWithSamePathWins) {
+    server.locations.push_back(locationOf("/upload", { "GET" }));
+    const RouteTable table(server);
+
+    EXPECT_EQ(table.getRoutes().size(), 5u);
+    EXPECT_TRUE(table.match("/upload/a")->allows(RouteTable::Method::GET));
+    EXPECT_FALSE(table.match("/upload/a")->allows(RouteTable::Method::POST));
+}
+
+TEST_F(RouteTableTest, KeepsServerSettings) {
+    const RouteTable table(server);
+
+    EXPECT_EQ(table.getErrorPage(404), "errors/404.html");
+    EXPECT_EQ(table.getErrorPage(500), "");
+    EXPECT_EQ(table.getClientMaxBodySize(), 1234u);
+    EXPECT_EQ(table.getClientBodyBufferSize(), server.clientBodyBufferSize);
+}
+
+// The table holds route indices, so a copy keeps working after the original is gone
+TEST_F(RouteTableTest, CopySurvivesOriginal) {
+    auto table = std::make_unique<RouteTable>(server);
+    const RouteTable copy = *table;
+    table.reset();
+
+    EXPECT_EQ(copy.match("/cgi-bin/a.py")->location.path, "/cgi-bin");
+    EXPECT_EQ(copy.match("/cgi-bin/a.py"), &copy.getRoutes()[2]);
+}
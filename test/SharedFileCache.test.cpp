@@ -0,0 +1,135 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+#include "http/SharedFileCache.hpp"
+
+namespace {
+    http::FileCache::Entry entryOf(const std::string& path, const std::string& content) {
+        http::FileCache::Entry entry {};
+        entry.path = path;
+        entry.content = content;
+        entry.mimeType = "text/plain";
+        entry.entityTag = "\"tag\"";
+        entry.lastModified = 784111777;
+        entry.headerFields = "Content-Type: text/plain\r\n";
+        return entry;
+    }
+}
+
+// Four pages of 64 KiB, the smallest blocks are 1 KiB
+class SharedFileCacheTest : public ::testing::Test {
+protected:
+    http::SharedFileCache& cache = http::SharedFileCache::instance();
+
+    void SetUp() override {
+        ASSERT_TRUE(cache.create(256 * 1024, 16 * 1024, 2));
+    }
+
+    void TearDown() override {
+        cache.destroy();
+    }
+};
+
+TEST_F(SharedFileCacheTest, InsertsFindsAndErases) {
+    const std::string content(500, 'a');
+
+    auto inserted = cache.insert(entryOf("/www/a.txt", content));
+    ASSERT_NE(inserted, nullptr);
+    EXPECT_EQ(inserted->content, content);
+    EXPECT_EQ(cache.size(), 1024u);
+
+    auto found = cache.find("/www/a.txt");
+    ASSERT_NE(found, nullptr);
+    EXPECT_EQ(found->content.data(), inserted->content.data());
+    EXPECT_EQ(found->mimeType, "text/plain");
+    EXPECT_EQ(found->lastModified, 784111777);
+    EXPECT_EQ(cache.find("/www/b.txt"), nullptr);
+
+    // The responses still sending it keep the block
+    cache.erase("/www/a.txt");
+    EXPECT_EQ(cache.find("/www/a.txt"), nullptr);
+    EXPECT_EQ(found->content, content);
+    EXPECT_EQ(cache.size(), 1024u);
+
+    inserted.reset();
+    found.reset();
+    EXPECT_EQ(cache.size(), 0u);
+}
+
+TEST_F(SharedFileCacheTest, ReplacesAndErasesBelowDirectory) {
+    cache.insert(entryOf("/www/a.txt", "old"));
+    cache.insert(entryOf("/www/a.txt", "new"));
+    cache.insert(entryOf("/www/sub/b.txt", "b"));
+    cache.insert(entryOf("/www/subway.txt", "c"));
+
+    EXPECT_EQ(cache.find("/www/a.txt")->content, "new");
+    EXPECT_EQ(cache.size(), 3 * 1024u);
+
+    cache.eraseBelow("/www/sub");
+    EXPECT_EQ(cache.find("/www/sub/b.txt"), nullptr);
+    EXPECT_NE(cache.find("/www/subway.txt"), nullptr);
+    EXPECT_NE(cache.find("/www/a.txt"), nullptr);
+}
+
+TEST_F(SharedFileCacheTest, ErasedSlotsAreClaimedAgain) {
+    // Many more paths than slots go through the index one at a time
+    for (int i = 0; i < 20000; i++) {
+        const std::string path = "/www/" + std::to_string(i);
+
+        ASSERT_NE(cache.insert(entryOf(path, "x")), nullptr) << path;
+        cache.erase(path);
+    }
+
+    EXPECT_EQ(cache.size(), 0u);
+}
+
+TEST_F(SharedFileCacheTest, EvictsIdleBlocks) {
+    std::vector<std::string> paths;
+
+    for (int i = 0; i < 1000; i++) {
+        paths.push_back("/www/" + std::to_string(i));
+        ASSERT_NE(cache.insert(entryOf(paths.back(), "x")), nullptr) << i;
+    }
+
+    EXPECT_LE(cache.size(), 256 * 1024u);
+    EXPECT_EQ(cache.find(paths.front()), nullptr);
+    EXPECT_NE(cache.find(paths.back()), nullptr);
+}
+
+TEST_F(SharedFileCacheTest, EvictsOtherSizeClassesForLargeFile) {
+    for (int i = 0; i < 256; i++) {
+        cache.insert(entryOf("/www/small/" + std::to_string(i), "x"));
+    }
+
+    // A block of a whole page, only available once a page of small blocks is emptied
+    const std::string content(40 * 1024, 'L');
+    auto large = cache.insert(entryOf("/www/large", content));
+
+    ASSERT_NE(large, nullptr);
+    EXPECT_EQ(large->content, content);
+    EXPECT_EQ(cache.find("/www/large")->content, content);
+}
+
+TEST_F(SharedFileCacheTest, ReleasesPinsOfDeadWorker) {
+    ASSERT_NE(cache.insert(entryOf("/www/a.txt", "a")), nullptr);
+
+    // The worker dies while a response still holds the entry
+    const pid_t pid = ::fork();
+    if (pid == 0) {
+        cache.attach(1);
+        auto entry = cache.find("/www/a.txt");
+        ::_exit(entry != nullptr ? 0 : 1);
+    }
+
+    int status = 0;
+    ASSERT_EQ(::waitpid(pid, &status, 0), pid);
+    ASSERT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    cache.erase("/www/a.txt");
+    EXPECT_EQ(cache.size(), 1024u);
+
+    cache.releasePins(1);
+    EXPECT_EQ(cache.size(), 0u);
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <initializer_list>
+#include <string>
+
+/**
+ * A directory of test files under the gtest temp dir, named after the
+ * test suite using it. It starts out empty but for `directories` and is
+ * removed with the object, so a fixture member gives every test a fresh
+ * tree.
+ */
+class TempTree {
+    public:
+        const std::filesystem::path root;
+
+        explicit TempTree(const std::string& name, std::initializer_list<std::string> directories = {})
+            : root(std::filesystem::path(::testing::TempDir()) / name) {
+            std::filesystem::remove_all(root);
+            std::filesystem::create_directories(root);
+
+            for (const auto& directory : directories) {
+                std::filesystem::create_directories(root / directory);
+            }
+        }
+
+        TempTree(const TempTree&) = delete;
+        TempTree& operator=(const TempTree&) = delete;
+
+        ~TempTree() {
+            std::error_code error;
+            std::filesystem::remove_all(root, error);
+        }
+
+        // Creates or replaces `name` below the root, returns its path
+        std::filesystem::path write(const std::string& name, const std::string& content) const {
+            std::ofstream(root / name, std::ios::binary) << content;
+            return root / name;
+        }
+};
@@ -0,0 +1,124 @@
+#include <gtest/gtest.h>
+#include <deque>
+#include <string>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+#include "VirtualHosts.hpp"
+
+class VirtualHostsTest : public ::testing::Test {
+protected:
+    std::deque<ServerConfig> servers;   // The table keeps pointers to them
+    VirtualHosts hosts;
+
+    void SetUp() override {
+        add({ "default.test" });
+        add({ "example.com", "www.example.com" });
+        add({ "*.example.com" });
+        add({ "*.api.example.com" });
+        add({ "www.example.*" });
+        add({ "www.*" });
+        add({ ".example.org" });
+        add({ "Mixed.Case.NET" });
+    }
+
+    ServerConfig& add(std::vector<std::string> names) {
+        ServerConfig& server = servers.emplace_back();
+        server.serverNames = std::move(names);
+        hosts.add(server);
+        return server;
+    }
+
+    // Index of the server that gets `host`
+    std::size_t serverOf(std::string_view host) {
+        return &hosts.find(host) - hosts.getRouters().data();
+    }
+};
+
+TEST_F(VirtualHostsTest, ExactNameFirst) {
+    EXPECT_EQ(serverOf("example.com"), 1u);
+    EXPECT_EQ(serverOf("www.example.com"), 1u);
+    EXPECT_EQ(serverOf("default.test"), 0u);
+}
+
+TEST_F(VirtualHostsTest, LongestLeadingWildcard) {
+    EXPECT_EQ(serverOf("shop.example.com"), 2u);
+    EXPECT_EQ(serverOf("a.b.example.com"), 2u);
+    EXPECT_EQ(serverOf("v1.api.example.com"), 3u);
+    EXPECT_EQ(serverOf("api.example.com"), 2u);
+}
+
+TEST_F(VirtualHostsTest, TrailingWildcardAfterLeadingOnes) {
+    EXPECT_EQ(serverOf("www.example.net"), 4u);
+    EXPECT_EQ(serverOf("www.example.co.uk"), 4u);
+    EXPECT_EQ(serverOf("www.other.net"), 5u);
+
+    // "*.example.com" wins over "www.example.*"
+    add({ "www.other.*" });
+    EXPECT_EQ(serverOf("www.shop.example.com"), 2u);
+    EXPECT_EQ(serverOf("www.other.net"), 8u);
+}
+
+TEST_F(VirtualHostsTest, DotNameCoversDomainAndSubdomains) {
+    EXPECT_EQ(serverOf("example.org"), 6u);
+    EXPECT_EQ(serverOf("www.example.org"), 6u);
+    EXPECT_EQ(serverOf("badexample.org"), 0u);
+}
+
+TEST_F(VirtualHostsTest, NormalizesHostHeader) {
+    EXPECT_EQ(serverOf("EXAMPLE.COM"), 1u);
+    EXPECT_EQ(serverOf("example.com:8080"), 1u);
+    EXPECT_EQ(serverOf("example.com."), 1u);
+    EXPECT_EQ(serverOf("mixed.case.net"), 7u);
+    EXPECT_EQ(serverOf("Shop.Example.Com:80"), 2u);
+}
+
+TEST_F(VirtualHostsTest, UnknownHostsGoToDefault) {
+    EXPECT_EQ(serverOf(""), 0u);
+    EXPECT_EQ(serverOf("127.0.0.1:8080"), 0u);
+    EXPECT_EQ(serverOf("unknown.test"), 0u);
+    EXPECT_EQ(serverOf("com"), 0u);
+}
+
+TEST_F(VirtualHostsTest, EarlierServerKeepsItsName) {
+    add({ "example.com", "*.example.com" });
+
+    EXPECT_EQ(serverOf("example.com"), 1u);
+    EXPECT_EQ(serverOf("shop.example.com"), 2u);
+}
+
+TEST_F(VirtualHostsTest, FindsServerConfigOfHost) {
+    EXPECT_EQ(&hosts.findServerConfig("shop.example.com"), &servers[2]);
+    EXPECT_EQ(&hosts.findServerConfig("WWW.EXAMPLE.COM:80"), &servers[1]);
+    EXPECT_EQ(&hosts.findServerConfig("unknown.test"), &servers[0]);
+}
+
+// The body limit of the server named by Host applies, not the one of the address default
+TEST_F(VirtualHostsTest, ConnectionUsesLimitsOfRequestedServer) {
+    servers[0].clientMaxBodySize = 1024 * 1024;
+    servers[1].clientMaxBodySize = 10;
+
+    int fds[2];
+    ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds), 0);
+
+    http::Connection con(fds[0], servers[0]);
+    con.onHeaderComplete([this](http::Request& req) -> const ServerConfig& {
+        return hosts.findServerConfig(req.getHeader(http::Header::HOST).value_or(""));
+    });
+
+    const std::string requests =
+        "POST /a HTTP/1.1\r\nHost: default.test\r\nContent-Length: 20\r\n\r\n01234567890123456789"
+        "POST /b HTTP/1.1\r\nHost: example.com\r\nContent-Length: 20\r\n\r\n01234567890123456789";
+    ASSERT_EQ(::write(fds[1], requests.data(), requests.size()), static_cast<ssize_t>(requests.size()));
+
+    std::vector<http::Request::Status> statuses;
+    con.read();
+    con.handleRequests([&statuses](http::Request& req, http::Response& res) {
+        statuses.push_back(req.getStatus());
+        res.setText(http::StatusCode::OK_200, "");
+    });
+
+    EXPECT_EQ(statuses, (std::vector<http::Request::Status> { http::Request::Status::COMPLETE, http::Request::Status::BAD }));
+    con.close();
+    ::close(fds[1]);
+}
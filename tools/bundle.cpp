@@ -0,0 +1,286 @@
+/**
+ * Offline companion of the `bundle` location directive.
+ *
+ * Packs every file below a location root into one archive: a perfect hash
+ * index of the paths, then per file its content, its gzip and brotli
+ * variants when they are smaller, and the serialized Content-Type, ETag and
+ * Last-Modified fields of each variant. See http::Bundle for the layout.
+ * The archive is written next to the output and renamed into place, so a
+ * running server maps either the old or the new one.
+ *
+ * Usage: ./bundle [--min-size=BYTES] <root> <output>
+ */
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+#include <string>
+#include <sys/stat.h>
+#include <vector>
+
+#include "encoders.hpp"
+#include "http/Bundle.hpp"
+
+namespace fs = std::filesystem;
+
+namespace {
+	constexpr std::size_t DEFAULT_MIN_SIZE = 256;
+	constexpr std::uint32_t MAX_SEED = 1 << 24;
+
+	struct File {
+		std::string path;
+		std::string content;
+		std::time_t lastModified;
+	};
+
+	std::size_t alignUp(std::size_t offset) {
+		return (offset + alignof(std::uint64_t) - 1) & ~(alignof(std::uint64_t) - 1);
+	}
+
+	std::string hexOf(std::uint64_t value) {
+		char buffer[17];
+		return std::string(buffer, std::snprintf(buffer, sizeof(buffer), "%llx", static_cast<unsigned long long>(value)));
+	}
+
+	/**
+	 * Hash and displace: paths go to buckets by their unseeded hash, then,
+	 * largest bucket first, each bucket gets the first seed that sends all of
+	 * its paths to free slots. One slot in five stays empty so the last
+	 * buckets find a seed quickly.
+	 */
+	bool buildIndex(const std::vector<File>& files, std::vector<std::uint32_t>& seeds, std::vector<std::uint32_t>& slots) {
+		const std::uint32_t count = static_cast<std::uint32_t>(files.size());
+		std::vector<std::vector<std::uint32_t>> buckets(count / 4 + 1);
+
+		seeds.assign(buckets.size(), 0);
+		slots.assign(count + count / 4 + 1, http::Bundle::EMPTY_SLOT);
+
+		for (std::uint32_t i = 0; i < count; i++) {
+			buckets[http::Bundle::hashOf(files[i].path, 0) % buckets.size()].push_back(i);
+		}
+
+		std::vector<std::uint32_t> order(buckets.size());
+		std::iota(order.begin(), order.end(), 0);
+		std::ranges::stable_sort(order, std::greater<>(), [&buckets](std::uint32_t bucket) {
+			return buckets[bucket].size();
+		});
+
+		std::vector<std::uint32_t> candidates;
+
+		for (const std::uint32_t bucket : order) {
+			if (buckets[bucket].empty()) {
+				break;
+			}
+
+			std::uint32_t seed = 1;
+
+			for (; seed < MAX_SEED; seed++) {
+				candidates.clear();
+
+				for (const std::uint32_t index : buckets[bucket]) {
+					const std::uint32_t slot = http::Bundle::hashOf(files[index].path, seed) % slots.size();
+
+					if (slots[slot] != http::Bundle::EMPTY_SLOT || std::ranges::find(candidates, slot) != candidates.end()) {
+						break;
+					}
+
+					candidates.push_back(slot);
+				}
+
+				if (candidates.size() == buckets[bucket].size()) {
+					break;
+				}
+			}
+
+			if (seed == MAX_SEED) {
+				return false;
+			}
+
+			seeds[bucket] = seed;
+
+			for (std::size_t i = 0; i < candidates.size(); i++) {
+				slots[candidates[i]] = buckets[bucket][i];
+			}
+		}
+
+		return true;
+	}
+
+	class Archive {
+		public:
+			explicit Archive(std::size_t heapOffset) : _heapOffset(heapOffset) {}
+
+			http::Bundle::Span add(const std::string& data) {
+				const http::Bundle::Span span { _heapOffset + _heap.size(), data.size() };
+
+				_heap += data;
+				return span;
+			}
+
+			const std::string& heap() const {
+				return _heap;
+			}
+
+		private:
+			std::size_t _heapOffset;
+			std::string _heap;
+	};
+
+	http::Bundle::Variant addVariant(Archive& archive, const File& file, const std::string& content, const char* encoding) {
+		const std::string extension = fs::path(file.path).extension().string();
+		const std::string entityTag = "\"" + hexOf(http::Bundle::hashOf(content, 0)) + "-" + hexOf(content.size()) + "\"";
+		std::string headerFields =
+			http::stringOf(http::Header::CONTENT_TYPE) + ": " + http::getMimeType(extension.empty() ? extension : extension.substr(1)) + "\r\n"
+			+ http::stringOf(http::Header::CONTENT_LENGTH) + ": " + std::to_string(content.size()) + "\r\n";
+
+		if (encoding != nullptr) {
+			headerFields += http::stringOf(http::Header::CONTENT_ENCODING) + ": " + encoding + "\r\n";
+		}
+
+		headerFields +=
+			http::stringOf(http::Header::ETAG) + ": " + entityTag + "\r\n"
+			+ http::stringOf(http::Header::LAST_MODIFIED) + ": " + http::formatHttpDate(file.lastModified) + "\r\n";
+
+		return { archive.add(content), archive.add(entityTag), archive.add(headerFields) };
+	}
+
+	std::vector<File> readFiles(const fs::path& root, std::error_code& ec) {
+		std::vector<File> files;
+
+		for (
+			auto it = fs::recursive_directory_iterator(root, fs::directory_options::skip_permission_denied, ec);
+			!ec && it != fs::recursive_directory_iterator();
+			it.increment(ec)
+		) {
+			const std::string extension = it->path().extension().string();
+			struct ::stat st;
+
+			// Sidecars of the `precompressed` directive are replaced by the variants of the bundle
+			if (!it->is_regular_file(ec) || extension == ".gz" || extension == ".br" || ::stat(it->path().c_str(), &st) == -1) {
+				continue;
+			}
+
+			std::ifstream file(it->path(), std::ios::binary);
+
+			files.push_back({
+				it->path().lexically_relative(root).generic_string(),
+				std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()),
+				st.st_mtim.tv_sec
+			});
+		}
+
+		std::ranges::sort(files, {}, &File::path);
+		return files;
+	}
+
+	bool writeArchive(const fs::path& outputPath, const std::vector<File>& files, std::size_t minSize) {
+		std::vector<std::uint32_t> seeds;
+		std::vector<std::uint32_t> slots;
+
+		if (!buildIndex(files, seeds, slots)) {
+			std::cerr << "bundle: no perfect hash found for " << files.size() << " paths" << std::endl;
+			return false;
+		}
+
+		http::Bundle::Header header {};
+
+		std::memcpy(header.magic, http::Bundle::MAGIC, sizeof(header.magic));
+		header.entryCount = static_cast<std::uint32_t>(files.size());
+		header.bucketCount = static_cast<std::uint32_t>(seeds.size());
+		header.slotCount = static_cast<std::uint32_t>(slots.size());
+		header.seedsOffset = alignUp(sizeof(header));
+		header.slotsOffset = alignUp(header.seedsOffset + seeds.size() * sizeof(std::uint32_t));
+		header.entriesOffset = alignUp(header.slotsOffset + slots.size() * sizeof(std::uint32_t));
+
+		Archive archive(header.entriesOffset + files.size() * sizeof(http::Bundle::Entry));
+		std::vector<http::Bundle::Entry> entries(files.size());
+
+		for (std::size_t i = 0; i < files.size(); i++) {
+			const File& file = files[i];
+			http::Bundle::Entry& entry = entries[i];
+
+			entry.path = archive.add(file.path);
+			entry.lastModified = file.lastModified;
+			entry.variants[http::Bundle::IDENTITY] = addVariant(archive, file, file.content, nullptr);
+
+			if (file.content.size() < minSize || !tools::isCompressible(file.path)) {
+				continue;
+			}
+
+			if (auto encoded = tools::gzip(file.content); encoded.has_value() && encoded->size() < file.content.size()) {
+				entry.variants[http::Bundle::GZIP] = addVariant(archive, file, *encoded, "gzip");
+			}
+
+			if (auto encoded = tools::brotli(file.content); encoded.has_value() && encoded->size() < file.content.size()) {
+				entry.variants[http::Bundle::BROTLI] = addVariant(archive, file, *encoded, "br");
+			}
+		}
+
+		const fs::path tempPath = outputPath.string() + ".tmp";
+
+		{
+			std::ofstream output(tempPath, std::ios::binary | std::ios::trunc);
+			const auto writeAt = [&output](std::size_t offset, const void* data, std::size_t size) {
+				output.seekp(static_cast<std::streamoff>(offset));
+				output.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+			};
+
+			writeAt(0, &header, sizeof(header));
+			writeAt(header.seedsOffset, seeds.data(), seeds.size() * sizeof(std::uint32_t));
+			writeAt(header.slotsOffset, slots.data(), slots.size() * sizeof(std::uint32_t));
+			writeAt(header.entriesOffset, entries.data(), entries.size() * sizeof(http::Bundle::Entry));
+			output.write(archive.heap().data(), static_cast<std::streamsize>(archive.heap().size()));
+
+			if (!output) {
+				fs::remove(tempPath);
+				return false;
+			}
+		}
+
+		if (std::rename(tempPath.c_str(), outputPath.c_str()) == -1) {
+			fs::remove(tempPath);
+			return false;
+		}
+
+		return true;
+	}
+}
+
+int main(int argc, char** argv) {
+	std::size_t minSize = DEFAULT_MIN_SIZE;
+	std::vector<std::string> paths;
+
+	for (int i = 1; i < argc; i++) {
+		const std::string arg(argv[i]);
+
+		if (arg.starts_with("--min-size=")) {
+			minSize = std::stoul(arg.substr(std::strlen("--min-size=")));
+		} else {
+			paths.push_back(arg);
+		}
+	}
+
+	if (paths.size() != 2) {
+		std::cerr << "Usage: " << argv[0] << " [--min-size=BYTES] <root> <output>" << std::endl;
+		return 1;
+	}
+
+	std::error_code ec;
+	const std::vector<File> files = readFiles(paths[0], ec);
+
+	if (ec) {
+		std::cerr << "bundle: " << paths[0] << ": " << ec.message() << std::endl;
+		return 1;
+	}
+
+	if (!writeArchive(paths[1], files, minSize)) {
+		std::cerr << "bundle: failed to write " << paths[1] << std::endl;
+		return 1;
+	}
+
+	std::cout << paths[1] << ": " << files.size() << " files, " << fs::file_size(paths[1]) << " bytes" << std::endl;
+	return 0;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+/**
+ * Encoders shared by the offline tools, at the highest quality since the
+ * output is made once and served many times.
+ */
+#include <brotli/encode.h>
+#include <zlib.h>
+
+#include <filesystem>
+#include <optional>
+#include <string>
+
+#include "http/utils.hpp"
+
+namespace tools {
+	inline bool isCompressible(const std::filesystem::path& path) {
+		const std::string ext = path.extension().string();
+
+		if (ext == ".gz" || ext == ".br") {
+			return false;
+		}
+
+		const std::string mimeType = http::getMimeType(ext.empty() ? ext : ext.substr(1));
+
+		return mimeType.starts_with("text/")
+			|| mimeType.find("json") != std::string::npos
+			|| mimeType.find("javascript") != std::string::npos
+			|| mimeType.find("xml") != std::string::npos;
+	}
+
+	inline std::optional<std::string> gzip(const std::string& input) {
+		z_stream stream {};
+
+		if (::deflateInit2(&stream, Z_BEST_COMPRESSION, Z_DEFLATED, 15 + 16, 9, Z_DEFAULT_STRATEGY) != Z_OK) {
+			return std::nullopt;
+		}
+
+		std::string output(::deflateBound(&stream, input.size()), '\0');
+		stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input.data()));
+		stream.avail_in = static_cast<uInt>(input.size());
+		stream.next_out = reinterpret_cast<Bytef*>(output.data());
+		stream.avail_out = static_cast<uInt>(output.size());
+
+		const int status = ::deflate(&stream, Z_FINISH);
+		output.resize(stream.total_out);
+		::deflateEnd(&stream);
+
+		if (status != Z_STREAM_END) {
+			return std::nullopt;
+		}
+
+		return output;
+	}
+
+	inline std::optional<std::string> brotli(const std::string& input) {
+		std::size_t size = ::BrotliEncoderMaxCompressedSize(input.size());
+		std::string output(size == 0 ? input.size() + 1024 : size, '\0');
+		size = output.size();
+
+		const BROTLI_BOOL status = ::BrotliEncoderCompress(
+			BROTLI_MAX_QUALITY,
+			BROTLI_DEFAULT_WINDOW,
+			BROTLI_MODE_TEXT,
+			input.size(),
+			reinterpret_cast<const std::uint8_t*>(input.data()),
+			&size,
+			reinterpret_cast<std::uint8_t*>(output.data())
+		);
+
+		if (status != BROTLI_TRUE) {
+			return std::nullopt;
+		}
+
+		output.resize(size);
+		return output;
+	}
+}
@@ -0,0 +1,136 @@
+/**
+ * Offline companion of the `precompressed` location directive.
+ *
+ * Walks the given location roots and writes foo.css.gz and foo.css.br next
+ * to every compressible file, with the mtime of the original so the server
+ * knows they are up to date. Sidecars that would not be smaller are skipped.
+ *
+ * Usage: ./precompress [--min-size=BYTES] <root>...
+ */
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <sys/stat.h>
+
+#include "encoders.hpp"
+
+namespace fs = std::filesystem;
+
+namespace {
+	constexpr std::size_t DEFAULT_MIN_SIZE = 256;
+
+	bool isUpToDate(const fs::path& sidecarPath, const struct ::stat& source) {
+		struct ::stat st;
+
+		return ::stat(sidecarPath.c_str(), &st) == 0
+			&& st.st_mtim.tv_sec == source.st_mtim.tv_sec
+			&& st.st_mtim.tv_nsec == source.st_mtim.tv_nsec;
+	}
+
+	// Writes next to the final path and renames, so the server never serves a partial sidecar
+	bool writeSidecar(const fs::path& sidecarPath, const std::string& content, const struct ::stat& source) {
+		const fs::path tempPath = sidecarPath.string() + ".tmp";
+
+		{
+			std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+
+			if (!file.write(content.data(), static_cast<std::streamsize>(content.size()))) {
+				return false;
+			}
+		}
+
+		const struct timespec times[2] = { source.st_atim, source.st_mtim };
+
+		if (::utimensat(AT_FDCWD, tempPath.c_str(), times, 0) == -1 || std::rename(tempPath.c_str(), sidecarPath.c_str()) == -1) {
+			fs::remove(tempPath);
+			return false;
+		}
+
+		return true;
+	}
+
+	void precompress(const fs::path& filePath, std::size_t minSize) {
+		struct ::stat st;
+
+		if (::stat(filePath.c_str(), &st) == -1 || static_cast<std::size_t>(st.st_size) < minSize) {
+			return;
+		}
+
+		const std::pair<const char*, std::optional<std::string> (*)(const std::string&)> encoders[] = {
+			{ ".gz", tools::gzip },
+			{ ".br", tools::brotli }
+		};
+		std::optional<std::string> content;
+
+		for (const auto& [suffix, encode] : encoders) {
+			const fs::path sidecarPath = filePath.string() + suffix;
+
+			if (isUpToDate(sidecarPath, st)) {
+				continue;
+			}
+
+			if (!content.has_value()) {
+				std::ifstream file(filePath, std::ios::binary);
+				content = std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+			}
+
+			auto encoded = encode(*content);
+
+			if (!encoded.has_value() || encoded->size() >= content->size()) {
+				fs::remove(sidecarPath);
+				continue;
+			}
+
+			if (!writeSidecar(sidecarPath, *encoded, st)) {
+				std::cerr << "precompress: failed to write " << sidecarPath << std::endl;
+				continue;
+			}
+
+			std::cout << sidecarPath.string() << " " << content->size() << " -> " << encoded->size() << std::endl;
+		}
+	}
+}
+
+int main(int argc, char** argv) {
+	std::size_t minSize = DEFAULT_MIN_SIZE;
+	int processed = 0;
+
+	for (int i = 1; i < argc; i++) {
+		const std::string arg(argv[i]);
+
+		if (arg.starts_with("--min-size=")) {
+			minSize = std::stoul(arg.substr(std::strlen("--min-size=")));
+			continue;
+		}
+
+		std::error_code ec;
+
+		for (
+			auto it = fs::recursive_directory_iterator(arg, fs::directory_options::skip_permission_denied, ec);
+			!ec && it != fs::recursive_directory_iterator();
+			it.increment(ec)
+		) {
+			if (it->is_regular_file(ec) && tools::isCompressible(it->path())) {
+				precompress(it->path(), minSize);
+			}
+		}
+
+		if (ec) {
+			std::cerr << "precompress: " << arg << ": " << ec.message() << std::endl;
+			return 1;
+		}
+
+		processed++;
+	}
+
+	if (processed == 0) {
+		std::cerr << "Usage: " << argv[0] << " [--min-size=BYTES] <root>..." << std::endl;
+		return 1;
+	}
+
+	return 0;
+}